@@ -152,12 +152,11 @@ public:
 		MADNESS_ASSERT(bra_.size()==ket_.size());
 		vecfuncT bra = copy(world,bra_);
 		vecfuncT ket = copy(world,ket_);
-		real_function_3d density = real_factory_3d(world);
-		for(size_t i=0;i<bra.size();i++){
-			bra[i].refine();
-			ket[i].refine();
-			density += bra[i]*ket[i];
-		}
+		refine(world,bra,false);
+		refine(world,ket);
+		Tensor<double> occ(bra.size());
+		occ=1.0;
+		real_function_3d density = sum_products(world,occ,bra,ket);
 		if(use_nuclear_correlation_factor_){
 			if(debug)std::cout << "Making Density*R2" << std::endl;
 			density = density*R2;
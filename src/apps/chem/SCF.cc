@@ -40,6 +40,8 @@
 #include "SCF.h"
 #include <cmath>
 #include <madness/mra/qmprop.h>
+#include <madness/tensor/vmath.h>
+#include <madness/mra/function_expression.h>
 #include <chem/nemo.h>
 #include <chem/SCFOperators.h>
 #include <chem/TDA.h>
@@ -66,8 +68,7 @@ namespace madness {
     template<int NDIM>
     struct unaryexp {
         void operator()(const Key<NDIM>& key, Tensor<double_complex>& t) const {
-            //vzExp(t.size, t.ptr(), t.ptr());
-            UNARY_OPTIMIZED_ITERATOR(double_complex, t, *_p0 = exp(*_p0););
+            t=vexp(t);
         }
         template <typename Archive>
         void serialize(Archive& ar) {}
@@ -947,13 +948,12 @@ namespace madness {
                 else {
                     vnuc = potentialmanager->vnuclear();
                     vnuc = vnuc + gthpseudopotential->vlocalpot();}     
-                vlocal = vnuc + apply(*coulop, rho);
+                real_function_3d vcoul = apply(*coulop, rho);
                 END_TIMER(world, "guess Coulomb potn");
                 bool save = param.spin_restricted;
                 param.spin_restricted = true;
                 START_TIMER(world);
-                vlocal = vlocal + make_lda_potential(world, rho);
-                vlocal.truncate();
+                vlocal = evaluate(lazy(vnuc) + vcoul + make_lda_potential(world, rho));
                 END_TIMER(world, "guess lda potn");
                 param.spin_restricted = save;
             } else {
@@ -1168,16 +1168,11 @@ namespace madness {
     functionT SCF::make_density(World & world, const tensorT & occ,
                                 const vecfuncT & v) const {
         PROFILE_MEMBER_FUNC(SCF);
-        vecfuncT vsq = square(world, v);
-        compress(world, vsq);
-        functionT rho = factoryT(world);
-        rho.compress();
-        for (unsigned int i = 0; i < vsq.size(); ++i) {
-            if (occ[i]) rho.gaxpy(1.0, vsq[i], occ[i], false);
-        }
-        world.gop.fence();
-        vsq.clear();
-        return rho;
+        if (v.empty()) return factoryT(world);
+        // occ may hold more entries than there are orbitals
+        const long nmo = v.size();
+        functionT rho = sum_squares(world, tensorT(copy(occ(Slice(0, nmo - 1)))), v);
+        return rho.compress();
     }
     
     functionT SCF::make_density(World & world, const tensorT & occ,
@@ -1209,8 +1204,8 @@ namespace madness {
     std::vector<poperatorT> SCF::make_bsh_operators(World& world, const tensorT& evals) const {
         PROFILE_MEMBER_FUNC(SCF);
         int nmo = evals.dim(0);
-        std::vector < poperatorT > ops(nmo);
         double tol = FunctionDefaults < 3 > ::get_thresh();
+        tensorT mu(nmo);
         for (int i = 0; i < nmo; ++i) {
             double eps = evals(i);
             if (eps > 0) {
@@ -1219,10 +1214,14 @@ namespace madness {
                 }
                 eps = -0.1;
             }
-            
-            ops[i] = poperatorT(
-                                BSHOperatorPtr3D(world, sqrt(-2.0 * eps), param.lo, tol));
+            mu(i) = sqrt(-2.0 * eps);
         }
+
+        // operators are reused between iterations once the orbital energies
+        // agree on the tolerance grid of the cache
+        if (not bsh_cache) bsh_cache.reset(new BSHOperatorCache<3>(world));
+        std::vector < poperatorT > ops = bsh_cache->get(mu, param.lo, tol);
+        bsh_cache->print_stats();
         
         return ops;
     }
@@ -2103,28 +2102,9 @@ namespace madness {
         START_TIMER(world);
         double trantol = vtol / std::min(30.0, double(amo_new.size()));
         normalize(world, amo_new);
-        double maxq;
-        do {
-            tensorT Q = Q2(matrix_inner(world, amo_new, amo_new)); // Q3(matrix_inner(world, amo_new, amo_new))
-            maxq = 0.0;
-            for (int j=1; j<Q.dim(0); j++)
-                for (int i=0; i<j; i++)
-                    maxq = std::max(std::abs(Q(j,i)),maxq);
-            
-            //Q.screen(trantol); // ???? Is this really needed? Just for speed.
-
-            //make virt orthog to occ without changing occ states (is this correct?)
-            for (int j=nocc; j<Q.dim(0); ++j)
-                for (int i=0; i<nocc; ++i)
-                    Q(j,i)=0.0;
 
-            amo_new = transform(world, amo_new,
-                                Q, trantol, true);
-            truncate(world, amo_new);
-            if (world.rank() == 0) print("ORTHOG2a: maxq trantol", maxq, trantol);
-            //print(Q);
-
-        } while (maxq>0.01);
+        // Loewdin among the occupied orbitals, virtuals orthogonal to the occupied space
+        madness::orthonormalize(world, amo_new, "lowdin", nocc, trantol);
         normalize(world, amo_new);
 
         END_TIMER(world, "Orthonormalize");
@@ -2140,22 +2120,7 @@ namespace madness {
         START_TIMER(world);
         double trantol = vtol / std::min(30.0, double(amo.size()));
         normalize(world, amo_new);
-        double maxq;
-        do {
-            tensorT Q = Q2(matrix_inner(world, amo_new, amo_new)); // Q3(matrix_inner(world, amo_new, amo_new))
-            maxq = 0.0;
-            for (int j=1; j<Q.dim(0); j++)
-                for (int i=0; i<j; i++)
-                    maxq = std::max(std::abs(Q(j,i)),maxq);
-            
-            //Q.screen(trantol); // ???? Is this really needed?
-            amo_new = transform(world, amo_new,
-                                Q, trantol, true);
-            truncate(world, amo_new);
-            if (world.rank() == 0) print("ORTHOG2b: maxq trantol", maxq, trantol);
-            //print(Q);
-            
-        } while (maxq>0.01);
+        madness::orthonormalize(world, amo_new, "lowdin", 0, trantol);
         normalize(world, amo_new);
         END_TIMER(world, "Orthonormalize");
     }
@@ -3104,7 +3069,7 @@ namespace madness {
             std::string xc_alda= "LDA";
             xc.initialize(xc_alda, !param.spin_restricted, world);
 
-            real_function_3d fxc = multiop_values <double, xc_kernel_apply, 3> (xc_kernel_apply(xc, spin, XCfunctional::potential_rho), vf);
+            real_function_3d fxc = multiop_values_batched<double, xc_kernel_apply, 3> (xc_kernel_apply(xc, spin, XCfunctional::potential_rho), vf);
 
             // return to original xc
             xc.initialize(param.xc_data, !param.spin_restricted, world);
@@ -43,6 +43,7 @@
 //#define WORLD_INSTANTIATE_STATIC_TEMPLATES
 
 #include <madness/mra/mra.h>
+#include <madness/mra/operator_cache.h>
 
 #include <chem/molecule.h>
 #include <chem/molecularbasis.h>
@@ -126,13 +127,25 @@ namespace madness {
     private:
         const Molecule& molecule;
         const AtomicBasisSet& aobasis;
+        const SpatialIndex index;   ///< atoms with the range of their basis functions
     public:
         MolecularGuessDensityFunctor(const Molecule& molecule, const AtomicBasisSet& aobasis)
-            : molecule(molecule), aobasis(aobasis) {}
+            : molecule(molecule), aobasis(aobasis), index(aobasis.atom_index(molecule)) {}
         
         double operator()(const coordT& x) const {
             return aobasis.eval_guess_density(molecule, x[0], x[1], x[2]);
         }
+
+        /// no atom is within range of the box
+        bool screened(const coordT& c1, const coordT& c2) const {
+            return index.intersecting(c1,c2).empty();
+        }
+
+        bool supports_vectorized() const {return true;}
+
+        void operator()(const Vector<double*,3>& xvals, double* fvals, int npts) const {
+            aobasis.eval_guess_density(molecule, xvals, fvals, npts, index);
+        }
         
         std::vector<coordT> special_points() const {return molecule.get_all_coords_vec();}
     };
@@ -151,6 +164,23 @@ namespace madness {
             return aofunc(x[0], x[1], x[2]);
         }
         
+        /// the box is beyond the range of the basis function
+        bool screened(const coordT& c1, const coordT& c2) const {
+            const coordT center=aofunc.get_coords_vec();
+            double rsq=0.0;
+            for (int i=0; i<3; ++i) {
+                const double d=std::max(0.0,std::max(c1[i]-center[i],center[i]-c2[i]));
+                rsq+=d*d;
+            }
+            return rsq>aofunc.rangesq();
+        }
+
+        bool supports_vectorized() const {return true;}
+
+        void operator()(const Vector<double*,3>& xvals, double* fvals, int npts) const {
+            aofunc(npts, xvals[0], xvals[1], xvals[2], fvals);
+        }
+        
         std::vector<coordT> special_points() const {
             return std::vector<coordT>(1,aofunc.get_coords_vec());
         }
@@ -860,6 +890,7 @@ namespace madness {
         /// orbital energies for alpha and beta orbitals
         tensorT aeps, beps;
         poperatorT coulop;
+        mutable std::shared_ptr<BSHOperatorCache<3> > bsh_cache;  ///< BSH operators reused between iterations
         std::vector< std::shared_ptr<real_derivative_3d> > gradop;
         double vtol;
         double current_energy;
@@ -1014,7 +1045,7 @@ namespace madness {
         
         double make_dft_energy(World & world, const vecfuncT& vf, int ispin)
         {
-            functionT vlda = multiop_values<double, xc_functional, 3>(xc_functional(xc), vf);
+            functionT vlda = multiop_values_batched<double, xc_functional, 3>(xc_functional(xc), vf);
             return vlda.trace();
         }
         
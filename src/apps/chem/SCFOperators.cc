@@ -39,6 +39,7 @@
 #include <apps/chem/nemo.h>
 #include <apps/chem/correlationfactor.h>
 #include <apps/chem/xcfunctional.h>
+#include <apps/chem/pair_scheduler.h>
 
 using namespace madness;
 
@@ -165,14 +166,21 @@ Coulomb::Coulomb(World& world, const Nemo* nemo) : world(world),
 
 
 real_function_3d Coulomb::compute_density(const SCF* calc) const {
-    real_function_3d density = calc->make_density(world, calc->get_aocc(),
-            calc->get_amo());
+    real_function_3d density;
     if (calc->is_spin_restricted()) {
+        density = calc->make_density(world, calc->get_aocc(), calc->get_amo());
         density.scale(2.0);
     } else {
-        real_function_3d brho = calc->make_density(world, calc->get_bocc(),
-                calc->get_bmo());
-        density+=brho;
+        // accumulate alpha and beta orbitals in a single pass
+        const vecfuncT& amo=calc->get_amo();
+        const vecfuncT& bmo=calc->get_bmo();
+        const long na=amo.size(), nb=bmo.size();
+        vecfuncT mo(amo);
+        mo.insert(mo.end(),bmo.begin(),bmo.end());
+        Tensor<double> occ(na+nb);
+        if (na>0) occ(Slice(0,na-1))=calc->get_aocc()(Slice(0,na-1));
+        if (nb>0) occ(Slice(na,na+nb-1))=calc->get_bocc()(Slice(0,nb-1));
+        density = calc->make_density(world, occ, mo);
     }
     density.truncate();
     return density;
@@ -313,7 +321,8 @@ vecfuncT DNuclear::operator()(const vecfuncT& vket) const {
 
 
 Exchange::Exchange(World& world, const SCF* calc, const int ispin)
-        : world(world), small_memory_(true), same_(false) {
+        : world(world), small_memory_(true), same_(false)
+        , screened_(false), max_memory_(-1.0), screening_thresh_(-1.0) {
     if (ispin==0) { // alpha spin
         mo_ket=calc->amo;
         occ=calc->aocc;
@@ -327,7 +336,8 @@ Exchange::Exchange(World& world, const SCF* calc, const int ispin)
 }
 
 Exchange::Exchange(World& world, const Nemo* nemo, const int ispin)
-    : world(world), small_memory_(true), same_(false) {
+    : world(world), small_memory_(true), same_(false)
+    , screened_(false), max_memory_(-1.0), screening_thresh_(-1.0) {
 
     if (ispin==0) { // alpha spin
         mo_ket=nemo->get_calc()->amo;
@@ -369,7 +379,9 @@ vecfuncT Exchange::operator()(const vecfuncT& vket) const {
         norm_tree(world, vket);
     }
 
-    if (small_memory_) {     // Smaller memory algorithm ... possible 2x saving using i-j sym
+    if (screened_) {
+        screened_exchange(vket, Kf, tol);
+    } else if (small_memory_) {     // Smaller memory algorithm ... possible 2x saving using i-j sym
         for(int i=0; i<nocc; ++i){
             if(occ[i] > 0.0){
                 vecfuncT psif = mul_sparse(world, mo_bra[i], vket, tol); /// was vtol
@@ -428,6 +440,161 @@ vecfuncT Exchange::operator()(const vecfuncT& vket) const {
 
 }
 
+/// norms of functions in the boxes of a coarse level, and their sizes
+
+/// The functions must be reconstructed and have an up-to-date norm tree.
+/// Leaves above the level distribute their norm evenly over the boxes they
+/// contain. Collective.
+/// @param[in]  vf      the functions
+/// @param[in]  n       the level of the boxes
+/// @return     a tensor (vf.size(), 2^(3n)+1) with the box norms of each
+///             function, followed by the number of its coefficients
+static Tensor<double> box_norms(World& world, const vecfuncT& vf, const int n) {
+    typedef FunctionImpl<double,3>::dcT dcT;
+    const long nbox1=1l<<n;
+    const long nbox=nbox1*nbox1*nbox1;
+    Tensor<double> result(vf.size(),nbox+1);
+    for (std::size_t i=0; i<vf.size(); ++i) {
+        const dcT& coeffs=vf[i].get_impl()->get_coeffs();
+        for (dcT::const_iterator it=coeffs.begin(); it!=coeffs.end(); ++it) {
+            const Key<3>& key=it->first;
+            const FunctionNode<double,3>& node=it->second;
+            if (node.has_coeff()) result(i,nbox)+=node.coeff().size();
+            if (key.level()>n) continue;
+            if ((key.level()<n) and node.has_children()) continue;
+
+            // the block of boxes covered by this node gets the squared norm
+            const Vector<Translation,3>& l=key.translation();
+            const long nsub=1l<<(n-key.level());
+            const double norm=node.get_norm_tree();
+            const double norm2=norm*norm/double(nsub*nsub*nsub);
+            for (long i0=l[0]*nsub; i0<(l[0]+1)*nsub; ++i0) {
+                for (long i1=l[1]*nsub; i1<(l[1]+1)*nsub; ++i1) {
+                    for (long i2=l[2]*nsub; i2<(l[2]+1)*nsub; ++i2) {
+                        result(i,(i0*nbox1+i1)*nbox1+i2)+=norm2;
+                    }
+                }
+            }
+        }
+    }
+    world.gop.sum(result.ptr(),result.size());
+    for (std::size_t i=0; i<vf.size(); ++i) {
+        for (long b=0; b<nbox; ++b) result(i,b)=sqrt(result(i,b));
+    }
+    return result;
+}
+
+/// The pair densities bra_i ket_j are screened with the estimate
+/// sum_B ||bra_i||_B ||ket_j||_B over the boxes B of a coarse level, which
+/// bounds the L1 norm of the pair density and thereby its potential. For
+/// localized orbitals the number of surviving pairs grows linearly with the
+/// size of the molecule. The estimate is accumulated box by box over the
+/// functions that are significant in the box, so that the screening itself
+/// does not loop over all pairs.
+///
+/// The surviving pairs are processed in batches whose estimated working set
+/// fits into the memory cap; each batch applies the Poisson operator to all
+/// of its pair densities at once and accumulates its contributions to Kf.
+void Exchange::screened_exchange(const vecfuncT& vket, vecfuncT& Kf,
+        const double tol) const {
+    typedef std::pair<int,int> pairT;
+    const bool same = this->same();
+    const int nocc = mo_bra.size();
+    const int nf = vket.size();
+    const double thresh=(screening_thresh_<0.0) ? tol : screening_thresh_;
+
+    // box norms on level 4 (4096 boxes); boxes that are much smaller than
+    // the screening threshold are not considered in the estimate
+    const int level=4;
+    const long nbox=1l<<(3*level);
+    const Tensor<double> bra_norms=box_norms(world,mo_bra,level);
+    const Tensor<double> ket_norms=box_norms(world,vket,level);
+    const double box_thresh=1.e-3*thresh;
+
+    std::vector<std::vector<std::pair<int,double> > > bra_in_box(nbox), ket_in_box(nbox);
+    for (long b=0; b<nbox; ++b) {
+        for (int i=0; i<nocc; ++i) {
+            if (bra_norms(i,b)>box_thresh) bra_in_box[b].push_back(std::make_pair(i,bra_norms(i,b)));
+        }
+        for (int j=0; j<nf; ++j) {
+            if (ket_norms(j,b)>box_thresh) ket_in_box[b].push_back(std::make_pair(j,ket_norms(j,b)));
+        }
+    }
+
+    std::map<pairT,double> overlap;
+    for (long b=0; b<nbox; ++b) {
+        for (std::size_t ii=0; ii<bra_in_box[b].size(); ++ii) {
+            const int i=bra_in_box[b][ii].first;
+            for (std::size_t jj=0; jj<ket_in_box[b].size(); ++jj) {
+                const int j=ket_in_box[b][jj].first;
+                if (same and (j>i)) continue;
+                overlap[pairT(i,j)]+=bra_in_box[b][ii].second*ket_in_box[b][jj].second;
+            }
+        }
+    }
+
+    // the weight of pair (i,j) is the largest occupation it is multiplied with
+    std::vector<pairT> pairs;
+    for (std::map<pairT,double>::const_iterator it=overlap.begin(); it!=overlap.end(); ++it) {
+        const int i=it->first.first;
+        const int j=it->first.second;
+        double weight=occ[i];
+        if (same and (i!=j)) weight=std::max(weight,occ[j]);
+        if (weight*it->second>thresh) pairs.push_back(it->first);
+    }
+
+    // the pair density, its potential and the product with the orbital
+    // are assumed to be at most as large as the larger of the two factors
+    const double nproc=world.size();
+    auto estimate=[&](const pairT& ij) {
+        const double size=std::max(bra_norms(ij.first,nbox),ket_norms(ij.second,nbox));
+        return 3.0*sizeof(double)*size/nproc;
+    };
+
+    auto solve=[&](const std::vector<pairT>& batch) {
+        vecfuncT psif(batch.size());
+        for (std::size_t k=0; k<batch.size(); ++k) {
+            psif[k]=mul_sparse(mo_bra[batch[k].first], vket[batch[k].second], tol, false);
+        }
+        world.gop.fence();
+        truncate(world, psif);
+        psif = apply(world, *poisson.get(), psif);
+        truncate(world, psif, tol);
+        reconstruct(world, psif);
+        norm_tree(world, psif);
+
+        vecfuncT psipsif;
+        std::vector<int> target;
+        std::vector<double> weight;
+        for (std::size_t k=0; k<batch.size(); ++k) {
+            const int i=batch[k].first;
+            const int j=batch[k].second;
+            if (occ[i]>0.0) {
+                psipsif.push_back(mul_sparse(psif[k], mo_ket[i], tol, false));
+                target.push_back(j);
+                weight.push_back(occ[i]);
+            }
+            if (same and (i!=j) and (occ[j]>0.0)) {
+                psipsif.push_back(mul_sparse(psif[k], mo_ket[j], tol, false));
+                target.push_back(i);
+                weight.push_back(occ[j]);
+            }
+        }
+        world.gop.fence();
+        psif.clear();
+        compress(world, psipsif);
+        for (std::size_t k=0; k<psipsif.size(); ++k) {
+            Kf[target[k]].gaxpy(1.0, psipsif[k], weight[k], false);
+        }
+        world.gop.fence();
+    };
+
+    PairScheduler scheduler(world, std::max(pairs.size(),std::size_t(1)));
+    scheduler.set_max_memory(max_memory_);
+    scheduler.set_print(false);
+    scheduler.run(pairs, estimate, solve);
+}
+
 /// custom ctor with information about the XC functional
 XCOperator::XCOperator(World& world, std::string xc_data, const bool spin_polarized,
         const real_function_3d& arho, const real_function_3d& brho)
@@ -558,7 +725,7 @@ double XCOperator::compute_xc_energy() const {
     }
 
     refine_to_common_level(world,xc_args);
-    real_function_3d vlda=multiop_values<double, xc_functional, 3>
+    real_function_3d vlda=multiop_values_batched<double, xc_functional, 3>
             (xc_functional(*xc), xc_args);
     truncate(world,xc_args);
 
@@ -575,7 +742,7 @@ real_function_3d XCOperator::make_xc_potential() const {
     refine_to_common_level(world,xc_args);
 
     // LDA/GGA local part
-    real_function_3d dft_pot=multiop_values<double, xc_potential, 3>
+    real_function_3d dft_pot=multiop_values_batched<double, xc_potential, 3>
                 (xc_potential(*xc, ispin, XCfunctional::potential_rho), xc_args);
 //    save(dft_pot,"lda_pot");
 
@@ -600,7 +767,7 @@ real_function_3d XCOperator::make_xc_potential() const {
         if (not xc->is_spin_polarized()) {      // RHF case
             MADNESS_ASSERT(ispin==0);
             // get Vsigma_aa * rho (total density)
-            functionT vsigaa = multiop_values<double, xc_potential, 3>
+            functionT vsigaa = multiop_values_batched<double, xc_potential, 3>
                 (xc_potential(*xc, ispin, XCfunctional::potential_same_spin), xc_args); //.truncate();
 //            save(vsigaa,"vsigaa");
 
@@ -613,10 +780,10 @@ real_function_3d XCOperator::make_xc_potential() const {
         } else if (have_beta) {                                // UHF case
 
             // get Vsigma_aa*rho_a or Vsigma_bb*rho_b (spin density)
-            functionT vsig_same = multiop_values<double, xc_potential, 3>
+            functionT vsig_same = multiop_values_batched<double, xc_potential, 3>
                     (xc_potential(*xc, ispin, XCfunctional::potential_same_spin), xc_args); //.truncate();
             // get Vsigma_ab * rho_other (spin density)
-            functionT vsig_mix= multiop_values<double, xc_potential, 3>
+            functionT vsig_mix= multiop_values_batched<double, xc_potential, 3>
                     (xc_potential(*xc, ispin, XCfunctional::potential_mixed_spin), xc_args); //.truncate();
 
             vecfuncT zeta_same(3), zeta_other(3);
@@ -687,13 +854,13 @@ real_function_3d XCOperator::apply_xc_kernel(const real_function_3d& dens_pt) co
     // compute the various terms from the xc kernel
 
     // compute the local terms: second_{local}
-    real_function_3d result=multiop_values<double, xc_kernel_apply, 3>
+    real_function_3d result=multiop_values_batched<double, xc_kernel_apply, 3>
             (xc_kernel_apply(*xc, ispin, XCfunctional::kernel_second_local), xc_args);
 //    save(result,"local_apply");
 
     if (xc->is_gga()) {
         // compute the semilocal terms, second partial derivatives
-        real_function_3d semilocal2a=multiop_values<double, xc_kernel_apply, 3>
+        real_function_3d semilocal2a=multiop_values_batched<double, xc_kernel_apply, 3>
                 (xc_kernel_apply(*xc, ispin, XCfunctional::kernel_second_semilocal), xc_args);
         save(semilocal2a,"semilocal2a");
 
@@ -714,7 +881,7 @@ real_function_3d XCOperator::apply_xc_kernel(const real_function_3d& dens_pt) co
         }
 
         // compute the semilocal terms, first partial derivative
-        real_function_3d semilocal1a=multiop_values<double, xc_kernel_apply, 3>
+        real_function_3d semilocal1a=multiop_values_batched<double, xc_kernel_apply, 3>
                 (xc_kernel_apply(*xc, ispin, XCfunctional::kernel_first_semilocal), xc_args);
         real_function_3d semilocal1=binary_op(semilocal1a,rho,binary_munging(tol));
 //        real_function_3d semilocal1=semilocal1a;
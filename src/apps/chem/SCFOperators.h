@@ -332,7 +332,8 @@ class Exchange {
 public:
 
     /// default ctor
-    Exchange(World& world) : world(world), small_memory_(true), same_(false) {};
+    Exchange(World& world) : world(world), small_memory_(true), same_(false)
+            , screened_(false), max_memory_(-1.0), screening_thresh_(-1.0) {};
 
     /// ctor with a conventional calculation
     Exchange(World& world, const SCF* calc, const int ispin);
@@ -389,11 +390,50 @@ public:
         return *this;
     }
 
+    /// use the screened algorithm, which takes precedence over small_memory
+
+    /// Only orbital pairs (i,j) whose estimated overlap density is above the
+    /// screening threshold are computed, so that the cost grows linearly
+    /// with the size of the molecule for localized orbitals. The surviving
+    /// pairs are processed in batches that fit into the memory cap.
+    bool& screened() {return screened_;}
+    bool screened() const {return screened_;}
+    Exchange& screened(const bool flag) {
+        screened_=flag;
+        return *this;
+    }
+
+    /// memory cap for a batch of pairs in the screened algorithm in bytes per rank
+
+    /// negative: half of the free memory
+    double& max_memory() {return max_memory_;}
+    double max_memory() const {return max_memory_;}
+    Exchange& max_memory(const double bytes) {
+        max_memory_=bytes;
+        return *this;
+    }
+
+    /// threshold for the pair overlaps in the screened algorithm
+
+    /// negative: the truncation threshold of the functions
+    double& screening_thresh() {return screening_thresh_;}
+    double screening_thresh() const {return screening_thresh_;}
+    Exchange& screening_thresh(const double thresh) {
+        screening_thresh_=thresh;
+        return *this;
+    }
+
 private:
 
+    /// the screened algorithm; K is accumulated into Kf
+    void screened_exchange(const vecfuncT& vket, vecfuncT& Kf, const double tol) const;
+
     World& world;
     bool small_memory_;
     bool same_;
+    bool screened_;
+    double max_memory_;         ///< memory cap of the screened algorithm in bytes per rank
+    double screening_thresh_;   ///< threshold for the pair overlaps of the screened algorithm
     vecfuncT mo_bra, mo_ket;    ///< MOs for bra and ket
     Tensor<double> occ;
     std::shared_ptr<real_convolution_3d> poisson;
@@ -161,11 +161,10 @@ vecfuncT TDA_DFT::apply_kernel(const vecfuncT & x) const{
 	if(xcfunctional_.is_gga()) MADNESS_EXCEPTION("apply kernel function not useful with GGA, was for testing purposes only",1);
 
 	// make perturbed density (factor 2 is for closed shell)
-	real_function_3d perturbed_density=real_factory_3d(world);
-	for(size_t i=0;i<calc.amo.size();i++){
-		perturbed_density += calc.amo[i]*x[i];
-	}
-	perturbed_density.scale(2.0);
+	MADNESS_ASSERT(x.size()==calc.amo.size());
+	Tensor<double> occ(calc.amo.size());
+	occ=2.0;
+	real_function_3d perturbed_density=sum_products(world,occ,calc.amo,x);
 	// make a vector which containes as first entry the unperturbed and as last two entries one active orbital and the perturbed density
 	// everything in between can be used later for GGA
 	vecfuncT applied_kernel;
@@ -0,0 +1,236 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file chem/ewald.cc
+/// \brief Ewald summation of point charges in an orthorhombic periodic cell
+
+#include <chem/ewald.h>
+#include <madness/constants.h>
+#include <madness/misc/cfft.h>
+#include <madness/world/madness_exception.h>
+#include <algorithm>
+#include <cmath>
+
+namespace madness {
+
+namespace {
+    /// Orders vectors by length
+    struct shorter {
+        bool operator()(const Vector<double,3>& a, const Vector<double,3>& b) const {
+            return a.normf() < b.normf();
+        }
+    };
+
+    /// The smallest power of two that is at least n
+    unsigned int pow2(int n) {
+        unsigned int p = 1;
+        while (int(p) < n) p <<= 1;
+        return p;
+    }
+}
+
+EwaldSum::EwaldSum(const coordT& cell, const std::vector<coordT>& positions,
+                   const std::vector<double>& charges, double eps, double alpha)
+    : cell_(cell), positions_(positions), charges_(charges), alpha_(alpha) {
+    MADNESS_ASSERT(positions.size() == charges.size());
+    MADNESS_ASSERT(cell[0] > 0.0 && cell[1] > 0.0 && cell[2] > 0.0);
+    MADNESS_ASSERT(eps > 0.0 && eps < 1.0);
+    const double pi = constants::pi;
+    const long natom = positions.size();
+    volume_ = cell[0]*cell[1]*cell[2];
+
+    // balance the work in the two sums (Perram, Petersen and de Leeuw)
+    if (alpha_ <= 0.0) alpha_ = sqrt(pi)*std::pow(std::max(1.0,double(natom))/(volume_*volume_), 1.0/6.0);
+    const double logeps = sqrt(-log(eps));
+    rcut_ = logeps/alpha_;
+    gcut_ = 2.0*alpha_*logeps;
+
+    // the displacements are reduced to the nearest image, so the lattice
+    // vectors have to reach rcut from anywhere within half a cell diagonal
+    rvecs_ = lattice_vectors(cell_, rcut_ + 0.5*cell_.normf());
+
+    double Q = 0.0, Q2 = 0.0;
+    for (long i=0; i<natom; ++i) {
+        Q += charges_[i];
+        Q2 += charges_[i]*charges_[i];
+    }
+    background_ = -pi*Q/(volume_*alpha_*alpha_);
+
+    // reciprocal-space coefficients with per-axis phase tables of the charges
+    for (int d=0; d<3; ++d) nmax_[d] = int(gcut_*cell_[d]/(2.0*pi));
+    const long n0 = 2*nmax_[0]+1, n1 = 2*nmax_[1]+1, n2 = nmax_[2]+1;
+    coeff_ = Tensor<double_complex>(n0, n1, n2);
+    std::vector<double_complex> phase[3];
+    for (int d=0; d<3; ++d) {
+        phase[d].resize(natom*(nmax_[d]+1));
+        for (long j=0; j<natom; ++j) phases(positions_[j][d], cell_[d], nmax_[d], &phase[d][j*(nmax_[d]+1)]);
+    }
+    double erec = 0.0;
+    for (long i0=0; i0<n0; ++i0) {
+        const int m0 = i0-nmax_[0];
+        const double g0 = 2.0*pi*m0/cell_[0];
+        for (long i1=0; i1<n1; ++i1) {
+            const int m1 = i1-nmax_[1];
+            const double g1 = 2.0*pi*m1/cell_[1];
+            for (long i2=0; i2<n2; ++i2) {
+                const double g2 = 2.0*pi*i2/cell_[2];
+                const double G2 = g0*g0 + g1*g1 + g2*g2;
+                if (G2 == 0.0 || G2 > gcut_*gcut_) continue;
+                double_complex S(0.0,0.0);
+                for (long j=0; j<natom; ++j) {
+                    double_complex p0 = phase[0][j*(nmax_[0]+1) + std::abs(m0)];
+                    double_complex p1 = phase[1][j*(nmax_[1]+1) + std::abs(m1)];
+                    if (m0 < 0) p0 = std::conj(p0);
+                    if (m1 < 0) p1 = std::conj(p1);
+                    S += charges_[j]*p0*p1*phase[2][j*(nmax_[2]+1) + i2];
+                }
+                const double w = 4.0*pi/volume_*exp(-0.25*G2/(alpha_*alpha_))/G2;
+                // -n2 is the complex conjugate of n2
+                coeff_(i0,i1,i2) = (i2 ? 2.0 : 1.0)*w*std::conj(S);
+                erec += 0.5*(i2 ? 2.0 : 1.0)*w*std::norm(S);
+            }
+        }
+    }
+
+    double ereal = 0.0;
+    for (long i=0; i<natom; ++i) {
+        for (long j=0; j<natom; ++j) {
+            coordT d = positions_[i] - positions_[j];
+            for (int k=0; k<3; ++k) d[k] -= cell_[k]*std::floor(d[k]/cell_[k] + 0.5);
+            for (std::size_t r=0; r<rvecs_.size(); ++r) {
+                const double t = (d + rvecs_[r]).normf();
+                if (t == 0.0 || t > rcut_) continue;         // t == 0 is the charge itself
+                ereal += 0.5*charges_[i]*charges_[j]*erfc(alpha_*t)/t;
+            }
+        }
+    }
+
+    energy_ = ereal + erec - alpha_/sqrt(pi)*Q2 + 0.5*background_*Q;
+}
+
+void EwaldSum::phases(double x, double len, int nmax, double_complex* phase) {
+    const double theta = 2.0*constants::pi*x/len;
+    const double_complex p1(cos(theta), sin(theta));
+    phase[0] = 1.0;
+    for (int n=1; n<=nmax; ++n) {
+        // restart the recurrence every few steps to keep the phases accurate
+        phase[n] = (n%16) ? phase[n-1]*p1 : double_complex(cos(n*theta), sin(n*theta));
+    }
+}
+
+double EwaldSum::real_space_potential(const coordT& r) const {
+    double sum = 0.0;
+    for (std::size_t j=0; j<positions_.size(); ++j) {
+        coordT d = r - positions_[j];
+        for (int k=0; k<3; ++k) d[k] -= cell_[k]*std::floor(d[k]/cell_[k] + 0.5);
+        for (std::size_t i=0; i<rvecs_.size(); ++i) {
+            const double t = (d + rvecs_[i]).normf();
+            if (t < rcut_) sum += charges_[j]*erfc(alpha_*t)/t;
+        }
+    }
+    return sum;
+}
+
+double EwaldSum::reciprocal_potential(const coordT& r) const {
+    const long n0 = coeff_.dim(0), n1 = coeff_.dim(1), n2 = coeff_.dim(2);
+    std::vector<double_complex> p0(n0), p1(n1), p2(n2), tmp(std::max(nmax_[0],nmax_[1])+1);
+
+    // phase tables over -nmax..nmax for the first two axes
+    phases(r[0], cell_[0], nmax_[0], &tmp[0]);
+    for (int m=0; m<=nmax_[0]; ++m) p0[nmax_[0]+m] = tmp[m], p0[nmax_[0]-m] = std::conj(tmp[m]);
+    phases(r[1], cell_[1], nmax_[1], &tmp[0]);
+    for (int m=0; m<=nmax_[1]; ++m) p1[nmax_[1]+m] = tmp[m], p1[nmax_[1]-m] = std::conj(tmp[m]);
+    phases(r[2], cell_[2], nmax_[2], &p2[0]);
+
+    double_complex sum(0.0,0.0);
+    const double_complex* c = coeff_.ptr();
+    for (long i0=0; i0<n0; ++i0) {
+        double_complex s1(0.0,0.0);
+        for (long i1=0; i1<n1; ++i1, c+=n2) {
+            double_complex s2(0.0,0.0);
+            for (long i2=0; i2<n2; ++i2) s2 += c[i2]*p2[i2];
+            s1 += s2*p1[i1];
+        }
+        sum += s1*p0[i0];
+    }
+    return sum.real();
+}
+
+void EwaldSum::potential(const Vector<double*,3>& xvals, double* fvals, int npts) const {
+    for (int i=0; i<npts; ++i) {
+        const coordT r = {xvals[0][i], xvals[1][i], xvals[2][i]};
+        fvals[i] = potential(r);
+    }
+}
+
+Tensor<double> EwaldSum::reciprocal_potential_grid(int n) const {
+    long N[3];
+    for (int d=0; d<3; ++d) N[d] = long(pow2(std::max(n, 2*nmax_[d]+1)));
+    Tensor<double_complex> data(N[0], N[1], N[2]);
+    for (long i0=0; i0<coeff_.dim(0); ++i0) {
+        const long m0 = i0-nmax_[0];
+        for (long i1=0; i1<coeff_.dim(1); ++i1) {
+            const long m1 = i1-nmax_[1];
+            for (long i2=0; i2<coeff_.dim(2); ++i2) {
+                // the conjugate half was folded into the weight of n2 > 0
+                const double_complex c = coeff_(i0,i1,i2)*(i2 ? 0.5 : 1.0);
+                if (c == 0.0) continue;
+                data((m0+N[0])%N[0], (m1+N[1])%N[1], i2) += c;
+                if (i2) data((N[0]-m0)%N[0], (N[1]-m1)%N[1], N[2]-i2) += std::conj(c);
+            }
+        }
+    }
+    CFFT::Inverse3D(data.ptr(), N[0], N[1], N[2], false);
+    return real(data);
+}
+
+std::vector<EwaldSum::coordT> EwaldSum::lattice_vectors(const coordT& cell, double maxlen) {
+    int nmax[3];
+    for (int d=0; d<3; ++d) nmax[d] = int(std::ceil(maxlen/cell[d]));
+    std::vector<coordT> vecs;
+    for (int i=-nmax[0]; i<=nmax[0]; ++i) {
+        for (int j=-nmax[1]; j<=nmax[1]; ++j) {
+            for (int k=-nmax[2]; k<=nmax[2]; ++k) {
+                const coordT R = {i*cell[0], j*cell[1], k*cell[2]};
+                if (R.normf() <= maxlen) vecs.push_back(R);
+            }
+        }
+    }
+    std::sort(vecs.begin(), vecs.end(), shorter());
+    return vecs;
+}
+
+std::vector<EwaldSum::coordT> EwaldSum::reciprocal_lattice_vectors(const coordT& cell, double maxlen) {
+    const double twopi = 2.0*constants::pi;
+    return lattice_vectors(coordT{twopi/cell[0], twopi/cell[1], twopi/cell[2]}, maxlen);
+}
+
+}
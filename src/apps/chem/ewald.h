@@ -0,0 +1,157 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_CHEM_EWALD_H__INCLUDED
+#define MADNESS_CHEM_EWALD_H__INCLUDED
+
+/// \file chem/ewald.h
+/// \brief Ewald summation of point charges in an orthorhombic periodic cell
+
+#include <madness/mra/function_interface.h>
+#include <madness/tensor/tensor.h>
+#include <madness/world/vector.h>
+#include <complex>
+#include <memory>
+#include <vector>
+
+namespace madness {
+
+/// Ewald sum of the electrostatics of point charges in a periodic cell
+
+/// The cell is the box [0,a]x[0,b]x[0,c] repeated periodically.  The
+/// Coulomb sum is split by the convergence parameter alpha into a
+/// real-space part (erfc(alpha r)/r over the images within rcut) and a
+/// reciprocal-space part (the Fourier series over the G vectors within
+/// gcut); both cutoffs follow from the requested precision.  A charged
+/// cell is neutralized by a uniform background.
+///
+/// Everything that does not depend on the evaluation point is computed
+/// once in the constructor: the lattice vectors that can reach into the
+/// real-space cutoff, and the reciprocal-space coefficients
+/// 4pi/V exp(-G^2/(4 alpha^2))/G^2 conj(S(G)), with the structure factor
+/// S(G) formed from per-axis phase tables rather than one complex
+/// exponential per G vector and charge.  The reciprocal part at a point
+/// is then a trigonometric polynomial summed from per-axis phase tables
+/// as well, and on a regular grid it is a single inverse 3D FFT.
+class EwaldSum {
+public:
+    typedef Vector<double,3> coordT;
+
+    /// Set up the sum
+
+    /// @param[in] cell lengths a, b, c of the cell
+    /// @param[in] positions positions of the charges
+    /// @param[in] charges the charges
+    /// @param[in] eps relative precision of the real- and reciprocal-space sums
+    /// @param[in] alpha convergence parameter; chosen from the cell and the number of charges if <= 0
+    EwaldSum(const coordT& cell, const std::vector<coordT>& positions,
+             const std::vector<double>& charges, double eps=1e-12, double alpha=0.0);
+
+    /// The electrostatic energy per cell
+    double energy() const {return energy_;}
+
+    /// The electrostatic potential of all charges and their images at r
+    double potential(const coordT& r) const {
+        return real_space_potential(r) + reciprocal_potential(r) + background_;
+    }
+
+    /// The electrostatic potential at npts points given by their coordinates
+    void potential(const Vector<double*,3>& xvals, double* fvals, int npts) const;
+
+    /// The real-space part of the potential at r
+    double real_space_potential(const coordT& r) const;
+
+    /// The reciprocal-space part of the potential at r (without the background)
+    double reciprocal_potential(const coordT& r) const;
+
+    /// The reciprocal-space part of the potential on a regular grid
+
+    /// Point (i,j,k) of the returned tensor is (i a/n0, j b/n1, k c/n2), with
+    /// n0, n1 and n2 the smallest powers of two that are at least n and
+    /// that resolve all G vectors within the cutoff.
+    /// @param[in] n the requested number of grid points per axis
+    Tensor<double> reciprocal_potential_grid(int n) const;
+
+    /// The lattice vectors of the cell with length up to maxlen, sorted by length
+    static std::vector<coordT> lattice_vectors(const coordT& cell, double maxlen);
+
+    /// The reciprocal lattice vectors of the cell with length up to maxlen, sorted by length
+    static std::vector<coordT> reciprocal_lattice_vectors(const coordT& cell, double maxlen);
+
+    double alpha() const {return alpha_;}
+
+    double rcut() const {return rcut_;}
+
+    double gcut() const {return gcut_;}
+
+    /// The number of lattice vectors in the real-space sum
+    std::size_t nlattice() const {return rvecs_.size();}
+
+    /// The largest index of the G vectors along each axis
+    const Vector<int,3>& gmax() const {return nmax_;}
+
+private:
+    coordT cell_;
+    std::vector<coordT> positions_;
+    std::vector<double> charges_;
+    double volume_, alpha_, rcut_, gcut_, background_, energy_;
+    std::vector<coordT> rvecs_;             ///< lattice vectors that reach into rcut
+    Vector<int,3> nmax_;                    ///< G = 2pi (n0/a, n1/b, n2/c) with |n_i| <= nmax_[i]
+    Tensor<double_complex> coeff_;          ///< reciprocal coefficients for n2 >= 0, indexed by n+nmax
+
+    /// exp(i 2pi n x/len) for n=0..nmax into phase[0..nmax]
+    static void phases(double x, double len, int nmax, double_complex* phase);
+};
+
+/// The Ewald potential of point charges as a functor for the projection into a periodic Function
+class EwaldPotentialFunctor : public FunctionFunctorInterface<double,3> {
+    std::shared_ptr<EwaldSum> ewald;
+    std::vector<Vector<double,3> > special;
+
+public:
+    EwaldPotentialFunctor(const std::shared_ptr<EwaldSum>& ewald,
+                          const std::vector<Vector<double,3> >& positions)
+        : ewald(ewald), special(positions) {}
+
+    double operator()(const Vector<double,3>& r) const {return ewald->potential(r);}
+
+    bool supports_vectorized() const {return true;}
+
+    void operator()(const Vector<double*,3>& xvals, double* fvals, int npts) const {
+        ewald->potential(xvals, fvals, npts);
+    }
+
+    std::vector<Vector<double,3> > special_points() const {return special;}
+};
+
+}
+
+#endif // MADNESS_CHEM_EWALD_H__INCLUDED
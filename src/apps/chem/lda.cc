@@ -343,4 +343,34 @@ int c_uks_vwn5__(double *ra, double *rb, double * f, double *dfdra, double *dfdr
     return 0;
 } /* c_uks_vwn5__ */
 
+/* ----------------------------------------------------------------------- */
+/* Slater exchange plus VWN5 correlation on n points, closed shell */
+/* f and dfdra are the sums of the exchange and correlation contributions; */
+/* the loop has no branches and no calls across translation units, so the */
+/* compiler can inline the functionals and vectorize over the points. */
+void xc_rks_s_vwn5_batch(const long n, const double *r, double *f, double *dfdra) {
+    for (long i=0; i<n; ++i) {
+        double xf, xdf, cf, cdf;
+        x_rks_s__(r+i, &xf, &xdf);
+        c_rks_vwn5__(r+i, &cf, &cdf);
+        f[i] = xf + cf;
+        dfdra[i] = xdf + cdf;
+    }
+}
+
+/* ----------------------------------------------------------------------- */
+/* Slater exchange plus VWN5 correlation on n points, open shell */
+void xc_uks_s_vwn5_batch(const long n, const double *ra, const double *rb,
+        double *f, double *dfdra, double *dfdrb) {
+    for (long i=0; i<n; ++i) {
+        double a = ra[i], b = rb[i];
+        double xf, cf, xdf[2], cdf[2];
+        x_uks_s__(&a, &b, &xf, xdf, xdf+1);
+        c_uks_vwn5__(&a, &b, &cf, cdf, cdf+1);
+        f[i] = xf + cf;
+        dfdra[i] = xdf[0] + cdf[0];
+        dfdrb[i] = xdf[1] + cdf[1];
+    }
+}
+
 }
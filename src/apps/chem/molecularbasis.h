@@ -117,6 +117,55 @@ public:
     }
 
 
+    /// Evaluates the radial part of the contracted function on npts points
+    void eval_radial(const int npts, const double* rsq, double* R) const {
+        for (int p=0; p<npts; ++p) R[p] = 0.0;
+        for (unsigned int i=0; i<coeff.size(); ++i) {
+            const double c = coeff[i], a = expnt[i];
+            for (int p=0; p<npts; ++p) {
+                const double ersq = a*rsq[p];
+                R[p] += (ersq < 27.6) ? c*exp(-ersq) : 0.0;
+            }
+        }
+        for (int p=0; p<npts; ++p) R[p] = (rsq[p] > rsqmax) ? 0.0 : R[p];
+    }
+
+
+    /// Evaluates function ibf of the shell on npts points relative to the center
+    void eval(const int npts, const double* rsq, const double* x, const double* y,
+            const double* z, const int ibf, double* f) const {
+        // exponents of x, y, z in the order of the functions in eval() above
+        static const int powers[4][10][3] = {
+            {{0,0,0}},
+            {{1,0,0},{0,1,0},{0,0,1}},
+            {{2,0,0},{1,1,0},{1,0,1},{0,2,0},{0,1,1},{0,0,2}},
+            {{3,0,0},{2,1,0},{2,0,1},{1,2,0},{1,1,1},{1,0,2},{0,3,0},{0,2,1},{0,1,2},{0,0,3}}
+        };
+        if (type > 3) throw "UNKNOWN ANGULAR MOMENTUM";
+        MADNESS_ASSERT(ibf<numbf && ibf >= 0);
+        const int px = powers[type][ibf][0], py = powers[type][ibf][1], pz = powers[type][ibf][2];
+
+        eval_radial(npts, rsq, f);
+        for (int p=0; p<npts; ++p) {
+            double v = (fabs(f[p]) < 1e-12) ? 0.0 : f[p];
+            for (int k=0; k<px; ++k) v *= x[p];
+            for (int k=0; k<py; ++k) v *= y[p];
+            for (int k=0; k<pz; ++k) v *= z[p];
+            f[p] = v;
+        }
+    }
+
+
+    /// Evaluates the entire shell on npts points returning the incremented result pointer
+
+    /// The values are stored function by function, bf[ibf*npts+p]
+    double* eval(const int npts, const double* rsq, const double* x, const double* y,
+            const double* z, double* bf) const {
+        for (int i=0; i<numbf; ++i, bf+=npts) eval(npts, rsq, x, y, z, i, bf);
+        return bf;
+    }
+
+
     /// Evaluates the entire shell returning the incremented result pointer
     double* eval(double rsq, double x, double y, double z, double* bf) const {
         double R = eval_radial(rsq);
@@ -303,6 +352,34 @@ public:
         return sum;
     }
 
+    /// Evaluates the guess atomic density on npts points relative to the atomic center
+
+    /// The density is added to f[]
+    void eval_guess_density(const int npts, const double* x, const double* y,
+            const double* z, bool pspat, double* f) const {
+        MADNESS_ASSERT(has_guess_info());
+        std::vector<double> rsq(npts), bf(numbf*npts);
+        for (int p=0; p<npts; ++p) rsq[p] = x[p]*x[p] + y[p]*y[p] + z[p]*z[p];
+        double* b = &bf[0];
+        for (unsigned int i=0; i<g.size(); ++i) b = g[i].eval(npts, &rsq[0], x, y, z, b);
+
+        const double* d = pspat ? dmatpsp.ptr() : dmat.ptr();
+        for (int i=0; i<numbf; ++i) {
+            const double* bfi = &bf[i*npts];
+            for (int j=0; j<numbf; ++j) {
+                const double dij = d[i*numbf+j];
+                if (dij == 0.0) continue;
+                const double* bfj = &bf[j*npts];
+                for (int p=0; p<npts; ++p) f[p] += dij*bfi[p]*bfj[p];
+            }
+        }
+    }
+
+    /// Returns the square of the largest range of the shells on this center
+    double rangesq() const {
+        return rmaxsq;
+    }
+
     /// Return shell that contains basis function ibf and also return index of function in the shell
     const ContractedGaussianShell& get_shell_from_basis_function(int ibf, int& ibf_in_shell) const {
         int n=0;
@@ -421,6 +498,19 @@ public:
         return bf[ibf];
     }
 
+    /// evaluate on npts points
+    void operator()(const int npts, const double* x, const double* y, const double* z,
+            double* f) const {
+        std::vector<double> dx(npts), dy(npts), dz(npts), rsq(npts);
+        for (int p=0; p<npts; ++p) {
+            dx[p] = x[p]-xx;
+            dy[p] = y[p]-yy;
+            dz[p] = z[p]-zz;
+            rsq[p] = dx[p]*dx[p] + dy[p]*dy[p] + dz[p]*dz[p];
+        }
+        shell.eval(npts, &rsq[0], &dx[0], &dy[0], &dz[0], ibf, f);
+    }
+
     void print_me(std::ostream& s) const;
 
     const ContractedGaussianShell& get_shell() const {
@@ -594,6 +684,38 @@ public:
         return sum;
     }
 
+    /// spatial index over the atoms with the range of their basis functions
+    SpatialIndex atom_index(const Molecule& molecule) const {
+        std::vector<double> radii(molecule.natom());
+        for (int i=0; i<molecule.natom(); ++i) {
+            radii[i] = sqrt(ag[molecule.get_atom(i).atomic_number].rangesq());
+        }
+        return SpatialIndex(molecule.get_all_coords_vec(), radii);
+    }
+
+    /// Evaluates the guess density on npts points
+
+    /// Only the atoms of the index that are within range of the points are evaluated
+    void eval_guess_density(const Molecule& molecule, const Vector<double*,3>& xvals,
+            double* f, const int npts, const SpatialIndex& index) const {
+        for (int p=0; p<npts; ++p) f[p] = 0.0;
+        Vector<double,3> lo, hi;
+        SpatialIndex::bounding_box(xvals, npts, lo, hi);
+        const std::vector<int> near = index.intersecting(lo, hi);
+
+        std::vector<double> dx(npts), dy(npts), dz(npts);
+        for (std::size_t i=0; i<near.size(); ++i) {
+            const Atom& atom = molecule.get_atom(near[i]);
+            for (int p=0; p<npts; ++p) {
+                dx[p] = xvals[0][p]-atom.x;
+                dy[p] = xvals[1][p]-atom.y;
+                dz[p] = xvals[2][p]-atom.z;
+            }
+            ag[atom.atomic_number].eval_guess_density(npts, &dx[0], &dy[0], &dz[0],
+                    atom.pseudo_atom, f);
+        }
+    }
+
     bool is_supported(int atomic_number) const {
         return ag[atomic_number].nbf() > 0;
     }
@@ -773,6 +773,49 @@ double Molecule::nuclear_attraction_potential(double x, double y, double z) cons
     return sum;
 }
 
+SpatialIndex Molecule::nuclear_index() const {
+    // smoothed_potential(r) is 1/r for r>7, smoothed_density(r) is cut at r=6
+    std::vector<double> radii(atoms.size());
+    for (unsigned int i=0; i<atoms.size(); ++i) radii[i] = 7.0/rcut[i];
+    return SpatialIndex(get_all_coords_vec(), radii);
+}
+
+void Molecule::nuclear_attraction_potential(const Vector<double*,3>& xvals,
+        double* fvals, const int npts, const SpatialIndex& index) const {
+    const double* x = xvals[0];
+    const double* y = xvals[1];
+    const double* z = xvals[2];
+
+    // field contribution
+    for (int p=0; p<npts; ++p) fvals[p] = field[0] * x[p] + field[1] * y[p] + field[2] * z[p];
+
+    Vector<double,3> lo, hi;
+    SpatialIndex::bounding_box(xvals, npts, lo, hi);
+    const std::vector<int> near = index.intersecting(lo, hi);
+    std::vector<bool> is_near(atoms.size(), false);
+    for (unsigned int i=0; i<near.size(); ++i) is_near[near[i]] = true;
+
+    for (unsigned int i=0; i<atoms.size(); ++i) {
+        //make sure this isn't a pseudo-atom
+        if (atoms[i].pseudo_atom) continue;
+
+        const double ax = atoms[i].x, ay = atoms[i].y, az = atoms[i].z;
+        const double q = atoms[i].q, rc = rcut[i];
+        if (is_near[i]) {
+            for (int p=0; p<npts; ++p) {
+                double r = distance(ax, ay, az, x[p], y[p], z[p]);
+                fvals[p] -= q * smoothed_potential(r*rc)*rc;
+            }
+        } else {
+            // point charge; no branches, so that the loop vectorizes
+            for (int p=0; p<npts; ++p) {
+                const double dx = x[p]-ax, dy = y[p]-ay, dz = z[p]-az;
+                fvals[p] -= q / sqrt(dx*dx + dy*dy + dz*dz);
+            }
+        }
+    }
+}
+
 double Molecule::atomic_attraction_potential(int iatom, double x, double y,
         double z) const {
 
@@ -860,6 +903,28 @@ double Molecule::nuclear_charge_density(double x, double y, double z) const {
 }
 
 
+void Molecule::nuclear_charge_density(const Vector<double*,3>& xvals,
+        double* fvals, const int npts, const SpatialIndex& index) const {
+    static const double rpithreehalf = std::pow(madness::constants::pi, -1.5);
+    for (int p=0; p<npts; ++p) fvals[p] = 0.0;
+
+    Vector<double,3> lo, hi;
+    SpatialIndex::bounding_box(xvals, npts, lo, hi);
+    const std::vector<int> near = index.intersecting(lo, hi);
+    for (unsigned int i=0; i<near.size(); ++i) {
+        const Atom& atom = atoms[near[i]];
+        const double rc = rcut[near[i]];
+        const double fac = atom.q * rc*rc*rc * rpithreehalf;
+        for (int p=0; p<npts; ++p) {
+            const double dx = xvals[0][p]-atom.x, dy = xvals[1][p]-atom.y, dz = xvals[2][p]-atom.z;
+            const double rsq = (dx*dx + dy*dy + dz*dz)*rc*rc;
+            // smoothed_density(r) inlined
+            fvals[p] += (rsq < 36.0) ? fac * exp(-rsq)*(2.5 - rsq) : 0.0;
+        }
+    }
+}
+
+
 unsigned int Molecule::n_core_orb_all() const {
     int natom = atoms.size();
     unsigned int sum = 0;
@@ -37,6 +37,7 @@
 
 #include <chem/corepotential.h>
 #include <chem/atomutil.h>
+#include <chem/spatial_index.h>
 #include <madness/world/vector.h>
 #include <vector>
 #include <string>
@@ -259,6 +260,10 @@ public:
 
     double nuclear_charge_density(double x, double y, double z) const;
 
+    /// nuclear charge density on npts points; only atoms of the index within range are evaluated
+    void nuclear_charge_density(const Vector<double*,3>& xvals, double* fvals,
+            const int npts, const SpatialIndex& index) const;
+
     double mol_nuclear_charge_density(double x, double y, double z) const;
 
     double smallest_length_scale() const;
@@ -305,6 +310,19 @@ public:
     /// nuclear attraction potential for the whole molecule
     double nuclear_attraction_potential(double x, double y, double z) const;
 
+    /// nuclear attraction potential for the whole molecule on npts points
+
+    /// Atoms of the index whose smoothing range overlaps the points are
+    /// evaluated with the smoothed potential, all others as point charges
+    void nuclear_attraction_potential(const Vector<double*,3>& xvals, double* fvals,
+            const int npts, const SpatialIndex& index) const;
+
+    /// spatial index over the atoms with the range of their smoothed nuclei
+
+    /// Beyond this range the smoothed potential of an atom equals the point
+    /// charge potential and its smoothed charge density vanishes
+    SpatialIndex nuclear_index() const;
+
     /// nuclear attraction potential for a specific atom in the molecule
     double atomic_attraction_potential(int iatom, double x, double y, double z) const;
 
@@ -74,6 +74,26 @@ void load_balance(const real_function_6d& f, const bool leaf) {
 	FunctionDefaults<6>::redistribute(f.world(), lb.load_balance(2.0, false));
 }
 
+/// do some load-balancing for a set of functions
+
+/// all functions contribute to the same process map, which is computed and
+/// applied only once
+/// @param[in]	vf		the functions we want to distribute evenly
+/// @param[in]	leaf	if true: weigh leaf nodes only; if false: weigh internal nodes only
+void load_balance(const std::vector<real_function_6d>& vf, const bool leaf) {
+	if (vf.empty()) return;
+	World& world=vf.front().world();
+	LoadBalanceDeux<6> lb(world);
+	for (std::size_t i=0; i<vf.size(); ++i) {
+		if (leaf)
+			lb.add_tree(vf[i], LBCost(1.0, 0.1), false);
+		else
+			lb.add_tree(vf[i], LBCost(0.001, 1.0), false);
+	}
+	world.gop.fence();
+	FunctionDefaults<6>::redistribute(world, lb.load_balance(2.0, false));
+}
+
 /// ctor
 MP2::MP2(World& world, const std::string& input) : world(world),
 		param(input.c_str()), corrfac(world), correlation_energy(0.0),
@@ -219,14 +239,7 @@ double MP2::value(const Tensor<double>& x) {
 	// DEBUG END
 
 	// compute the 0th order term and do some coarse pre-iterations
-	for (int i = param.freeze; i < hf->nocc(); ++i) {
-		for (int j = i; j < hf->nocc(); ++j) {
-			pairs(i,j)=make_pair(i,j);				// initialize
-			solve_residual_equations(pairs(i,j),param.econv_*0.5,param.dconv_);
-			correlation_energy += pairs(i, j).e_singlet
-					+ pairs(i, j).e_triplet;
-		}
-	}
+	correlation_energy=solve_decoupled_pairs(param.econv_*0.5,param.dconv_,true);
 	if (world.rank()==0) {
 		printf("current decoupled mp2 energy %12.8f\n", correlation_energy);
 	}
@@ -239,13 +252,7 @@ double MP2::value(const Tensor<double>& x) {
 	} else {
 
 		// solve the canonical MP1 equations with increased accuracy
-		for (int i = param.freeze; i < hf->nocc(); ++i) {
-			for (int j = i; j < hf->nocc(); ++j) {
-				pairs(i,j).converged=false;
-				solve_residual_equations(pairs(i,j),param.econv_*0.05,param.dconv_);
-				correlation_energy += pairs(i, j).e_singlet + pairs(i, j).e_triplet;
-			}
-		}
+		correlation_energy=solve_decoupled_pairs(param.econv_*0.05,param.dconv_,false);
 	}
 	return correlation_energy;
 }
@@ -283,96 +290,213 @@ void MP2::print_info(World& world) const {
 		print_options(" correlated orbitals",ss1.str());
 
 		print_options("max KAIN subspace", param.maxsub);
+		print_options("max concurrent pairs", param.pair_batch);
+		print_options("pair memory fraction", param.pair_memory);
 	}
 }
 
 /// solve the residual equation for electron pair (i,j)
 void MP2::solve_residual_equations(ElectronPair& result,
 		const double econv, const double dconv) const {
+	solve_residual_equations(std::vector<ElectronPair*>(1,&result),econv,dconv);
+}
 
+/// solve the residual equations for a batch of decoupled electron pairs
+void MP2::solve_residual_equations(const std::vector<ElectronPair*>& batch,
+		const double econv, const double dconv) const {
 
-	if (result.converged) {
-		result.print_energy();
-		return;
+	std::vector<ElectronPair*> active;
+	for (std::size_t ip=0; ip<batch.size(); ++ip) {
+		if (batch[ip]->converged) batch[ip]->print_energy();
+		else active.push_back(batch[ip]);
 	}
+	if (active.empty()) return;
+	const std::size_t npair=active.size();
 
-	const int i=result.i;
-	const int j=result.j;
+	std::vector<double> energy(npair);
+	std::vector<std::shared_ptr<real_convolution_6d> > green(npair);
+	std::vector<std::shared_ptr<NonlinearSolverND<6> > > solver(npair);
 
-	if (world.rank() == 0) printf("\n\nsolving electron pair (%d, %d)\n\n", i, j);
-	guess_mp1_3(result);
-	result.store_pair(world);
+	for (std::size_t ip=0; ip<npair; ++ip) {
+		ElectronPair& result=*active[ip];
+		const int i=result.i;
+		const int j=result.j;
 
-	double energy = compute_energy(result);
-	if (world.rank() == 0)
-		printf("finished with prep step at time %6.1fs with energy %12.8f\n\n",
-				wall_time(), energy);
+		if (world.rank() == 0) printf("\n\nsolving electron pair (%d, %d)\n\n", i, j);
+		guess_mp1_3(result);
+		result.store_pair(world);
 
-	// the Green's function depends on the zeroth order energy, which is the sum
-	// of the orbital energies of orbitals i and j
-	//  -2.0 G = (T - e_i - e_j) ^ -1
-	const double eps = zeroth_order_energy(i, j);
-	if (world.rank()==0) print("eps in green:  ", eps);
-	real_convolution_6d green = BSHOperator<6>(world, sqrt(-2 * eps), lo,
-			bsh_eps);
-	if(world.rank() == 0) std::cout << "Constructed Green Operator is destructive ? :" << green.destructive() << std::endl;
+		energy[ip] = compute_energy(result);
+		if (world.rank() == 0)
+			printf("finished with prep step at time %6.1fs with energy %12.8f\n\n",
+					wall_time(), energy[ip]);
+
+		// the Green's function depends on the zeroth order energy, which is the sum
+		// of the orbital energies of orbitals i and j
+		//  -2.0 G = (T - e_i - e_j) ^ -1
+		const double eps = zeroth_order_energy(i, j);
+		if (world.rank()==0) print("eps in green:  ", eps);
+		green[ip].reset(new real_convolution_6d(BSHOperator<6>(world,
+				sqrt(-2 * eps), lo, bsh_eps)));
 
-	NonlinearSolverND<6> solver(param.maxsub);
-	solver.do_print = (world.rank() == 0);
-	// increment iteration counter upon entry
-	for (++result.iteration; result.iteration <= param.maxiter; ++result.iteration) {
+		solver[ip].reset(new NonlinearSolverND<6>(param.maxsub));
+		solver[ip]->do_print = (world.rank() == 0);
 
-		result.function.print_size("psi");
+		// increment iteration counter upon entry
+		++result.iteration;
+	}
 
-		// apply the convolution
-		real_function_6d vphi = multiply_with_0th_order_Hamiltonian(
-				result.function, i, j);
+	// the pairs that are still iterating
+	std::vector<std::size_t> running;
+	for (std::size_t ip=0; ip<npair; ++ip) {
+		if (active[ip]->iteration <= param.maxiter) running.push_back(ip);
+	}
 
-		vphi.print_size("Vpsi");
+	while (not running.empty()) {
+		const std::size_t nrun=running.size();
 
-		vphi.scale(-2.0).truncate();
+		std::vector<real_function_6d> function(nrun), constant_term(nrun);
+		for (std::size_t k=0; k<nrun; ++k) {
+			function[k]=active[running[k]]->function;
+			constant_term[k]=active[running[k]]->constant_term;
+			function[k].print_size("psi");
+		}
+
+		// apply the convolution
+		std::vector<real_function_6d> vphi(nrun);
+		for (std::size_t k=0; k<nrun; ++k) {
+			const ElectronPair& result=*active[running[k]];
+			vphi[k] = multiply_with_0th_order_Hamiltonian(function[k],
+					result.i, result.j);
+			vphi[k].print_size("Vpsi");
+			vphi[k].scale(-2.0);
+		}
+		truncate(world,vphi);
 		load_balance(vphi, false);
 
-		real_function_6d tmp = green(vphi);	// green is destructive
-		tmp.print_size("GV psi");
+		std::vector<real_function_6d> tmp(nrun);
+		for (std::size_t k=0; k<nrun; ++k) {
+			tmp[k] = (*green[running[k]])(vphi[k]);	// green is destructive
+			tmp[k].print_size("GV psi");
+		}
+		vphi.clear();
 
 		// we have to solve this equation:
 		// psi1 = psi0 + GVpsi1 <=> psi0 + GVpsi1 - psi1 = r =0
-		real_function_6d tmp1 = (result.constant_term + tmp).truncate();
-		tmp1.print_size("const + GVpsi");
-		tmp = Q12(tmp1);
-		tmp.print_size("Q12(const + GVpsi)");
-		//tmp = (Q12(result.constant_term + tmp)).truncate();
-
-		real_function_6d residual = result.function - tmp;
-		result.function = Q12(solver.update(tmp, residual));
-		const double rnorm = residual.norm2();
-		const double fnorm = result.function.norm2();
-		if (world.rank() == 0)
-			printf("norm2 of psi, residual %12.8f %12.8f\n", fnorm, rnorm);
+		std::vector<real_function_6d> tmp1=add(world,constant_term,tmp);
+		truncate(world,tmp1);
+		for (std::size_t k=0; k<nrun; ++k) {
+			tmp1[k].print_size("const + GVpsi");
+			tmp[k] = Q12(tmp1[k]);
+			tmp[k].print_size("Q12(const + GVpsi)");
+		}
+		tmp1.clear();
 
-		double old_energy = energy;
-		energy = compute_energy(result);
+		std::vector<real_function_6d> residual=sub(world,function,tmp);
+		for (std::size_t k=0; k<nrun; ++k) {
+			function[k] = Q12(solver[running[k]]->update(tmp[k], residual[k]));
+		}
+		const std::vector<double> rnorm=norm2s(world,residual);
+		const std::vector<double> fnorm=norm2s(world,function);
 
-		result.converged = ((std::abs(old_energy - energy) < econv) and (
-				rnorm < dconv));
-		result.store_pair(world);
+		std::vector<std::size_t> still_running;
+		for (std::size_t k=0; k<nrun; ++k) {
+			const std::size_t ip=running[k];
+			ElectronPair& result=*active[ip];
+			result.function=function[k];
 
-		if (world.rank() == 0)
-			printf("finished iteration %2d at time %8.1fs with energy %12.8f\n\n",
-					result.iteration, wall_time(), energy);
+			if (world.rank() == 0)
+				printf("norm2 of psi, residual %2d %2d %12.8f %12.8f\n",
+						result.i, result.j, fnorm[k], rnorm[k]);
 
-		if (result.converged)
-			break;
+			double old_energy = energy[ip];
+			energy[ip] = compute_energy(result);
+
+			result.converged = ((std::abs(old_energy - energy[ip]) < econv) and (
+					rnorm[k] < dconv));
+			result.store_pair(world);
+
+			if (world.rank() == 0)
+				printf("finished iteration %2d of pair %2d %2d at time %8.1fs with energy %12.8f\n\n",
+						result.iteration, result.i, result.j, wall_time(), energy[ip]);
+
+			if ((not result.converged) and (result.iteration < param.maxiter)) {
+				++result.iteration;
+				still_running.push_back(ip);
+			}
+		}
+		running.swap(still_running);
+	}
+
+	for (std::size_t ip=0; ip<npair; ++ip) {
+		const ElectronPair& result=*active[ip];
+
+		// save the converged first order pair function separately for easier access
+		std::string name = "pair_" + stringify(result.i) + stringify(result.j)
+				+ "_psi1_converged";
+		save_function(result.function, name);
+
+		// print the final pair energies
+		result.print_energy();
+	}
+}
+
+/// solve all decoupled pair equations, several pairs at a time
+double MP2::solve_decoupled_pairs(const double econv, const double dconv,
+		const bool initialize) {
 
+	typedef std::pair<int,int> keyT;
+	std::vector<keyT> keys;
+	for (int i = param.freeze; i < hf->nocc(); ++i) {
+		for (int j = i; j < hf->nocc(); ++j) {
+			keys.push_back(std::make_pair(i,j));
+		}
 	}
 
-	// save the converged first order pair function separately for easier access
-	std::string name = "pair_" + stringify(i) + stringify(j) + "_psi1_converged";
-	save_function(result.function, name);
+	// the largest pair seen so far serves as estimate for pairs that have
+	// not been constructed yet
+	double largest=-1.0;
+
+	PairScheduler scheduler(world,param.pair_batch,param.pair_memory);
+	scheduler.run(keys,
+		[&](const keyT& key) -> double {
+			const double e=pair_memory_estimate(pairs(key.first,key.second));
+			return (e<0.0) ? largest : e;
+		},
+		[&](const std::vector<keyT>& batch) {
+			std::vector<ElectronPair*> pp;
+			for (std::size_t ib=0; ib<batch.size(); ++ib) {
+				ElectronPair& pair=pairs(batch[ib].first,batch[ib].second);
+				if (initialize) pair=make_pair(batch[ib].first,batch[ib].second);
+				else pair.converged=false;
+				pp.push_back(&pair);
+			}
+			solve_residual_equations(pp,econv,dconv);
+			for (std::size_t ib=0; ib<pp.size(); ++ib) {
+				largest=std::max(largest,pair_memory_estimate(*pp[ib]));
+			}
+		});
+
+	double energy=0.0;
+	for (std::size_t ik=0; ik<keys.size(); ++ik) {
+		const ElectronPair& pair=pairs(keys[ik].first,keys[ik].second);
+		energy += pair.e_singlet + pair.e_triplet;
+	}
+	return energy;
+}
 
-	// print the final pair energies
-	result.print_energy();
+/// estimated working set of a pair during its solve in bytes per rank
+
+/// besides the pair function and the constant term the solver holds the
+/// potential, the Green's function applied to it, the residual and the KAIN
+/// subspace of maxsub iterates and residuals
+double MP2::pair_memory_estimate(const ElectronPair& pair) const {
+	if (not pair.function.is_initialized()) return -1.0;
+	std::size_t size=pair.function.size();
+	if (pair.constant_term.is_initialized())
+		size=std::max(size,pair.constant_term.size());
+	const double nfunction=5.0+2.0*param.maxsub;
+	return nfunction*sizeof(double)*double(size)/double(world.size());
 }
 
 /// solve the coupled MP1 equations for local orbitals
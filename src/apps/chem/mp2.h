@@ -48,6 +48,7 @@
 #include <chem/correlationfactor.h>
 #include <chem/electronic_correlation_factor.h>
 #include <chem/nemo.h>
+#include <chem/pair_scheduler.h>
 
 #include <iostream>
 
@@ -379,10 +380,16 @@ namespace madness {
         	/// maximum number of microiterations
         	int maxiter;
 
+        	/// maximum number of decoupled pairs that are solved concurrently
+        	int pair_batch;
+
+        	/// fraction of the free memory a batch of pairs may occupy
+        	double pair_memory;
+
         	/// ctor reading out the input file
         	Parameters(const std::string& input) : thresh_(-1.0), econv_(-1.0),
         	        dconv_(-1.0), i(-1), j(-1), freeze(0), restart(false),
-        	        maxsub(2), maxiter(20) {
+        	        maxsub(2), maxiter(20), pair_batch(4), pair_memory(0.5) {
 
         		// get the parameters from the input file
                 std::ifstream f(input.c_str());
@@ -398,6 +405,8 @@ namespace madness {
                     else if (s == "maxsub") f >> maxsub;
                     else if (s == "freeze") f >> freeze;
                     else if (s == "restart") restart=true;
+                    else if (s == "pair_batch") f >> pair_batch;
+                    else if (s == "pair_memory") f >> pair_memory;
                     else continue;
                 }
                 // set default for dconv if not explicitly given
@@ -411,6 +420,9 @@ namespace madness {
                 if (i>=hf->nocc()) MADNESS_EXCEPTION("there is no i-th orbital",1);
                 if (j>=hf->nocc()) MADNESS_EXCEPTION("there is no j-th orbital",1);
                 if (thresh_<0.0) MADNESS_EXCEPTION("please provide the accuracy threshold for MP2",1);
+                if (pair_batch<1) MADNESS_EXCEPTION("pair_batch must be at least 1",1);
+                if ((pair_memory<=0.0) or (pair_memory>1.0))
+                    MADNESS_EXCEPTION("pair_memory must be in (0,1]",1);
         	}
 
         };
@@ -502,6 +514,35 @@ namespace madness {
         void solve_residual_equations(ElectronPair& pair,
                 const double econv, const double dconv) const;
 
+        /// solve the residual equations for a batch of decoupled electron pairs
+
+        /// the pairs are iterated in lock-step, such that the operations of
+        /// all pairs of the batch are issued before the world is fenced and
+        /// the intermediates of all pairs are load-balanced together.
+        /// Every pair keeps its own KAIN solver and convergence criterion.
+        /// @param[inout]   batch   the electron pairs to solve
+        /// @param[in]      econv   energy convergence criterion (for a single pair)
+        /// @param[in]      dconv   density convergence criterion (for a single pair)
+        void solve_residual_equations(const std::vector<ElectronPair*>& batch,
+                const double econv, const double dconv) const;
+
+        /// solve all decoupled pair equations, several pairs at a time
+
+        /// the pairs are admitted to a batch by the PairScheduler according to
+        /// their estimated memory footprint and the free memory
+        /// @param[in]  econv       energy convergence criterion (for a single pair)
+        /// @param[in]  dconv       density convergence criterion (for a single pair)
+        /// @param[in]  initialize  if true construct the pairs, otherwise
+        ///                         continue from the current pair functions
+        /// @return the sum of the pair energies
+        double solve_decoupled_pairs(const double econv, const double dconv,
+                const bool initialize);
+
+        /// estimated working set of a pair during its solve in bytes per rank
+
+        /// @return the estimate or a negative number if the pair is not yet known
+        double pair_memory_estimate(const ElectronPair& pair) const;
+
         /// solve the coupled MP1 equations (e.g. for local orbitals)
 
         /// @param[in]  pairs   set of (coupled) electron pairs to solve
@@ -540,21 +540,8 @@ void Nemo::orthonormalize(vecfuncT& nemo) const {
     PROFILE_MEMBER_FUNC(SCF);
     START_TIMER(world);
     normalize(nemo);
-    double maxq;
-    do {
-        vecfuncT R2nemo=mul(world,R_square,nemo);
-        tensorT Q = Q2(matrix_inner(world, R2nemo, nemo));
-        maxq=0.0;
-        for (int i=0; i<Q.dim(0); ++i)
-            for (int j=0; j<i; ++j)
-                maxq = std::max(maxq,std::abs(Q(i,j)));
-
-        Q.screen(trantol()); // ???? Is this really needed?
-        nemo = transform(world, nemo, Q, trantol(), true);
-        truncate(world, nemo);
-        if (world.rank() == 0) print("ORTHOG2: maxq trantol", maxq, trantol());
-
-    } while (maxq>0.01);
+    vecfuncT R2nemo=mul(world,R_square,nemo);
+    madness::orthonormalize(world, nemo, R2nemo, "lowdin", 0, trantol());
     normalize(nemo);
     END_TIMER(world, "Orthonormalize");
 }
@@ -580,15 +567,11 @@ real_function_3d Nemo::make_density(const tensorT & occ,
         if (&bra!=&ket) refine(world,ket,true);
     }
 
-    vecfuncT vsq = mul(world, bra, ket);
-    compress(world, vsq);
-    functionT rho = factoryT(world).compressed();
-    for (unsigned int i = 0; i < vsq.size(); ++i) {
-        if (calc->get_aocc()[i])
-            rho.gaxpy(1.0, vsq[i], calc->get_aocc()[i], false);
-    }
-    world.gop.fence();
-    return rho;
+    if (bra.empty()) return factoryT(world).compressed();
+    const long nmo = bra.size();
+    functionT rho = sum_products(world, tensorT(copy(occ(Slice(0, nmo - 1)))),
+            bra, ket);
+    return rho.compress();
 }
 
 
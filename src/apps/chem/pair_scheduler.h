@@ -0,0 +1,193 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/*!
+  \file pair_scheduler.h
+  \brief Admission control for solving several electron pairs at once
+  \ingroup chem
+
+  The pair equations of MP2 and CC2 are independent of each other (or only
+  weakly coupled), but each 6D pair function is large. The PairScheduler
+  groups the pairs into batches that are solved concurrently on the same
+  World, such that the estimated working set of a batch fits into the memory
+  that is currently free on every rank. Solving several pairs together allows
+  the solvers to issue their operations without intermediate fences and to
+  load balance all pairs of a batch at once.
+*/
+
+#ifndef MADNESS_CHEM_PAIR_SCHEDULER_H__INCLUDED
+#define MADNESS_CHEM_PAIR_SCHEDULER_H__INCLUDED
+
+#include <madness/world/MADworld.h>
+#include <madness/world/worldmem.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <vector>
+
+namespace madness {
+
+    /// Groups electron pairs into memory-bounded batches
+
+    /// The scheduler is agnostic of the pair type: it works on a list of keys
+    /// (e.g. std::pair<int,int>), asks an estimator for the memory a key will
+    /// occupy while it is being solved, and hands batches of keys to a solver.
+    /// The memory budget is re-evaluated before each batch is admitted, so
+    /// that pairs that grew during the solve are accounted for.
+    ///
+    /// All decisions are based on globally reduced quantities, so that every
+    /// rank builds identical batches.
+    class PairScheduler {
+        World& world;
+        std::size_t max_concurrent_;    ///< maximum number of pairs in a batch
+        double memory_fraction_;        ///< fraction of the free memory a batch may use
+        double max_memory_;             ///< cap on the memory of a batch in bytes per rank; negative: none
+        bool do_print;
+
+    public:
+
+        /// ctor
+
+        /// @param[in]  world           the world
+        /// @param[in]  max_concurrent  maximum number of pairs solved at the same time
+        /// @param[in]  memory_fraction fraction of the free memory a batch may occupy
+        PairScheduler(World& world, const std::size_t max_concurrent=4,
+                const double memory_fraction=0.5)
+            : world(world)
+            , max_concurrent_(std::max(max_concurrent,std::size_t(1)))
+            , memory_fraction_(memory_fraction)
+            , max_memory_(-1.0)
+            , do_print(world.rank()==0) {
+        }
+
+        std::size_t get_max_concurrent() const {return max_concurrent_;}
+
+        double get_memory_fraction() const {return memory_fraction_;}
+
+        double get_max_memory() const {return max_memory_;}
+
+        /// cap the memory of a batch in bytes per rank, independent of the free memory; negative: no cap
+        void set_max_memory(const double max_memory) {max_memory_=max_memory;}
+
+        void set_print(const bool print) {do_print=print and (world.rank()==0);}
+
+        /// return the memory in bytes that is free on this process, or -1 if unknown
+
+        /// If the memory statistics are gathered and a limit is set in
+        /// WorldMemInfo the difference to the limit is returned, otherwise
+        /// the free physical memory as reported by the operating system.
+        static double free_memory() {
+#ifdef WORLD_GATHER_MEM_STATS
+            const WorldMemInfo* mi=world_mem_info();
+            if (mi->max_mem_limit!=ULONG_MAX) {
+                if (mi->max_mem_limit<mi->cur_num_bytes) return 0.0;
+                return double(mi->max_mem_limit-mi->cur_num_bytes);
+            }
+#endif
+#if defined(_SC_AVPHYS_PAGES)
+            const long npage=sysconf(_SC_AVPHYS_PAGES);
+            const long pagesize=sysconf(_SC_PAGESIZE);
+            if ((npage>0) and (pagesize>0)) return double(npage)*double(pagesize);
+#endif
+            return -1.0;
+        }
+
+        /// return the memory budget in bytes for the next batch on every rank
+
+        /// the budget is the minimum free memory over all ranks times the
+        /// memory fraction, limited by the memory cap; collective; returns -1
+        /// if neither the free memory nor the cap is known
+        double memory_budget() const {
+            double mem=free_memory();
+            world.gop.min(mem);
+            if (mem<0.0) return max_memory_;
+            if (max_memory_<0.0) return memory_fraction_*mem;
+            return std::min(max_memory_,memory_fraction_*mem);
+        }
+
+        /// form the next batch from the front of the pending keys
+
+        /// The first pending key is always admitted, so that progress is
+        /// guaranteed even if a single pair exceeds the budget. Further keys
+        /// are admitted in order as long as their estimates are known (i.e.
+        /// non-negative) and fit into the budget. Collective.
+        /// @param[inout]   pending     keys not yet solved; admitted keys are removed
+        /// @param[in]      estimate    estimate(key) returns the working set of
+        ///                             a key in bytes per rank, or a negative
+        ///                             number if unknown
+        /// @return the admitted keys
+        template<typename keyT, typename estimateT>
+        std::vector<keyT> admit(std::deque<keyT>& pending, const estimateT& estimate) const {
+            std::vector<keyT> batch;
+            if (pending.empty()) return batch;
+
+            const double budget=memory_budget();
+            double used=estimate(pending.front());
+            batch.push_back(pending.front());
+            pending.pop_front();
+            if (used<0.0) return batch;
+
+            while ((not pending.empty()) and (batch.size()<max_concurrent_)) {
+                const double e=estimate(pending.front());
+                if (e<0.0) break;
+                if ((budget>=0.0) and (used+e>budget)) break;
+                used+=e;
+                batch.push_back(pending.front());
+                pending.pop_front();
+            }
+
+            if (do_print) {
+                printf("pair scheduler: admitted %2lu pair(s), estimated %10.3f GByte, budget %10.3f GByte\n",
+                        (unsigned long)(batch.size()),used/1.e9,budget/1.e9);
+            }
+            return batch;
+        }
+
+        /// solve all keys batch by batch
+
+        /// @param[in]  keys        the keys to solve, in the order of admission
+        /// @param[in]  estimate    estimate(key) returns the working set in bytes per rank
+        /// @param[in]  solve       solve(std::vector<keyT>) solves a batch; collective
+        template<typename keyT, typename estimateT, typename solveT>
+        void run(const std::vector<keyT>& keys, const estimateT& estimate,
+                const solveT& solve) const {
+            std::deque<keyT> pending(keys.begin(),keys.end());
+            while (not pending.empty()) {
+                const std::vector<keyT> batch=admit(pending,estimate);
+                solve(batch);
+            }
+        }
+    };
+
+}
+
+#endif // MADNESS_CHEM_PAIR_SCHEDULER_H__INCLUDED
@@ -53,14 +53,21 @@ namespace madness {
 class MolecularPotentialFunctor : public FunctionFunctorInterface<double,3> {
 private:
     const Molecule& molecule;
+    const SpatialIndex index;   ///< atoms with the range of their smoothed nuclei
 public:
     MolecularPotentialFunctor(const Molecule& molecule)
-        : molecule(molecule) {}
+        : molecule(molecule), index(molecule.nuclear_index()) {}
 
     double operator()(const coord_3d& x) const {
         return molecule.nuclear_attraction_potential(x[0], x[1], x[2]);
     }
 
+    bool supports_vectorized() const {return true;}
+
+    void operator()(const Vector<double*,3>& xvals, double* fvals, int npts) const {
+        molecule.nuclear_attraction_potential(xvals, fvals, npts, index);
+    }
+
     std::vector<coord_3d> special_points() const {return molecule.get_all_coords_vec();}
 };
 
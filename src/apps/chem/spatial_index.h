@@ -0,0 +1,184 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_CHEM_SPATIAL_INDEX_H__INCLUDED
+#define MADNESS_CHEM_SPATIAL_INDEX_H__INCLUDED
+
+/// \file chem/spatial_index.h
+/// \brief Cell list of spheres for range queries on atoms and basis functions
+
+#include <madness/world/madness_exception.h>
+#include <madness/world/vector.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace madness {
+
+/// Cell list over spheres (atoms, shells) with a finite range
+
+/// The spheres are sorted into a uniform grid of cubic cells; a sphere is
+/// stored in every cell its bounding cube overlaps. A query for a box then
+/// only inspects the cells overlapping the box, so that the contributors to
+/// a box of quadrature points are found in O(1) for a fixed range instead
+/// of O(N_atoms). Spheres with negative radius have infinite range and are
+/// returned by every query.
+class SpatialIndex {
+public:
+    typedef Vector<double,3> coordT;
+
+private:
+    typedef std::tuple<long,long,long> cellT;
+
+    std::vector<coordT> centers;
+    std::vector<double> radii;
+    std::vector<int> infinite;              ///< spheres of infinite range
+    std::map<cellT, std::vector<int> > cells;
+    double h;                               ///< edge length of a cell
+
+    long cell_index(const double x) const {return long(std::floor(x/h));}
+
+    /// squared distance between a point and a box
+    static double distance_sq(const coordT& c, const coordT& lo, const coordT& hi) {
+        double d2=0.0;
+        for (int i=0; i<3; ++i) {
+            const double d=std::max(0.0,std::max(lo[i]-c[i],c[i]-hi[i]));
+            d2+=d*d;
+        }
+        return d2;
+    }
+
+public:
+
+    SpatialIndex() : h(1.0) {}
+
+    /// ctor
+
+    /// @param[in]  centers     the centers of the spheres
+    /// @param[in]  radii       their radii, negative for infinite range
+    /// @param[in]  cellsize    edge length of a cell; default: the largest finite radius
+    SpatialIndex(const std::vector<coordT>& centers, const std::vector<double>& radii,
+            const double cellsize=-1.0)
+        : centers(centers), radii(radii), h(cellsize) {
+        MADNESS_ASSERT(centers.size()==radii.size());
+        if (h<=0.0) {
+            h=0.0;
+            for (std::size_t i=0; i<radii.size(); ++i) h=std::max(h,radii[i]);
+            if (h<=0.0) h=1.0;
+        }
+        for (std::size_t i=0; i<centers.size(); ++i) {
+            if (radii[i]<0.0) {
+                infinite.push_back(i);
+                continue;
+            }
+            const coordT& c=centers[i];
+            const double r=radii[i];
+            for (long i0=cell_index(c[0]-r); i0<=cell_index(c[0]+r); ++i0) {
+                for (long i1=cell_index(c[1]-r); i1<=cell_index(c[1]+r); ++i1) {
+                    for (long i2=cell_index(c[2]-r); i2<=cell_index(c[2]+r); ++i2) {
+                        cells[cellT(i0,i1,i2)].push_back(i);
+                    }
+                }
+            }
+        }
+    }
+
+    /// number of spheres in the index
+    std::size_t size() const {return centers.size();}
+
+    /// return the sorted indices of the spheres that intersect the box [lo,hi]
+    std::vector<int> intersecting(const coordT& lo, const coordT& hi) const {
+        std::vector<int> candidates(infinite);
+        const long l0=cell_index(lo[0]), l1=cell_index(lo[1]), l2=cell_index(lo[2]);
+        const long h0=cell_index(hi[0]), h1=cell_index(hi[1]), h2=cell_index(hi[2]);
+        const double ncell=double(h0-l0+1)*double(h1-l1+1)*double(h2-l2+1);
+
+        if (ncell<double(cells.size())) {
+            for (long i0=l0; i0<=h0; ++i0) {
+                for (long i1=l1; i1<=h1; ++i1) {
+                    for (long i2=l2; i2<=h2; ++i2) {
+                        std::map<cellT, std::vector<int> >::const_iterator it=cells.find(cellT(i0,i1,i2));
+                        if (it!=cells.end()) {
+                            candidates.insert(candidates.end(),it->second.begin(),it->second.end());
+                        }
+                    }
+                }
+            }
+        } else {
+            // large boxes: scan the occupied cells instead
+            std::map<cellT, std::vector<int> >::const_iterator it;
+            for (it=cells.begin(); it!=cells.end(); ++it) {
+                const cellT& c=it->first;
+                if ((std::get<0>(c)<l0) or (std::get<0>(c)>h0)) continue;
+                if ((std::get<1>(c)<l1) or (std::get<1>(c)>h1)) continue;
+                if ((std::get<2>(c)<l2) or (std::get<2>(c)>h2)) continue;
+                candidates.insert(candidates.end(),it->second.begin(),it->second.end());
+            }
+        }
+        std::sort(candidates.begin(),candidates.end());
+        candidates.erase(std::unique(candidates.begin(),candidates.end()),candidates.end());
+
+        std::vector<int> result;
+        for (std::size_t i=0; i<candidates.size(); ++i) {
+            const int j=candidates[i];
+            if ((radii[j]<0.0) or (distance_sq(centers[j],lo,hi)<=radii[j]*radii[j])) {
+                result.push_back(j);
+            }
+        }
+        return result;
+    }
+
+    /// return the sorted indices of the spheres that contain the point x
+    std::vector<int> containing(const coordT& x) const {
+        return intersecting(x,x);
+    }
+
+    /// the bounding box of a set of points
+    static void bounding_box(const Vector<double*,3>& xvals, const int npts,
+            coordT& lo, coordT& hi) {
+        for (int d=0; d<3; ++d) {
+            const double* x=xvals[d];
+            double xlo=x[0], xhi=x[0];
+            for (int i=1; i<npts; ++i) {
+                xlo=std::min(xlo,x[i]);
+                xhi=std::max(xhi,x[i]);
+            }
+            lo[d]=xlo;
+            hi[d]=xhi;
+        }
+    }
+};
+
+}
+
+#endif // MADNESS_CHEM_SPATIAL_INDEX_H__INCLUDED
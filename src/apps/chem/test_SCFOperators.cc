@@ -434,6 +434,14 @@ int test_exchange(World& world) {
     success=test_asymmetric<Exchange,3>(world, K, thresh);
     if (success>0) return 1;
 
+    // the screened algorithm with one pair per batch
+    K.screened(true).max_memory(1.0);
+    success=exchange_anchor_test(world, K, thresh);
+    if (success>0) return 1;
+
+    success=test_hermiticity<Exchange,3>(world, K, thresh);
+    if (success>0) return 1;
+
     return 0;
 }
 
@@ -534,6 +542,72 @@ int test_nuclear(World& world) {
     return ierr;
 }
 
+/// compare the vectorized and screened functors on a molecule to the pointwise ones
+int test_spatial_index(World& world) {
+
+    if (world.rank()==0) print("\nentering test_spatial_index");
+    Molecule molecule;
+    for (int i=0; i<4; ++i) {
+        for (int j=0; j<3; ++j) molecule.add_atom(2.0*i-3.0,2.5*j-2.5,0.3*i,1.0,1);
+    }
+    molecule.add_atom(0.0,0.0,4.0,8.0,8);
+    molecule.set_eprec(1.e-4);
+    AtomicBasisSet aobasis;
+    aobasis.read_file("sto-3g");
+
+    const SpatialIndex nuclei=molecule.nuclear_index();
+    MolecularPotentialFunctor vnuc(molecule);
+    MolecularGuessDensityFunctor guess(molecule,aobasis);
+    AtomicBasisFunctor ao(aobasis.get_atomic_basis_function(molecule,aobasis.nbf(molecule)-2));
+
+    // boxes of quadrature points of different sizes at different places
+    const int n=4, npts=n*n*n;
+    double err=0.0;
+    for (int ibox=0; ibox<60; ++ibox) {
+        const double width=(ibox%3==0) ? 10.0 : ((ibox%3==1) ? 1.0 : 0.05);
+        const coord_3d lo{-9.0+0.3*ibox, -6.0+0.2*ibox, 5.0-0.15*ibox};
+        std::vector<double> x(npts), y(npts), z(npts), f(npts);
+        for (int p=0; p<npts; ++p) {
+            x[p]=lo[0]+width*(p/(n*n))/(n-1);
+            y[p]=lo[1]+width*((p/n)%n)/(n-1);
+            z[p]=lo[2]+width*(p%n)/(n-1);
+        }
+        const Vector<double*,3> xvals{&x[0],&y[0],&z[0]};
+        const coord_3d c1{x[0],y[0],z[0]}, c2{x[npts-1],y[npts-1],z[npts-1]};
+
+        vnuc(xvals,&f[0],npts);
+        for (int p=0; p<npts; ++p) {
+            const coord_3d r{x[p],y[p],z[p]};
+            err=std::max(err,std::abs(f[p]-vnuc(r))/std::max(1.0,std::abs(vnuc(r))));
+        }
+
+        molecule.nuclear_charge_density(xvals,&f[0],npts,nuclei);
+        for (int p=0; p<npts; ++p) {
+            const double ref=molecule.nuclear_charge_density(x[p],y[p],z[p]);
+            err=std::max(err,std::abs(f[p]-ref)/std::max(1.0,std::abs(ref)));
+        }
+
+        guess(xvals,&f[0],npts);
+        const bool guess_screened=guess.screened(c1,c2);
+        for (int p=0; p<npts; ++p) {
+            const coord_3d r{x[p],y[p],z[p]};
+            err=std::max(err,std::abs(f[p]-guess(r)));
+            if (guess_screened) err=std::max(err,std::abs(guess(r)));
+        }
+
+        ao(xvals,&f[0],npts);
+        const bool ao_screened=ao.screened(c1,c2);
+        for (int p=0; p<npts; ++p) {
+            const coord_3d r{x[p],y[p],z[p]};
+            err=std::max(err,std::abs(f[p]-ao(r)));
+            if (ao_screened) err=std::max(err,std::abs(ao(r)));
+        }
+    }
+    print("largest deviation of the vectorized functors",err);
+    if (check_err(err,1.e-12,"vectorized functors")) return 1;
+    return 0;
+}
+
 int dnuclear_anchor_test(World& world) {
     double thresh=FunctionDefaults<3>::get_thresh();
     write_test_input test_input("hf");
@@ -727,6 +801,7 @@ int main(int argc, char** argv) {
 //
 //    result+=test_coulomb(world);
 //    result+=test_exchange(world);
+    result+=test_spatial_index(world);
     result+=test_XCOperator(world);
     result+=test_nuclear(world);
     result+=test_dnuclear(world);
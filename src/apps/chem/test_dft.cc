@@ -32,6 +32,7 @@
 //#define WORLD_INSTANTIATE_STATIC_TEMPLATES
 #include <madness.h>
 #include <apps/chem/SCFOperators.h>
+#include <apps/chem/xcfunctional.h>
 
 using namespace madness;
 
@@ -108,6 +109,36 @@ int test_slater_exchange(World& world) {
 
 }
 
+/// compare and time the evaluation of the XC potential box by box and in batches of boxes
+int test_batched_xc(World& world) {
+
+    const double thresh=FunctionDefaults<3>::get_thresh();
+    real_function_3d dens=real_factory_3d(world).f(slater2).truncate_on_project();
+    std::vector<real_function_3d> vf(1,dens);
+    refine_to_common_level(world,vf);
+
+    XCfunctional xc;
+    xc.initialize("LDA",false,world);
+    xc_potential op(xc,0,XCfunctional::potential_rho);
+
+    double wall0=wall_time();
+    real_function_3d v1=multiop_values<double,xc_potential,3>(op,vf);
+    double wall1=wall_time();
+    real_function_3d v2=multiop_values_batched<double,xc_potential,3>(op,vf);
+    double wall2=wall_time();
+    if (world.rank()==0) {
+        print("xc potential on",vf[0].size()/FunctionDefaults<3>::get_k()/FunctionDefaults<3>::get_k()/
+                FunctionDefaults<3>::get_k(),"boxes");
+        printf("  box by box   %8.3fs\n",wall1-wall0);
+        printf("  in batches   %8.3fs\n",wall2-wall1);
+    }
+
+    double err=(v1-v2).norm2()/v1.norm2();
+    print("relative difference of the batched potential",err);
+    if (check_err(err,thresh*1.e-4,"batched xc potential")) return 1;
+    return 0;
+}
+
 int main(int argc, char** argv) {
     madness::initialize(argc, argv);
 
@@ -121,6 +152,7 @@ int main(int argc, char** argv) {
 
     int result=0;
 
+    result+=test_batched_xc(world);
     result+=test_slater_exchange(world);
 
     if (world.rank()==0) {
@@ -0,0 +1,158 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file chem/test_ewald.cc
+/// \brief Tests the Ewald sum against known Madelung constants
+
+#include <madness.h>
+#include <apps/chem/ewald.h>
+
+using namespace madness;
+
+typedef Vector<double,3> coordT;
+
+bool check_err(double err, double thresh, std::string msg) {
+    print("   ", msg, err, (std::abs(err) > thresh) ? "FAILED" : "ok");
+    return std::abs(err) > thresh;
+}
+
+/// rock salt in the conventional cell of length a: 4 ion pairs
+void rocksalt(double a, std::vector<coordT>& pos, std::vector<double>& q) {
+    const double fcc[4][3] = {{0,0,0}, {0.5,0.5,0}, {0.5,0,0.5}, {0,0.5,0.5}};
+    for (int i=0; i<4; ++i) {
+        pos.push_back(coordT{a*fcc[i][0], a*fcc[i][1], a*fcc[i][2]});
+        q.push_back(1.0);
+        pos.push_back(coordT{a*(fcc[i][0]+0.5), a*fcc[i][1], a*fcc[i][2]});
+        q.push_back(-1.0);
+    }
+}
+
+int test_madelung(World& world) {
+    int nfail = 0;
+    const double a = 10.0;
+    {
+        std::vector<coordT> pos;
+        std::vector<double> q;
+        rocksalt(a, pos, q);
+        double t = wall_time();
+        EwaldSum ewald(coordT(a), pos, q);
+        t = wall_time() - t;
+        print("rock salt: alpha", ewald.alpha(), "images", ewald.nlattice(), "G vectors up to", ewald.gmax(), "time", t);
+        const double M = 1.747564594633182;         // nearest neighbour distance a/2
+        nfail += check_err(ewald.energy()/(-4.0*M/(0.5*a)) - 1.0, 1e-10, "rock salt Madelung constant");
+    }
+    {
+        std::vector<coordT> pos = {coordT(0.0), coordT(0.5*a)};
+        std::vector<double> q = {1.0, -1.0};
+        EwaldSum ewald(coordT(a), pos, q);
+        const double M = 1.762674773070988;         // nearest neighbour distance sqrt(3)a/2
+        nfail += check_err(ewald.energy()/(-M/(0.5*sqrt(3.0)*a)) - 1.0, 1e-10, "CsCl Madelung constant");
+    }
+    return nfail;
+}
+
+/// the energy and the potential must not depend on the convergence parameter
+int test_alpha(World& world) {
+    int nfail = 0;
+    const coordT cell = {6.5, 7.0, 8.0};
+    std::vector<coordT> pos = {coordT{0.1,0.2,0.3}, coordT{3.3,3.4,4.1}, coordT{1.0,5.0,2.0}};
+    std::vector<double> q = {7.0, 1.0, -2.0};       // charged, with background
+    EwaldSum ref(cell, pos, q);
+    const std::vector<coordT> pts = {coordT{1.0,1.0,1.0}, coordT{6.0,0.5,7.5}, coordT{3.0,3.0,4.0}};
+    for (double s : {0.5, 2.0}) {
+        EwaldSum ewald(cell, pos, q, 1e-12, s*ref.alpha());
+        nfail += check_err(ewald.energy() - ref.energy(), 1e-9, "energy for other alpha");
+        double err = 0.0;
+        for (const coordT& r : pts) err = std::max(err, std::abs(ewald.potential(r) - ref.potential(r)));
+        nfail += check_err(err, 1e-9, "potential for other alpha");
+    }
+
+    // the potential is periodic and the energy is half the potential at the charges
+    double err = 0.0;
+    for (const coordT& r : pts) err = std::max(err, std::abs(ref.potential(r + coordT{6.5,-7.0,16.0}) - ref.potential(r)));
+    nfail += check_err(err, 1e-9, "periodicity of the potential");
+    double e = 0.0;
+    for (std::size_t i=0; i<pos.size(); ++i) {
+        // remove the divergent term of the charge itself, averaged over
+        // opposite points to cancel the field of the other charges
+        const coordT dr(1e-3);
+        const double phi = 0.5*(ref.potential(pos[i] + dr) + ref.potential(pos[i] - dr));
+        e += 0.5*q[i]*(phi - q[i]/dr.normf());
+    }
+    nfail += check_err(e - ref.energy(), 1e-5, "energy from the potential");
+    return nfail;
+}
+
+/// the reciprocal part on a grid by FFT against the pointwise sum
+int test_grid(World& world) {
+    int nfail = 0;
+    const double a = 10.0;
+    std::vector<coordT> pos;
+    std::vector<double> q;
+    rocksalt(a, pos, q);
+    pos[0] = coordT{0.3, 0.2, 0.1};
+    EwaldSum ewald(coordT(a), pos, q);
+
+    double t = wall_time();
+    Tensor<double> grid = ewald.reciprocal_potential_grid(32);
+    t = wall_time() - t;
+    double tp = wall_time();
+    double err = 0.0;
+    for (long i=0; i<grid.dim(0); ++i) {
+        for (long j=0; j<grid.dim(1); ++j) {
+            for (long k=0; k<grid.dim(2); ++k) {
+                const coordT r = {a*i/grid.dim(0), a*j/grid.dim(1), a*k/grid.dim(2)};
+                err = std::max(err, std::abs(grid(i,j,k) - ewald.reciprocal_potential(r)));
+            }
+        }
+    }
+    tp = wall_time() - tp;
+    print("reciprocal potential on", grid.dim(0), "^3 points: FFT", t, "pointwise", tp);
+    nfail += check_err(err, 1e-10, "FFT grid vs pointwise");
+    return nfail;
+}
+
+int main(int argc, char** argv) {
+    madness::initialize(argc, argv);
+    madness::World world(SafeMPI::COMM_WORLD);
+
+    int result = 0;
+    result += test_madelung(world);
+    result += test_alpha(world);
+    result += test_grid(world);
+
+    if (world.rank()==0) {
+        if (result==0) print("\ntests passed\n");
+        else print("\ntests failed\n");
+    }
+    madness::finalize();
+    return result;
+}
@@ -216,6 +216,15 @@ private:
         return rho;
     }
 
+    /// munge an array of densities: out[i]=munge(scale*rho[i])
+    void munge(const long n, const double* rho, const double scale, double* out) const {
+        const double tol=rhotol, min=rhomin;
+        for (long i=0; i<n; ++i) {
+            const double r=scale*rho[i];
+            out[i] = (r <= tol) ? min : r;
+        }
+    }
+
     /// similar to the Laura's ratio thresholding, but might be more robust
     void munge_xc_kernel(double& rho, double& sigma) const {
         if (sigma<0.0) sigma=sigmin;
@@ -428,6 +437,13 @@ struct xc_functional {
         MADNESS_ASSERT(xc);
         return xc->exc(t);
     }
+
+    /// evaluate on a batch of boxes, see multiop_values_batched
+    madness::Tensor<double> operator()(const std::vector< madness::Key<3> >& keys,
+            const std::vector< madness::Tensor<double> >& t) const {
+        MADNESS_ASSERT(xc);
+        return xc->exc(t);
+    }
 };
 
 /// Class to compute terms of the potential
@@ -446,6 +462,13 @@ struct xc_potential {
         madness::Tensor<double> r = xc->vxc(t, ispin, what);
         return r;
     }
+
+    /// evaluate on a batch of boxes, see multiop_values_batched
+    madness::Tensor<double> operator()(const std::vector< madness::Key<3> >& keys,
+            const std::vector< madness::Tensor<double> >& t) const {
+        MADNESS_ASSERT(xc);
+        return xc->vxc(t, ispin, what);
+    }
 };
 
 
@@ -466,6 +489,13 @@ struct xc_kernel_apply {
         madness::Tensor<double> r = xc->fxc_apply(t, ispin, xc_contrib);
         return r;
     }
+
+    /// evaluate on a batch of boxes, see multiop_values_batched
+    madness::Tensor<double> operator()(const std::vector< madness::Key<3> >& keys,
+            const std::vector< madness::Tensor<double> >& t) const {
+        MADNESS_ASSERT(xc);
+        return xc->fxc_apply(t, ispin, xc_contrib);
+    }
 };
 
 }
@@ -6,6 +6,7 @@
 #include <madness/tensor/tensor.h>
 #include <sstream>
 #include <cmath>
+#include <algorithm>
 #include <madness/world/MADworld.h>
 
 namespace madness {
@@ -15,6 +16,9 @@ int x_rks_s__(const double *r__, double *f, double * dfdra);
 int c_rks_vwn5__(const double *r__, double *f, double * dfdra);
 int x_uks_s__(double *ra, double *rb, double *f, double *dfdra, double *dfdrb);
 int c_uks_vwn5__(double *ra, double *rb, double *f, double *dfdra, double *dfdrb);
+void xc_rks_s_vwn5_batch(const long n, const double *r, double *f, double *dfdra);
+void xc_uks_s_vwn5_batch(const long n, const double *ra, const double *rb,
+        double *f, double *dfdra, double *dfdrb);
 
 XCfunctional::XCfunctional() : hf_coeff(0.0) {
     rhotol=1e-7; rhomin=1e-12; sigtol=0.0; sigmin=0.0; // default values
@@ -84,40 +88,43 @@ bool XCfunctional::has_kxc() const
     return false;
 }
 
+/// throw if the functional is not a number on any point
+static void check_nan(const long n, const double* f, const double* ra, const double* rb,
+        const char* msg) {
+    bool bad=false;
+    for (long i=0; i<n; ++i) bad = bad or std::isnan(f[i]);
+    if (not bad) return;
+    for (long i=0; i<n; ++i) {
+        if (std::isnan(f[i])) {
+            if (rb) print(msg, ra[i], rb[i]);
+            else print(msg, ra[i]);
+            throw "numerical error in lda functional";
+        }
+    }
+}
+
+// All points of the argument tensors are processed at once: the densities
+// are munged in one loop and the functionals are evaluated in another, so
+// that the cost of a call is amortized if the tensors hold many boxes (see
+// multiop_values_batched).
+
 madness::Tensor<double> XCfunctional::exc(const std::vector< madness::Tensor<double> >& t) const
 {
-    const double* arho = t[0].ptr();
     madness::Tensor<double> result(3L, t[0].dims(), false);
+    const long n = result.size();
     double* f = result.ptr();
     if (spin_polarized) {
-        const double* brho = t[1].ptr();
-        for (unsigned int i=0; i<result.size(); i++) {
-            double ra = munge(arho[i]);
-            double rb = munge(brho[i]);
-            double xf, cf, xdfdr[2], cdfdr[2];
-
-            x_uks_s__(&ra, &rb, &xf, xdfdr, xdfdr+1);
-            c_uks_vwn5__(&ra, &rb, &cf, cdfdr, cdfdr+1);
-
-            f[i] = xf + cf;
-            if (std::isnan(f[i])) {
-                print("bad 1?", ra, rb);
-                throw "numerical error in lda functional";
-            }
-        }
+        madness::Tensor<double> ra(n), rb(n), dfdra(n), dfdrb(n);
+        munge(n, t[0].ptr(), 1.0, ra.ptr());
+        munge(n, t[1].ptr(), 1.0, rb.ptr());
+        xc_uks_s_vwn5_batch(n, ra.ptr(), rb.ptr(), f, dfdra.ptr(), dfdrb.ptr());
+        check_nan(n, f, ra.ptr(), rb.ptr(), "bad 1?");
     }
     else {
-        double q1, q2, dq;
-        for (unsigned int i=0; i<result.size(); i++) {
-            double r = munge(2.0 * arho[i]);
-            x_rks_s__(&r, &q1, &dq);
-            c_rks_vwn5__(&r, &q2, &dq);
-            f[i] = q1 + q2;
-            if (std::isnan(f[i])) {
-                print("bad? 2", r);
-                throw "numerical error in lda functional";
-            }
-        }
+        madness::Tensor<double> r(n), dfdr(n);
+        munge(n, t[0].ptr(), 2.0, r.ptr());
+        xc_rks_s_vwn5_batch(n, r.ptr(), f, dfdr.ptr());
+        check_nan(n, f, r.ptr(), 0, "bad? 2");
     }
     return result;
 }
@@ -125,42 +132,24 @@ madness::Tensor<double> XCfunctional::exc(const std::vector< madness::Tensor<dou
 madness::Tensor<double> XCfunctional::vxc(const std::vector< madness::Tensor<double> >& t,
         const int ispin, const XCfunctional::xc_contribution what) const
 {
-    //MADNESS_ASSERT(what == 0);
-    const double* arho = t[0].ptr();
     madness::Tensor<double> result(3L, t[0].dims(), false);
+    const long n = result.size();
     double* f = result.ptr();
 
     if (spin_polarized) {
-        const double* brho = t[1].ptr();
-        for (unsigned int i=0; i<result.size(); i++) {
-            double ra = munge(arho[i]);
-            double rb = munge(brho[i]);
-            double xf, cf, xdfdr[2], cdfdr[2];
-
-            x_uks_s__(&ra, &rb, &xf, xdfdr, xdfdr+1);
-            c_uks_vwn5__(&ra, &rb, &cf, cdfdr, cdfdr+1);
-
-//            f[i] = xdfdr[what] + cdfdr[what];
-            f[i] = xdfdr[ispin] + cdfdr[ispin];
-            if (std::isnan(f[i])) {
-                print("bad? 3", ra, rb);
-                throw "numerical error in lda functional";
-            }
-        }
+        madness::Tensor<double> ra(n), rb(n), e(n), dfdra(n), dfdrb(n);
+        munge(n, t[0].ptr(), 1.0, ra.ptr());
+        munge(n, t[1].ptr(), 1.0, rb.ptr());
+        xc_uks_s_vwn5_batch(n, ra.ptr(), rb.ptr(), e.ptr(), dfdra.ptr(), dfdrb.ptr());
+        const madness::Tensor<double>& dfdr = (ispin==0) ? dfdra : dfdrb;
+        std::copy(dfdr.ptr(), dfdr.ptr()+n, f);
+        check_nan(n, f, ra.ptr(), rb.ptr(), "bad? 3");
     }
     else {
-        const double* arho = t[0].ptr();
-        for (unsigned int i=0; i<result.size(); i++) {
-            double r = munge(2.0 * arho[i]);
-            double q, dq1, dq2;
-            x_rks_s__(&r, &q, &dq1);
-            c_rks_vwn5__(&r, &q, &dq2);
-            f[i] = dq1 + dq2;
-            if (std::isnan(f[i])) {
-                print("bad? 4", r);
-                throw "numerical error in lda functional";
-            }
-        }
+        madness::Tensor<double> r(n), e(n);
+        munge(n, t[0].ptr(), 2.0, r.ptr());
+        xc_rks_s_vwn5_batch(n, r.ptr(), e.ptr(), f);
+        check_nan(n, f, r.ptr(), 0, "bad? 4");
     }
     return result;
 }
@@ -2,6 +2,7 @@
 
 #include <madness/mra/mra.h>
 #include "mentity.h"
+#include <chem/ewald.h>
 
 using namespace madness;
 
@@ -20,18 +21,6 @@ double compute_volume()
 }
 //*************************************************************************
 
-//***************************************************************************
-struct vectorLengthFunctor : public std::binary_function<Vector<double,3>, Vector<double,3>, bool>
-{
-    bool operator()( Vector<double,3> lhs, Vector<double,3> rhs)
-    {
-      double llen = sqrt(lhs[0]*lhs[0] + lhs[1]*lhs[1] + lhs[2]*lhs[2]);
-      double rlen = sqrt(rhs[0]*rhs[0] + rhs[1]*rhs[1] + rhs[2]*rhs[2]);
-      return (llen < rlen);
-    }
-};
-//***************************************************************************
-
 //*************************************************************************
 class GaussianFunctor : public FunctionFunctorInterface<double,3> {
 private:
@@ -102,36 +91,12 @@ void gen_ce(double mu, double xlo, double eps, Tensor<double>& c, Tensor<double>
 //*************************************************************************
 std::vector< Vector<double,3> > generate_R_vectors(World& world, double maxRlen = 50.0)
 {
-  const double t1 = L;
-
-  std::vector< Vector<double,3> > rvecs;
-  std::vector< Vector<double,3> > rvecs2;
-  double maxRlen20 = 1.2*maxRlen;
-
-  int rlo = -500;
-  int rhi = 501;
-  for (int ir1 = rlo; ir1 < rhi; ir1++)
-  {
-    for (int ir2 = rlo; ir2 < rhi; ir2++)
-    {
-      for (int ir3 = rlo; ir3 < rhi; ir3++)
-      {
-        double rlen = t1*std::sqrt(ir1*ir1 + ir2*ir2 + ir3*ir3);
-        if (rlen <= maxRlen)
-        {
-          Vector<double,3> rvec {t1*ir1, t1*ir2, t1*ir3};
-          rvecs.push_back(rvec);
-        }
-        else if (rlen < maxRlen20)
-        {
-          Vector<double,3> rvec {t1*ir1, t1*ir2, t1*ir3};
-          rvecs2.push_back(rvec);
-        }
-      }
-    }
-  }
-  std::sort(rvecs.begin(), rvecs.end(), vectorLengthFunctor());
-  std::sort(rvecs2.begin(), rvecs2.end(), vectorLengthFunctor());
+  // only the lattice vectors within 120% of maxRlen, sorted by length
+  std::vector< Vector<double,3> > rvecs = EwaldSum::lattice_vectors(coordT(L), 1.2*maxRlen);
+  std::vector< Vector<double,3> >::iterator it = rvecs.begin();
+  while (it != rvecs.end() && it->normf() <= maxRlen) ++it;
+  std::vector< Vector<double,3> > rvecs2(it, rvecs.end());
+  rvecs.erase(it, rvecs.end());
 
 //      if (_world.rank() == 0) printf("Size of vectors:  %d\n", rvecs.size());
 //      if (_world.rank() == 0)
@@ -167,29 +132,7 @@ std::vector< Vector<double,3> > generate_R_vectors(World& world, double maxRlen
 // generate G-vectors for a SCC in terms of the real space lattice vectors
 std::vector< Vector<double,3> > generate_G_vectors(World& world, double maxGlen = 15.0)
 {
-  const double TWO_PI = 2*constants::pi;
-  const double t1 = TWO_PI/L;
-
-  std::vector< Vector<double,3> > gvecs;
-
-  int glo = -500;
-  int ghi = 501;
-  for (int ig1 = glo; ig1 < ghi; ig1++)
-  {
-    for (int ig2 = glo; ig2 < ghi; ig2++)
-    {
-      for (int ig3 = glo; ig3 < ghi; ig3++)
-      {
-        double glen = t1*std::sqrt(ig1*ig1 + ig2*ig2 + ig3*ig3);
-        if (glen <= maxGlen)
-        {
-          Vector<double,3> gvec {t1*ig1, t1*ig2, t1*ig3};
-          gvecs.push_back(gvec);
-        }
-      }
-    }
-  }
-  std::sort(gvecs.begin(), gvecs.end(), vectorLengthFunctor());
+  std::vector< Vector<double,3> > gvecs = EwaldSum::reciprocal_lattice_vectors(coordT(L), maxGlen);
 //      if (_world.rank() == 0)
 //        printf("\nG-vectors:\n");
   for (unsigned int ig = 0; ig < gvecs.size(); ig++)
@@ -1575,6 +1518,58 @@ void test_nuclear_energy(int argc, char** argv)
 }
 //*************************************************************************
 
+//*************************************************************************
+// time the Madelung energy above against the cached Ewald sum of chem/ewald.h
+void test_madelung_timing(int argc, char** argv)
+{
+  initialize(argc, argv);
+
+  World world(SafeMPI::COMM_WORLD);
+
+  try {
+      startup(world,argc,argv);
+
+      MolecularEntity mentity;
+      mentity.add_atom(0.0,0.0,0.0,7,9);
+      mentity.add_atom(L/2,L/2,L/2,1,3);
+      mentity.center();
+
+      double t0 = wall_time();
+      compute_madelung_energy_PWSCF(world,mentity,1.2,50.0,100.0);
+      double t1 = wall_time();
+
+      std::vector<coordT> positions;
+      std::vector<double> charges;
+      for (int i = 0; i < mentity.natom(); i++)
+      {
+        Atom atom = mentity.get_atom(i);
+        positions.push_back(coordT{atom.x, atom.y, atom.z});
+        charges.push_back(atom.q);
+      }
+      EwaldSum ewald(coordT(L), positions, charges);
+      double t2 = wall_time();
+
+      if (world.rank() == 0)
+      {
+        printf("Ewald sum:  alpha: %8.4f  energy: %15.7f\n", ewald.alpha(), ewald.energy());
+        printf("time: compute_madelung_energy_PWSCF %8.3fs  EwaldSum %8.3fs\n", t1-t0, t2-t1);
+      }
+
+  } catch (const SafeMPI::Exception& e) {
+      print(e);
+      error("caught an MPI exception");
+  } catch (const madness::MadnessException& e) {
+      if (world.rank() == 0) print(e);
+      error("caught a MADNESS exception");
+  } catch (const std::exception& e) {
+      if (world.rank() == 0) print(e.what());
+      error("caught an STL exception");
+  }
+
+  finalize();
+}
+//*************************************************************************
+
 int main(int argc, char** argv)
 {
 //    test_nuclear_energy(argc,argv);
@@ -1582,6 +1577,7 @@ int main(int argc, char** argv)
   test_nuclear_potential3(argc,argv);
   //test_gence2(argc,argv);
   //test_G_R_vectors(argc,argv);
+  //test_madelung_timing(argc,argv);
   return 0;
 }
 
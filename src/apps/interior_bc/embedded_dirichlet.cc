@@ -183,6 +183,8 @@ int main(int argc, char **argv) {
         error("shouldn't be here");
         break;
     }
+    // the functor as the factory takes it
+    std::shared_ptr<FunctionFunctorInterface<double, 3> > ffunctor(functor);
 
     if(world.rank() == 0) {
         // print out the arguments
@@ -200,7 +202,7 @@ int main(int argc, char **argv) {
             fflush(stdout);
         }
 
-        surf = real_factory_3d(world).k(6).thresh(1.0e-4).functor(functor);
+        surf = real_factory_3d(world).k(6).thresh(1.0e-4).functor(ffunctor);
 
         if(world.rank() == 0) {
             printf("Performing load balancing\n");
@@ -208,6 +210,7 @@ int main(int argc, char **argv) {
         }
         functor->load_balance(world, surf);
         surf.clear();
+        functor->clear_cache(); // the signed distances were for k=6
     }
 
     // reproject the surface function to the requested threshold & k
@@ -215,7 +218,7 @@ int main(int argc, char **argv) {
         printf("Projecting the surface function to requested order\n");
         fflush(stdout);
     }
-    surf = real_factory_3d(world).functor(functor);
+    surf = real_factory_3d(world).functor(ffunctor);
 
     // project the domain mask
     real_function_3d phi;
@@ -224,7 +227,7 @@ int main(int argc, char **argv) {
         fflush(stdout);
     }
     functor->fop = DOMAIN_MASK;
-    phi = real_factory_3d(world).functor(functor);
+    phi = real_factory_3d(world).functor(ffunctor);
 
     // print out the errors in surface area and volume
     // these are checks of the diffuse domain approximation
@@ -256,10 +259,11 @@ int main(int argc, char **argv) {
     }
 
     functor->fop = DIRICHLET_RHS;
-    usol = real_factory_3d(world).functor(functor);
+    usol = real_factory_3d(world).functor(ffunctor);
     rhs = G(usol);
     rhs.truncate();
     usol.clear();
+    functor->clear_cache(); // no more projections of the surface or mask
 
     // load balance using the domain mask, the surface function, and the rhs
     if(world.rank() == 0){
@@ -301,7 +305,7 @@ int main(int argc, char **argv) {
     std::vector<Vector<double, 3> > check_pts;
 
     functor->fop = EXACT;
-    uexact = real_factory_3d(world).functor(functor);
+    uexact = real_factory_3d(world).functor(ffunctor);
     uerror = (usol - uexact)*phi; // only use interior solution
     error = uerror.norm2();
 
@@ -109,8 +109,10 @@ class EmbeddedDirichlet : public FunctionFunctorInterface<double, 3> {
         std::string penalty_name;
 
     protected:
-        DomainMaskInterface *dmi;
-        SignedDFInterface<3> *sdfi;
+        std::shared_ptr<DomainMaskInterface> dmi;
+        std::shared_ptr<SignedDFInterface<3> > sdfi;
+        /// the mask, surface, etc. of dmi and sdfi for all points of a box
+        std::shared_ptr<DomainMaskSDFFunctor<3> > dmf;
         double penalty_prefact, eps;
         std::string problem_name;
         std::string problem_specific_info;
@@ -119,6 +121,16 @@ class EmbeddedDirichlet : public FunctionFunctorInterface<double, 3> {
        // is the problem homogeneous?
        virtual bool isHomogeneous() const =  0;
 
+       /// \brief Sets the shape.
+       ///
+       /// The signed distances are kept, so that the surface function, the
+       /// domain mask and the r.h.s. compute them only once.
+       void set_sdf(SignedDFInterface<3> *sdf) {
+           sdfi.reset(sdf);
+           dmf.reset(new DomainMaskSDFFunctor<3>(dmi, sdfi));
+           dmf->cache_sdf();
+       }
+
     public:
         /// which function to use when projecting:
         /// -# the weighted surface (SURFACE)
@@ -132,8 +144,8 @@ class EmbeddedDirichlet : public FunctionFunctorInterface<double, 3> {
         /// Also sets the FunctionDefaults for the appropriate dimension.
         EmbeddedDirichlet(double penalty_prefact, std::string penalty_name,
             double eps, int k, double thresh, Mask mask)
-            : k(k), thresh(thresh), penalty_name(penalty_name), dmi(nullptr),
-              sdfi(nullptr), penalty_prefact(penalty_prefact), eps(eps),
+            : k(k), thresh(thresh), penalty_name(penalty_name),
+              penalty_prefact(penalty_prefact), eps(eps),
               fop(DIRICHLET_RHS) {
 
             // calculate some nice initial projection level
@@ -147,11 +159,11 @@ class EmbeddedDirichlet : public FunctionFunctorInterface<double, 3> {
             switch(mask) {
             case LLRV:
                 domain_mask_name = "LLRV";
-                dmi = new LLRVDomainMask(eps);
+                dmi.reset(new LLRVDomainMask(eps));
                 break;
             case Gaussian:
                 domain_mask_name = "Gaussian";
-                dmi = new GaussianDomainMask(eps);
+                dmi.reset(new GaussianDomainMask(eps));
                 break;
             default:
                 error("Unknown mask");
@@ -159,11 +171,11 @@ class EmbeddedDirichlet : public FunctionFunctorInterface<double, 3> {
             }
         }
 
-        virtual ~EmbeddedDirichlet() {
-            if(sdfi != nullptr)
-                delete sdfi;
-            if(dmi != nullptr)
-                delete dmi;
+        virtual ~EmbeddedDirichlet() {}
+
+        /// \brief Releases the cached signed distances
+        void clear_cache() {
+            dmf->clear_cache();
         }
 
         /// \brief Load balances using the provided Function
@@ -216,6 +228,69 @@ class EmbeddedDirichlet : public FunctionFunctorInterface<double, 3> {
             }
         }
 
+        bool supports_vectorized() const { return true; }
+
+        /// \brief Is the projected function zero between c1 and c2?
+        bool screened(const coord_3d &c1, const coord_3d &c2) const {
+            switch(fop) {
+            case SURFACE:
+                return dmf->screened(DomainMaskSDFFunctor<3>::SURFACE, c1, c2);
+            case DIRICHLET_RHS:
+                return dmf->screened(DomainMaskSDFFunctor<3>::SURFACE, c1, c2)
+                    && (isHomogeneous() ||
+                        dmf->screened(DomainMaskSDFFunctor<3>::MASK, c1, c2));
+            case DOMAIN_MASK:
+                return dmf->screened(DomainMaskSDFFunctor<3>::MASK, c1, c2);
+            default:
+                return false;
+            }
+        }
+
+        /// \brief The operator for projecting all points of a box at once.
+        void operator() (const Vector<double*, 3> &x, double *f, int npts)
+            const {
+
+            coord_3d pt;
+            switch(fop) {
+            case EXACT:
+                for(int j = 0; j < npts; ++j) {
+                    pt[0] = x[0][j]; pt[1] = x[1][j]; pt[2] = x[2][j];
+                    f[j] = ExactSol(pt);
+                }
+                break;
+            case DIRICHLET_RHS: {
+                std::vector<double> surf(npts);
+                dmf->evaluate(DomainMaskSDFFunctor<3>::SURFACE, x, surf.data(),
+                    npts);
+                if(isHomogeneous())
+                    std::fill(f, f+npts, 0.0);
+                else
+                    dmf->evaluate(DomainMaskSDFFunctor<3>::MASK, x, f, npts);
+                for(int j = 0; j < npts; ++j) {
+                    if(f[j] == 0.0 && surf[j] == 0.0)
+                        continue;
+                    pt[0] = x[0][j]; pt[1] = x[1][j]; pt[2] = x[2][j];
+                    if(f[j] != 0.0)
+                        f[j] *= Inhomogeneity(pt);
+                    if(surf[j] != 0.0)
+                        f[j] -= DirichletCond(pt) * surf[j] * penalty_prefact;
+                }
+                break;
+            }
+            case SURFACE:
+                dmf->evaluate(DomainMaskSDFFunctor<3>::SURFACE, x, f, npts);
+                for(int j = 0; j < npts; ++j)
+                    f[j] *= penalty_prefact;
+                break;
+            case DOMAIN_MASK:
+                dmf->evaluate(DomainMaskSDFFunctor<3>::MASK, x, f, npts);
+                break;
+            default:
+                error("shouldn't be here...");
+                break;
+            }
+        }
+
         virtual double DirichletCond(const Vector<double, 3> &x) const = 0;
 
         virtual double ExactSol(const Vector<double, 3> &x) const = 0;
@@ -255,7 +330,7 @@ class ConstantSphere : public EmbeddedDirichlet {
 
             // set up the domain masks, etc.
             coord_3d pt(0.0); // origin
-            sdfi = new SDFSphere(radius, pt);
+            set_sdf(new SDFSphere(radius, pt));
         }
 
         double DirichletCond(const Vector<double, 3> &x) const {
@@ -321,7 +396,7 @@ class InhomoConstantSphere : public EmbeddedDirichlet {
 
             // set up the domain masks, etc.
             coord_3d pt(0.0); // origin
-            sdfi = new SDFSphere(radius, pt);
+            set_sdf(new SDFSphere(radius, pt));
         }
 
         double DirichletCond(const Vector<double, 3> &x) const {
@@ -387,7 +462,7 @@ class CosineSphere : public EmbeddedDirichlet {
 
             // set up the domain masks, etc.
             coord_3d pt(0.0); // origin
-            sdfi = new SDFSphere(radius, pt);
+            set_sdf(new SDFSphere(radius, pt));
         }
 
         double DirichletCond(const Vector<double, 3> &x) const {
@@ -458,7 +533,7 @@ class Y20Sphere : public EmbeddedDirichlet {
 
             // set up the domain masks, etc.
             coord_3d pt(0.0); // origin
-            sdfi = new SDFSphere(radius, pt);
+            set_sdf(new SDFSphere(radius, pt));
         }
 
         double DirichletCond(const Vector<double, 3> &x) const {
@@ -37,7 +37,9 @@
 //#define WORLD_INSTANTIATE_STATIC_TEMPLATES
 #include <madness/mra/mra.h>
 #include <madness/mra/qmprop.h>
+#include <madness/mra/splitprop.h>
 #include <madness/mra/operator.h>
+#include <madness/mra/function_expression.h>
 #include <madness/constants.h>
 #include <madness/tensor/vmath.h>
 #include <complex>
@@ -231,25 +233,6 @@ typedef Convolution1D<double_complex> complex_operatorT;
         template <typename Archive> void serialize(Archive& ar) {}
     };
 
-complex_functionT APPLY(const complex_operatorT* q1d, const complex_functionT& psi) {
-    complex_functionT r = psi;  // Shallow copy violates constness !!!!!!!!!!!!!!!!!
-    coordT lo, hi;
-    lo[2] = -10;
-    hi[2] = +10;
-
-    r.reconstruct();
-    r.broaden();
-    r.broaden();
-    r.broaden();
-    r.broaden();
-
-    r = apply_1d_realspace_push(*q1d, r, 2); r.sum_down();
-    r = apply_1d_realspace_push(*q1d, r, 1); r.sum_down();
-    r = apply_1d_realspace_push(*q1d, r, 0); r.sum_down();
-
-    return r;
-}
-
 //typedef SeparatedConvolution<double_complex,3> complex_operatorT;
 
 // Derivative of the smoothed 1/r approximation
@@ -487,87 +470,6 @@ void converge2s(World& world, functionT& potn, functionT& psi, double& eps) {
     }
 }
 
-complex_functionT chin_chen(const complex_functionT& expV_0,
-                            const complex_functionT& expV_tilde,
-                            const complex_functionT& expV_1,
-                            const complex_operatorT* G,
-                            const complex_functionT& psi0) {
-    // psi(t) = exp(-i*V(t)*t/6) exp(-i*T*t/2) exp(-i*2*Vtilde(t/2)*t/3) exp(-i*T*t/2) exp(-i*V(0)*t/6)
-    // .             expV_1            G               expV_tilde             G             expV_0
-
-    complex_functionT psi1;
-
-    double t0 = wall_time();
-    psi1 = expV_0*psi0;     psi1.truncate();
-    double t1 = wall_time();
-    psi1 = APPLY(G,psi1);   psi1.truncate();
-
-    double t2 = wall_time();
-    psi1 = expV_tilde*psi1; psi1.truncate();
-    double t3 = wall_time();
-
-    psi1 = APPLY(G,psi1);   psi1.truncate();
-    double t4 = wall_time();
-    psi1 = expV_1*psi1;     psi1.truncate(param.thresh);
-    double t5 = wall_time();
-
-    if (psi1.world().rank() == 0) {
-        printf("chin-chen: %.2f %.2f %.2f %.2f %.2f\n", t1-t0, t2-t1, t3-t2, t4-t3, t5-t4);
-    }
-
-    return psi1;
-}
-
-complex_functionT trotter(World& world,
-                          const complex_functionT& expV,
-                          const complex_operatorT* G,
-                          const complex_functionT& psi0) {
-    //    psi(t) = exp(-i*T*t/2) exp(-i*V(t/2)*t) exp(-i*T*t/2) psi(0)
-
-    complex_functionT psi1;
-
-    unsigned long size = psi0.size();
-    if (world.rank() == 0) print("APPLYING G", size);
-    psi1 = APPLY(G,psi0);  psi1.truncate();  size = psi1.size();
-    if (world.rank() == 0) print("APPLYING expV", size);
-    psi1 = expV*psi1;      psi1.truncate();  size = psi1.size();
-    if (world.rank() == 0) print("APPLYING G again", size);
-    psi1 = APPLY(G,psi1);  psi1.truncate(param.thresh);  size = psi1.size();
-    if (world.rank() == 0) print("DONE", size);
-
-    return psi1;
-}
-
-template<typename T, int NDIM>
-struct unaryexp {
-//     void operator()(const Key<NDIM>& key, Tensor<T>& t) const {
-//         UNARY_OPTIMIZED_ITERATOR(T, t, *_p0 = exp(*_p0););
-//     }
-//     template <typename Archive>
-//     void serialize(Archive& ar) {}
-};
-
-
-template<int NDIM>
-struct unaryexp<double_complex,NDIM> {
-    void operator()(const Key<NDIM>& key, Tensor<double_complex>& t) const {
-        //vzExp(t.size, t.ptr(), t.ptr());
-        UNARY_OPTIMIZED_ITERATOR(double_complex, t, *_p0 = exp(*_p0););
-    }
-    template <typename Archive>
-    void serialize(Archive& ar) {}
-};
-
-
-// Returns exp(-I*t*V)
-complex_functionT make_exp(double t, const functionT& v) {
-    v.reconstruct();
-    complex_functionT expV = double_complex(0.0,-t)*v;
-    expV.unaryop(unaryexp<double_complex,3>());
-    //expV.truncate(); expV.reconstruct();
-    return expV;
-}
-
 void print_stats_header(World& world) {
     if (world.rank() == 0) {
         printf("  step       time            field           energy            norm           overlap0         x-dipole         y-dipole         z-dipole           accel      wall-time(s)\n");
@@ -759,11 +661,9 @@ void propagate(World& world, int step0) {
 
     preloadbal(world, potn, psi);
 
-    // Free particle propagator for both Trotter and Chin-Chen --- exp(-I*T*time_step/2)
-    //SeparatedConvolution<double_complex,3> G = qm_free_particle_propagator<3>(world, param.k, c, 0.5*time_step);
-    //G.doleaves = true;
-
-    complex_operatorT* G = qm_1d_free_particle_propagator(param.k, c, 0.5*time_step, 2.0*param.L);
+    // Split-operator propagator for both Trotter and Chin-Chen; the kinetic
+    // factor is exp(-I*T*time_step/2)
+    SplitOperatorPropagator<3> prop(world, param.k, c, time_step);
 
     functionT dpotn_dx = factoryT(world).f(dVdx);  dpotn_dx.truncate(param.thresh);
     functionT dpotn_dy = factoryT(world).f(dVdy);  dpotn_dy.truncate(param.thresh);
@@ -816,65 +716,35 @@ void propagate(World& world, int step0) {
 
     bool use_trotter = false;
     while (step < nstep) {
-        double t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13;
+        double t0, t1, t2, t3, t4, t5, t6;
         t0 = wall_time();
-        if (step < 2 || (step%param.nloadbal) == 0)
+        if (step < 2 || (step%param.nloadbal) == 0) {
             loadbal(world, potn, psi);
+            prop.clear_cache();
+        }
         t1 = wall_time();
 
         long depth = psi.max_depth(); long size=psi.size();
+        t2 = t1;
         if (use_trotter) {
-            // Make the potential at time t + step/2
-            functionT vhalf = potn + laser(t+0.5*time_step)*z;
-
-            // Apply Trotter to advance from time t to time t+step
-            complex_functionT expV = make_exp(time_step, vhalf);
-            psi = trotter(world, expV, G, psi);
+            // Advance from time t to time t+step with the field at time t + step/2
+            psi = prop.trotter(psi, potn, vec(0.0, 0.0, laser(t+0.5*time_step)));
         }
         else { // Chin-Chen
             // Make z-component of del V at time tstep/2
+            const double E = laser(t+0.5*time_step);
+            FunctionExpression<double,3> dV_dz = lazy(dpotn_dz) + E;
 
-            functionT dV_dz = copy(dpotn_dz);
+            // Make Vtilde = V + E z - dt^2/48 |del V|^2 at time tstep/2 in
+            // one traversal, without forming dV_dz, its square and dvsq
+            functionT Vtilde = evaluate(lazy(potn) + E*lazy(z)
+                - (time_step*time_step/48.0)*(lazy(dpotn_dx_sq) + dpotn_dy_sq + dV_dz*dV_dz), false);
             t2 = wall_time();
-            dV_dz.add_scalar(laser(t+0.5*time_step));
-
-            // Make Vtilde at time tstep/2
-            functionT Vtilde = potn + laser(t+0.5*time_step)*z;
-            t3 = wall_time();
-
-            //functionT dvsq = dpotn_dx_sq + dpotn_dy_sq + dV_dz*dV_dz;
-            world.gop.fence();
-            functionT dV_dz_sq = dV_dz*dV_dz;
-            world.gop.fence();
-            dV_dz_sq.compress();
-            world.gop.fence();
-            functionT dvsq = dpotn_dx_sq + dpotn_dy_sq + dV_dz_sq;
-            world.gop.fence();
-            dV_dz_sq.clear();
-
-            t4 = wall_time();
-            Vtilde.gaxpy(1.0, dvsq, -time_step*time_step/48.0);
-            t5 = wall_time();
 
-            // Exponentiate potentials
-            complex_functionT expv_0     = make_exp(time_step/6.0, vt);
-            t6 = wall_time();
-            complex_functionT expv_tilde = make_exp(2.0*time_step/3.0, Vtilde);
-            t7 = wall_time();
-            complex_functionT expv_1     = make_exp(time_step/6.0, potn + laser(t+time_step)*z);
-            t8 = wall_time();
-
-            // Free up some memory
-            dV_dz.clear();
-            Vtilde.clear();
-            dvsq.clear();
-            world.gop.fence();
-            t9 = wall_time();
-
-            // Apply Chin-Chen
-            psi = chin_chen(expv_0, expv_tilde, expv_1, G, psi);
-            t10 = wall_time();
+            // Apply Chin-Chen; the phases of potn are cached across steps
+            psi = prop.chin_chen(psi, potn, vec(0.0, 0.0, laser(t)), Vtilde, vec(0.0, 0.0, laser(t+time_step)));
         }
+        t3 = wall_time();
 
         // Update counters, print info, dump/plot as necessary
         step++;
@@ -885,9 +755,9 @@ void propagate(World& world, int step0) {
         {
             // Make gradient of potential at time t in z direction to compute HHG
             functionT dV_dz = copy(dpotn_dz);
-            t11 = wall_time();
+            t4 = wall_time();
             dV_dz.add_scalar(laser(t));
-            t12 = wall_time();
+            t5 = wall_time();
 
             if ((step%param.nprint) == 0 || step==nstep) {
                 print_stats(world, step, t, vt, x, y, z, dV_dz, psi0, psi);
@@ -895,10 +765,10 @@ void propagate(World& world, int step0) {
                 if (world.rank() == 0) print(step, "depth", depth, "size", size);
             }
 
-            t13 = wall_time();
+            t6 = wall_time();
             if (world.rank() == 0)
-                printf("loadbal=%.2f copy=%.2f Vtil=%.2f dvsq =%.2f gaxpy=%.2f exp1=%.2f exp2=%.2f exp3=%.2f clear=%.2f CC=%.2f copy=%.2f addscl=%.2f prnt=%.2f\n",
-                       t1-t0, t2-t1, t3-t2, t4-t3, t5-t4, t6-t5, t7-t6, t8-t7, t9-t8, t10-t9, t11-t10, t12-t11, t13-t12);
+                printf("loadbal=%.2f Vtil=%.2f prop=%.2f copy=%.2f addscl=%.2f prnt=%.2f\n",
+                       t1-t0, t2-t1, t3-t2, t4-t3, t5-t4, t6-t5);
         }
 
         if ((step%param.ndump) == 0 || step==nstep) {
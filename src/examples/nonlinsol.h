@@ -48,53 +48,27 @@
  */
 
 #include <madness/mra/mra.h>
+#include <madness/mra/kain_subspace.h>
 #include <madness/tensor/solvers.h>
 
 namespace madness {
 
 
-	/// check for subspace linear dependency
-
-	/// @param[in]     Q	the input matrix for KAIN
-	/// @param[in,out] c	the coefficients for constructing the new solution
-    /// @param[in]     rcondtol rcond less than this will cause the subspace to be shrunk due to linear dependence
-    /// @param[in]     cabsmax  maximum element of c greater than this will cause the subspace to be shrunk due to linear dependence
-	template<typename C>
-	void check_linear_dependence(const Tensor<C>& Q, Tensor<C>& c, const double rcondtol, const double cabsmax) {
-		double rcond = 1e-12;
-		int m = c.dim(0);
-
-		while(1){
-			c = KAIN(Q, rcond);
-			//if (world.rank() == 0) print("kain c:", c);
-//			if(std::abs(c[m - 1]) < 3.0){
-			if (c.absmax()<cabsmax) {
-				break;
-			} else  if(rcond < rcondtol){
-				print("Increasing subspace singular value threshold ", c[m - 1], rcond);
-				rcond *= 100;
-			} else {
-				print("Forcing full step due to subspace malfunction");
-				c = 0.0;
-				c[m - 1] = 1.0;
-				break;
-			}
-		}
-	}
-
 	/// A simple Krylov-subspace nonlinear equation solver
 
     /// \ingroup nonlinearsolve
+    /// The subspace is kept in a KAINSubspace, see there for options to
+    /// reduce its memory footprint.
 	template<size_t NDIM>
 	class NonlinearSolverND {
 		unsigned int maxsub; ///< Maximum size of subspace dimension
 
-		std::vector<Function<double,NDIM> > ulist, rlist;
-		real_tensor Q;
+		std::shared_ptr<KAINSubspace<double,NDIM> > subspace;
 
 	public:
 		void set_maxsub(const unsigned int &new_maxsub){
 			maxsub = new_maxsub;
+			if (subspace) subspace->set_maxsub(maxsub);
 		}
 		unsigned int get_maxsub()const{
 			const unsigned int tmp = maxsub;
@@ -104,6 +78,12 @@ namespace madness {
 
 		NonlinearSolverND(unsigned int maxsub = 10) : maxsub(maxsub), do_print(false) {}
 
+		/// the subspace; available after the first call to update
+		KAINSubspace<double,NDIM>& get_subspace() {
+			MADNESS_ASSERT(subspace);
+			return *subspace;
+		}
+
 		/// Computes next trial solution vector
 
 		/// You are responsible for performing step restriction or line search
@@ -117,36 +97,12 @@ namespace madness {
 		Function<double,NDIM> update(const Function<double,NDIM>& u, const Function<double,NDIM>& r,
 				const double rcondtol=1e-8, const double cabsmax=1000.0) {
 			if (maxsub==1) return u-r;
-			int iter = ulist.size();
-			ulist.push_back(u);
-			rlist.push_back(r);
-
-			// Solve subspace equations
-			real_tensor Qnew(iter+1,iter+1);
-			if (iter>0) Qnew(Slice(0,-2),Slice(0,-2)) = Q;
-			for (int i=0; i<=iter; i++) {
-				Qnew(i,iter) = inner(ulist[i],rlist[iter]);
-				Qnew(iter,i) = inner(ulist[iter],rlist[i]);
-			}
-			Q = Qnew;
-			real_tensor c = KAIN(Q);
-			check_linear_dependence(Q,c,rcondtol,cabsmax);
-			if (do_print) print("subspace solution",c);
-
-			// Form new solution in u
-			Function<double,NDIM> unew = FunctionFactory<double,NDIM>(u.world());
-			if (ulist[0].is_compressed()) unew.compress();
-			for (int i=0; i<=iter; i++) {
-				unew.gaxpy(1.0,ulist[i], c[i]);
-				unew.gaxpy(1.0,rlist[i],-c[i]);
-			}
-			unew.truncate();
+			if (not subspace) subspace.reset(new KAINSubspace<double,NDIM>(u.world(),maxsub));
+			subspace->do_print=do_print;
 
-			if (ulist.size() == maxsub) {
-				ulist.erase(ulist.begin());
-				rlist.erase(rlist.begin());
-				Q = copy(Q(Slice(1,-1),Slice(1,-1)));
-			}
+			std::vector<Function<double,NDIM> > vu(1,u), vr(1,r);
+			Function<double,NDIM> unew=subspace->update(vu,vr,rcondtol,cabsmax)[0];
+			unew.truncate();
 			return unew;
 		}
 	};
@@ -176,6 +132,9 @@ namespace madness {
     ///
     /// I've not yet tested with anything except \c C=double and I think
     /// that the KAIN routine will need extending for anything else.
+    ///
+    /// For vectors of Functions KAINSubspace stores the subspace more
+    /// economically and computes the overlaps in a single reduction.
     template <class T, class C = double, class Alloc = default_allocator<T> >
     class XNonlinearSolver {
         unsigned int maxsub; ///< Maximum size of subspace dimension
@@ -88,6 +88,38 @@ bool CFFT::Inverse(double_complex *const Data, const unsigned int N, const bool
 	return true;
 }
 
+//   3D FORWARD FOURIER TRANSFORM, INPLACE VERSION
+//     Data       - N0 x N1 x N2 array in row-major order, both input data and output
+//     N0, N1, N2 - lengths along the three axes
+bool CFFT::Forward3D(double_complex *const Data, const unsigned int N0, const unsigned int N1, const unsigned int N2)
+{
+	//   Check input parameters
+	if (!Data || N0 < 1 || N0 & (N0 - 1) || N1 < 1 || N1 & (N1 - 1) || N2 < 1 || N2 & (N2 - 1))
+		return false;
+	//   Transform along all three axes
+	Perform3D(Data, N0, N1, N2, false);
+	//   Succeeded
+	return true;
+}
+
+//   3D INVERSE FOURIER TRANSFORM, INPLACE VERSION
+//     Data       - N0 x N1 x N2 array in row-major order, both input data and output
+//     N0, N1, N2 - lengths along the three axes
+//     Scale      - if to scale result
+bool CFFT::Inverse3D(double_complex *const Data, const unsigned int N0, const unsigned int N1, const unsigned int N2, const bool Scale /* = true */)
+{
+	//   Check input parameters
+	if (!Data || N0 < 1 || N0 & (N0 - 1) || N1 < 1 || N1 & (N1 - 1) || N2 < 1 || N2 & (N2 - 1))
+		return false;
+	//   Transform along all three axes
+	Perform3D(Data, N0, N1, N2, true);
+	//   Scale if necessary
+	if (Scale)
+		CFFT::Scale(Data, N0 * N1 * N2);
+	//   Succeeded
+	return true;
+}
+
 //   Rearrange function
 void CFFT::Rearrange(const double_complex *const Input, double_complex *const Output, const unsigned int N)
 {
@@ -174,6 +206,40 @@ void CFFT::Perform(double_complex *const Data, const unsigned int N, const bool
 	}
 }
 
+//   3D FFT implementation
+void CFFT::Perform3D(double_complex *const Data, const unsigned int N0, const unsigned int N1, const unsigned int N2, const bool Inverse)
+{
+	//   Last axis - lines are contiguous
+	for (unsigned int Line = 0; Line < N0 * N1; ++Line)
+	{
+		Rearrange(Data + Line * N2, N2);
+		Perform(Data + Line * N2, N2, Inverse);
+	}
+	//   Other axes - gather each line into a buffer, transform and scatter back
+	vector<double_complex> Buffer(N0 > N1 ? N0 : N1);
+	for (unsigned int i = 0; i < N0; ++i)
+		for (unsigned int k = 0; k < N2; ++k)
+		{
+			double_complex *const Line = Data + i * N1 * N2 + k;
+			for (unsigned int j = 0; j < N1; ++j)
+				Buffer[j] = Line[j * N2];
+			Rearrange(&Buffer[0], N1);
+			Perform(&Buffer[0], N1, Inverse);
+			for (unsigned int j = 0; j < N1; ++j)
+				Line[j * N2] = Buffer[j];
+		}
+	for (unsigned int jk = 0; jk < N1 * N2; ++jk)
+	{
+		double_complex *const Line = Data + jk;
+		for (unsigned int i = 0; i < N0; ++i)
+			Buffer[i] = Line[i * N1 * N2];
+		Rearrange(&Buffer[0], N0);
+		Perform(&Buffer[0], N0, Inverse);
+		for (unsigned int i = 0; i < N0; ++i)
+			Line[i * N1 * N2] = Buffer[i];
+	}
+}
+
 //   Scaling of inverse FFT result
 void CFFT::Scale(double_complex *const Data, const unsigned int N)
 {
@@ -40,6 +40,17 @@ public:
     //     Scale - if to scale result
     static bool Inverse(double_complex *const Data, const unsigned int N, const bool Scale = true);
     
+    //   3D FORWARD FOURIER TRANSFORM, INPLACE VERSION
+    //     Data       - N0 x N1 x N2 array in row-major order, both input data and output
+    //     N0, N1, N2 - lengths along the three axes
+    static bool Forward3D(double_complex *const Data, const unsigned int N0, const unsigned int N1, const unsigned int N2);
+    
+    //   3D INVERSE FOURIER TRANSFORM, INPLACE VERSION
+    //     Data       - N0 x N1 x N2 array in row-major order, both input data and output
+    //     N0, N1, N2 - lengths along the three axes
+    //     Scale      - if to scale result
+    static bool Inverse3D(double_complex *const Data, const unsigned int N0, const unsigned int N1, const unsigned int N2, const bool Scale = true);
+    
 protected:
     //   Rearrange function and its inplace version
     static void Rearrange(const double_complex *const Input, double_complex *const Output, const unsigned int N);
@@ -48,6 +59,9 @@ protected:
     //   FFT implementation
     static void Perform(double_complex *const Data, const unsigned int N, const bool Inverse = false);
     
+    //   3D FFT implementation, one axis after the other
+    static void Perform3D(double_complex *const Data, const unsigned int N0, const unsigned int N1, const unsigned int N2, const bool Inverse);
+    
     //   Scaling of inverse FFT result
     static void Scale(double_complex *const Data, const unsigned int N);
 };
@@ -51,15 +51,407 @@
 
 #include <madness/external/muParser/muParser.h>
 #include <string>
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
 #include <madness/mra/mra.h>
 
 //using namespace madness;
 //using namespace mu;
 
+namespace madness {
+    namespace detail {
+
+        /// An expression in the muParser syntax compiled for arrays of points
+
+        /// The supported subset is numbers, the constants _pi and _e, the
+        /// variables x,y,z,u,v,w,r, the operators + - * / ^ and unary minus
+        /// with the precedence and associativity of muParser, the one-argument
+        /// functions of muParser and min, max, sum and avg.  Anything else
+        /// (comparisons, logical operators, if) makes compile() return false.
+        ///
+        /// The expression is parsed into a tree, constants are folded, and the
+        /// tree is emitted as instructions over registers.  The points are
+        /// processed in blocks of \c blocksize; every instruction loops over a
+        /// block, so that the arithmetic vectorizes and the interpretation
+        /// overhead is paid once per block rather than once per point.
+        class ParserProgram {
+        public:
+            enum {NVAR = 7};                    ///< x,y,z,u,v,w and r
+            enum {blocksize = 64};              ///< points per block
+
+        private:
+            enum opcode {CONST, VAR, ADD, SUB, MUL, DIV, POW, NEG, SQR, MIN, MAX, FUNC};
+
+            typedef double (*funcT)(double);
+
+            struct node {
+                opcode op;
+                int left, right;                // children, -1 if none
+                double value;                   // CONST
+                int var;                        // VAR
+                funcT f;                        // FUNC
+            };
+
+            enum {REG, VARIABLE, CONSTANT};
+
+            struct operand {
+                int kind;
+                int index;                      // register or variable
+                double value;
+            };
+
+            struct instruction {
+                opcode op;
+                int dst;
+                operand a, b;
+                funcT f;
+            };
+
+            // parser state
+            std::vector<node> tree;
+            const char* pos;
+            int ndim;
+            bool ok;
+
+            // the program
+            std::vector<instruction> code;
+            operand result;
+            int nreg;
+            bool usesvar[NVAR];
+
+            static double log2f(double v) {return std::log(v)/std::log(2.0);} // as muParser
+            static double rintf(double v) {return std::floor(v + 0.5);}
+            static double signf(double v) {return (v<0) ? -1.0 : (v>0) ? 1.0 : 0.0;}
+
+            static funcT lookup_function(const std::string& name) {
+                static const struct {const char* name; funcT f;} table[] = {
+                    {"sin", ::sin}, {"cos", ::cos}, {"tan", ::tan},
+                    {"asin", ::asin}, {"acos", ::acos}, {"atan", ::atan},
+                    {"sinh", ::sinh}, {"cosh", ::cosh}, {"tanh", ::tanh},
+                    {"asinh", ::asinh}, {"acosh", ::acosh}, {"atanh", ::atanh},
+                    {"log2", log2f}, {"log10", ::log10}, {"log", ::log10}, {"ln", ::log},
+                    {"exp", ::exp}, {"sqrt", ::sqrt}, {"sign", signf}, {"rint", rintf},
+                    {"abs", ::fabs}};
+                for (const auto& e : table) if (name == e.name) return e.f;
+                return 0;
+            }
+
+            static double fold(opcode op, double a, double b, funcT f) {
+                switch (op) {
+                case ADD: return a + b;
+                case SUB: return a - b;
+                case MUL: return a * b;
+                case DIV: return a / b;
+                case POW: return std::pow(a, b);
+                case NEG: return -a;
+                case SQR: return a * a;
+                case MIN: return std::min(a, b);
+                case MAX: return std::max(a, b);
+                case FUNC: return f(a);
+                default: MADNESS_EXCEPTION("ParserProgram: cannot fold", op);
+                }
+                return 0.0;
+            }
+
+            int make_const(double value) {
+                node n = {CONST, -1, -1, value, -1, 0};
+                tree.push_back(n);
+                return tree.size()-1;
+            }
+
+            /// Makes an operation node, folding constant operands
+            int make_op(opcode op, int left, int right=-1, funcT f=0) {
+                if (left < 0 || (right < 0 && (op != NEG && op != SQR && op != FUNC))) {
+                    ok = false;
+                    return -1;
+                }
+                if (op == POW && tree[right].op == CONST && tree[right].value == 2.0) {
+                    op = SQR;
+                    right = -1;
+                }
+                if (tree[left].op == CONST && (right < 0 || tree[right].op == CONST)) {
+                    return make_const(fold(op, tree[left].value, right < 0 ? 0.0 : tree[right].value, f));
+                }
+                node n = {op, left, right, 0.0, -1, f};
+                tree.push_back(n);
+                return tree.size()-1;
+            }
+
+            void skip() {while (std::isspace(*pos)) ++pos;}
+
+            bool accept(char c) {
+                skip();
+                if (*pos == c) {
+                    ++pos;
+                    return true;
+                }
+                return false;
+            }
+
+            // expr := term (('+'|'-') term)*
+            int parse_expr() {
+                int left = parse_term();
+                while (ok) {
+                    if (accept('+')) left = make_op(ADD, left, parse_term());
+                    else if (accept('-')) left = make_op(SUB, left, parse_term());
+                    else break;
+                }
+                return left;
+            }
+
+            // term := signed (('*'|'/') signed)*
+            int parse_term() {
+                int left = parse_signed();
+                while (ok) {
+                    if (accept('*')) left = make_op(MUL, left, parse_signed());
+                    else if (accept('/')) left = make_op(DIV, left, parse_signed());
+                    else break;
+                }
+                return left;
+            }
+
+            // signed := '-' signed | power; the sign binds weaker than ^
+            int parse_signed() {
+                if (accept('-')) return make_op(NEG, parse_signed());
+                return parse_power();
+            }
+
+            // power := primary ('^' ('-' signed | primary))*, left associative
+            int parse_power() {
+                int left = parse_primary();
+                while (ok && accept('^')) {
+                    if (accept('-')) left = make_op(POW, left, make_op(NEG, parse_signed()));
+                    else left = make_op(POW, left, parse_primary());
+                }
+                return left;
+            }
+
+            int parse_primary() {
+                skip();
+                if (accept('(')) {
+                    int e = parse_expr();
+                    if (!accept(')')) ok = false;
+                    return e;
+                }
+                if (std::isdigit(*pos) || *pos == '.') {
+                    char* end;
+                    double value = std::strtod(pos, &end);
+                    if (end == pos) {
+                        ok = false;
+                        return -1;
+                    }
+                    pos = end;
+                    return make_const(value);
+                }
+                if (std::isalpha(*pos) || *pos == '_') {
+                    const char* start = pos;
+                    while (std::isalnum(*pos) || *pos == '_') ++pos;
+                    std::string name(start, pos);
+                    if (name == "_pi") return make_const(3.141592653589793238462643);
+                    if (name == "_e") return make_const(2.718281828459045235360287);
+                    static const char* varnames[NVAR] = {"x", "y", "z", "u", "v", "w", "r"};
+                    for (int i=0; i<NVAR; ++i) {
+                        if (name == varnames[i] && (i < ndim || i == NVAR-1)) {
+                            node n = {VAR, -1, -1, 0.0, i, 0};
+                            tree.push_back(n);
+                            return tree.size()-1;
+                        }
+                    }
+                    if (!accept('(')) {
+                        ok = false;
+                        return -1;
+                    }
+                    std::vector<int> args;
+                    do {
+                        args.push_back(parse_expr());
+                    } while (ok && accept(','));
+                    if (!accept(')')) ok = false;
+                    if (!ok) return -1;
+
+                    if (funcT f = lookup_function(name)) {
+                        if (args.size() != 1) ok = false;
+                        return make_op(FUNC, args[0], -1, f);
+                    }
+                    opcode op;
+                    if (name == "min") op = MIN;
+                    else if (name == "max") op = MAX;
+                    else if (name == "sum" || name == "avg") op = ADD;
+                    else {
+                        ok = false;
+                        return -1;
+                    }
+                    int e = args[0];
+                    for (std::size_t i=1; i<args.size(); ++i) e = make_op(op, e, args[i]);
+                    if (name == "avg") e = make_op(DIV, e, make_const(args.size()));
+                    return e;
+                }
+                ok = false;
+                return -1;
+            }
+
+            /// Emits the subtree at \c inode using registers from \c depth up
+            operand emit(int inode, int depth) {
+                const node& n = tree[inode];
+                operand r;
+                if (n.op == CONST) {
+                    r.kind = CONSTANT;
+                    r.index = -1;
+                    r.value = n.value;
+                    return r;
+                }
+                if (n.op == VAR) {
+                    usesvar[n.var] = true;
+                    r.kind = VARIABLE;
+                    r.index = n.var;
+                    r.value = 0.0;
+                    return r;
+                }
+                instruction ins;
+                ins.op = n.op;
+                ins.f = n.f;
+                ins.a = emit(n.left, depth);
+                if (n.right >= 0) {
+                    ins.b = emit(n.right, depth + (ins.a.kind == REG ? 1 : 0));
+                }
+                else {
+                    ins.b.kind = CONSTANT;
+                    ins.b.index = -1;
+                    ins.b.value = 0.0;
+                }
+                ins.dst = depth;
+                nreg = std::max(nreg, depth+1);
+                code.push_back(ins);
+                r.kind = REG;
+                r.index = depth;
+                r.value = 0.0;
+                return r;
+            }
+
+            static const double* address(const operand& o, double* regs, const double* const* vars, int offset) {
+                if (o.kind == REG) return regs + o.index*blocksize;
+                return vars[o.index] + offset;
+            }
+
+            template <typename opT>
+            static void binary(double* restrict d, const operand& a, const operand& b, double* regs,
+                               const double* const* vars, int offset, int n, opT op) {
+                if (a.kind == CONSTANT) {
+                    const double* restrict pb = address(b, regs, vars, offset);
+                    const double va = a.value;
+                    for (int i=0; i<n; ++i) d[i] = op(va, pb[i]);
+                }
+                else if (b.kind == CONSTANT) {
+                    const double* restrict pa = address(a, regs, vars, offset);
+                    const double vb = b.value;
+                    for (int i=0; i<n; ++i) d[i] = op(pa[i], vb);
+                }
+                else {
+                    const double* restrict pa = address(a, regs, vars, offset);
+                    const double* restrict pb = address(b, regs, vars, offset);
+                    for (int i=0; i<n; ++i) d[i] = op(pa[i], pb[i]);
+                }
+            }
+
+        public:
+            ParserProgram() : pos(0), ndim(0), ok(false), nreg(0) {
+                std::fill(usesvar, usesvar+NVAR, false);
+            }
+
+            /// Compiles \c expr for \c ndim coordinates; returns false if it is not supported
+            bool compile(const std::string& expr, int ndim) {
+                tree.clear();
+                code.clear();
+                nreg = 0;
+                std::fill(usesvar, usesvar+NVAR, false);
+                this->ndim = ndim;
+                pos = expr.c_str();
+                ok = true;
+                int root = parse_expr();
+                skip();
+                if (*pos != 0) ok = false;
+                if (ok) result = emit(root, 0);
+                else code.clear();
+                tree.clear();
+                pos = 0;
+                return ok;
+            }
+
+            bool compiled() const {return ok;}
+
+            /// Is variable \c i (0..5 for x..w, 6 for r) used by the expression?
+            bool uses_variable(int i) const {return usesvar[i];}
+
+            /// Evaluates the expression at \c npts points
+
+            /// \c vars[i] points to the values of variable \c i; only the used
+            /// variables need to be set.  Thread safe.
+            void operator()(const double* const* vars, double* result, int npts) const {
+                MADNESS_ASSERT(ok);
+                std::vector<double> storage(std::max(nreg,1)*int(blocksize));
+                double* regs = storage.data();
+                for (int offset=0; offset<npts; offset+=blocksize) {
+                    const int n = std::min(int(blocksize), npts-offset);
+                    for (const instruction& ins : code) {
+                        double* restrict d = regs + ins.dst*blocksize;
+                        switch (ins.op) {
+                        case ADD: binary(d, ins.a, ins.b, regs, vars, offset, n, [](double x, double y) {return x+y;}); break;
+                        case SUB: binary(d, ins.a, ins.b, regs, vars, offset, n, [](double x, double y) {return x-y;}); break;
+                        case MUL: binary(d, ins.a, ins.b, regs, vars, offset, n, [](double x, double y) {return x*y;}); break;
+                        case DIV: binary(d, ins.a, ins.b, regs, vars, offset, n, [](double x, double y) {return x/y;}); break;
+                        case MIN: binary(d, ins.a, ins.b, regs, vars, offset, n, [](double x, double y) {return std::min(x,y);}); break;
+                        case MAX: binary(d, ins.a, ins.b, regs, vars, offset, n, [](double x, double y) {return std::max(x,y);}); break;
+                        case POW: binary(d, ins.a, ins.b, regs, vars, offset, n, [](double x, double y) {return std::pow(x,y);}); break;
+                        case NEG: {
+                            const double* restrict pa = address(ins.a, regs, vars, offset);
+                            for (int i=0; i<n; ++i) d[i] = -pa[i];
+                            break;
+                        }
+                        case SQR: {
+                            const double* restrict pa = address(ins.a, regs, vars, offset);
+                            for (int i=0; i<n; ++i) d[i] = pa[i]*pa[i];
+                            break;
+                        }
+                        case FUNC: {
+                            const double* restrict pa = address(ins.a, regs, vars, offset);
+                            const funcT f = ins.f;
+                            for (int i=0; i<n; ++i) d[i] = f(pa[i]);
+                            break;
+                        }
+                        default:
+                            MADNESS_EXCEPTION("ParserProgram: bad instruction", ins.op);
+                        }
+                    }
+                    double* restrict out = result + offset;
+                    if (this->result.kind == CONSTANT) {
+                        for (int i=0; i<n; ++i) out[i] = this->result.value;
+                    }
+                    else {
+                        const double* restrict p = address(this->result, regs, vars, offset);
+                        for (int i=0; i<n; ++i) out[i] = p[i];
+                    }
+                }
+            }
+        };
+
+    } // namespace detail
+} // namespace madness
+
 // T can be double or complex, but muParser results will always be real
 // NDIM can be 1 to 6
 // Varables allowed in strings are x,y,z,u,v,w, and r
 // "r" will always mean magnitude of given vector
+//
+// Expressions in the common subset of the muParser syntax (arithmetic,
+// the one-argument functions, min/max/sum/avg) are also compiled into a
+// madness::detail::ParserProgram, which evaluates all quadrature points of
+// a box in one call through the vectorized FunctionFunctorInterface path.
+// The compiled program is checked against muParser at a few points; other
+// expressions are evaluated point by point with muParser, one thread at a
+// time since muParser reads the variables from members.
 
 template <typename T, int NDIM>
 class ParserHandler : public madness::FunctionFunctorInterface<T, NDIM> {
@@ -69,10 +461,55 @@ class ParserHandler : public madness::FunctionFunctorInterface<T, NDIM> {
     static const int MAX_DIM = 6;
     mutable double vars[MAX_DIM];              // variables used in expression
     mutable double r;                    // distance to origin
+    mutable madness::Mutex mutex;        // muParser evaluates through vars and r
     typedef madness::Vector<double, NDIM> coordT;
+    madness::detail::ParserProgram program;  // compiled expression, if supported
+    bool use_program;                    // compile supported expressions
+
+    // compile the expression and check it against muParser
+    void compile(const std::string& expr) {
+      if (!use_program || !program.compile(expr, NDIM)) return;
+      for (int ipt = 0; ipt < 5; ++ipt) {
+        double x[MAX_DIM+1];
+        double rr = 0.0;
+        for (int i = 0; i < NDIM; ++i) {
+          x[i] = 0.37*(i+1) - 0.61*ipt + 0.05*i*ipt;
+          rr += x[i]*x[i];
+        }
+        x[MAX_DIM] = sqrt(rr);
+        const double* p[MAX_DIM+1];
+        for (int i = 0; i <= MAX_DIM; ++i) p[i] = &x[i];
+        double fp;
+        program(p, &fp, 1);
+        double fm;
+        try {
+          for (int i = 0; i < NDIM; ++i) vars[i] = x[i];
+          r = x[MAX_DIM];
+          fm = parser.Eval();
+        } catch (mu::Parser::exception_type &e) {
+          program = madness::detail::ParserProgram();
+          return;
+        }
+        const bool same = (std::isnan(fp) && std::isnan(fm)) || fp == fm ||
+          std::abs(fp - fm) <= 1e-12*std::max(std::abs(fp), std::abs(fm));
+        if (!same) {
+          program = madness::detail::ParserProgram();
+          return;
+        }
+      }
+    }
+
+    void store(const double* f, double* fvals, int npts) const {
+      std::copy(f, f+npts, fvals);
+    }
+
+    void store(const double* f, std::complex<double>* fvals, int npts) const {
+      for (int i = 0; i < npts; ++i) fvals[i] = f[i];
+    }
 
   public:
-    ParserHandler(std::string expr)   {
+    /// \c use_program=false evaluates every point with muParser
+    ParserHandler(std::string expr, bool use_program=true) : use_program(use_program) {
         if (NDIM > MAX_DIM) MADNESS_EXCEPTION("too many dim for parser!",0);
         try {
           if (NDIM >= 1) parser.DefineVar("x", &vars[0]);
@@ -83,12 +520,29 @@ class ParserHandler : public madness::FunctionFunctorInterface<T, NDIM> {
           if (NDIM >= 6) parser.DefineVar("w", &vars[5]);
           parser.DefineVar("r", &r);
           parser.SetExpr(expr);
+          compile(expr);
         } catch (mu::Parser::exception_type &e) {
           std::cout << "muParser: " << e.GetMsg() << std::endl;
         }
     }
 
     virtual T operator() (const coordT &vals_in) const {
+      if (program.compiled()) {
+        double x[MAX_DIM+1], rr = 0.0;
+        const double* p[MAX_DIM+1];
+        for (int i = 0; i < NDIM; ++i) {
+          x[i] = vals_in[i];
+          rr += x[i]*x[i];
+          p[i] = &x[i];
+        }
+        x[MAX_DIM] = sqrt(rr);
+        p[MAX_DIM] = &x[MAX_DIM];
+        double f;
+        program(p, &f, 1);
+        return f;
+      }
+
+      madness::ScopedMutex<madness::Mutex> guard(mutex);
       r = 0;
       for (int i = 0; i < NDIM; ++i) {
         vars[i] = vals_in[i];
@@ -104,9 +558,32 @@ class ParserHandler : public madness::FunctionFunctorInterface<T, NDIM> {
       }
     } // end operator()
 
+    virtual bool supports_vectorized() const {return program.compiled();}
+
+    /// Evaluates the compiled expression at all \c npts points of a box in one call
+    virtual void operator()(const madness::Vector<double*,NDIM>& xvals, T* fvals, int npts) const {
+      const double* p[MAX_DIM+1] = {0};
+      for (int i = 0; i < NDIM; ++i) p[i] = xvals[i];
+      std::vector<double> rr;
+      if (program.uses_variable(MAX_DIM)) {
+        rr.assign(npts, 0.0);
+        for (int i = 0; i < NDIM; ++i) {
+          const double* restrict x = xvals[i];
+          for (int j = 0; j < npts; ++j) rr[j] += x[j]*x[j];
+        }
+        for (int j = 0; j < npts; ++j) rr[j] = sqrt(rr[j]);
+        p[MAX_DIM] = rr.data();
+      }
+      std::vector<double> f(npts);
+      program(p, f.data(), npts);
+      store(f.data(), fvals, npts);
+    }
+
     void changeExpr(const std::string newExpr) {
+      program = madness::detail::ParserProgram();
       try {
         parser.SetExpr(newExpr);
+        compile(newExpr);
       } catch (mu::Parser::exception_type &e) {
         std::cout << "muParser: " << e.GetMsg() << std::endl;
       }
@@ -37,6 +37,7 @@
 #include <limits.h>
 #include <madness/tensor/tensor.h>
 #include <madness/mra/simplecache.h>
+#include <madness/mra/operator_disk_cache.h>
 #include <madness/mra/adquad.h>
 #include <madness/mra/twoscale.h>
 #include <madness/tensor/aligned.h>
@@ -274,6 +275,15 @@ namespace madness {
 
         virtual ~Convolution1D() {};
 
+        /// Approximate number of bytes held by the caches of this convolution
+        double memory_size() const {
+            const double tsize=double(2*k)*double(2*k)*sizeof(Q);
+            // NS blocks hold R, T, their SVD approximations and the NS matrix
+            return double(ns_cache.size()+mod_ns_cache.size())*8.0*tsize
+                    + double(rnlp_cache.size())*2.0*k*sizeof(Q)
+                    + double(rnlij_cache.size())*tsize;
+        }
+
         Convolution1D(int k, int npt, int maxR, double arg = 0.0)
                 : k(k)
                 , npt(npt)
@@ -499,6 +509,14 @@ namespace madness {
 
             // PROFILE_MEMBER_FUNC(Convolution1D); // Too fine grain for routine profiling
 
+            // Without a phase the lattice sum is periodic in lx, so each
+            // level needs only the blocks of the translations 0..2^n-1
+            if ((maxR > 0) && (arg == 0.0)) {
+                Translation twon = Translation(1)<<n;
+                Translation lp = ((lx % twon) + twon) % twon;
+                if (lp != lx) return get_rnlp(n,lp);
+            }
+
             long twok = 2*k;
             Tensor<Q> r;
 
@@ -520,6 +538,8 @@ namespace madness {
                     Translation twon = Translation(1)<<n;
                     r = Tensor<Q>(2*k);
                     for (int R=-maxR; R<=maxR; ++R) {
+                        // most images of a compact kernel are negligible
+                        if (issmall(n, R*twon+lx)) continue;
                         r.gaxpy(1.0, rnlp(n,R*twon+lx), phase(Q(R)));
                     }
                 }
@@ -688,6 +708,66 @@ namespace madness {
                 return 0;
             }
         }
+
+        std::size_t nloaded;    ///< number of rnlp blocks read from the OperatorDiskCache
+
+        /// the key of this convolution in the OperatorDiskCache
+        std::string cache_key() const {
+            char buf[64];
+            snprintf(buf,64,"conv1d:gauss:%d:%d:%d:%d:%d:",int(sizeof(Q)),this->k,m,
+                    static_cast<const Convolution1D<Q>*>(this)->maxR,this->npt);
+            std::string key(buf);
+            const double* c=reinterpret_cast<const double*>(&coeff);
+            for (std::size_t i=0; i<sizeof(Q)/sizeof(double); ++i) key+=OperatorDiskCache::exact(c[i])+":";
+            return key+OperatorDiskCache::exact(expnt)+":"+OperatorDiskCache::exact(this->arg);
+        }
+
+        /// number of doubles per rnlp block in the OperatorDiskCache: n, l and r(n,l,p)
+        std::size_t blocksize() const {
+            return 2+2*this->k*sizeof(Q)/sizeof(double);
+        }
+
+        /// fill the rnlp cache from the OperatorDiskCache
+        void load_rnlp() {
+            std::vector<double> data;
+            if (!OperatorDiskCache::load(cache_key(),data)) return;
+            if (data.size()%blocksize()!=0) return;
+            for (std::size_t i=0; i<data.size(); i+=blocksize()) {
+                Tensor<Q> r(2*this->k);
+                std::memcpy(r.ptr(),&data[i+2],2*this->k*sizeof(Q));
+                this->rnlp_cache.set(Level(data[i]),Translation(data[i+1]),r);
+            }
+            nloaded=data.size()/blocksize();
+        }
+
+        /// write the rnlp cache to the OperatorDiskCache if it has grown since loading
+
+        /// Blocks written by other processes in the meantime are merged in.
+        void store_rnlp() const {
+            if (this->rnlp_cache.size()<=nloaded) return;
+            const std::string key=cache_key();
+            std::vector<double> data;
+            data.reserve(this->rnlp_cache.size()*blocksize());
+            typename SimpleCache<Tensor<Q>,1>::const_iterator it;
+            for (it=this->rnlp_cache.begin(); it!=this->rnlp_cache.end(); ++it) {
+                const Tensor<Q>& r=it->second;
+                if ((r.size()!=2*this->k) or (not r.iscontiguous())) continue;
+                data.push_back(double(it->first.level()));
+                data.push_back(double(it->first.translation()[0]));
+                const double* p=reinterpret_cast<const double*>(r.ptr());
+                data.insert(data.end(),p,p+blocksize()-2);
+            }
+            std::vector<double> old;
+            if (OperatorDiskCache::load(key,old) and (old.size()%blocksize()==0)) {
+                for (std::size_t i=0; i<old.size(); i+=blocksize()) {
+                    if (!this->rnlp_cache.getptr(Level(old[i]),Translation(old[i+1]))) {
+                        data.insert(data.end(),old.begin()+i,old.begin()+i+blocksize());
+                    }
+                }
+            }
+            OperatorDiskCache::store(key,data);
+        }
+
     public:
         const Q coeff;          ///< Coefficient
         const double expnt;     ///< Exponent
@@ -703,6 +783,8 @@ namespace madness {
             , m(m)
         {
             MADNESS_ASSERT(m>=0 && m<=2);
+            nloaded=0;
+            if (OperatorDiskCache::enabled()) load_rnlp();
             // std::cout << "GC expnt=" << expnt << " coeff="  << coeff << " natlev=" << natlev << " maxR=" << maxR(periodic,expnt) << std::endl;
             // for (Level n=0; n<5; n++) {
             //     for (Translation l=0; l<(1<<n); l++) {
@@ -712,7 +794,9 @@ namespace madness {
             // }
         }
 
-        virtual ~GaussianConvolution1D() {}
+        virtual ~GaussianConvolution1D() {
+            if (OperatorDiskCache::enabled()) store_rnlp();
+        }
 
         virtual Level natural_level() const {
             return natlev;
@@ -870,6 +954,20 @@ namespace madness {
             }
             return it->second;
         }
+
+        /// Remove all convolutions that are not referenced outside the cache
+
+        /// Not thread safe: must not be called while operators are being
+        /// constructed or applied, i.e. call it after a fence.
+        /// @return the number of removed convolutions
+        static std::size_t erase_unused() {
+            std::vector<hashT> unused;
+            for (iterator it=map.begin(); it!=map.end(); ++it) {
+                if (it->second.use_count()==1) unused.push_back(it->first);
+            }
+            for (std::size_t i=0; i<unused.size(); ++i) map.erase(unused[i]);
+            return unused.size();
+        }
     };
 }
 
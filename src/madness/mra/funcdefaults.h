@@ -191,6 +191,7 @@ namespace madness {
         static double cell_volume;      ///< Volume of simulation cell
         static double cell_min_width;   ///< Size of smallest dimension
         static TensorType tt;			///< structure of the tensor in FunctionNode
+        static RankReductionType rr;	///< algorithm for rank reduction of low rank tensors
         static std::shared_ptr< WorldDCPmapInterface< Key<NDIM> > > pmap; ///< Default mapping of keys to processes
 
         static void recompute_cell_info() {
@@ -366,6 +367,16 @@ namespace madness {
 #endif
         }
 
+        /// Returns the default algorithm for the rank reduction of low rank tensors
+        static RankReductionType get_rank_reduction() {
+            return rr;
+        }
+
+        /// Sets the default algorithm for the rank reduction of low rank tensors
+        static void set_rank_reduction(const RankReductionType& r) {
+            rr=r;
+        }
+
         /// Gets the user cell for the simulation
         static const Tensor<double>& get_cell() {
             return cell;
@@ -105,6 +105,9 @@ namespace madness {
 
         LevelPmap(World& world) : nproc(world.nproc()) {}
 
+        /// the map of a world with nproc processes, e.g. for a world this process is not part of
+        explicit LevelPmap(const int nproc) : nproc(nproc) {}
+
         /// Find the owner of a given key
         ProcessID owner(const keyT& key) const {
             Level n = key.level();
@@ -234,6 +237,11 @@ namespace madness {
             _coeffs.reduce_rank(eps);
         }
 
+        /// reduces the rank of the coefficients, using the algorithm in targs
+        void reduceRank(const TensorArgs& targs) {
+            _coeffs.reduce_rank(targs);
+        }
+
         /// Sets \c has_children attribute to value of \c flag.
         void set_has_children(bool flag) {
             _has_children = flag;
@@ -358,10 +366,10 @@ namespace madness {
             if (has_coeff()) {
 
 #if 1
-                coeff().add_SVD(t,args.thresh);
+                coeff().add_SVD(t,args);
                 if (buffer.rank()<coeff().rank()) {
                     if (buffer.has_data()) {
-                        buffer.add_SVD(coeff(),args.thresh);
+                        buffer.add_SVD(coeff(),args);
                     } else {
                         buffer=copy(coeff());
                     }
@@ -391,7 +399,7 @@ namespace madness {
 
         void consolidate_buffer(const TensorArgs& args) {
             if ((coeff().has_data()) and (buffer.has_data())) {
-                coeff().add_SVD(buffer,args.thresh);
+                coeff().add_SVD(buffer,args);
             } else if (buffer.has_data()) {
                 coeff()=buffer;
             }
@@ -955,7 +963,8 @@ namespace madness {
             , autorefine(factory._autorefine)
             , truncate_on_project(factory._truncate_on_project)
             , nonstandard(false)
-            , targs(factory._thresh,FunctionDefaults<NDIM>::get_tensor_type())
+            , targs(factory._thresh,FunctionDefaults<NDIM>::get_tensor_type(),
+                    FunctionDefaults<NDIM>::get_rank_reduction())
             , cdata(FunctionCommonData<T,NDIM>::get(k))
             , functor(factory.get_functor())
             , on_demand(factory._is_on_demand)
@@ -2151,7 +2160,7 @@ namespace madness {
             bool operator()(typename rangeT::iterator& it) const {
 
                 nodeT& node = it->second;
-                node.reduceRank(args.thresh);
+                node.reduceRank(args);
                 return true;
             }
             template <typename Archive> void serialize(const Archive& ar) {}
@@ -2494,6 +2503,77 @@ namespace madness {
             world.gop.fence();
         }
 
+        /// Inplace operate on many functions with a pointwise operator in a batch of boxes
+
+        /// The values of each function in all boxes of the batch are gathered
+        /// into one contiguous tensor of shape (nbox*k,k,...), the operator is
+        /// evaluated once on the whole batch, and the result is scattered back
+        /// into the boxes.
+        /// @param[in] keys the keys of the boxes of the batch
+        /// @param[in] op the operator, called as op(keys, values)
+        /// @param[in] v the vector of function impl's on which to be operated
+        template <typename opT>
+        void multiop_values_batch_doit(const std::vector<keyT>& keys, const opT& op,
+                const std::vector<implT*>& v) {
+            std::vector<long> dims(NDIM,k);
+            dims[0]=keys.size()*k;
+            std::vector<Slice> s(NDIM,_);
+
+            std::vector<tensorT> c(v.size());
+            for (unsigned int i=0; i<v.size(); i++) {
+                if (v[i]) {
+                    c[i]=tensorT(dims,false);
+                    for (std::size_t b=0; b<keys.size(); ++b) {
+                        s[0]=Slice(b*k,(b+1)*k-1);
+                        coeffT cc = coeffs2values(keys[b], v[i]->coeffs.find(keys[b]).get()->second.coeff());
+                        c[i](s)=cc.full_tensor();
+                    }
+                }
+            }
+            const tensorT r = op(keys, c);
+            for (std::size_t b=0; b<keys.size(); ++b) {
+                s[0]=Slice(b*k,(b+1)*k-1);
+                const tensorT rb=copy(r(s));
+                coeffs.replace(keys[b], nodeT(coeffT(values2coeffs(keys[b], rb),targs),false));
+            }
+        }
+
+        /// Inplace operate on many functions (impl's) with a pointwise operator, batching boxes
+
+        /// Same as multiop_values, but the leaf boxes are processed in batches
+        /// of nbox boxes, so that the operator is called on long contiguous
+        /// arrays of points instead of once per box.
+        /// Assumes all functions have been refined down to the same level
+        /// @param[in] op the operator, called as op(keys, values) on a batch
+        /// @param[in] v the vector of function impl's on which to be operated
+        /// @param[in] nbox the number of boxes in a batch
+        template <typename opT>
+        void multiop_values_batched(const opT& op, const std::vector<implT*>& v, const std::size_t nbox) {
+            for (std::size_t i=1; i<v.size(); ++i) {
+                if (v[i] and v[i-1]) {
+                    MADNESS_ASSERT(v[i]->coeffs.size()==v[i-1]->coeffs.size());
+                }
+            }
+            std::vector<keyT> keys;
+            typename dcT::iterator end = v[0]->coeffs.end();
+            for (typename dcT::iterator it=v[0]->coeffs.begin(); it!=end; ++it) {
+                const keyT& key = it->first;
+                if (it->second.has_coeff()) {
+                    keys.push_back(key);
+                    if (keys.size()>=nbox) {
+                        world.taskq.add(*this, &implT:: template multiop_values_batch_doit<opT>, keys, op, v);
+                        keys.clear();
+                    }
+                } else {
+                    coeffs.replace(key, nodeT(coeffT(),true));
+                }
+            }
+            if (keys.size()>0) {
+                world.taskq.add(*this, &implT:: template multiop_values_batch_doit<opT>, keys, op, v);
+            }
+            world.gop.fence();
+        }
+
         /// Transforms a vector of functions left[i] = sum[j] right[j]*c[j,i] using sparsity
         /// @param[in] vright vector of functions (impl's) on which to be transformed
         /// @param[in] c the tensor (matrix) transformer
@@ -2511,6 +2591,124 @@ namespace madness {
                 world.gop.fence();
         }
 
+        /// Transforms the coefficients of a range of keys of the union map of vright
+
+        /// For each key the coefficients of all input functions are stacked
+        /// into a matrix and all output coefficients at this key are formed
+        /// with a single matrix product.  Contributions with
+        /// |c(j,i)|*||right[j]|| below truncate_tol(tol,key) are dropped, and
+        /// outputs without any contribution are not created.
+        template <typename Q, typename R>
+        static void vtransform_keys_doit(const typename FunctionImpl<R,NDIM>::mapT::iterator start,
+                                         const typename FunctionImpl<R,NDIM>::mapT::iterator end,
+                                         const Tensor<Q> c,
+                                         const std::vector< std::shared_ptr< FunctionImpl<T,NDIM> > > vleft,
+                                         const double tol) {
+            typedef typename FunctionImpl<R,NDIM>::mapvecT rmapvecT;
+            const long m = c.dim(1);
+            std::vector<double> norms;
+            std::vector<long> active;
+
+            for (typename FunctionImpl<R,NDIM>::mapT::iterator it=start; it!=end; ++it) {
+                const keyT& key = it->first;
+                const rmapvecT& rightv = it->second;
+                const long nright = rightv.size();
+                const double keytol = vleft[0]->truncate_tol(tol,key);
+
+                norms.resize(nright);
+                bool full = true;
+                for (long jv=0; jv<nright; ++jv) {
+                    norms[jv] = rightv[jv].second->normf();
+                    full = full && (rightv[jv].second->tensor_type()==TT_FULL);
+                }
+
+                // screened transformation matrix restricted to the inputs present at this key
+                Tensor<Q> csub(nright,m);
+                active.clear();
+                for (long i=0; i<m; ++i) {
+                    bool any = false;
+                    for (long jv=0; jv<nright; ++jv) {
+                        const Q cji = c(rightv[jv].first,i);
+                        if (std::abs(norms[jv]*cji) > keytol) {
+                            csub(jv,i) = cji;
+                            any = true;
+                        }
+                    }
+                    if (any) active.push_back(i);
+                }
+                if (active.empty()) continue;
+
+                // all outputs at this key in one product; low-rank coefficients are accumulated
+                Tensor<T> result;
+                if (full) {
+                    const long size = rightv[0].second->full_tensor().size();
+                    Tensor<R> a(nright,size);
+                    for (long jv=0; jv<nright; ++jv) {
+                        a(jv,_) = rightv[jv].second->full_tensor().reshape(size);
+                    }
+                    Tensor<Q> cact(nright,long(active.size()));
+                    for (std::size_t ia=0; ia<active.size(); ++ia) cact(_,ia) = csub(_,active[ia]);
+                    result = inner(cact,a,0,0);
+                }
+
+                for (std::size_t ia=0; ia<active.size(); ++ia) {
+                    const long i = active[ia];
+                    implT* left = vleft[i].get();
+                    typename dcT::accessor acc;
+                    bool newnode = left->coeffs.insert(acc,key);
+                    if (newnode && key.level()>0) {
+                        Key<NDIM> parent = key.parent();
+                        left->coeffs.send(parent, &nodeT::set_has_children_recursive, left->coeffs, parent);
+                    }
+                    nodeT& node = acc->second;
+                    if (full) {
+                        const Tensor<R>& r0 = rightv[0].second->full_tensor();
+                        std::vector<long> dims(r0.dims(),r0.dims()+r0.ndim());
+                        coeffT r(copy(result(ia,_)).reshape(dims),left->get_tensor_args());
+                        if (node.has_coeff()) node.coeff().gaxpy(1.0,r,1.0);
+                        else node.set_coeff(r);
+                    } else {
+                        if (!node.has_coeff()) node.set_coeff(coeffT(left->cdata.v2k,left->get_tensor_args()));
+                        for (long jv=0; jv<nright; ++jv) {
+                            if (csub(jv,i) != Q(0.0)) node.coeff().gaxpy(1.0,*(rightv[jv].second),csub(jv,i));
+                        }
+                    }
+                }
+            }
+        }
+
+        /// Transforms a vector of functions key by key: left[i] = sum[j] right[j]*c[j,i]
+
+        /// In contrast to vtransform, which loops over the input functions,
+        /// the union of the local keys of all inputs is traversed once and all
+        /// outputs of a key are formed together (see vtransform_keys_doit).
+        /// Inputs and outputs must be compressed and share the process map.
+        /// Local tasks are fenced on return, remote messages are not.
+        /// @param[in] vright vector of functions (impl's) on which to be transformed
+        /// @param[in] c the tensor (matrix) transformer
+        /// @param[in] vleft vector of of the *newly* transformed functions (impl's)
+        /// @param[in] tol screening threshold, see vtransform
+        template <typename Q, typename R>
+        static void vtransform_keys(const std::vector<const FunctionImpl<R,NDIM>*>& vright,
+                                    const Tensor<Q>& c,
+                                    const std::vector< std::shared_ptr< FunctionImpl<T,NDIM> > >& vleft,
+                                    double tol) {
+            typedef typename FunctionImpl<R,NDIM>::mapT rmapT;
+            if (vright.empty()) return;
+            World& world = vright[0]->world;
+            rmapT rmap = FunctionImpl<R,NDIM>::make_key_vec_map(vright);
+
+            size_t chunk = (rmap.size()-1)/(3*4*5)+1;
+            typename rmapT::iterator start=rmap.begin();
+            while (start != rmap.end()) {
+                typename rmapT::iterator end = start;
+                advance(end,chunk);
+                world.taskq.add(&implT:: template vtransform_keys_doit<Q,R>, start, end, c, vleft, tol);
+                start = end;
+            }
+            world.taskq.fence();
+        }
+
         /// Unary operation applied inplace to the values with optional refinement and fence
         /// @param[in] op the unary operator for the values
         template <typename opT>
@@ -2522,8 +2720,32 @@ namespace madness {
                 world.gop.fence();
         }
 
+        /// Returns the coefficients (empty if none) and the norm of the tree of the local node key
+
+        /// Executed by the owner of key on behalf of find_coeff_norm_tree.
+        std::pair<Tensor<T>,double> get_coeff_norm_tree(const keyT& key) const {
+            typename dcT::const_iterator it = coeffs.find(key).get();
+            MADNESS_ASSERT(it != coeffs.end());
+            Tensor<T> c;
+            if (it->second.has_coeff()) c = it->second.coeff().full_tensor_copy();
+            return std::pair<Tensor<T>,double>(c, it->second.get_norm_tree());
+        }
+
+        /// Future of the coefficients and the norm of the tree of node key, without waiting
+
+        /// The future of a local node is assigned at once, a remote node is
+        /// requested from its owner.  The recursive descents below pass these
+        /// futures as task arguments, so that a running task never waits on a
+        /// remote node (ThreadPool::await would run other tasks on its stack).
+        Future< std::pair<Tensor<T>,double> > find_coeff_norm_tree(const keyT& key) const {
+            if (coeffs.is_local(key)) return Future< std::pair<Tensor<T>,double> >(get_coeff_norm_tree(key));
+            return woT::task(coeffs.owner(key), &implT::get_coeff_norm_tree, key, TaskAttributes::hipri());
+        }
+
         // Multiplication assuming same distribution and recursive descent
-        /// Both left and right functions are in the scaling function basis
+        /// Both left and right functions are in the scaling function basis.
+        /// Nodes not passed down are fetched with find_coeff_norm_tree; if
+        /// any is remote the work continues in a task that depends on them.
         /// @param[in] key the key to the current function node (box)
         /// @param[in] left the function impl associated with the left function
         /// @param[in] lcin the scaling function coefficients associated with the
@@ -2540,19 +2762,33 @@ namespace madness {
                        const std::vector< Tensor<R> >& vrcin,
                        const std::vector<FunctionImpl<T,NDIM>*> vresultin,
                        double tol) {
-            typedef typename FunctionImpl<L,NDIM>::dcT::const_iterator literT;
-            typedef typename FunctionImpl<R,NDIM>::dcT::const_iterator riterT;
+            typedef std::pair<Tensor<L>,double> lnodeT;
+            typedef std::pair<Tensor<R>,double> rnodeT;
 
-            double lnorm = 1e99;
-            Tensor<L> lc = lcin;
-            if (lc.size() == 0) {
-                literT it = left->coeffs.find(key).get();
-                MADNESS_ASSERT(it != left->coeffs.end());
-                lnorm = it->second.get_norm_tree();
-                if (it->second.has_coeff())
-                    lc = it->second.coeff().full_tensor_copy();
+            const Future<lnodeT> lnode = lcin.size() ? Future<lnodeT>(lnodeT(lcin,1e99)) : left->find_coeff_norm_tree(key);
+            bool ready = lnode.probe();
+            std::vector< Future<rnodeT> > vrnode = future_vector_factory<rnodeT>(vrightin.size());
+            for (unsigned int i=0; i<vrightin.size(); ++i) {
+                vrnode[i] = vrcin[i].size() ? Future<rnodeT>(rnodeT(vrcin[i],vrcin[i].normf()))
+                    : vrightin[i]->find_coeff_norm_tree(key);
+                ready = ready and vrnode[i].probe();
             }
 
+            if (ready) mulXXveca_node<L,R>(key, left, lnode.get(), vrightin, vrnode, vresultin, tol);
+            else woT::task(world.rank(), &implT:: template mulXXveca_node<L,R>, key, left, lnode, vrightin, vrnode, vresultin, tol);
+        }
+
+        /// Continuation of mulXXveca once the nodes of all functions are available
+        template <typename L, typename R>
+        void mulXXveca_node(const keyT& key,
+                            const FunctionImpl<L,NDIM>* left, const std::pair<Tensor<L>,double>& lnode,
+                            const std::vector<const FunctionImpl<R,NDIM>*> vrightin,
+                            const std::vector< Future< std::pair<Tensor<R>,double> > >& vrnode,
+                            const std::vector<FunctionImpl<T,NDIM>*> vresultin,
+                            double tol) {
+            const Tensor<L>& lc = lnode.first;
+            const double lnorm = lnode.second;
+
             // Loop thru RHS functions seeing if anything can be multiplied
             std::vector<FunctionImpl<T,NDIM>*> vresult;
             std::vector<const FunctionImpl<R,NDIM>*> vright;
@@ -2564,18 +2800,8 @@ namespace madness {
             for (unsigned int i=0; i<vrightin.size(); ++i) {
                 FunctionImpl<T,NDIM>* result = vresultin[i];
                 const FunctionImpl<R,NDIM>* right = vrightin[i];
-                Tensor<R> rc = vrcin[i];
-                double rnorm;
-                if (rc.size() == 0) {
-                    riterT it = right->coeffs.find(key).get();
-                    MADNESS_ASSERT(it != right->coeffs.end());
-                    rnorm = it->second.get_norm_tree();
-                    if (it->second.has_coeff())
-                        rc = it->second.coeff().full_tensor_copy();
-                }
-                else {
-                    rnorm = rc.normf();
-                }
+                const Tensor<R>& rc = vrnode[i].get().first;
+                const double rnorm = vrnode[i].get().second;
 
                 if (rc.size() && lc.size()) { // Yipee!
                     result->task(world.rank(), &implT:: template do_mul<L,R>, key, lc, std::make_pair(key,rc));
@@ -2629,7 +2855,9 @@ namespace madness {
         }
 
         /// Multiplication using recursive descent and assuming same distribution
-        /// Both left and right functions are in the scaling function basis
+        /// Both left and right functions are in the scaling function basis.
+        /// Nodes not passed down are fetched with find_coeff_norm_tree; if
+        /// one is remote the work continues in a task that depends on it.
         /// @param[in] key the key to the current function node (box)
         /// @param[in] left the function impl associated with the left function
         /// @param[in] lcin the scaling function coefficients associated with the
@@ -2642,28 +2870,25 @@ namespace madness {
                     const FunctionImpl<L,NDIM>* left, const Tensor<L>& lcin,
                     const FunctionImpl<R,NDIM>* right,const Tensor<R>& rcin,
                     double tol) {
-            typedef typename FunctionImpl<L,NDIM>::dcT::const_iterator literT;
-            typedef typename FunctionImpl<R,NDIM>::dcT::const_iterator riterT;
-
-            double lnorm=1e99, rnorm=1e99;
-
-            Tensor<L> lc = lcin;
-            if (lc.size() == 0) {
-                literT it = left->coeffs.find(key).get();
-                MADNESS_ASSERT(it != left->coeffs.end());
-                lnorm = it->second.get_norm_tree();
-                if (it->second.has_coeff())
-                    lc = it->second.coeff().full_tensor_copy();
-            }
+            typedef std::pair<Tensor<L>,double> lnodeT;
+            typedef std::pair<Tensor<R>,double> rnodeT;
+            const Future<lnodeT> lnode = lcin.size() ? Future<lnodeT>(lnodeT(lcin,1e99)) : left->find_coeff_norm_tree(key);
+            const Future<rnodeT> rnode = rcin.size() ? Future<rnodeT>(rnodeT(rcin,1e99)) : right->find_coeff_norm_tree(key);
+            if (lnode.probe() and rnode.probe())
+                mulXXa_node<L,R>(key, left, lnode.get(), right, rnode.get(), tol);
+            else
+                woT::task(world.rank(), &implT:: template mulXXa_node<L,R>, key, left, lnode, right, rnode, tol);
+        }
 
-            Tensor<R> rc = rcin;
-            if (rc.size() == 0) {
-                riterT it = right->coeffs.find(key).get();
-                MADNESS_ASSERT(it != right->coeffs.end());
-                rnorm = it->second.get_norm_tree();
-                if (it->second.has_coeff())
-                    rc = it->second.coeff().full_tensor_copy();
-            }
+        /// Continuation of mulXXa once the nodes of left and right are available
+        template <typename L, typename R>
+        void mulXXa_node(const keyT& key,
+                         const FunctionImpl<L,NDIM>* left, const std::pair<Tensor<L>,double>& lnode,
+                         const FunctionImpl<R,NDIM>* right, const std::pair<Tensor<R>,double>& rnode,
+                         double tol) {
+            const Tensor<L>& lc = lnode.first;
+            const Tensor<R>& rc = rnode.first;
+            double lnorm = lnode.second, rnorm = rnode.second;
 
             // both nodes are leaf nodes: multiply and return
             if (rc.size() && lc.size()) { // Yipee!
@@ -2714,7 +2939,8 @@ namespace madness {
 
 
         // Binary operation on values using recursive descent and assuming same distribution
-        /// Both left and right functions are in the scaling function basis
+        /// Both left and right functions are in the scaling function basis.
+        /// Nodes not passed down are fetched as in mulXXa.
         /// @param[in] key the key to the current function node (box)
         /// @param[in] left the function impl associated with the left function
         /// @param[in] lcin the scaling function coefficients associated with the
@@ -2728,24 +2954,24 @@ namespace madness {
                        const FunctionImpl<L,NDIM>* left, const Tensor<L>& lcin,
                        const FunctionImpl<R,NDIM>* right,const Tensor<R>& rcin,
                        const opT& op) {
-            typedef typename FunctionImpl<L,NDIM>::dcT::const_iterator literT;
-            typedef typename FunctionImpl<R,NDIM>::dcT::const_iterator riterT;
-
-            Tensor<L> lc = lcin;
-            if (lc.size() == 0) {
-                literT it = left->coeffs.find(key).get();
-                MADNESS_ASSERT(it != left->coeffs.end());
-                if (it->second.has_coeff())
-                    lc = it->second.coeff().full_tensor_copy();
-            }
+            typedef std::pair<Tensor<L>,double> lnodeT;
+            typedef std::pair<Tensor<R>,double> rnodeT;
+            const Future<lnodeT> lnode = lcin.size() ? Future<lnodeT>(lnodeT(lcin,0.0)) : left->find_coeff_norm_tree(key);
+            const Future<rnodeT> rnode = rcin.size() ? Future<rnodeT>(rnodeT(rcin,0.0)) : right->find_coeff_norm_tree(key);
+            if (lnode.probe() and rnode.probe())
+                binaryXXa_node<L,R,opT>(key, left, lnode.get(), right, rnode.get(), op);
+            else
+                woT::task(world.rank(), &implT:: template binaryXXa_node<L,R,opT>, key, left, lnode, right, rnode, op);
+        }
 
-            Tensor<R> rc = rcin;
-            if (rc.size() == 0) {
-                riterT it = right->coeffs.find(key).get();
-                MADNESS_ASSERT(it != right->coeffs.end());
-                if (it->second.has_coeff())
-                    rc = it->second.coeff().full_tensor_copy();
-            }
+        /// Continuation of binaryXXa once the nodes of left and right are available
+        template <typename L, typename R, typename opT>
+        void binaryXXa_node(const keyT& key,
+                            const FunctionImpl<L,NDIM>* left, const std::pair<Tensor<L>,double>& lnode,
+                            const FunctionImpl<R,NDIM>* right, const std::pair<Tensor<R>,double>& rnode,
+                            const opT& op) {
+            const Tensor<L>& lc = lnode.first;
+            const Tensor<R>& rc = rnode.first;
 
             if (rc.size() && lc.size()) { // Yipee!
                 do_binary_op<L,R>(key, lc, std::make_pair(key,rc), op);
@@ -2818,9 +3044,18 @@ namespace madness {
         template <typename Q, typename opT>
         void unaryXXa(const keyT& key,
                       const FunctionImpl<Q,NDIM>* func, const opT& op) {
+            const Future< std::pair<Tensor<Q>,double> > node = func->find_coeff_norm_tree(key);
+            if (node.probe())
+                unaryXXa_node<Q,opT>(key, func, node.get(), op);
+            else
+                woT::task(world.rank(), &implT:: template unaryXXa_node<Q,opT>, key, func, node, op);
+        }
 
-            //            const Tensor<Q>& fc = func->coeffs.find(key).get()->second.full_tensor_copy();
-            const Tensor<Q> fc = func->coeffs.find(key).get()->second.coeff().full_tensor_copy();
+        /// Continuation of unaryXXa once the node of func is available
+        template <typename Q, typename opT>
+        void unaryXXa_node(const keyT& key, const FunctionImpl<Q,NDIM>* func,
+                           const std::pair<Tensor<Q>,double>& node, const opT& op) {
+            const Tensor<Q>& fc = node.first;
 
             if (fc.size() == 0) {
                 // Recur down
@@ -2910,6 +3145,360 @@ namespace madness {
                 world.gop.fence();
         }
 
+        /// Returns true if the product of two coefficient blocks needs autorefining
+
+        /// same test as autorefine_square_test(), applied to the product of
+        /// the blocks weighted by c
+        bool mul_autorefine_test(const keyT& key, const tensorT& lc,
+                                 const tensorT& rc, const double c) const {
+            double llo, lhi, rlo, rhi;
+            tnorm(lc, &llo, &lhi);
+            tnorm(rc, &rlo, &rhi);
+            const double test = std::abs(c)*(llo*rhi + lhi*rlo + lhi*rhi);
+            return test > truncate_tol(thresh, key);
+        }
+
+        /// Accumulates c*left*right into the (redundant) tree of this using recursive descent
+
+        /// Both functions are in the scaling function basis and have the same
+        /// distribution as this. The product is formed at the finest common
+        /// level of left and right (autorefined if requested) and added to
+        /// the node of this, creating the node and its parents if necessary.
+        /// The tree of this must be summed down afterwards.
+        /// @param[in] key the key to the current function node (box)
+        /// @param[in] left the function impl associated with the left function
+        /// @param[in] lcin the coefficients of the left function passed from above (may be empty)
+        /// @param[in] right the function impl associated with the right function (may be left)
+        /// @param[in] rcin the coefficients of the right function passed from above (may be empty)
+        /// @param[in] c the weight of the product
+        void mulsum_paira(const keyT& key,
+                          const implT* left, const tensorT& lcin,
+                          const implT* right, const tensorT& rcin,
+                          const double c) {
+            typedef std::pair<tensorT,double> tnodeT;
+            const Future<tnodeT> lnode = lcin.size() ? Future<tnodeT>(tnodeT(lcin,0.0)) : left->find_coeff_norm_tree(key);
+            const Future<tnodeT> rnode = (left==right) ? lnode
+                : (rcin.size() ? Future<tnodeT>(tnodeT(rcin,0.0)) : right->find_coeff_norm_tree(key));
+            if (lnode.probe() and rnode.probe())
+                mulsum_paira_node(key, left, lnode.get(), right, rnode.get(), c);
+            else
+                woT::task(world.rank(), &implT::mulsum_paira_node, key, left, lnode, right, rnode, c);
+        }
+
+        /// Continuation of mulsum_paira once the nodes of left and right are available
+        void mulsum_paira_node(const keyT& key,
+                               const implT* left, const std::pair<tensorT,double>& lnode,
+                               const implT* right, const std::pair<tensorT,double>& rnode,
+                               const double c) {
+            const bool same=(left==right);
+            const tensorT& lc = lnode.first;
+            const tensorT& rc = rnode.first;
+
+            // both nodes have coefficients: multiply, accumulate and return
+            if (lc.size() && rc.size()) {
+                const bool refine=autorefine and (key.level()<max_refine_level)
+                        and mul_autorefine_test(key, lc, rc, c);
+                if (not refine) {
+                    tensorT lcube = fcube_for_mul(key, key, lc);
+                    tensorT rcube = same ? lcube : fcube_for_mul(key, key, rc);
+                    tensorT tcube(cdata.vk,false);
+                    TERNARY_OPTIMIZED_ITERATOR(T, tcube, T, lcube, T, rcube, *_p0 = c * *_p1 * *_p2;);
+                    double scale = pow(0.5,0.5*NDIM*key.level())*sqrt(FunctionDefaults<NDIM>::get_cell_volume());
+                    tcube = transform(tcube,cdata.quad_phiw).scale(scale);
+                    coeffs.task(key, &nodeT::accumulate2, tcube, coeffs, key, TaskAttributes::hipri());
+                    return;
+                }
+            }
+
+            // Recur down
+            tensorT lss, rss;
+            if (lc.size()) {
+                tensorT d(cdata.v2k);
+                d(cdata.s0) = lc(___);
+                lss = unfilter(d);
+            }
+            if ((not same) and rc.size()) {
+                tensorT d(cdata.v2k);
+                d(cdata.s0) = rc(___);
+                rss = unfilter(d);
+            }
+
+            for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+                const keyT& child = kit.key();
+                tensorT ll, rr;
+                if (lss.size()) ll = copy(lss(child_patch(child)));
+                if (rss.size()) rr = copy(rss(child_patch(child)));
+                woT::task(coeffs.owner(child), &implT::mulsum_paira, child, left, ll, right, rr, c);
+            }
+        }
+
+        /// Accumulates the values sum_ij c_ij left_i right_j in box key and stores them as leaf
+
+        /// @param[in] key the key to the current function node (box)
+        /// @param[in] vlc the scaling function coefficients of the left functions in this box
+        /// @param[in] vrc the scaling function coefficients of the right functions in this box
+        /// @param[in] c the matrix of coefficients
+        void do_mulsum_matrix(const keyT& key,
+                              const std::vector<tensorT>& vlc,
+                              const std::vector<tensorT>& vrc,
+                              const Tensor<double>& c) {
+            std::vector<tensorT> lcube(vlc.size()), rcube(vrc.size());
+            for (std::size_t i=0; i<vlc.size(); ++i) lcube[i]=fcube_for_mul(key, key, vlc[i]);
+            for (std::size_t j=0; j<vrc.size(); ++j) rcube[j]=fcube_for_mul(key, key, vrc[j]);
+
+            // contract the left functions with the matrix first: h_j = sum_i c_ij left_i
+            tensorT tcube(cdata.vk);
+            tensorT h(cdata.vk,false);
+            for (std::size_t j=0; j<rcube.size(); ++j) {
+                bool nonzero=false;
+                h.fill(0.0);
+                for (std::size_t i=0; i<lcube.size(); ++i) {
+                    const double cij=c(i,j);
+                    if (cij==0.0) continue;
+                    h.gaxpy(1.0,lcube[i],cij);
+                    nonzero=true;
+                }
+                if (nonzero) {
+                    TERNARY_OPTIMIZED_ITERATOR(T, tcube, T, h, T, rcube[j], *_p0 += *_p1 * *_p2;);
+                }
+            }
+            double scale = pow(0.5,0.5*NDIM*key.level())*sqrt(FunctionDefaults<NDIM>::get_cell_volume());
+            tcube = transform(tcube,cdata.quad_phiw).scale(scale);
+            coeffs.replace(key, nodeT(coeffT(tcube,targs),false));
+        }
+
+        /// Fused sum sum_ij c_ij left_i right_j using recursive descent
+
+        /// All functions are in the scaling function basis and have the same
+        /// distribution as this. Since every left function is multiplied with
+        /// every right function the products are formed in the finest common
+        /// box of all functions: coefficients of functions whose leaves are
+        /// above the current box are passed down from the parent, all other
+        /// coefficients are taken from the nodes (find_coeff_norm_tree).
+        /// @param[in] key the key to the current function node (box)
+        /// @param[in] vleft the function impl's of the left functions
+        /// @param[in] vlcin the coefficients of the left functions passed from above (may be empty)
+        /// @param[in] vright the function impl's of the right functions
+        /// @param[in] vrcin the coefficients of the right functions passed from above (may be empty)
+        /// @param[in] c the matrix of coefficients
+        void mulsum_matrixa(const keyT& key,
+                            const std::vector<const implT*>& vleft,
+                            const std::vector<tensorT>& vlcin,
+                            const std::vector<const implT*>& vright,
+                            const std::vector<tensorT>& vrcin,
+                            const Tensor<double>& c) {
+            typedef std::pair<tensorT,double> tnodeT;
+            bool ready=true;
+            std::vector< Future<tnodeT> > vlnode = future_vector_factory<tnodeT>(vleft.size());
+            for (std::size_t i=0; i<vleft.size(); ++i) {
+                vlnode[i] = (vlcin.size() and vlcin[i].size()) ? Future<tnodeT>(tnodeT(vlcin[i],0.0))
+                    : vleft[i]->find_coeff_norm_tree(key);
+                ready = ready and vlnode[i].probe();
+            }
+            std::vector< Future<tnodeT> > vrnode = future_vector_factory<tnodeT>(vright.size());
+            for (std::size_t j=0; j<vright.size(); ++j) {
+                vrnode[j] = (vrcin.size() and vrcin[j].size()) ? Future<tnodeT>(tnodeT(vrcin[j],0.0))
+                    : vright[j]->find_coeff_norm_tree(key);
+                ready = ready and vrnode[j].probe();
+            }
+            if (ready) mulsum_matrixa_node(key, vleft, vlnode, vright, vrnode, c);
+            else woT::task(world.rank(), &implT::mulsum_matrixa_node, key, vleft, vlnode, vright, vrnode, c);
+        }
+
+        /// Continuation of mulsum_matrixa once the nodes of all functions are available
+        void mulsum_matrixa_node(const keyT& key,
+                                 const std::vector<const implT*>& vleft,
+                                 const std::vector< Future< std::pair<tensorT,double> > >& vlnode,
+                                 const std::vector<const implT*>& vright,
+                                 const std::vector< Future< std::pair<tensorT,double> > >& vrnode,
+                                 const Tensor<double>& c) {
+            bool all_leaves=true;
+            std::vector<tensorT> vlc(vleft.size()), vrc(vright.size());
+            for (std::size_t i=0; i<vleft.size(); ++i) {
+                vlc[i] = vlnode[i].get().first;
+                if (vlc[i].size()==0) all_leaves=false;
+            }
+            for (std::size_t j=0; j<vright.size(); ++j) {
+                vrc[j] = vrnode[j].get().first;
+                if (vrc[j].size()==0) all_leaves=false;
+            }
+
+            // all functions have coefficients: multiply and return
+            if (all_leaves) {
+                bool refine=false;
+                if (autorefine and (key.level()<max_refine_level)) {
+                    for (std::size_t i=0; (i<vlc.size()) and (not refine); ++i) {
+                        for (std::size_t j=0; (j<vrc.size()) and (not refine); ++j) {
+                            if (c(i,j)!=0.0) refine=mul_autorefine_test(key, vlc[i], vrc[j], c(i,j));
+                        }
+                    }
+                }
+                if (not refine) {
+                    do_mulsum_matrix(key, vlc, vrc, c);
+                    return;
+                }
+            }
+
+            // Recur down
+            coeffs.replace(key, nodeT(coeffT(),true)); // Interior node
+
+            std::vector<tensorT> vlss(vlc.size()), vrss(vrc.size());
+            for (std::size_t i=0; i<vlc.size(); ++i) {
+                if (vlc[i].size()) {
+                    tensorT d(cdata.v2k);
+                    d(cdata.s0) = vlc[i](___);
+                    vlss[i] = unfilter(d);
+                }
+            }
+            for (std::size_t j=0; j<vrc.size(); ++j) {
+                if (vrc[j].size()) {
+                    tensorT d(cdata.v2k);
+                    d(cdata.s0) = vrc[j](___);
+                    vrss[j] = unfilter(d);
+                }
+            }
+
+            for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+                const keyT& child = kit.key();
+                const std::vector<Slice> cp = child_patch(child);
+                std::vector<tensorT> ll(vlss.size()), rr(vrss.size());
+                for (std::size_t i=0; i<vlss.size(); ++i) {
+                    if (vlss[i].size()) ll[i] = copy(vlss[i](cp));
+                }
+                for (std::size_t j=0; j<vrss.size(); ++j) {
+                    if (vrss[j].size()) rr[j] = copy(vrss[j](cp));
+                }
+                woT::task(coeffs.owner(child), &implT::mulsum_matrixa, child, vleft, ll, vright, rr, c);
+            }
+        }
+
+        /// Fused sum of products sum_i c_i left_i right_i or sum_ij c_ij left_i right_j into this
+
+        /// No intermediate functions are formed. For a vector c every product
+        /// is formed on the common tree of its two factors only and
+        /// accumulated into this, which is summed down at the end; the
+        /// vector case therefore always fences. For a matrix c all products
+        /// are formed in the finest common box of all functions.
+        /// All functions must be reconstructed and have the same distribution
+        /// as this, which must be empty.
+        /// @param[in] vleft vector of pointers to the left function impl's
+        /// @param[in] vright vector of pointers to the right function impl's
+        /// @param[in] c either a vector c_i or a matrix c_ij
+        /// @param[in] fence global fence at the end
+        void mulsumXX(const std::vector<const implT*>& vleft,
+                      const std::vector<const implT*>& vright,
+                      const Tensor<double>& c,
+                      bool fence) {
+            const bool iamroot=(world.rank() == coeffs.owner(cdata.key0));
+            if (c.ndim()==1) {
+                MADNESS_ASSERT(vleft.size()==vright.size());
+                if (iamroot) {
+                    for (std::size_t i=0; i<vleft.size(); ++i) {
+                        if (c(i)==0.0) continue;
+                        woT::task(world.rank(), &implT::mulsum_paira, cdata.key0,
+                                  vleft[i], tensorT(), vright[i], tensorT(), c(i));
+                    }
+                }
+                world.gop.fence();
+                sum_down(fence);
+            }
+            else {
+                if (iamroot)
+                    mulsum_matrixa(cdata.key0, vleft, std::vector<tensorT>(),
+                                   vright, std::vector<tensorT>(), c);
+                if (fence)
+                    world.gop.fence();
+            }
+        }
+
+        /// Evaluates a fused pointwise expression of the functions vleaf using recursive descent
+
+        /// As in mulsum_matrixa the expression is evaluated in the finest
+        /// common box of all leaves, with the coefficients of leaves that end
+        /// above the box passed down from the parent.  prog maps the
+        /// coefficients of the leaves in the box to those of the result and
+        /// may request autorefinement below the common box.
+        /// @param[in] key the key to the current function node (box)
+        /// @param[in] vleaf the function impl's of the leaves of the expression
+        /// @param[in] vcin the coefficients of the leaves passed from above (may be empty)
+        /// @param[in] prog the expression, see FunctionExpressionProgram
+        template <typename progT>
+        void expressiona(const keyT& key,
+                         const std::vector<const implT*>& vleaf,
+                         const std::vector<tensorT>& vcin,
+                         const progT& prog) {
+            typedef std::pair<tensorT,double> tnodeT;
+            bool ready=true;
+            std::vector< Future<tnodeT> > vnode = future_vector_factory<tnodeT>(vleaf.size());
+            for (std::size_t i=0; i<vleaf.size(); ++i) {
+                vnode[i] = (vcin.size() and vcin[i].size()) ? Future<tnodeT>(tnodeT(vcin[i],0.0))
+                    : vleaf[i]->find_coeff_norm_tree(key);
+                ready = ready and vnode[i].probe();
+            }
+            if (ready) expressiona_node<progT>(key, vleaf, vnode, prog);
+            else woT::task(world.rank(), &implT:: template expressiona_node<progT>, key, vleaf, vnode, prog);
+        }
+
+        /// Continuation of expressiona once the nodes of all leaves are available
+        template <typename progT>
+        void expressiona_node(const keyT& key,
+                              const std::vector<const implT*>& vleaf,
+                              const std::vector< Future< std::pair<tensorT,double> > >& vnode,
+                              const progT& prog) {
+            bool all_leaves=true;
+            std::vector<tensorT> vc(vleaf.size());
+            for (std::size_t i=0; i<vleaf.size(); ++i) {
+                vc[i] = vnode[i].get().first;
+                if (vc[i].size()==0) all_leaves=false;
+            }
+
+            // all leaves have coefficients: evaluate and return unless refinement is requested
+            if (all_leaves) {
+                bool refine=false;
+                const tensorT r=prog(this, key, vc, autorefine and (key.level()<max_refine_level), refine);
+                if (not refine) {
+                    coeffs.replace(key, nodeT(coeffT(r,targs),false));
+                    return;
+                }
+            }
+
+            // Recur down
+            coeffs.replace(key, nodeT(coeffT(),true)); // Interior node
+
+            std::vector<tensorT> vss(vc.size());
+            for (std::size_t i=0; i<vc.size(); ++i) {
+                if (vc[i].size()) {
+                    tensorT d(cdata.v2k);
+                    d(cdata.s0) = vc[i](___);
+                    vss[i] = unfilter(d);
+                }
+            }
+
+            for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+                const keyT& child = kit.key();
+                const std::vector<Slice> cp = child_patch(child);
+                std::vector<tensorT> cc(vss.size());
+                for (std::size_t i=0; i<vss.size(); ++i) {
+                    if (vss[i].size()) cc[i] = copy(vss[i](cp));
+                }
+                woT::task(coeffs.owner(child), &implT:: template expressiona<progT>, child, vleaf, cc, prog);
+            }
+        }
+
+        /// Evaluates a fused pointwise expression of the functions vleaf into this
+
+        /// All functions must be reconstructed and have the same k; this must be empty.
+        /// @param[in] vleaf vector of pointers to the function impl's of the leaves
+        /// @param[in] prog the expression, see FunctionExpressionProgram
+        /// @param[in] fence global fence at the end
+        template <typename progT>
+        void expressionXX(const std::vector<const implT*>& vleaf, const progT& prog, bool fence) {
+            if (world.rank() == coeffs.owner(cdata.key0))
+                expressiona(cdata.key0, vleaf, std::vector<tensorT>(), prog);
+            if (fence)
+                world.gop.fence();
+        }
+
         Future<double> get_norm_tree_recursive(const keyT& key) const;
 
         mutable long box_leaf[1000];
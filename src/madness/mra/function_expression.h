@@ -0,0 +1,409 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_FUNCTION_EXPRESSION_H__INCLUDED
+#define MADNESS_MRA_FUNCTION_EXPRESSION_H__INCLUDED
+
+/// \file function_expression.h
+/// \brief Lazy pointwise expressions of functions, evaluated in a single recursive descent
+
+/// An expression such as
+/// \code
+///   real_function_3d v = evaluate(lazy(vnuc) + lazy(vcoul) - 0.5*lazy(a)*lazy(b));
+/// \endcode
+/// records its operations in a DAG instead of forming intermediate
+/// functions.  evaluate() visits the union of the trees of all functions
+/// once: in the finest common box of all functions the linear operations
+/// combine coefficients, products and unary operations combine the values at
+/// the quadrature points, products refine the result where autorefinement
+/// asks for it, and the result is truncated once.  Operators that are not
+/// pointwise, such as apply or derivatives, need a materialized Function and
+/// therefore end an expression.
+///
+/// Subexpressions that are shared in the DAG are evaluated once per box,
+/// and a function that appears several times is read once.
+
+#include <madness/mra/mra.h>
+#include <madness/tensor/vmath.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace madness {
+
+    /// The compiled form of a FunctionExpression, evaluated box by box by FunctionImpl::expressiona
+
+    /// Each instruction computes one function in the box from the leaves or
+    /// from the results of earlier instructions; the last instruction is the
+    /// result.
+    template <typename T>
+    struct FunctionExpressionProgram {
+        enum opcode {LEAF, SCALE, ADD_SCALAR, GAXPY, MUL, EXP, SQRT, LOG, ABS, INVERSE};
+
+        struct instruction {
+            int op;
+            int a, b;           ///< leaf index for LEAF, otherwise operand instructions
+            T alpha, beta;
+            template <typename Archive>
+            void serialize(Archive& ar) {ar & op & a & b & alpha & beta;}
+        };
+
+        std::vector<instruction> code;
+
+        /// Coefficients of the expression in box key from the coefficients of the leaves
+
+        /// Linear instructions act on the coefficients as long as their
+        /// operands are available as coefficients; products and unary
+        /// operations act on the values at the quadrature points.
+        /// @param[in] impl the result, used for the transformations and the autorefinement test
+        /// @param[in] key the box
+        /// @param[in] leaf the scaling function coefficients of the leaves in the box
+        /// @param[in] test_refine if true, products are tested for autorefinement
+        /// @param[out] refine set if a product needs to be refined below key
+        template <typename implT, typename keyT>
+        Tensor<T> operator()(const implT* impl, const keyT& key, const std::vector< Tensor<T> >& leaf,
+                             const bool test_refine, bool& refine) const {
+            // each instruction has its coefficients c[i] or its values v[i], or both
+            std::vector< Tensor<T> > c(code.size()), v(code.size());
+            auto coeff = [&](const int i) -> const Tensor<T>& {
+                if (c[i].size() == 0) c[i] = impl->values2coeffs(key, v[i]);
+                return c[i];
+            };
+            auto value = [&](const int i) -> const Tensor<T>& {
+                if (v[i].size() == 0) v[i] = impl->coeffs2values(key, c[i]);
+                return v[i];
+            };
+
+            for (std::size_t i=0; i<code.size(); ++i) {
+                const instruction& in = code[i];
+                switch (in.op) {
+                case LEAF:
+                    c[i] = leaf[in.a];
+                    break;
+                case SCALE:
+                    if (c[in.a].size()) c[i] = c[in.a]*in.alpha;
+                    else v[i] = v[in.a]*in.alpha;
+                    break;
+                case ADD_SCALAR:
+                    v[i] = copy(value(in.a));
+                    v[i] += in.alpha;
+                    break;
+                case GAXPY:
+                    if (c[in.a].size() and c[in.b].size()) {
+                        c[i] = copy(c[in.a]);
+                        c[i].gaxpy(in.alpha, c[in.b], in.beta);
+                    }
+                    else {
+                        v[i] = copy(value(in.a));
+                        v[i].gaxpy(in.alpha, value(in.b), in.beta);
+                    }
+                    break;
+                case MUL:
+                    if (test_refine and not refine) {
+                        refine = impl->mul_autorefine_test(key, coeff(in.a), coeff(in.b), 1.0);
+                    }
+                    v[i] = copy(value(in.a));
+                    v[i].emul(value(in.b));
+                    break;
+                case EXP:
+                    v[i] = vexp(value(in.a));
+                    break;
+                case SQRT:
+                    v[i] = copy(value(in.a));
+                    UNARY_OPTIMIZED_ITERATOR(T, v[i], *_p0 = std::sqrt(*_p0););
+                    break;
+                case LOG:
+                    v[i] = copy(value(in.a));
+                    UNARY_OPTIMIZED_ITERATOR(T, v[i], *_p0 = std::log(*_p0););
+                    break;
+                case ABS:
+                    v[i] = copy(value(in.a));
+                    UNARY_OPTIMIZED_ITERATOR(T, v[i], *_p0 = std::abs(*_p0););
+                    break;
+                case INVERSE:
+                    v[i] = copy(value(in.a));
+                    UNARY_OPTIMIZED_ITERATOR(T, v[i], *_p0 = T(1)/(*_p0););
+                    break;
+                default:
+                    MADNESS_EXCEPTION("FunctionExpressionProgram: unknown instruction", in.op);
+                }
+            }
+            return coeff(code.size()-1);
+        }
+
+        template <typename Archive>
+        void serialize(Archive& ar) {ar & code;}
+    };
+
+
+    /// A lazy pointwise expression of functions, see function_expression.h
+    template <typename T, std::size_t NDIM>
+    class FunctionExpression {
+        typedef FunctionExpressionProgram<T> programT;
+        typedef typename programT::opcode opcode;
+
+        struct node {
+            opcode op;
+            std::shared_ptr<const node> a, b;
+            T alpha, beta;
+            Function<T,NDIM> f;
+        };
+
+        std::shared_ptr<const node> root;
+
+        FunctionExpression(opcode op, const FunctionExpression& a, const FunctionExpression* b,
+                           const T alpha, const T beta) {
+            std::shared_ptr<node> p(new node);
+            p->op = op;
+            p->a = a.root;
+            if (b) p->b = b->root;
+            p->alpha = alpha;
+            p->beta = beta;
+            root = p;
+        }
+
+        /// Appends node p and its operands to prog once; returns its instruction
+        int compile(const std::shared_ptr<const node>& p, programT& prog,
+                    std::vector< Function<T,NDIM> >& leaves,
+                    std::map<const node*,int>& done) const {
+            typename std::map<const node*,int>::const_iterator it = done.find(p.get());
+            if (it != done.end()) return it->second;
+
+            typename programT::instruction in;
+            in.op = p->op;
+            in.a = in.b = -1;
+            in.alpha = p->alpha;
+            in.beta = p->beta;
+            if (p->op == programT::LEAF) {
+                in.a = leaves.size();
+                for (std::size_t i=0; i<leaves.size(); ++i) {
+                    if (leaves[i].get_impl() == p->f.get_impl()) in.a = i;
+                }
+                if (in.a == int(leaves.size())) leaves.push_back(p->f);
+            }
+            else {
+                in.a = compile(p->a, prog, leaves, done);
+                if (p->b) in.b = compile(p->b, prog, leaves, done);
+            }
+            prog.code.push_back(in);
+            return done[p.get()] = prog.code.size()-1;
+        }
+
+    public:
+        /// An expression that is just the function f
+        explicit FunctionExpression(const Function<T,NDIM>& f) {
+            MADNESS_ASSERT(f.is_initialized());
+            std::shared_ptr<node> p(new node);
+            p->op = programT::LEAF;
+            p->alpha = p->beta = T(0);
+            p->f = f;
+            root = p;
+        }
+
+        /// Returns alpha*a + beta*b
+        static FunctionExpression gaxpy(const T alpha, const FunctionExpression& a,
+                                        const T beta, const FunctionExpression& b) {
+            return FunctionExpression(programT::GAXPY, a, &b, alpha, beta);
+        }
+
+        /// Returns the pointwise product a*b
+        static FunctionExpression mul(const FunctionExpression& a, const FunctionExpression& b) {
+            return FunctionExpression(programT::MUL, a, &b, T(1), T(0));
+        }
+
+        /// Returns alpha*a
+        static FunctionExpression scale(const FunctionExpression& a, const T alpha) {
+            return FunctionExpression(programT::SCALE, a, 0, alpha, T(0));
+        }
+
+        /// Returns a + alpha
+        static FunctionExpression add_scalar(const FunctionExpression& a, const T alpha) {
+            return FunctionExpression(programT::ADD_SCALAR, a, 0, alpha, T(0));
+        }
+
+        /// Returns op(a) for one of the unary opcodes (EXP, SQRT, LOG, ABS, INVERSE)
+        static FunctionExpression unary(const FunctionExpression& a, const opcode op) {
+            return FunctionExpression(op, a, 0, T(0), T(0));
+        }
+
+        /// Evaluates the expression in one recursive descent (collective)
+
+        /// The functions of the expression are reconstructed.  The result
+        /// has the process map of the first function in the expression.
+        /// @param[in] truncate if true the result is truncated (fences)
+        /// @param[in] fence if false and not truncate, the final fence is omitted
+        Function<T,NDIM> evaluate(const bool truncate=true, const bool fence=true) const {
+            programT prog;
+            std::vector< Function<T,NDIM> > leaves;
+            std::map<const node*,int> done;
+            compile(root, prog, leaves, done);
+
+            World& world = leaves[0].world();
+            for (std::size_t i=0; i<leaves.size(); ++i) {
+                if (leaves[i].k() != leaves[0].k()) {
+                    MADNESS_EXCEPTION("FunctionExpression: functions have different k", leaves[i].k());
+                }
+                leaves[i].reconstruct(false);
+            }
+            world.gop.fence();
+
+            std::vector<const FunctionImpl<T,NDIM>*> vleaf(leaves.size());
+            for (std::size_t i=0; i<leaves.size(); ++i) vleaf[i] = leaves[i].get_impl().get();
+
+            Function<T,NDIM> result;
+            result.set_impl(leaves[0], false);
+            result.get_impl()->expressionXX(vleaf, prog, truncate or fence);
+            if (truncate) result.truncate();
+            return result;
+        }
+    };
+
+
+    /// Starts a lazy expression from the function f
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> lazy(const Function<T,NDIM>& f) {
+        return FunctionExpression<T,NDIM>(f);
+    }
+
+    /// Evaluates the lazy expression e in one recursive descent and truncates the result (collective)
+    template <typename T, std::size_t NDIM>
+    Function<T,NDIM> evaluate(const FunctionExpression<T,NDIM>& e, const bool truncate=true) {
+        return e.evaluate(truncate);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator+(const FunctionExpression<T,NDIM>& a, const FunctionExpression<T,NDIM>& b) {
+        return FunctionExpression<T,NDIM>::gaxpy(T(1), a, T(1), b);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator-(const FunctionExpression<T,NDIM>& a, const FunctionExpression<T,NDIM>& b) {
+        return FunctionExpression<T,NDIM>::gaxpy(T(1), a, T(-1), b);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator*(const FunctionExpression<T,NDIM>& a, const FunctionExpression<T,NDIM>& b) {
+        return FunctionExpression<T,NDIM>::mul(a, b);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator-(const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::scale(a, T(-1));
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator+(const FunctionExpression<T,NDIM>& a, const Function<T,NDIM>& f) {
+        return a + lazy(f);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator+(const Function<T,NDIM>& f, const FunctionExpression<T,NDIM>& a) {
+        return lazy(f) + a;
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator-(const FunctionExpression<T,NDIM>& a, const Function<T,NDIM>& f) {
+        return a - lazy(f);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator-(const Function<T,NDIM>& f, const FunctionExpression<T,NDIM>& a) {
+        return lazy(f) - a;
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator*(const FunctionExpression<T,NDIM>& a, const Function<T,NDIM>& f) {
+        return a * lazy(f);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator*(const Function<T,NDIM>& f, const FunctionExpression<T,NDIM>& a) {
+        return lazy(f) * a;
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator*(const FunctionExpression<T,NDIM>& a, const T alpha) {
+        return FunctionExpression<T,NDIM>::scale(a, alpha);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator*(const T alpha, const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::scale(a, alpha);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator+(const FunctionExpression<T,NDIM>& a, const T alpha) {
+        return FunctionExpression<T,NDIM>::add_scalar(a, alpha);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator+(const T alpha, const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::add_scalar(a, alpha);
+    }
+
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> operator-(const FunctionExpression<T,NDIM>& a, const T alpha) {
+        return FunctionExpression<T,NDIM>::add_scalar(a, -alpha);
+    }
+
+    /// Lazy pointwise exp(a)
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> lazy_exp(const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::unary(a, FunctionExpressionProgram<T>::EXP);
+    }
+
+    /// Lazy pointwise sqrt(a)
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> lazy_sqrt(const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::unary(a, FunctionExpressionProgram<T>::SQRT);
+    }
+
+    /// Lazy pointwise log(a)
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> lazy_log(const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::unary(a, FunctionExpressionProgram<T>::LOG);
+    }
+
+    /// Lazy pointwise |a|
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> lazy_abs(const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::unary(a, FunctionExpressionProgram<T>::ABS);
+    }
+
+    /// Lazy pointwise 1/a
+    template <typename T, std::size_t NDIM>
+    FunctionExpression<T,NDIM> lazy_inverse(const FunctionExpression<T,NDIM>& a) {
+        return FunctionExpression<T,NDIM>::unary(a, FunctionExpressionProgram<T>::INVERSE);
+    }
+
+}
+
+#endif // MADNESS_MRA_FUNCTION_EXPRESSION_H__INCLUDED
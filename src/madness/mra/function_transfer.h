@@ -0,0 +1,246 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_FUNCTION_TRANSFER_H__INCLUDED
+#define MADNESS_MRA_FUNCTION_TRANSFER_H__INCLUDED
+
+/// \file function_transfer.h
+/// \brief Functions in subworlds, and moving functions between the universe and its subworlds
+
+#include <madness/mra/mra.h>
+#include <madness/world/subworld.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace madness {
+
+    /// the process map of NDIM-dimensional functions in a world other than the default world
+
+    /// Operations on two functions require that they share the same process
+    /// map instance, so there is exactly one map per world.
+    template <std::size_t NDIM>
+    std::shared_ptr< WorldDCPmapInterface< Key<NDIM> > > subworld_pmap(World& world) {
+        static std::map<unsigned long, std::shared_ptr< WorldDCPmapInterface< Key<NDIM> > > > pmaps;
+        std::shared_ptr< WorldDCPmapInterface< Key<NDIM> > >& pmap=pmaps[world.id()];
+        if (!pmap) pmap.reset(new LevelPmap< Key<NDIM> >(world));
+        return pmap;
+    }
+
+    /// Sets the default process maps of all dimensions to those of a subworld
+
+    /// FunctionFactory uses the default process map, which refers to the
+    /// universe. While an object of this class exists, functions are created
+    /// with the map of the subworld instead; the previous maps are restored
+    /// on destruction.
+    class SubworldPmaps {
+        std::shared_ptr< WorldDCPmapInterface< Key<1> > > pmap1;
+        std::shared_ptr< WorldDCPmapInterface< Key<2> > > pmap2;
+        std::shared_ptr< WorldDCPmapInterface< Key<3> > > pmap3;
+        std::shared_ptr< WorldDCPmapInterface< Key<4> > > pmap4;
+        std::shared_ptr< WorldDCPmapInterface< Key<5> > > pmap5;
+        std::shared_ptr< WorldDCPmapInterface< Key<6> > > pmap6;
+
+        template <std::size_t NDIM>
+        static void swap(World& world, std::shared_ptr< WorldDCPmapInterface< Key<NDIM> > >& saved) {
+            saved=FunctionDefaults<NDIM>::get_pmap();
+            FunctionDefaults<NDIM>::set_pmap(subworld_pmap<NDIM>(world));
+        }
+
+    public:
+        explicit SubworldPmaps(World& subworld) {
+            swap<1>(subworld,pmap1);
+            swap<2>(subworld,pmap2);
+            swap<3>(subworld,pmap3);
+            swap<4>(subworld,pmap4);
+            swap<5>(subworld,pmap5);
+            swap<6>(subworld,pmap6);
+        }
+
+        ~SubworldPmaps() {
+            FunctionDefaults<1>::set_pmap(pmap1);
+            FunctionDefaults<2>::set_pmap(pmap2);
+            FunctionDefaults<3>::set_pmap(pmap3);
+            FunctionDefaults<4>::set_pmap(pmap4);
+            FunctionDefaults<5>::set_pmap(pmap5);
+            FunctionDefaults<6>::set_pmap(pmap6);
+        }
+    };
+
+    /// run independent computations on the subworlds and gather the results
+
+    /// Same as Subworlds::map(), but functions created by op live in the
+    /// subworld without passing a process map explicitly.
+    template <typename resultT, typename opT>
+    std::vector<resultT> map_subworlds(const Subworlds& subworlds, const std::size_t n, const opT& op) {
+        SubworldPmaps pmaps(subworlds.subworld());
+        return subworlds.map<resultT>(n,op);
+    }
+
+    namespace detail {
+
+        /// insert nodes that were sent from another world into the local part of a function
+        template <typename T, std::size_t NDIM>
+        void insert_transferred_nodes(const unsigned long worldid, const uniqueidT& implid,
+                const std::vector< std::pair< Key<NDIM>, FunctionNode<T,NDIM> > >& nodes) {
+            World* world=World::world_from_id(worldid);
+            MADNESS_ASSERT(world);
+            FunctionImpl<T,NDIM>* impl=world->ptr_from_id< FunctionImpl<T,NDIM> >(implid);
+            MADNESS_ASSERT(impl);
+            for (std::size_t i=0; i<nodes.size(); ++i) {
+                impl->get_coeffs().replace(nodes[i].first,nodes[i].second);
+            }
+        }
+
+        /// send the local nodes of f to their owners in a function of another world
+
+        /// Nodes are sent in batches, one task per batch and destination.
+        /// @param[in]  universe    a world that contains the processes of both worlds
+        /// @param[in]  f           the source function
+        /// @param[in]  worldid     the id of the destination world
+        /// @param[in]  implid      the id of the destination FunctionImpl
+        /// @param[in]  pmap        the process map of the destination function
+        /// @param[in]  ranks       the universe ranks of the processes of the destination world
+        template <typename T, std::size_t NDIM>
+        void send_function_nodes(World& universe, const Function<T,NDIM>& f,
+                const unsigned long worldid, const uniqueidT& implid,
+                const WorldDCPmapInterface< Key<NDIM> >& pmap, const std::vector<ProcessID>& ranks) {
+            typedef std::vector< std::pair< Key<NDIM>, FunctionNode<T,NDIM> > > bufferT;
+            const std::size_t batchsize=256;
+            std::map<ProcessID,bufferT> buffers;
+
+            typename FunctionImpl<T,NDIM>::dcT::const_iterator it;
+            const typename FunctionImpl<T,NDIM>::dcT& coeffs=f.get_impl()->get_coeffs();
+            for (it=coeffs.begin(); it!=coeffs.end(); ++it) {
+                const ProcessID dest=ranks[pmap.owner(it->first)];
+                bufferT& buffer=buffers[dest];
+                buffer.push_back(std::make_pair(it->first,it->second));
+                if (buffer.size()==batchsize) {
+                    universe.taskq.add(dest,&insert_transferred_nodes<T,NDIM>,worldid,implid,buffer);
+                    buffer.clear();
+                }
+            }
+            typename std::map<ProcessID,bufferT>::const_iterator bit;
+            for (bit=buffers.begin(); bit!=buffers.end(); ++bit) {
+                if (bit->second.empty()) continue;
+                universe.taskq.add(bit->first,&insert_transferred_nodes<T,NDIM>,worldid,implid,bit->second);
+            }
+        }
+    }
+
+    /// copy a function of the universe into the subworld of every process
+
+    /// The tree of f is preserved, and every subworld receives a complete
+    /// copy. Every node is sent once per subworld directly to its new owner;
+    /// there is no intermediate gather. f must be reconstructed or
+    /// compressed. Collective over the universe.
+    /// @param[in]  subworlds   the partition of the universe
+    /// @param[in]  f           a function of the universe
+    /// @return a copy of f in the subworld of this process
+    template <typename T, std::size_t NDIM>
+    Function<T,NDIM> copy_to_subworld(const Subworlds& subworlds, const Function<T,NDIM>& f) {
+        World& universe=subworlds.universe();
+        World& subworld=subworlds.subworld();
+        MADNESS_ASSERT(f.world().id()==universe.id());
+        MADNESS_ASSERT(not (f.get_impl()->is_nonstandard() or f.get_impl()->is_redundant()));
+
+        FunctionFactory<T,NDIM> factory(subworld);
+        factory.k(f.k()).thresh(f.thresh()).empty().compressed(f.is_compressed())
+                .pmap(subworld_pmap<NDIM>(subworld)).nofence();
+        if (f.get_impl()->get_autorefine()) factory.autorefine();
+        else factory.noautorefine();
+        Function<T,NDIM> result(factory);
+        universe.gop.fence();
+
+        for (int c=0; c<subworlds.size(); ++c) {
+            unsigned long worldid=subworld.id();
+            uniqueidT implid=result.get_impl()->id();
+            universe.gop.broadcast(worldid,subworlds.root(c));
+            universe.gop.broadcast_serializable(implid,subworlds.root(c));
+            const std::vector<ProcessID> ranks=subworlds.universe_ranks(c);
+            const LevelPmap< Key<NDIM> > pmap(ranks.size());
+            detail::send_function_nodes(universe,f,worldid,implid,pmap,ranks);
+        }
+        universe.gop.fence();
+        return result;
+    }
+
+    /// copy a function of one subworld into the universe
+
+    /// The tree of f is preserved; every node is sent directly to its owner
+    /// in the universe. f must be reconstructed or compressed. Collective
+    /// over the universe.
+    /// @param[in]  subworlds   the partition of the universe
+    /// @param[in]  f           a function of the subworld of this process; ignored
+    ///                         unless this process belongs to subworld color
+    /// @param[in]  color       the subworld that holds the function
+    /// @return a copy of f in the universe, with the default process map
+    template <typename T, std::size_t NDIM>
+    Function<T,NDIM> copy_to_universe(const Subworlds& subworlds, const Function<T,NDIM>& f,
+            const int color) {
+        World& universe=subworlds.universe();
+        const bool sender=(subworlds.color()==color);
+
+        int k=0, autorefine=0, compressed=0;
+        double thresh=0.0;
+        if (sender) {
+            MADNESS_ASSERT(f.world().id()==subworlds.subworld().id());
+            MADNESS_ASSERT(not (f.get_impl()->is_nonstandard() or f.get_impl()->is_redundant()));
+            k=f.k();
+            thresh=f.thresh();
+            autorefine=f.get_impl()->get_autorefine();
+            compressed=f.is_compressed();
+        }
+        universe.gop.broadcast(k,subworlds.root(color));
+        universe.gop.broadcast(thresh,subworlds.root(color));
+        universe.gop.broadcast(autorefine,subworlds.root(color));
+        universe.gop.broadcast(compressed,subworlds.root(color));
+
+        FunctionFactory<T,NDIM> factory(universe);
+        factory.k(k).thresh(thresh).empty().compressed(compressed).nofence();
+        if (autorefine) factory.autorefine();
+        else factory.noautorefine();
+        Function<T,NDIM> result(factory);
+        universe.gop.fence();
+
+        if (sender) {
+            std::vector<ProcessID> ranks(universe.size());
+            for (ProcessID p=0; p<universe.size(); ++p) ranks[p]=p;
+            detail::send_function_nodes(universe,f,universe.id(),result.get_impl()->id(),
+                    *result.get_impl()->get_pmap(),ranks);
+        }
+        universe.gop.fence();
+        return result;
+    }
+
+}
+
+#endif // MADNESS_MRA_FUNCTION_TRANSFER_H__INCLUDED
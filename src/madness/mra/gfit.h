@@ -48,6 +48,7 @@
 #include "../tensor/tensor_lapack.h"
 #include "../world/madness_exception.h"
 #include "../world/print.h"
+#include "operator_disk_cache.h"
 
 namespace madness {
 
@@ -77,8 +78,11 @@ public:
 	/// @parma[in]	prnt	print level
 	static GFit BSHFit(double mu, double lo, double hi, double eps, bool prnt=false) {
 		GFit fit;
+		const std::string key=cache_key("bsh",mu,lo,hi,eps);
+		if (fit.load(key)) return fit;
 		if (NDIM==3) bsh_fit(mu,lo,hi,eps,fit.coeffs_,fit.exponents_,prnt);
 		else bsh_fit_ndim(NDIM,mu,lo,hi,eps,fit.coeffs_,fit.exponents_,prnt);
+		fit.store(key);
 		return fit;
 	}
 
@@ -93,7 +97,10 @@ public:
 	/// @parma[in]	prnt	print level
 	static GFit SlaterFit(double gamma, double lo, double hi, double eps, bool prnt=false) {
 		GFit fit;
+		const std::string key=cache_key("slater",gamma,lo,hi,eps);
+		if (fit.load(key)) return fit;
 		slater_fit(gamma,lo,hi,eps,fit.coeffs_,fit.exponents_,prnt);
+		fit.store(key);
 		return fit;
 	}
 
@@ -161,6 +168,41 @@ private:
 	/// the exponents of the expansion f(x) = \sum_m coeffs[m] exp(-exponents[m] * x^2)
 	Tensor<T> exponents_;
 
+	/// the key of a fit in the OperatorDiskCache
+	static std::string cache_key(const char* type, double mu, double lo, double hi, double eps) {
+		char ndim[8];
+		snprintf(ndim,8,"%d",int(NDIM));
+		return std::string("gfit:")+type+":"+ndim+":"+OperatorDiskCache::exact(mu)+":"
+				+OperatorDiskCache::exact(lo)+":"+OperatorDiskCache::exact(hi)+":"
+				+OperatorDiskCache::exact(eps);
+	}
+
+	/// read the fit from the OperatorDiskCache; return false if not present
+	bool load(const std::string& key) {
+		std::vector<double> data;
+		if (!OperatorDiskCache::load(key,data) or (data.size()%2!=0)) return false;
+		const long n=data.size()/2;
+		coeffs_=Tensor<T>(n);
+		exponents_=Tensor<T>(n);
+		for (long i=0; i<n; ++i) {
+			coeffs_(i)=data[i];
+			exponents_(i)=data[n+i];
+		}
+		return true;
+	}
+
+	/// write the fit to the OperatorDiskCache, if enabled
+	void store(const std::string& key) const {
+		if (!OperatorDiskCache::enabled()) return;
+		const long n=coeffs_.dim(0);
+		std::vector<double> data(2*n);
+		for (long i=0; i<n; ++i) {
+			data[i]=coeffs_(i);
+			data[n+i]=exponents_(i);
+		}
+		OperatorDiskCache::store(key,data);
+	}
+
 	/// fit the function exp(-mu r)/r
 
 	/// formulas taken from
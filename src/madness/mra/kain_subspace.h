@@ -0,0 +1,367 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+
+  $Id$
+*/
+#ifndef MADNESS_MRA_KAIN_SUBSPACE_H__INCLUDED
+#define MADNESS_MRA_KAIN_SUBSPACE_H__INCLUDED
+
+/*!
+	\file kain_subspace.h
+	\brief Krylov subspace of vectors of Functions for the KAIN solver
+	\ingroup mra
+
+	The subspace holds the previous iterates and residuals of a nonlinear
+	solver together with the subspace matrix
+	\f$ Q_{ij} = \langle u_i | r_j \rangle \f$, see
+	\verbatim
+	R. J. Harrison, Krylov subspace accelerated inexact newton method for linear
+	and nonlinear equations, J. Comput. Chem. 25 (2004), no. 3, 328-334.
+	\endverbatim
+
+	For large vectors (many orbitals) the history is the largest memory
+	consumer of an SCF calculation. KAINSubspace therefore
+	 - keeps the history in compressed form, optionally truncated with a
+	   looser threshold than the working precision,
+	 - updates Q incrementally: the new row and column are computed with a
+	   single batched inner product and one global reduction,
+	 - optionally spills the oldest vectors to disk, keeping only a given
+	   number of them in memory.
+*/
+
+#include <madness/mra/mra.h>
+#include <madness/tensor/solvers.h>
+#include <cstdio>
+#include <string>
+
+namespace madness {
+
+
+	/// check for subspace linear dependency
+
+	/// @param[in]     Q	the input matrix for KAIN
+	/// @param[in,out] c	the coefficients for constructing the new solution
+    /// @param[in]     rcondtol rcond less than this will cause the subspace to be shrunk due to linear dependence
+    /// @param[in]     cabsmax  maximum element of c greater than this will cause the subspace to be shrunk due to linear dependence
+	template<typename C>
+	void check_linear_dependence(const Tensor<C>& Q, Tensor<C>& c, const double rcondtol, const double cabsmax) {
+		double rcond = 1e-12;
+		int m = c.dim(0);
+
+		while(1){
+			c = KAIN(Q, rcond);
+			//if (world.rank() == 0) print("kain c:", c);
+//			if(std::abs(c[m - 1]) < 3.0){
+			if (c.absmax()<cabsmax) {
+				break;
+			} else  if(rcond < rcondtol){
+				print("Increasing subspace singular value threshold ", c[m - 1], rcond);
+				rcond *= 100;
+			} else {
+				print("Forcing full step due to subspace malfunction");
+				c = 0.0;
+				c[m - 1] = 1.0;
+				break;
+			}
+		}
+	}
+
+
+    /// The KAIN subspace for vectors of Functions
+
+    /// \ingroup mra
+    /// The vectors of a subspace must all have the same length; for a single
+    /// Function use vectors of length one.
+    template<typename T, std::size_t NDIM>
+    class KAINSubspace {
+
+        typedef Function<T,NDIM> functionT;
+        typedef std::vector<functionT> vecfuncT;
+
+        /// an iterate and its residual
+        struct Item {
+            vecfuncT u, r;
+            std::string filename;   ///< base name of the archive if spilled, empty otherwise
+
+            bool is_spilled() const {return not filename.empty();}
+        };
+
+        World& world;
+        unsigned int maxsub;            ///< maximum size of subspace dimension
+        double history_thresh;          ///< truncation threshold of the stored vectors, 0 for none
+        unsigned int max_in_memory;     ///< number of stored pairs kept in memory
+        std::string spill_dir;          ///< directory for the spilled pairs
+        long id;                        ///< unique id of this, for the file names
+        long nspill;                    ///< counter for the file names
+        std::vector<Item> history;      ///< the previous iterates and residuals
+        Tensor<T> Q;                    ///< the subspace matrix
+
+        /// return the next id; must be called in the same order on all processes
+        static long next_id() {
+            static long counter=0;
+            return counter++;
+        }
+
+    public:
+        bool do_print;
+
+        /// ctor
+
+        /// @param[in]  world   the world
+        /// @param[in]  maxsub  maximum size of subspace dimension
+        KAINSubspace(World& world, unsigned int maxsub=10)
+            : world(world)
+            , maxsub(maxsub)
+            , history_thresh(0.0)
+            , max_in_memory(maxsub)
+            , spill_dir(".")
+            , id(next_id())
+            , nspill(0)
+            , do_print(false) {
+        }
+
+        ~KAINSubspace() {
+            for (const Item& item : history) if (item.is_spilled()) remove_files(item.filename);
+        }
+
+        void set_maxsub(const unsigned int n) {maxsub=n;}
+
+        unsigned int get_maxsub() const {return maxsub;}
+
+        /// truncate the stored vectors with this threshold; 0 keeps them as they are
+
+        /// The stored vectors are deep copies then; the current iterate always
+        /// enters the update with full precision.
+        void set_history_thresh(const double thresh) {history_thresh=thresh;}
+
+        /// keep at most n pairs in memory, write older ones into dir
+
+        /// Every I/O node (see BaseParallelArchive::open) writes its own file,
+        /// so dir may be local to the compute node.
+        /// @param[in]  n   number of pairs to keep in memory
+        /// @param[in]  dir directory for the spilled pairs
+        void set_spill(const unsigned int n, const std::string dir=".") {
+            max_in_memory=n;
+            spill_dir=dir;
+            spill();
+        }
+
+        /// the current size of the subspace
+        std::size_t size() const {return history.size();}
+
+        /// the subspace matrix Q(i,j) = <u_i | r_j>
+        const Tensor<T>& get_Q() const {return Q;}
+
+        /// discard the subspace
+        void clear() {
+            for (const Item& item : history) if (item.is_spilled()) remove_files(item.filename);
+            history.clear();
+            Q.clear();
+        }
+
+        /// Computes next trial solution vector
+
+        /// You are responsible for performing step restriction or line search
+        /// (not necessary for linear problems).
+        ///
+        /// @param[in]  u   Current solution vector
+        /// @param[in]  r   Corresponding residual
+        /// @param[in]  rcondtol rcond less than this will cause the subspace to be shrunk due to linear dependence
+        /// @param[in]  cabsmax  maximum element of c greater than this will cause the subspace to be shrunk due to linear dependence
+        /// @return Next trial solution vector, in compressed form
+        vecfuncT update(const vecfuncT& u, const vecfuncT& r,
+                const double rcondtol=1e-8, const double cabsmax=1000.0) {
+
+            MADNESS_ASSERT(u.size()==r.size());
+            if (history.size()>0) MADNESS_ASSERT(u.size()==history.front().u.size());
+
+            compress(world,u,false);
+            compress(world,r,false);
+            world.gop.fence();
+            if (maxsub<=1) return sub(world,u,r);
+
+            // extend the subspace matrix by the overlaps with the current pair
+            const long m=history.size();
+            Tensor<T> Qnew(m+1,m+1);
+            if (m>0) Qnew(Slice(0,-2),Slice(0,-2))=Q;
+            Tensor<T> qrow(m+1), qcol(m+1);
+            compute_overlaps(u,r,qrow,qcol);
+            Qnew(m,_)=qrow;
+            Qnew(_,m)=qcol;
+            Q=Qnew;
+
+            // solve the subspace equations
+            Tensor<T> c;
+            if (world.rank()==0) {
+                c=KAIN(Q);
+                check_linear_dependence(Q,c,rcondtol,cabsmax);
+            }
+            world.gop.broadcast_serializable(c,0);
+            if (do_print and (world.rank()==0)) print("subspace solution",c);
+
+            // form the new solution, use the current pair in full precision
+            vecfuncT unew=zero_functions_compressed<T,NDIM>(world,u.size());
+            for (long i=0; i<m; ++i) {
+                const Item item=get_item(i);
+                gaxpy(world,T(1.0),unew,c(i),item.u,false);
+                gaxpy(world,T(1.0),unew,-c(i),item.r,false);
+                if (history[i].is_spilled()) world.gop.fence();
+            }
+            gaxpy(world,T(1.0),unew,c(m),u,false);
+            gaxpy(world,T(1.0),unew,-c(m),r,false);
+            world.gop.fence();
+
+            // store the current pair, discard the oldest one
+            store(u,r);
+            if (history.size()==maxsub) {
+                if (history.front().is_spilled()) remove_files(history.front().filename);
+                history.erase(history.begin());
+                Q=copy(Q(Slice(1,-1),Slice(1,-1)));
+            }
+            return unew;
+        }
+
+    private:
+
+        /// compute the new row Q(m,i)=<u|r_i> and column Q(i,m)=<u_i|r> of Q
+
+        /// the pairs in memory are batched into a single inner product with
+        /// one global sum, the spilled ones are read one after another
+        void compute_overlaps(const vecfuncT& u, const vecfuncT& r,
+                Tensor<T>& qrow, Tensor<T>& qcol) const {
+
+            const long n=u.size();
+            const long m=history.size();
+
+            // left=(u_i.., u.., u), right=(r.., r_i.., r)
+            std::vector<long> in_memory;
+            for (long i=0; i<m; ++i) if (not history[i].is_spilled()) in_memory.push_back(i);
+            const long nmem=in_memory.size();
+
+            vecfuncT left, right;
+            left.reserve((2*nmem+1)*n);
+            right.reserve((2*nmem+1)*n);
+            for (long i : in_memory) {
+                left.insert(left.end(),history[i].u.begin(),history[i].u.end());
+                right.insert(right.end(),r.begin(),r.end());
+            }
+            for (long i : in_memory) {
+                left.insert(left.end(),u.begin(),u.end());
+                right.insert(right.end(),history[i].r.begin(),history[i].r.end());
+            }
+            left.insert(left.end(),u.begin(),u.end());
+            right.insert(right.end(),r.begin(),r.end());
+
+            Tensor<T> ovlp=inner(world,left,right);
+            for (long j=0; j<nmem; ++j) {
+                qcol(in_memory[j])=ovlp(Slice(j*n,(j+1)*n-1)).sum();
+                qrow(in_memory[j])=ovlp(Slice((nmem+j)*n,(nmem+j+1)*n-1)).sum();
+            }
+            qrow(m)=qcol(m)=ovlp(Slice(2*nmem*n,(2*nmem+1)*n-1)).sum();
+
+            for (long i=0; i<m; ++i) {
+                if (not history[i].is_spilled()) continue;
+                Item item=get_item(i);
+                vecfuncT left1(item.u), right1(r);
+                left1.insert(left1.end(),u.begin(),u.end());
+                right1.insert(right1.end(),item.r.begin(),item.r.end());
+                Tensor<T> ovlp1=inner(world,left1,right1);
+                qcol(i)=ovlp1(Slice(0,n-1)).sum();
+                qrow(i)=ovlp1(Slice(n,2*n-1)).sum();
+            }
+        }
+
+        /// append the pair (u,r) to the history
+        void store(const vecfuncT& u, const vecfuncT& r) {
+            Item item;
+            if (history_thresh>0.0) {
+                item.u=copy(world,u,false);
+                item.r=copy(world,r,false);
+                world.gop.fence();
+                truncate(world,item.u,history_thresh,false);
+                truncate(world,item.r,history_thresh,false);
+                world.gop.fence();
+            } else {
+                item.u=u;
+                item.r=r;
+            }
+            history.push_back(item);
+            spill();
+        }
+
+        /// write the oldest pairs in memory to disk until at most max_in_memory are left
+        void spill() {
+            long nmem=0;
+            for (const Item& item : history) if (not item.is_spilled()) ++nmem;
+            for (Item& item : history) {
+                if (nmem<=long(max_in_memory)) break;
+                if (item.is_spilled()) continue;
+
+                std::string name=spill_dir+"/kain_subspace_"+std::to_string(id)
+                        +"_"+std::to_string(nspill++);
+                {
+                    archive::ParallelOutputArchive ar(world,name.c_str(),world.size());
+                    for (const functionT& f : item.u) ar & f;
+                    for (const functionT& f : item.r) ar & f;
+                }
+                const long n=item.u.size();
+                item.u=vecfuncT(n);
+                item.r=vecfuncT(n);
+                item.filename=name;
+                --nmem;
+            }
+        }
+
+        /// return the pair i, read from disk if it has been spilled
+        Item get_item(const long i) const {
+            const Item& item=history[i];
+            if (not item.is_spilled()) return item;
+
+            Item result;
+            result.u=vecfuncT(item.u.size());
+            result.r=vecfuncT(item.r.size());
+            archive::ParallelInputArchive ar(world,item.filename.c_str(),world.size());
+            for (functionT& f : result.u) ar & f;
+            for (functionT& f : result.r) ar & f;
+            return result;
+        }
+
+        /// remove the files of a spilled pair; each process removes its own
+        void remove_files(const std::string& name) const {
+            char buf[256];
+            MADNESS_ASSERT(name.size()+7 <= sizeof(buf));
+            sprintf(buf, "%s.%5.5d", name.c_str(), world.rank());
+            std::remove(buf);
+        }
+    };
+
+}
+
+#endif // MADNESS_MRA_KAIN_SUBSPACE_H__INCLUDED
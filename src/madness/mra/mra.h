@@ -1483,6 +1483,24 @@ namespace madness {
             return asy;
         }
 
+        /// This is replaced with op(vector of functions), evaluated on batches of boxes ... private
+
+        /// op is called as op(std::vector<keyT>, std::vector<tensorT>) with
+        /// the values of nbox boxes stacked along the first dimension
+        template <typename opT>
+        Function<T,NDIM>& multiop_values_batched(const opT& op, const std::vector< Function<T,NDIM> >& vf,
+                const std::size_t nbox) {
+            std::vector<implT*> v(vf.size(),NULL);
+            for (unsigned int i=0; i<v.size(); ++i) {
+                if (vf[i].is_initialized()) v[i] = vf[i].get_impl().get();
+            }
+            impl->multiop_values_batched(op, v, nbox);
+            world().gop.fence();
+            if (VERIFY_TREE) verify_tree();
+
+            return *this;
+        }
+
         /// reduce the rank of the coefficient tensors
         Function<T,NDIM>& reduce_rank(const bool fence=true) {
             verify();
@@ -1499,6 +1517,21 @@ namespace madness {
         return r;
     }
 
+    /// same as multiop_values, but op is evaluated on batches of nbox boxes at once
+
+    /// This amortizes the overhead of the operator (e.g. the setup of an XC
+    /// functional) over many boxes. op must act on each point independently
+    /// and provide operator()(const std::vector< Key<NDIM> >&, const std::vector< Tensor<T> >&),
+    /// where the values of the boxes are stacked along the first dimension.
+    template <typename T, typename opT, int NDIM>
+    Function<T,NDIM> multiop_values_batched(const opT& op, const std::vector< Function<T,NDIM> >& vf,
+            const std::size_t nbox=64) {
+        Function<T,NDIM> r;
+        r.set_impl(vf[0], false);
+        r.multiop_values_batched(op, vf, nbox);
+        return r;
+    }
+
     /// Returns new function equal to alpha*f(x) with optional fence
     template <typename Q, typename T, std::size_t NDIM>
     Function<TENSOR_RESULT_TYPE(Q,T),NDIM>
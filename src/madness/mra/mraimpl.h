@@ -3310,6 +3310,7 @@ namespace madness {
         project_randomize = false;
         bc = BoundaryConditions<NDIM>(BC_FREE);
         tt = TT_FULL;
+        rr = RR_SVD;
         cell = Tensor<double>(NDIM,2);
         cell(_,1) = 1.0;
         recompute_cell_info();
@@ -3335,6 +3336,7 @@ namespace madness {
     		std::cout << "               project_randomize" <<  ": " << project_randomize << std::endl;
     		std::cout << "                              bc" <<  ": " << bc << std::endl;
     		std::cout << "                              tt" <<  ": " << tt << std::endl;
+    		std::cout << "                              rr" <<  ": " << rr << std::endl;
     		std::cout << "                            cell" <<  ": " << cell << std::endl;
     }
 
@@ -3354,6 +3356,7 @@ namespace madness {
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::project_randomize;
     template <std::size_t NDIM> BoundaryConditions<NDIM> FunctionDefaults<NDIM>::bc;
     template <std::size_t NDIM> TensorType FunctionDefaults<NDIM>::tt;
+    template <std::size_t NDIM> RankReductionType FunctionDefaults<NDIM>::rr;
     template <std::size_t NDIM> Tensor<double> FunctionDefaults<NDIM>::cell;
     template <std::size_t NDIM> Tensor<double> FunctionDefaults<NDIM>::cell_width;
     template <std::size_t NDIM> Tensor<double> FunctionDefaults<NDIM>::rcell_width;
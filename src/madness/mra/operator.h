@@ -159,6 +159,27 @@ namespace madness {
         bool& destructive() {return destructive_;}
         const bool& destructive() const {return destructive_;}
 
+        /// the number of separated terms
+        int get_rank() const {return rank;}
+
+        /// the wavelet order
+        int get_k() const {return k;}
+
+        /// the 1d convolution of separated term mu in dimension d
+        std::shared_ptr<Convolution1D<Q> > get_convolution1d(int mu, int d) const {
+            return ops[mu].getop(d);
+        }
+
+        /// approximate number of bytes in the local caches of this operator
+
+        /// the 1d convolutions are not included, since they may be shared
+        /// with other operators through GaussianConvolution1DCache
+        double memory_size() const {
+            const double entry=sizeof(SeparatedConvolutionData<Q,NDIM>)
+                    + rank*sizeof(SeparatedConvolutionInternal<Q,NDIM>);
+            return double(data.size()+mod_data.size())*entry;
+        }
+
         const double& gamma() const {return mu_;}
         const double& mu() const {return mu_;}
 
@@ -0,0 +1,254 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_OPERATOR_CACHE_H__INCLUDED
+#define MADNESS_MRA_OPERATOR_CACHE_H__INCLUDED
+
+/// \file operator_cache.h
+/// \brief Reuse of BSH operators between iterations
+
+#include <madness/mra/operator.h>
+#include <cmath>
+#include <climits>
+#include <map>
+#include <set>
+#include <tuple>
+
+namespace madness {
+
+    /// A factory for BSH operators that reuses operators between calls
+
+    /// In an SCF or response calculation a BSH operator is constructed for
+    /// every orbital in every iteration. The operators are cheap to construct,
+    /// but the transition matrices they generate on the first application are
+    /// not, and they are lost when the operator is destroyed. This cache keeps
+    /// the operators alive between iterations.
+    ///
+    /// Operators are keyed on (mu, lo, eps, k, boundary conditions), where mu
+    /// is rounded to a logarithmic grid with relative spacing mu_tol. The
+    /// operator is constructed with the rounded mu, so that the result does not
+    /// depend on the history of the cache. The default spacing 0.1*eps changes
+    /// the Green's function by much less than the precision of the operator;
+    /// converged orbitals and degenerate orbitals then share one operator.
+    ///
+    /// The exponents of the BSH fit lie on a grid that is independent of mu,
+    /// so the 1d convolutions of different operators coincide and are shared
+    /// through GaussianConvolution1DCache; only the expansion coefficients
+    /// depend on mu.
+    ///
+    /// If the cache grows beyond its memory budget the least recently used
+    /// operators are dropped, and 1d convolutions that are no longer
+    /// referenced by any operator are removed from GaussianConvolution1DCache.
+    /// The memory is reduced over all ranks, so that all ranks evict the same
+    /// operators and the WorldObjects stay in sync. All methods that may
+    /// construct or evict operators are therefore collective.
+    template <std::size_t NDIM>
+    class BSHOperatorCache {
+    public:
+        typedef SeparatedConvolution<double,NDIM> operatorT;
+        typedef std::shared_ptr<operatorT> poperatorT;
+
+    private:
+        typedef std::tuple<double,double,double,int,bool> keyT;  ///< (rounded mu, lo, eps, k, periodic)
+
+        struct entryT {
+            poperatorT op;
+            long last_use;
+        };
+
+        World& world;
+        double mu_tol;          ///< relative spacing of the mu grid; negative: 0.1*eps
+        double max_memory;      ///< budget in bytes per rank; negative: unlimited
+        std::map<keyT,entryT> cache;
+        long clock;
+        long nhit, nmiss, nevict;
+
+        double grid_spacing(const double eps) const {
+            return (mu_tol<0.0) ? 0.1*eps : mu_tol;
+        }
+
+        /// the index of mu on the logarithmic grid; LONG_MIN if mu is not rounded
+        long mu_index(const double mu, const double eps) const {
+            const double delta=grid_spacing(eps);
+            if ((mu<=0.0) or (delta<=0.0)) return LONG_MIN;
+            return std::lround(std::log(mu)/delta);
+        }
+
+        keyT make_key(const double mu, const double lo, const double eps,
+                const BoundaryConditions<NDIM>& bc, const int k) const {
+            return keyT(rounded_mu(mu,eps),lo,eps,k,bc(0,0)==BC_PERIODIC);
+        }
+
+        static poperatorT make_operator(World& world, const double mu, const double lo,
+                const double eps, const BoundaryConditions<NDIM>& bc, const int k) {
+            const Tensor<double>& cell_width = FunctionDefaults<NDIM>::get_cell_width();
+            double hi = cell_width.normf(); // Diagonal width of cell
+            if (bc(0,0) == BC_PERIODIC) hi *= 100; // Extend range for periodic summation
+
+            GFit<double,NDIM> fit=GFit<double,NDIM>::BSHFit(mu,lo,hi,eps,false);
+            Tensor<double> coeff=fit.coeffs();
+            Tensor<double> expnt=fit.exponents();
+
+            if (bc(0,0) == BC_PERIODIC) {
+                fit.truncate_periodic_expansion(coeff, expnt, cell_width.max(), false);
+            }
+            return poperatorT(new operatorT(world, coeff, expnt, bc, k));
+        }
+
+    public:
+
+        /// ctor
+
+        /// @param[in]  world       the world the operators live in
+        /// @param[in]  max_memory  memory budget in bytes per rank, negative for unlimited
+        /// @param[in]  mu_tol      relative spacing of the mu grid, negative for 0.1*eps,
+        ///                         zero to reuse operators only for identical mu
+        BSHOperatorCache(World& world, const double max_memory=2.e9, const double mu_tol=-1.0)
+            : world(world), mu_tol(mu_tol), max_memory(max_memory)
+            , clock(0), nhit(0), nmiss(0), nevict(0) {
+        }
+
+        /// return mu rounded to the grid of this cache
+        double rounded_mu(const double mu, const double eps) const {
+            const long index=mu_index(mu,eps);
+            if (index==LONG_MIN) return mu;
+            return std::exp(grid_spacing(eps)*index);
+        }
+
+        /// return the BSH operator for exp(-mu r)/(4 pi r) with mu rounded to the grid
+
+        /// collective, since a new operator may be constructed
+        poperatorT get(const double mu, const double lo, const double eps,
+                const BoundaryConditions<NDIM>& bc=FunctionDefaults<NDIM>::get_bc(),
+                const int k=FunctionDefaults<NDIM>::get_k()) {
+            const keyT key=make_key(mu,lo,eps,bc,k);
+            typename std::map<keyT,entryT>::iterator it=cache.find(key);
+            if (it==cache.end()) {
+                entryT entry;
+                entry.op=make_operator(world,rounded_mu(mu,eps),lo,eps,bc,k);
+                it=cache.insert(std::make_pair(key,entry)).first;
+                nmiss++;
+            } else {
+                nhit++;
+            }
+            it->second.last_use=clock++;
+            return it->second.op;
+        }
+
+        /// return the BSH operators for all mu, then enforce the memory budget
+
+        /// collective
+        std::vector<poperatorT> get(const Tensor<double>& mu, const double lo, const double eps,
+                const BoundaryConditions<NDIM>& bc=FunctionDefaults<NDIM>::get_bc(),
+                const int k=FunctionDefaults<NDIM>::get_k()) {
+            std::vector<poperatorT> ops(mu.dim(0));
+            for (long i=0; i<mu.dim(0); ++i) ops[i]=get(mu(i),lo,eps,bc,k);
+            evict();
+            return ops;
+        }
+
+        /// approximate memory held by the cached operators in bytes on this rank
+
+        /// 1d convolutions shared between operators are counted once
+        double memory_size() const {
+            double total=0.0;
+            std::set<const Convolution1D<double>*> conv1d;
+            typename std::map<keyT,entryT>::const_iterator it;
+            for (it=cache.begin(); it!=cache.end(); ++it) {
+                const operatorT& op=*(it->second.op);
+                total+=op.memory_size();
+                for (int mu=0; mu<op.get_rank(); ++mu) {
+                    for (std::size_t d=0; d<NDIM; ++d) {
+                        const Convolution1D<double>* c=op.get_convolution1d(mu,d).get();
+                        if (conv1d.insert(c).second) total+=c->memory_size();
+                    }
+                }
+            }
+            return total;
+        }
+
+        /// drop the least recently used operators until the cache fits into its budget
+
+        /// The most recently used operator is always kept. Collective.
+        /// @return the number of evicted operators
+        std::size_t evict() {
+            if (max_memory<0.0) return 0;
+            double mem=memory_size();
+            world.gop.max(mem);
+            if (mem<=max_memory) return 0;
+
+            std::size_t nevicted=0;
+            while ((cache.size()>1) and (mem>max_memory)) {
+                typename std::map<keyT,entryT>::iterator oldest=cache.begin();
+                typename std::map<keyT,entryT>::iterator it;
+                for (it=cache.begin(); it!=cache.end(); ++it) {
+                    if (it->second.last_use<oldest->second.last_use) oldest=it;
+                }
+                cache.erase(oldest);
+                nevicted++;
+                mem=memory_size();
+                world.gop.max(mem);
+            }
+            nevict+=nevicted;
+
+            // the 1d convolutions are shared by all operators of this process
+            world.gop.fence();
+            GaussianConvolution1DCache<double>::erase_unused();
+            return nevicted;
+        }
+
+        /// remove all operators from the cache
+        void clear() {
+            cache.clear();
+        }
+
+        /// number of cached operators
+        std::size_t size() const {return cache.size();}
+
+        long hits() const {return nhit;}
+
+        long misses() const {return nmiss;}
+
+        long evictions() const {return nevict;}
+
+        /// print statistics on rank 0
+        void print_stats() const {
+            const double mem=memory_size();
+            if (world.rank()==0) {
+                printf("bsh operator cache: %4lu operators, %6ld hits, %6ld misses, %6ld evictions, %8.3f GByte\n",
+                        (unsigned long)(cache.size()),nhit,nmiss,nevict,mem/1.e9);
+            }
+        }
+    };
+
+}
+
+#endif // MADNESS_MRA_OPERATOR_CACHE_H__INCLUDED
@@ -0,0 +1,202 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_OPERATOR_DISK_CACHE_H__INCLUDED
+#define MADNESS_MRA_OPERATOR_DISK_CACHE_H__INCLUDED
+
+/// \file operator_disk_cache.h
+/// \brief Persistent cache of operator data between program runs
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace madness {
+
+    /// Persistent cache of operator fits and 1d convolution blocks on disk
+
+    /// The Gaussian fits of the Coulomb, BSH and Slater kernels and the
+    /// projections of the 1d Gaussian convolutions (rnlp) only depend on the
+    /// parameters of the operator, but are recomputed in every program run.
+    /// If a cache directory is set, these data are read from and written to
+    /// the directory, so that subsequent runs start with warm caches.
+    ///
+    /// The cache is opt-in: it is enabled by setting the environment variable
+    /// MAD_OPERATOR_CACHE to a directory, or by calling set_directory() before
+    /// any operator is constructed.
+    ///
+    /// Each entry is one file, named by a hash of its key. A record consists
+    /// of a fixed header, the full key (to detect hash collisions), and the
+    /// payload of doubles at an 8-byte aligned offset, so that records may be
+    /// memory mapped and used in place. The payload is protected by a
+    /// checksum; records that fail any check are ignored and recomputed.
+    ///
+    /// Writers create a unique temporary file and rename it into place, which
+    /// is atomic on POSIX file systems: readers see either the old or the new
+    /// record, never a partial one, and concurrent writers of the same key
+    /// from different ranks or jobs do not corrupt each other. The cache is
+    /// best effort; all I/O errors are silently ignored.
+    class OperatorDiskCache {
+
+        struct headerT {
+            char magic[8];          ///< "MADOPC01"
+            uint64_t keylen;        ///< length of the key in bytes
+            uint64_t nelem;         ///< number of doubles in the payload
+            uint64_t checksum;      ///< FNV-1a hash of the payload
+        };
+
+        /// the directory; never destroyed, so that the cache may be used from static destructors
+        static std::string*& dir_ptr() {
+            static std::string* dir=0;
+            if (!dir) {
+                const char* env=getenv("MAD_OPERATOR_CACHE");
+                dir=new std::string(env ? env : "");
+                if (!dir->empty()) mkdir(dir->c_str(),0755);
+            }
+            return dir;
+        }
+
+        static std::size_t padded(std::size_t n) {return (n+7)/8*8;}
+
+        static std::string filename(const std::string& key) {
+            char buf[32];
+            snprintf(buf,32,"%016llx",(unsigned long long)(fnv1a(key.data(),key.size())));
+            return directory()+"/"+buf+".mop";
+        }
+
+    public:
+
+        /// 64-bit FNV-1a hash
+        static uint64_t fnv1a(const void* p, std::size_t nbyte) {
+            const unsigned char* c=static_cast<const unsigned char*>(p);
+            uint64_t h=14695981039346656037ULL;
+            for (std::size_t i=0; i<nbyte; ++i) {
+                h^=c[i];
+                h*=1099511628211ULL;
+            }
+            return h;
+        }
+
+        /// set the cache directory, which is created if necessary; an empty string disables the cache
+        static void set_directory(const std::string& dir) {
+            *dir_ptr()=dir;
+            if (!dir.empty()) mkdir(dir.c_str(),0755);
+        }
+
+        static const std::string& directory() {return *dir_ptr();}
+
+        static bool enabled() {return !directory().empty();}
+
+        /// represent a double exactly in a key
+        static std::string exact(const double d) {
+            char buf[32];
+            snprintf(buf,32,"%a",d);
+            return std::string(buf);
+        }
+
+        /// read the payload of an entry
+
+        /// @return false if the cache is disabled or the entry is missing or invalid
+        static bool load(const std::string& key, std::vector<double>& data) {
+            if (!enabled()) return false;
+            const int fd=open(filename(key).c_str(),O_RDONLY);
+            if (fd<0) return false;
+            struct stat st;
+            if ((fstat(fd,&st)!=0) or (std::size_t(st.st_size)<sizeof(headerT))) {
+                close(fd);
+                return false;
+            }
+            void* map=mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+            close(fd);
+            if (map==MAP_FAILED) return false;
+
+            bool ok=false;
+            const char* base=static_cast<const char*>(map);
+            const headerT* h=reinterpret_cast<const headerT*>(base);
+            const std::size_t offset=sizeof(headerT)+padded(h->keylen);
+            if ((std::memcmp(h->magic,"MADOPC01",8)==0) and (h->keylen==key.size())
+                    and (std::size_t(st.st_size)==offset+h->nelem*sizeof(double))
+                    and (std::memcmp(base+sizeof(headerT),key.data(),key.size())==0)) {
+                const double* payload=reinterpret_cast<const double*>(base+offset);
+                if (fnv1a(payload,h->nelem*sizeof(double))==h->checksum) {
+                    data.assign(payload,payload+h->nelem);
+                    ok=true;
+                }
+            }
+            munmap(map,st.st_size);
+            return ok;
+        }
+
+        /// write an entry, replacing an existing one atomically
+
+        /// @return false if the cache is disabled or the entry could not be written
+        static bool store(const std::string& key, const std::vector<double>& data) {
+            if (!enabled()) return false;
+
+            headerT h;
+            std::memcpy(h.magic,"MADOPC01",8);
+            h.keylen=key.size();
+            h.nelem=data.size();
+            h.checksum=fnv1a(data.data(),data.size()*sizeof(double));
+            std::vector<char> keybuf(padded(key.size()),'\0');
+            std::memcpy(keybuf.data(),key.data(),key.size());
+
+            // the temporary name must be unique across hosts, processes and threads
+            char host[64]="";
+            gethostname(host,63);
+            char suffix[128];
+            snprintf(suffix,128,".%s.%ld.%p.tmp",host,long(getpid()),(const void*)(&data));
+            const std::string name=filename(key);
+            const std::string tmpname=name+suffix;
+
+            FILE* f=fopen(tmpname.c_str(),"wb");
+            if (!f) return false;
+            bool ok=(fwrite(&h,sizeof(h),1,f)==1)
+                    and (fwrite(keybuf.data(),1,keybuf.size(),f)==keybuf.size())
+                    and (fwrite(data.data(),sizeof(double),data.size(),f)==data.size());
+            ok=(fclose(f)==0) and ok;
+            if (ok) ok=(rename(tmpname.c_str(),name.c_str())==0);
+            if (!ok) unlink(tmpname.c_str());
+            return ok;
+        }
+    };
+
+}
+
+#endif // MADNESS_MRA_OPERATOR_DISK_CACHE_H__INCLUDED
@@ -32,6 +32,7 @@
 */
 #include <madness/mra/mra.h>
 #include <madness/mra/operator.h>
+#include <madness/mra/splitprop.h>
 #include <madness/mra/adquad.h>
 #include <madness/misc/cfft.h>
 #include <madness/misc/interpolation_1d.h>
@@ -187,25 +188,37 @@ namespace madness {
 #ifdef FUNCTION_INSTANTIATE_1
     template SeparatedConvolution<double_complex,1> qm_free_particle_propagator(World& world, int k, double bandlimit, double timestep);
     template SeparatedConvolution<double_complex,1>* qm_free_particle_propagatorPtr(World& world, int k, double bandlimit, double timestep);
+    template <> volatile std::list<detail::PendingMsg> WorldObject<SplitOperatorPropagator<1> >::pending = std::list<detail::PendingMsg>();
+    template <> Spinlock WorldObject<SplitOperatorPropagator<1> >::pending_mutex(0);
 #endif
 
 #ifdef FUNCTION_INSTANTIATE_2
     template SeparatedConvolution<double_complex,2> qm_free_particle_propagator(World& world, int k, double bandlimit, double timestep);
+    template <> volatile std::list<detail::PendingMsg> WorldObject<SplitOperatorPropagator<2> >::pending = std::list<detail::PendingMsg>();
+    template <> Spinlock WorldObject<SplitOperatorPropagator<2> >::pending_mutex(0);
 #endif
 
 #ifdef FUNCTION_INSTANTIATE_3
     template SeparatedConvolution<double_complex,3> qm_free_particle_propagator(World& world, int k, double bandlimit, double timestep);
+    template <> volatile std::list<detail::PendingMsg> WorldObject<SplitOperatorPropagator<3> >::pending = std::list<detail::PendingMsg>();
+    template <> Spinlock WorldObject<SplitOperatorPropagator<3> >::pending_mutex(0);
 #endif
 
 #ifdef FUNCTION_INSTANTIATE_4
     template SeparatedConvolution<double_complex,4> qm_free_particle_propagator(World& world, int k, double bandlimit, double timestep);
+    template <> volatile std::list<detail::PendingMsg> WorldObject<SplitOperatorPropagator<4> >::pending = std::list<detail::PendingMsg>();
+    template <> Spinlock WorldObject<SplitOperatorPropagator<4> >::pending_mutex(0);
 #endif
 
 #ifdef FUNCTION_INSTANTIATE_5
     template SeparatedConvolution<double_complex,5> qm_free_particle_propagator(World& world, int k, double bandlimit, double timestep);
+    template <> volatile std::list<detail::PendingMsg> WorldObject<SplitOperatorPropagator<5> >::pending = std::list<detail::PendingMsg>();
+    template <> Spinlock WorldObject<SplitOperatorPropagator<5> >::pending_mutex(0);
 #endif
 
 #ifdef FUNCTION_INSTANTIATE_6
     template SeparatedConvolution<double_complex,6> qm_free_particle_propagator(World& world, int k, double bandlimit, double timestep);
+    template <> volatile std::list<detail::PendingMsg> WorldObject<SplitOperatorPropagator<6> >::pending = std::list<detail::PendingMsg>();
+    template <> Spinlock WorldObject<SplitOperatorPropagator<6> >::pending_mutex(0);
 #endif
 }
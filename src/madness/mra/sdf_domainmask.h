@@ -58,6 +58,7 @@
 #define MADNESS_MRA_SDF_DOMAINMASK_H__INCLUDED
 
 #include <madness/mra/mra.h>
+#include <limits>
 
 namespace madness {
 
@@ -89,7 +90,195 @@ namespace madness {
         virtual Vector<double,NDIM> grad_sdf(const Vector<double,NDIM>& x)
             const = 0;
 
+        /** \brief Computes the signed distance at many points
+
+            The default calls \c sdf() for each point; shapes override it
+            with a loop over the coordinate arrays.
+
+            \param[in] x The coordinates, \c x[i][j] is coordinate \c i of
+                         point \c j
+            \param[out] d The signed distances
+            \param[in] npts The number of points */
+        virtual void sdf_points(const Vector<double*,NDIM>& x, double* d,
+                                int npts) const {
+            Vector<double,NDIM> pt;
+            for(int j = 0; j < npts; ++j) {
+                for(std::size_t i = 0; i < NDIM; ++i)
+                    pt[i] = x[i][j];
+                d[j] = sdf(pt);
+            }
+        }
+
+        /** \brief Bounds the signed distance over a box
+
+            \param[in] lo The lower corner of the box
+            \param[in] hi The upper corner of the box
+            \param[out] dmin Lower bound of the sdf in the box
+            \param[out] dmax Upper bound of the sdf in the box
+            \return False if the shape cannot bound its sdf (the default) */
+        virtual bool sdf_bounds(const Vector<double,NDIM>& lo,
+                const Vector<double,NDIM>& hi, double& dmin, double& dmax)
+                const {
+            return false;
+        }
+
         virtual ~SignedDFInterface() {}
+
+    protected:
+        /** \brief Bounds the sdf over a box from its value at the center
+                   and a Lipschitz constant
+
+            \param[in] lo The lower corner of the box
+            \param[in] hi The upper corner of the box
+            \param[in] lipschitz Bound on the norm of the gradient of the sdf
+            \param[out] dmin Lower bound of the sdf in the box
+            \param[out] dmax Upper bound of the sdf in the box
+            \return True */
+        bool lipschitz_bounds(const Vector<double,NDIM>& lo,
+                const Vector<double,NDIM>& hi, double lipschitz, double& dmin,
+                double& dmax) const {
+            Vector<double,NDIM> center;
+            double halfdiag = 0.0;
+            for(std::size_t i = 0; i < NDIM; ++i) {
+                center[i] = 0.5*(lo[i] + hi[i]);
+                halfdiag += 0.25*(hi[i] - lo[i])*(hi[i] - lo[i]);
+            }
+            halfdiag = lipschitz*sqrt(halfdiag);
+            const double d = sdf(center);
+            dmin = d - halfdiag;
+            dmax = d + halfdiag;
+            return true;
+        }
+    };
+
+    /** \brief The union of shapes: inside if inside any of them
+
+        The sdf is the minimum of the sdfs of the shapes.
+
+        \ingroup mrabcint */
+    template <std::size_t NDIM>
+    class SDFUnion : public SignedDFInterface<NDIM> {
+    protected:
+        /// The shapes
+        std::vector<std::shared_ptr<SignedDFInterface<NDIM> > > shapes;
+
+    public:
+        /** \brief Constructor for the union
+
+            \param shapes The shapes, at least one */
+        SDFUnion(const std::vector<std::shared_ptr<SignedDFInterface<NDIM> > >& shapes)
+            : shapes(shapes) {
+            MADNESS_ASSERT(!shapes.empty());
+        }
+
+        double sdf(const Vector<double,NDIM>& x) const {
+            double d = shapes[0]->sdf(x);
+            for(std::size_t s = 1; s < shapes.size(); ++s)
+                d = std::min(d, shapes[s]->sdf(x));
+            return d;
+        }
+
+        /// The gradient of the shape nearest to \c x
+        Vector<double,NDIM> grad_sdf(const Vector<double,NDIM>& x) const {
+            std::size_t smin = 0;
+            double d = shapes[0]->sdf(x);
+            for(std::size_t s = 1; s < shapes.size(); ++s) {
+                const double ds = shapes[s]->sdf(x);
+                if(ds < d) {
+                    d = ds;
+                    smin = s;
+                }
+            }
+            return shapes[smin]->grad_sdf(x);
+        }
+
+        void sdf_points(const Vector<double*,NDIM>& x, double* d, int npts) const {
+            shapes[0]->sdf_points(x, d, npts);
+            std::vector<double> ds(npts);
+            for(std::size_t s = 1; s < shapes.size(); ++s) {
+                shapes[s]->sdf_points(x, ds.data(), npts);
+                for(int j = 0; j < npts; ++j)
+                    d[j] = std::min(d[j], ds[j]);
+            }
+        }
+
+        bool sdf_bounds(const Vector<double,NDIM>& lo,
+                const Vector<double,NDIM>& hi, double& dmin, double& dmax)
+                const {
+            if(!shapes[0]->sdf_bounds(lo, hi, dmin, dmax)) return false;
+            for(std::size_t s = 1; s < shapes.size(); ++s) {
+                double smin, smax;
+                if(!shapes[s]->sdf_bounds(lo, hi, smin, smax)) return false;
+                dmin = std::min(dmin, smin);
+                dmax = std::min(dmax, smax);
+            }
+            return true;
+        }
+    };
+
+    /** \brief The intersection of shapes: inside if inside all of them
+
+        The sdf is the maximum of the sdfs of the shapes.
+
+        \ingroup mrabcint */
+    template <std::size_t NDIM>
+    class SDFIntersection : public SignedDFInterface<NDIM> {
+    protected:
+        /// The shapes
+        std::vector<std::shared_ptr<SignedDFInterface<NDIM> > > shapes;
+
+    public:
+        /** \brief Constructor for the intersection
+
+            \param shapes The shapes, at least one */
+        SDFIntersection(const std::vector<std::shared_ptr<SignedDFInterface<NDIM> > >& shapes)
+            : shapes(shapes) {
+            MADNESS_ASSERT(!shapes.empty());
+        }
+
+        double sdf(const Vector<double,NDIM>& x) const {
+            double d = shapes[0]->sdf(x);
+            for(std::size_t s = 1; s < shapes.size(); ++s)
+                d = std::max(d, shapes[s]->sdf(x));
+            return d;
+        }
+
+        /// The gradient of the shape farthest from \c x
+        Vector<double,NDIM> grad_sdf(const Vector<double,NDIM>& x) const {
+            std::size_t smax = 0;
+            double d = shapes[0]->sdf(x);
+            for(std::size_t s = 1; s < shapes.size(); ++s) {
+                const double ds = shapes[s]->sdf(x);
+                if(ds > d) {
+                    d = ds;
+                    smax = s;
+                }
+            }
+            return shapes[smax]->grad_sdf(x);
+        }
+
+        void sdf_points(const Vector<double*,NDIM>& x, double* d, int npts) const {
+            shapes[0]->sdf_points(x, d, npts);
+            std::vector<double> ds(npts);
+            for(std::size_t s = 1; s < shapes.size(); ++s) {
+                shapes[s]->sdf_points(x, ds.data(), npts);
+                for(int j = 0; j < npts; ++j)
+                    d[j] = std::max(d[j], ds[j]);
+            }
+        }
+
+        bool sdf_bounds(const Vector<double,NDIM>& lo,
+                const Vector<double,NDIM>& hi, double& dmin, double& dmax)
+                const {
+            if(!shapes[0]->sdf_bounds(lo, hi, dmin, dmax)) return false;
+            for(std::size_t s = 1; s < shapes.size(); ++s) {
+                double smin, smax;
+                if(!shapes[s]->sdf_bounds(lo, hi, smin, smax)) return false;
+                dmin = std::max(dmin, smin);
+                dmax = std::max(dmax, smax);
+            }
+            return true;
+        }
     };
 
     /** \brief The interface for masking functions defined by signed distance
@@ -137,6 +326,17 @@ namespace madness {
             \return Derivative of the normalized surface layer function */
         virtual double dsurface(double d) const = 0;
 
+        /** \brief Half width of the surface layer
+
+            For \f$ |d| > \f$ band() the mask is 0 or 1 and the other
+            functions are 0 (to machine precision).  The default, infinity,
+            means there is no such band.
+
+            \return The half width */
+        virtual double band() const {
+            return std::numeric_limits<double>::infinity();
+        }
+
         virtual ~DomainMaskInterface() {}
     };
 
@@ -153,6 +353,13 @@ namespace madness {
         The functor defaults to the domain mask; however, member functions
         can toggle between the other options.
 
+        The functor evaluates all quadrature points of a box in one call.
+        Boxes whose points lie entirely outside the surface layer of the
+        mask (see DomainMaskInterface::band()) get a constant without
+        evaluating the sdf, and with \c cache_sdf() the signed distances of
+        the boxes in the layer are kept, so that projecting the mask, the
+        surface, etc. of the same shape computes them only once.
+
         \ingroup mrabcint */
     template <std::size_t NDIM>
     class DomainMaskSDFFunctor : public FunctionFunctorInterface<double,NDIM> {
@@ -161,6 +368,27 @@ namespace madness {
         /// \brief Bury the default constructor
         DomainMaskSDFFunctor() {}
 
+        typedef Vector<double,NDIM> coordT;
+
+        /// The points of a box, identified by their bounds
+        struct pointsT {
+            coordT lo, hi;
+            int npts;
+
+            bool operator==(const pointsT& other) const {
+                return npts == other.npts && lo == other.lo && hi == other.hi;
+            }
+
+            hashT hash() const {
+                hashT h = hash_value(npts);
+                hash_combine(h, lo);
+                hash_combine(h, hi);
+                return h;
+            }
+        };
+
+        typedef ConcurrentHashMap< pointsT, std::vector<double> > cacheT;
+
     private: // protected may be better if this becomes highly inherited
         /// The domain mask to use
         std::shared_ptr<DomainMaskInterface> mask;
@@ -170,6 +398,54 @@ namespace madness {
 
         int mswitch; ///< Which masking function to use (mask, surface, etc.)
 
+        /// Signed distances of the boxes in the layer, if they are kept
+        std::shared_ptr<cacheT> cache;
+
+        /// \brief The bounds of the coordinates of \c npts points
+        static void bounds(const Vector<double*,NDIM>& x, int npts, coordT& lo,
+                coordT& hi) {
+            for(std::size_t i = 0; i < NDIM; ++i) {
+                const double* restrict xi = x[i];
+                double l = xi[0], h = xi[0];
+                for(int j = 1; j < npts; ++j) {
+                    l = std::min(l, xi[j]);
+                    h = std::max(h, xi[j]);
+                }
+                lo[i] = l;
+                hi[i] = h;
+            }
+        }
+
+        /** \brief Is function \c which constant in the box?
+
+            \param[in] which The function (MASK, DMASK, etc.)
+            \param[in] lo The lower corner of the box
+            \param[in] hi The upper corner of the box
+            \param[out] value The constant
+            \return True if the box is outside of the surface layer */
+        bool constant(int which, const coordT& lo, const coordT& hi,
+                double& value) const {
+            const double band = mask->band();
+            double dmin, dmax;
+            if(band == std::numeric_limits<double>::infinity() ||
+               !sdf->sdf_bounds(lo, hi, dmin, dmax))
+                return false;
+            bool inside;
+            if(dmin > band)
+                inside = false;
+            else if(dmax < -band)
+                inside = true;
+            else
+                return false;
+            if(which == MASK)
+                value = inside ? 1.0 : 0.0;
+            else if(which == MASK_COMPLEMENT)
+                value = inside ? 0.0 : 1.0;
+            else
+                value = 0.0;
+            return true;
+        }
+
     public:
         // switch values
         static const int MASK; ///< Use the \c mask() function in \c mask
@@ -229,6 +505,100 @@ namespace madness {
             }
         }
 
+        /** \brief Is function \c which zero between the given points?
+
+            \param[in] which The function (MASK, DMASK, etc.)
+            \param[in] c1 The lower corner
+            \param[in] c2 The upper corner
+            \return True if the function is zero */
+        bool screened(int which, const coordT& c1, const coordT& c2) const {
+            double value;
+            return constant(which, c1, c2, value) && value == 0.0;
+        }
+
+        bool screened(const coordT& c1, const coordT& c2) const {
+            return screened(mswitch, c1, c2);
+        }
+
+        bool supports_vectorized() const {
+            return true;
+        }
+
+        /** \brief Evaluates function \c which at many points
+
+            \param[in] which The function (MASK, DMASK, etc.)
+            \param[in] x The coordinates, \c x[i][j] is coordinate \c i of
+                         point \c j
+            \param[out] f The values
+            \param[in] npts The number of points */
+        void evaluate(int which, const Vector<double*,NDIM>& x, double* f,
+                int npts) const {
+            coordT lo, hi;
+            bounds(x, npts, lo, hi);
+            double value;
+            if(constant(which, lo, hi, value)) {
+                std::fill(f, f+npts, value);
+                return;
+            }
+
+            // the signed distances, from the cache if possible
+            std::vector<double> dvec;
+            const double* d;
+            typename cacheT::accessor acc;
+            if(cache) {
+                pointsT key = {lo, hi, npts};
+                if(cache->insert(acc, key)) {
+                    acc->second.resize(npts);
+                    sdf->sdf_points(x, acc->second.data(), npts);
+                }
+                d = acc->second.data();
+            }
+            else {
+                dvec.resize(npts);
+                sdf->sdf_points(x, dvec.data(), npts);
+                d = dvec.data();
+            }
+
+            const DomainMaskInterface& m = *mask;
+            if(which == MASK)
+                for(int j = 0; j < npts; ++j) f[j] = m.mask(d[j]);
+            else if(which == MASK_COMPLEMENT)
+                for(int j = 0; j < npts; ++j) f[j] = 1.0 - m.mask(d[j]);
+            else if(which == DMASK)
+                for(int j = 0; j < npts; ++j) f[j] = m.dmask(d[j]);
+            else if(which == SURFACE)
+                for(int j = 0; j < npts; ++j) f[j] = m.surface(d[j]);
+            else if(which == DSURFACE)
+                for(int j = 0; j < npts; ++j) f[j] = m.dsurface(d[j]);
+            else
+                error("Unknown function from DomainMaskInterface in " \
+                      "DomainMaskSDFFunctor::evaluate()");
+        }
+
+        void operator()(const Vector<double*,NDIM>& x, double* f, int npts)
+                const {
+            evaluate(mswitch, x, f, npts);
+        }
+
+        /** \brief Keeps the signed distances at the points of the boxes in
+                   the surface layer for later projections
+
+            Projections with the same wavelet order visit the same points,
+            so the sdf of each box is computed only once.  The memory is that
+            of a function on the surface layer; see \c clear_cache().
+
+            \param[in] on Whether to cache */
+        void cache_sdf(bool on = true) {
+            // a layer has many boxes, hence the many bins
+            if(on && !cache) cache.reset(new cacheT(100003));
+            if(!on) cache.reset();
+        }
+
+        /// \brief Releases the cached signed distances
+        void clear_cache() {
+            if(cache) cache->clear();
+        }
+
         /** \brief Toggles which function from DomainMaskInterface to use when
                    making the MADNESS function.
 
@@ -366,6 +736,11 @@ namespace madness {
             return 72.0*phi*(1.0-phi)*dphi*(1.0 - 2.0*phi)/epsilon;
         }
 
+        /// The mask is 0 or 1 beyond \f$ 8 \epsilon \f$
+        double band() const {
+            return 8.0*epsilon;
+        }
+
         virtual ~LLRVDomainMask() {}
     };
 
@@ -437,6 +812,12 @@ namespace madness {
                 * epsilon*epsilon*epsilon);
         }
 
+        /// The mask is 0 or 1 beyond \f$ 8 \epsilon \f$, where the surface
+        /// function is below \f$ 10^{-14} \f$
+        double band() const {
+            return 8.0*epsilon;
+        }
+
         virtual ~GaussianDomainMask() {}
     };
 
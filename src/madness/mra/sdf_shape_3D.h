@@ -36,7 +36,9 @@
   \brief Implements the SignedDFInterface for common 3-D geometric objects.
   \ingroup mrabcint
 
-  This file provides signed distance functions for common 3-D geometric objects:
+  This file provides signed distance functions for common 3-D geometric objects
+  (unions and intersections of them are SDFUnion and SDFIntersection in
+  sdf_domainmask.h):
   - Plane
   - Sphere
   - Cone
@@ -54,6 +56,10 @@
   may be extremely problematic and cause excessive refinement.  The sdf
   function of the sphere class outlines how to calculate the exact signed
   distance functions, if needed.
+
+  The shapes also evaluate their SDF for the arrays of points that
+  DomainMaskSDFFunctor passes when projecting, and bound it over a box so
+  that boxes outside the surface layer are not evaluated at all.
 */  
   
 #ifndef MADNESS_MRA_SDF_SHAPE_3D_H__INCLUDED
@@ -97,6 +103,32 @@ namespace madness {
         coord_3d grad_sdf(const coord_3d& pt) const {
             MADNESS_EXCEPTION("gradient method is not yet implemented for this shape",0);
         }
+
+        void sdf_points(const Vector<double*,3>& x, double* d, int npts) const {
+            const double* restrict x0 = x[0];
+            const double* restrict x1 = x[1];
+            const double* restrict x2 = x[2];
+            const double c = point[0]*normal[0] + point[1]*normal[1] + point[2]*normal[2];
+            for(int j = 0; j < npts; ++j)
+                d[j] = x0[j]*normal[0] + x1[j]*normal[1] + x2[j]*normal[2] - c;
+        }
+
+        /** \brief Exact bounds of the SDF over a box
+
+            \param lo The lower corner of the box
+            \param hi The upper corner of the box
+            \param dmin The smallest signed distance in the box
+            \param dmax The largest signed distance in the box
+            \return True */
+        bool sdf_bounds(const coord_3d& lo, const coord_3d& hi, double& dmin, double& dmax) const {
+            dmin = dmax = 0.0;
+            for(int i = 0; i < 3; ++i) {
+                const double a = (lo[i]-point[i])*normal[i], b = (hi[i]-point[i])*normal[i];
+                dmin += std::min(a, b);
+                dmax += std::max(a, b);
+            }
+            return true;
+        }
     };
 
     /// \brief A spherical surface (3 dimensions)
@@ -149,6 +181,39 @@ namespace madness {
             g[2] = z/r;
             return g;
         }
+
+        void sdf_points(const Vector<double*,3>& x, double* d, int npts) const {
+            const double* restrict x0 = x[0];
+            const double* restrict x1 = x[1];
+            const double* restrict x2 = x[2];
+            for(int j = 0; j < npts; ++j) {
+                const double a = x0[j] - center[0], b = x1[j] - center[1], c = x2[j] - center[2];
+                d[j] = sqrt(a*a + b*b + c*c) - radius;
+            }
+        }
+
+        /** \brief Exact bounds of the SDF over a box
+
+            The nearest and farthest points of the box from the center give
+            the bounds.
+
+            \param lo The lower corner of the box
+            \param hi The upper corner of the box
+            \param dmin The smallest signed distance in the box
+            \param dmax The largest signed distance in the box
+            \return True */
+        bool sdf_bounds(const coord_3d& lo, const coord_3d& hi, double& dmin, double& dmax) const {
+            double rmin = 0.0, rmax = 0.0;
+            for(int i = 0; i < 3; ++i) {
+                const double a = lo[i] - center[i], b = hi[i] - center[i];
+                if(a > 0.0) rmin += a*a;
+                else if(b < 0.0) rmin += b*b;
+                rmax += std::max(a*a, b*b);
+            }
+            dmin = sqrt(rmin) - radius;
+            dmax = sqrt(rmax) - radius;
+            return true;
+        }
     };
 
     /** \brief A cone (3 dimensions)
@@ -207,6 +272,33 @@ namespace madness {
         coord_3d grad_sdf(const coord_3d& pt) const {
             MADNESS_EXCEPTION("gradient method is not yet implemented for this shape",0);
         }
+
+        void sdf_points(const Vector<double*,3>& x, double* d, int npts) const {
+            const double* restrict x0 = x[0];
+            const double* restrict x1 = x[1];
+            const double* restrict x2 = x[2];
+            for(int j = 0; j < npts; ++j) {
+                double a = x0[j] - apex[0], b = x1[j] - apex[1], e = x2[j] - apex[2];
+                const double dotp = a*dir[0] + b*dir[1] + e*dir[2];
+                a -= dotp*dir[0];
+                b -= dotp*dir[1];
+                e -= dotp*dir[2];
+                d[j] = sqrt(a*a + b*b + e*e) - c*dotp;
+            }
+        }
+
+        /** \brief Bounds of the SDF over a box
+
+            The gradient of the contour is at most \f$ \sqrt{1+c^2} \f$.
+
+            \param lo The lower corner of the box
+            \param hi The upper corner of the box
+            \param dmin Lower bound of the signed distance in the box
+            \param dmax Upper bound of the signed distance in the box
+            \return True */
+        bool sdf_bounds(const coord_3d& lo, const coord_3d& hi, double& dmin, double& dmax) const {
+            return lipschitz_bounds(lo, hi, sqrt(1.0 + c*c), dmin, dmax);
+        }
     };
 
     /** \brief A paraboloid (3 dimensions)
@@ -364,6 +456,19 @@ namespace madness {
             MADNESS_EXCEPTION("gradient method is not yet implemented for this shape",0);
         }
 
+        /** \brief Bounds of the SDF over a box
+
+            The SDF is exact, so it changes no faster than the distance.
+
+            \param lo The lower corner of the box
+            \param hi The upper corner of the box
+            \param dmin Lower bound of the signed distance in the box
+            \param dmax Upper bound of the signed distance in the box
+            \return True */
+        bool sdf_bounds(const coord_3d& lo, const coord_3d& hi, double& dmin, double& dmax) const {
+            return lipschitz_bounds(lo, hi, 1.0, dmin, dmax);
+        }
+
         protected:
         /** \brief Finds real root(s) of the cubic polynomial in the sdf
                    function.
@@ -634,6 +739,35 @@ namespace madness {
         coord_3d grad_sdf(const coord_3d& pt) const {
             MADNESS_EXCEPTION("gradient method is not yet implemented for this shape",0);
         }
+
+        void sdf_points(const Vector<double*,3>& x, double* d, int npts) const {
+            const double* restrict x0 = x[0];
+            const double* restrict x1 = x[1];
+            const double* restrict x2 = x[2];
+            for(int j = 0; j < npts; ++j) {
+                d[j] = std::max(std::max(fabs(x0[j] - center[0]) - lengths[0],
+                                         fabs(x1[j] - center[1]) - lengths[1]),
+                                fabs(x2[j] - center[2]) - lengths[2]);
+            }
+        }
+
+        /** \brief Exact bounds of the SDF over a box
+
+            \param lo The lower corner of the box
+            \param hi The upper corner of the box
+            \param dmin The smallest signed distance in the box
+            \param dmax The largest signed distance in the box
+            \return True */
+        bool sdf_bounds(const coord_3d& lo, const coord_3d& hi, double& dmin, double& dmax) const {
+            dmin = dmax = -std::numeric_limits<double>::infinity();
+            for(int i = 0; i < 3; ++i) {
+                const double a = lo[i] - center[i], b = hi[i] - center[i];
+                const double amin = (a > 0.0) ? a : ((b < 0.0) ? -b : 0.0);
+                dmin = std::max(dmin, amin - lengths[i]);
+                dmax = std::max(dmax, std::max(fabs(a), fabs(b)) - lengths[i]);
+            }
+            return true;
+        }
     };
 
     /** \brief A cube (3 dimensions)
@@ -695,6 +829,36 @@ namespace madness {
         coord_3d grad_sdf(const coord_3d& pt) const {
             MADNESS_EXCEPTION("gradient method is not yet implemented for this shape",0);
         }
+
+        void sdf_points(const Vector<double*,3>& x, double* d, int npts) const {
+            const double* restrict x0 = x[0];
+            const double* restrict x1 = x[1];
+            const double* restrict x2 = x[2];
+            const double r0 = 1.0/radii[0], r1 = 1.0/radii[1], r2 = 1.0/radii[2];
+            for(int j = 0; j < npts; ++j) {
+                const double a = (x0[j] - center[0])*r0, b = (x1[j] - center[1])*r1,
+                    c = (x2[j] - center[2])*r2;
+                d[j] = a*a + b*b + c*c - 1.0;
+            }
+        }
+
+        /** \brief Exact bounds of the SDF over a box
+
+            \param lo The lower corner of the box
+            \param hi The upper corner of the box
+            \param dmin The smallest signed distance in the box
+            \param dmax The largest signed distance in the box
+            \return True */
+        bool sdf_bounds(const coord_3d& lo, const coord_3d& hi, double& dmin, double& dmax) const {
+            dmin = dmax = -1.0;
+            for(int i = 0; i < 3; ++i) {
+                const double a = (lo[i] - center[i])/radii[i], b = (hi[i] - center[i])/radii[i];
+                if(a > 0.0) dmin += a*a;
+                else if(b < 0.0) dmin += b*b;
+                dmax += std::max(a*a, b*b);
+            }
+            return true;
+        }
     };
     
     /// \brief A cylinder (3 dimensions)
@@ -754,6 +918,34 @@ namespace madness {
         coord_3d grad_sdf(const coord_3d& pt) const {
             MADNESS_EXCEPTION("gradient method is not yet implemented for this shape",0);
         }
+
+        void sdf_points(const Vector<double*,3>& x, double* d, int npts) const {
+            const double* restrict x0 = x[0];
+            const double* restrict x1 = x[1];
+            const double* restrict x2 = x[2];
+            for(int j = 0; j < npts; ++j) {
+                double r0 = x0[j] - center[0], r1 = x1[j] - center[1], r2 = x2[j] - center[2];
+                const double dist = r0*axis[0] + r1*axis[1] + r2*axis[2];
+                r0 -= dist*axis[0];
+                r1 -= dist*axis[1];
+                r2 -= dist*axis[2];
+                d[j] = std::max(fabs(dist) - a, sqrt(r0*r0 + r1*r1 + r2*r2) - radius);
+            }
+        }
+
+        /** \brief Bounds of the SDF over a box
+
+            Both the axial and the radial distance change no faster than the
+            distance.
+
+            \param lo The lower corner of the box
+            \param hi The upper corner of the box
+            \param dmin Lower bound of the signed distance in the box
+            \param dmax Upper bound of the signed distance in the box
+            \return True */
+        bool sdf_bounds(const coord_3d& lo, const coord_3d& hi, double& dmin, double& dmax) const {
+            return lipschitz_bounds(lo, hi, 1.0, dmin, dmax);
+        }
     };
 
 } // end of madness namespace
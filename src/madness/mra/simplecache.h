@@ -49,6 +49,8 @@ namespace madness {
         mapT cache;
 
     public:
+        typedef typename mapT::const_iterator const_iterator;
+
         SimpleCache() : cache() {};
 
         SimpleCache(const SimpleCache& c) : cache(c.cache) {};
@@ -87,6 +89,20 @@ namespace madness {
         }
 
 
+        /// Return the number of cached elements
+        inline std::size_t size() const {
+            return cache.size();
+        }
+
+        /// Iterate over the cached (key,value) pairs ... not thread safe w.r.t. set()
+        inline const_iterator begin() const {
+            return cache.begin();
+        }
+
+        inline const_iterator end() const {
+            return cache.end();
+        }
+
         /// Set value associated with key ... gives ownership of a new copy to the container
         inline void set(const Key<NDIM>& key, const Q& val) {
             cache.insert(pairT(key,val));
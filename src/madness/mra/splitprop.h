@@ -0,0 +1,302 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_SPLITPROP_H__INCLUDED
+#define MADNESS_MRA_SPLITPROP_H__INCLUDED
+
+/// \file splitprop.h
+/// \brief Split-operator propagator for the time-dependent Schrodinger equation
+
+#include <madness/mra/mra.h>
+#include <madness/mra/operator.h>
+#include <madness/mra/qmprop.h>
+#include <madness/tensor/vmath.h>
+#include <madness/world/worldhashmap.h>
+#include <list>
+
+namespace madness {
+
+    /// Split-operator propagator for complex wave functions
+
+    /// The kinetic factor exp(-i T dt/2) is the band-limited free-particle
+    /// propagator of qmprop.h, applied one dimension at a time with
+    /// apply_1d_realspace_push after broadening psi, as in apps/tdse; the
+    /// band limit lets the push screen small contributions.  The potential factor exp(-i tau (V + F.r)) is
+    /// never formed as a function: it multiplies the values of the leaves of
+    /// psi in place, and psi is refined only where V is finer than psi.
+    ///
+    /// The values of exp(-i tau V) in each box are computed with the
+    /// vectorized complex exp and cached per potential and tau, so that a
+    /// static potential is exponentiated once for the whole propagation.  The
+    /// phase of a uniform field F is separable and is applied as an outer
+    /// product of one-dimensional phases, which leaves the cache valid for a
+    /// time-dependent field.  A cached potential must not be modified in
+    /// place; call clear_cache() if it is.
+    ///
+    /// apply_phase, trotter and chin_chen are collective.
+    template <std::size_t NDIM>
+    class SplitOperatorPropagator : public WorldObject< SplitOperatorPropagator<NDIM> > {
+    public:
+        typedef Vector<double,NDIM> coordT;
+        typedef Function<double,NDIM> functionT;
+        typedef Function<double_complex,NDIM> complex_functionT;
+
+    private:
+        typedef SplitOperatorPropagator<NDIM> propT;
+        typedef WorldObject<propT> woT;
+        typedef Key<NDIM> keyT;
+        typedef FunctionImpl<double,NDIM> implT;
+        typedef FunctionImpl<double_complex,NDIM> complex_implT;
+        typedef GenTensor<double> coeffT;
+        typedef GenTensor<double_complex> complex_coeffT;
+        typedef FunctionNode<double_complex,NDIM> complex_nodeT;
+        typedef ConcurrentHashMap< keyT, Tensor<double_complex> > cacheT;
+
+        /// The values of exp(-i tau V) per box; holding V keeps its id unique
+        struct phase_cache {
+            std::shared_ptr<implT> v;
+            double tau;
+            std::shared_ptr<cacheT> values;
+        };
+
+        World& world;
+        const double time_step;
+        const int nbroaden;                                ///< broadenings before the kinetic step
+        std::shared_ptr< Convolution1D<double_complex> > q1d;   ///< 1-d factor of exp(-i T time_step/2)
+        const std::size_t max_cached;                      ///< number of cached potentials
+        mutable Mutex cache_mutex;
+        std::list<phase_cache> caches;                     ///< most recent first
+
+        /// The cache of exp(-i tau v) on this process, or null if it is not registered
+        std::shared_ptr<cacheT> find_cache(const implT* v, const double tau) const {
+            ScopedMutex<Mutex> guard(cache_mutex);
+            for (const phase_cache& c : caches) {
+                if (c.v.get() == v and c.tau == tau) return c.values;
+            }
+            return std::shared_ptr<cacheT>();
+        }
+
+        /// Registers the cache of exp(-i tau v), evicting the least recently registered
+        void register_cache(const functionT& v, const double tau) {
+            ScopedMutex<Mutex> guard(cache_mutex);
+            for (typename std::list<phase_cache>::iterator it=caches.begin(); it!=caches.end(); ++it) {
+                if (it->v == v.get_impl() and it->tau == tau) {
+                    caches.splice(caches.begin(), caches, it);
+                    return;
+                }
+            }
+            phase_cache c = {v.get_impl(), tau, std::shared_ptr<cacheT>(new cacheT)};
+            caches.push_front(c);
+            if (caches.size() > max_cached) caches.pop_back();
+        }
+
+        /// exp(-i tau F.r) at the quadrature points of box key
+        static Tensor<double_complex> field_phase(const keyT& key, const int k, const double tau,
+                                                  const coordT& field) {
+            const Tensor<double>& qx = FunctionCommonData<double,NDIM>::get(k).quad_x;
+            const Tensor<double>& cell = FunctionDefaults<NDIM>::get_cell();
+            const Tensor<double>& width = FunctionDefaults<NDIM>::get_cell_width();
+            const double h = std::pow(0.5, double(key.level()));
+            Tensor<double_complex> r;
+            for (std::size_t d=0; d<NDIM; ++d) {
+                Tensor<double_complex> e(k);
+                for (int i=0; i<k; ++i) {
+                    const double x = cell(d,0) + width[d]*h*(key.translation()[d] + qx[i]);
+                    e[i] = std::exp(double_complex(0.0, -tau*field[d]*x));
+                }
+                r = (d == 0) ? e : outer(r, e);
+            }
+            return r;
+        }
+
+        /// Multiplies the leaf of psi in box key with the given phase
+        void multiply(complex_implT* psi, const keyT& key, const complex_coeffT& c,
+                      const Tensor<double_complex>& phase, const double tau, const coordT& field) const {
+            Tensor<double_complex> values = psi->coeffs2values(key, c).full_tensor_copy();
+            values.emul(phase);
+            if (field.normf() > 0.0) values.emul(field_phase(key, psi->get_k(), tau, field));
+            psi->get_coeffs().replace(key,
+                complex_nodeT(complex_coeffT(psi->values2coeffs(key, values), psi->get_tensor_args()), false));
+        }
+
+        /// Applies the phase to the leaf of psi in box key, whose coefficients are c
+        void phase_node(complex_implT* psi, const implT* v, const double tau, const coordT& field,
+                        const bool use_cache, const keyT& key, const complex_coeffT& c) const {
+            if (use_cache) {
+                std::shared_ptr<cacheT> cache = find_cache(v, tau);
+                typename cacheT::const_accessor acc;
+                if (cache and cache->find(acc, key)) {
+                    multiply(psi, key, c, acc->second, tau, field);
+                    return;
+                }
+            }
+
+            // the leaf of v at or above key, or no coefficients if v is finer than psi
+            Future< std::pair<keyT,coeffT> > vleaf;
+            v->task(v->get_coeffs().owner(key), &implT::sock_it_to_me, key, vleaf.remote_ref(world),
+                    TaskAttributes::hipri());
+            woT::task(world.rank(), &propT::phase_node_cont, psi, v, tau, field, use_cache, key, c, vleaf);
+        }
+
+        /// Continuation of phase_node once the leaf of v is available
+        void phase_node_cont(complex_implT* psi, const implT* v, const double tau, const coordT& field,
+                             const bool use_cache, const keyT& key, const complex_coeffT& c,
+                             const std::pair<keyT,coeffT>& vleaf) const {
+            if (not vleaf.second.has_data()) {
+                // v is refined below key: split the leaf of psi and descend
+                psi->get_coeffs().replace(key, complex_nodeT(complex_coeffT(), true));
+                for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+                    const keyT& child = kit.key();
+                    woT::task(psi->get_coeffs().owner(child), &propT::phase_node, psi, v, tau, field,
+                              use_cache, child, psi->parent_to_child(c, key, child));
+                }
+                return;
+            }
+
+            const Tensor<double> vc = vleaf.second.full_tensor_copy();
+            const Tensor<double> vvalues = v->fcube_for_mul(key, vleaf.first, vc);
+            const Tensor<double_complex> phase = vexp(vvalues*double_complex(0.0,-tau));
+            if (use_cache) {
+                std::shared_ptr<cacheT> cache = find_cache(v, tau);
+                if (cache) cache->insert(std::make_pair(key, phase));
+            }
+            multiply(psi, key, c, phase, tau, field);
+        }
+
+    public:
+        /// Makes the propagator for the given time step
+
+        /// @param[in] k the wavelet order of the wave functions
+        /// @param[in] bandlimit the band limit of the free-particle propagator
+        /// @param[in] time_step the time step; the kinetic factor is for half a step
+        /// @param[in] nbroaden the number of times psi is broadened before the kinetic step
+        /// @param[in] max_cached the number of potentials whose phases are cached
+        SplitOperatorPropagator(World& world, const int k, const double bandlimit, const double time_step,
+                                const int nbroaden=4, const std::size_t max_cached=4)
+            : woT(world)
+            , world(world)
+            , time_step(time_step)
+            , nbroaden(nbroaden)
+            , q1d(qm_1d_free_particle_propagator(k, bandlimit, 0.5*time_step,
+                                                 FunctionDefaults<NDIM>::get_cell_min_width()))
+            , max_cached(max_cached) {
+            woT::process_pending();
+        }
+
+        /// The time step
+        double get_time_step() const {return time_step;}
+
+        /// Forgets the cached phases
+        void clear_cache() {
+            ScopedMutex<Mutex> guard(cache_mutex);
+            caches.clear();
+        }
+
+        /// Multiplies psi in place with exp(-i tau (v + field.r))
+
+        /// psi is left reconstructed and is not truncated.
+        /// @param[in] use_cache if false, the phase of v is neither cached nor looked up (e.g. for
+        ///            a potential that is used only once)
+        void apply_phase(complex_functionT& psi, const functionT& v, const double tau,
+                         const coordT& field=coordT(0.0), const bool use_cache=true) {
+            MADNESS_ASSERT(psi.k() == v.k());
+            psi.reconstruct(false);
+            v.reconstruct(false);
+            if (use_cache) register_cache(v, tau);
+            world.gop.fence();
+
+            complex_implT* psiimpl = psi.get_impl().get();
+            const implT* vimpl = v.get_impl().get();
+            std::vector< std::pair<keyT,complex_coeffT> > leaves;
+            typedef typename complex_implT::dcT::const_iterator iterT;
+            for (iterT it=psiimpl->get_coeffs().begin(); it!=psiimpl->get_coeffs().end(); ++it) {
+                if (it->second.has_coeff()) leaves.push_back(std::make_pair(it->first, it->second.coeff()));
+            }
+            for (std::size_t i=0; i<leaves.size(); ++i) {
+                woT::task(world.rank(), &propT::phase_node, psiimpl, vimpl, tau, field, use_cache,
+                          leaves[i].first, leaves[i].second);
+            }
+            world.gop.fence();
+        }
+
+        /// Applies the kinetic factor exp(-i T time_step/2)
+        complex_functionT kinetic(const complex_functionT& psi) const {
+            complex_functionT r = copy(psi);
+            for (int i=0; i<nbroaden; ++i) r.broaden();
+            for (int axis=NDIM-1; axis>=0; --axis) {
+                r = apply_1d_realspace_push(*q1d, r, axis);
+                r.sum_down();
+            }
+            return r;
+        }
+
+        /// One Trotter step exp(-i T dt/2) exp(-i dt (v + field.r)) exp(-i T dt/2) psi
+
+        /// v and field are taken at the middle of the step.
+        complex_functionT trotter(const complex_functionT& psi, const functionT& v,
+                                  const coordT& field=coordT(0.0)) {
+            complex_functionT psi1 = kinetic(psi);
+            psi1.truncate();
+            apply_phase(psi1, v, time_step, field);
+            psi1.truncate();
+            psi1 = kinetic(psi1);
+            psi1.truncate();
+            return psi1;
+        }
+
+        /// One Chin-Chen step
+
+        /// psi(t+dt) = exp(-i dt/6 V(t+dt)) exp(-i T dt/2) exp(-i 2dt/3 Vtilde(t+dt/2))
+        ///             exp(-i T dt/2) exp(-i dt/6 V(t)) psi(t)
+        ///
+        /// with V(t) = v + field0.r, V(t+dt) = v + field1.r and Vtilde, which
+        /// includes its field, made by the caller.  The phases of v are cached,
+        /// that of vtilde is not.
+        complex_functionT chin_chen(const complex_functionT& psi, const functionT& v,
+                                    const coordT& field0, const functionT& vtilde, const coordT& field1) {
+            complex_functionT psi1 = copy(psi);
+            apply_phase(psi1, v, time_step/6.0, field0);
+            psi1.truncate();
+            psi1 = kinetic(psi1);
+            psi1.truncate();
+            apply_phase(psi1, vtilde, 2.0*time_step/3.0, coordT(0.0), false);
+            psi1.truncate();
+            psi1 = kinetic(psi1);
+            psi1.truncate();
+            apply_phase(psi1, v, time_step/6.0, field1);
+            psi1.truncate();
+            return psi1;
+        }
+    };
+
+}
+
+#endif // MADNESS_MRA_SPLITPROP_H__INCLUDED
@@ -37,6 +37,7 @@
 
 #include <madness/mra/mra.h>
 #include <madness/mra/operator.h>
+#include <madness/mra/operator_cache.h>
 #include <madness/constants.h>
 
 using namespace madness;
@@ -169,6 +170,135 @@ int test_bsh(World& world) {
     return success;
 }
 
+/// test reuse of operators and 1d convolutions, and eviction in BSHOperatorCache
+int test_bsh_cache(World& world) {
+    typedef Vector<double,3> coordT;
+    typedef std::shared_ptr< FunctionFunctorInterface<double,3> > functorT;
+    typedef BSHOperatorCache<3>::poperatorT poperatorT;
+
+    int success=0;
+    if (world.rank() == 0) print("\nTest BSH operator cache");
+
+    FunctionDefaults<3>::set_cubic_cell(-20,20);
+    FunctionDefaults<3>::set_k(6);
+    FunctionDefaults<3>::set_thresh(1e-6);
+    FunctionDefaults<3>::set_initial_level(5);
+
+    const double eps=1e-6;
+    const double lo=1e-4;
+    const double mu=1.0;
+    const double expnt=100.0;
+    aa=expnt;
+    const coordT origin(0.0);
+    Function<double,3> f = FunctionFactory<double,3>(world)
+            .functor(functorT(new Gaussian<double,3>(origin, expnt, pow(expnt/constants::pi,1.5))));
+    f.truncate();
+
+    // operators for mu on the same grid point are identical
+    BSHOperatorCache<3> cache(world);
+    poperatorT op1=cache.get(mu,lo,eps);
+    poperatorT op2=cache.get(mu*(1.0+1.e-9),lo,eps);
+    poperatorT op3=cache.get(1.1*mu,lo,eps);
+    if (op1!=op2) success++;
+    if (op1==op3) success++;
+    if ((cache.hits()!=1) or (cache.misses()!=2)) success++;
+    if (world.rank() == 0) print("hits, misses",cache.hits(),cache.misses());
+
+    // the fits of different mu share their 1d convolutions
+    std::set<const Convolution1D<double>*> conv1d;
+    for (int i=0; i<op1->get_rank(); ++i) conv1d.insert(op1->get_convolution1d(i,0).get());
+    int nshared=0;
+    for (int i=0; i<op3->get_rank(); ++i) nshared+=conv1d.count(op3->get_convolution1d(i,0).get());
+    if (world.rank() == 0) print("shared 1d convolutions",nshared,"of",op3->get_rank());
+    if (nshared==0) success++;
+
+    // rounding mu does not affect the result beyond the precision of the operator
+    Function<double,3> opf=(*op1)(f);
+    std::shared_ptr<SeparatedConvolution<double,3> > ref(BSHOperatorPtr3D(world,mu,lo,eps));
+    const double diff=(opf-(*ref)(f)).norm2();
+    const double err=opf.err(Qfunc());
+    if (world.rank() == 0) print("cached vs. fresh operator, error",diff,err);
+    if (diff>FunctionDefaults<3>::get_thresh()) success++;
+
+    // with a vanishing budget only the most recent operator survives
+    BSHOperatorCache<3> small(world,0.0);
+    Tensor<double> mus(3);
+    mus(0l)=0.9; mus(1)=1.0; mus(2)=1.1;
+    std::vector<poperatorT> ops=small.get(mus,lo,eps);
+    opf=(*ops[2])(f);
+    small.evict();
+    if (world.rank() == 0) print("operators after eviction",small.size(),"evictions",small.evictions());
+    if (small.size()!=1) success++;
+    if (small.get(1.1,lo,eps)!=ops[2]) success++;
+
+    world.gop.fence();
+    return success;
+}
+
+
+/// test that a warm OperatorDiskCache reproduces the operator and report the time to first apply
+int test_operator_disk_cache(World& world) {
+    typedef Vector<double,3> coordT;
+    typedef std::shared_ptr< FunctionFunctorInterface<double,3> > functorT;
+
+    int success=0;
+    if (world.rank() == 0) print("\nTest operator disk cache");
+
+    FunctionDefaults<3>::set_cubic_cell(-20,20);
+    FunctionDefaults<3>::set_k(6);
+    FunctionDefaults<3>::set_thresh(1e-6);
+    FunctionDefaults<3>::set_initial_level(5);
+
+    const double expnt=1.0;
+    const coordT origin(0.0);
+    Function<double,3> f = FunctionFactory<double,3>(world)
+            .functor(functorT(new Gaussian<double,3>(origin, expnt, pow(expnt/constants::pi,1.5))));
+    f.truncate();
+
+    // all ranks share the directory of rank 0
+    char dir[]="/tmp/madness_opcache_XXXXXX";
+    if (world.rank() == 0) {
+        if (!mkdtemp(dir)) {
+            print("could not create a temporary directory");
+            return 1;
+        }
+    }
+    world.gop.broadcast(dir,sizeof(dir),0);
+
+    // the operators are constructed from fresh 1d convolutions in both runs
+    GaussianConvolution1DCache<double>::erase_unused();
+    OperatorDiskCache::set_directory(dir);
+    std::vector<double> time(2);
+    std::vector<Function<double,3> > result(2);
+    for (int i=0; i<2; ++i) {
+        world.gop.fence();
+        const double start=wall_time();
+        std::shared_ptr<SeparatedConvolution<double,3> > op(BSHOperatorPtr3D(world,1.0,1.e-4,1.e-6));
+        result[i]=(*op)(f);
+        world.gop.fence();
+        time[i]=wall_time()-start;
+        op.reset();
+
+        // destroying the 1d convolutions writes them to disk
+        GaussianConvolution1DCache<double>::erase_unused();
+        world.gop.fence();
+    }
+    const double diff=(result[0]-result[1]).norm2();
+    if (world.rank() == 0) {
+        print("time to first apply, cold and warm cache",time[0],time[1]);
+        print("difference between the results          ",diff);
+    }
+    if (diff>1.e-12) success++;
+
+    OperatorDiskCache::set_directory("");
+    world.gop.fence();
+    if (world.rank() == 0) {
+        const std::string cmd=std::string("rm -rf ")+dir;
+        if (system(cmd.c_str())!=0) print("could not remove",dir);
+    }
+    return success;
+}
+
 
 int main(int argc, char**argv) {
     initialize(argc,argv);
@@ -179,6 +309,8 @@ int main(int argc, char**argv) {
         startup(world,argc,argv);
 
         success=test_bsh<double>(world);
+        success+=test_bsh_cache(world);
+        success+=test_operator_disk_cache(world);
 
     }
     catch (const SafeMPI::Exception& e) {
@@ -0,0 +1,157 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testdataflow.cc
+/// \brief Stress test of the recursive descents (mul, binary_op, vmul) on deep trees
+
+/// The left and right functions use different process maps, so that with
+/// several processes the descents need remote nodes.  These are passed as
+/// task dependencies; a task that waited for them instead would run other
+/// tasks on its own stack.  The span of stack addresses seen by the kernel
+/// on each thread is recorded and must stay small.
+///
+/// Run e.g. with MAD_NUM_THREADS=16 and several MPI processes.
+
+#include <madness/mra/mra.h>
+#include <madness/mra/vmra.h>
+#include <algorithm>
+#include <cstdint>
+
+using namespace madness;
+
+static const double L = 20.0;     // box size [-L,L]^3
+static const long k = 8;          // wavelet order
+static const double thresh = 1e-8;
+static const std::ptrdiff_t max_stack_span = 1<<20;
+
+// narrow Gaussians force deep trees
+static double f1(const coord_3d& r) {
+    const double x=r[0]-0.3, y=r[1]+0.2, z=r[2]-0.1;
+    return exp(-1000.0*(x*x + y*y + z*z)) + exp(-2.0*(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]));
+}
+
+static double f2(const coord_3d& r) {
+    const double x=r[0]-0.25, y=r[1]+0.2, z=r[2]-0.15;
+    return exp(-3000.0*(x*x + y*y + z*z)) + 0.5*exp(-(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]));
+}
+
+// lowest and highest stack address seen by the kernel on each thread
+static thread_local std::uintptr_t stack_lo = 0, stack_hi = 0;
+static Mutex stack_mutex;
+static std::ptrdiff_t stack_span = 0;
+
+static void record_stack() {
+    char here;
+    const std::uintptr_t p = reinterpret_cast<std::uintptr_t>(&here);
+    if (stack_lo == 0) stack_lo = stack_hi = p;
+    stack_lo = std::min(stack_lo, p);
+    stack_hi = std::max(stack_hi, p);
+    ScopedMutex<Mutex> guard(stack_mutex);
+    stack_span = std::max(stack_span, std::ptrdiff_t(stack_hi-stack_lo));
+}
+
+/// Pointwise product that records the stack depth of the calling task
+struct mul_and_record {
+    void operator()(const Key<3>& key, Tensor<double>& t, const Tensor<double>& l,
+                    const Tensor<double>& r) const {
+        record_stack();
+        t(___) = l;
+        t.emul(r);
+    }
+    template <typename Archive> void serialize(Archive& ar) {}
+};
+
+int check(World& world, const char* what, double err, double tol) {
+    if (world.rank() == 0) print("   ", what, err, (err > tol) ? "FAILED" : "ok");
+    return (err > tol) ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+    startup(world,argc,argv);
+
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L, L);
+
+    int nfail = 0;
+    try {
+        std::shared_ptr< WorldDCPmapInterface< Key<3> > > pmap(new LevelPmap< Key<3> >(world));
+        real_function_3d a = real_factory_3d(world).f(f1);
+        real_function_3d b = real_factory_3d(world).f(f2).pmap(pmap);
+        std::vector<real_function_3d> vb(4);
+        for (std::size_t i=0; i<vb.size(); ++i) vb[i] = real_factory_3d(world).f(f2).pmap(pmap);
+        if (world.rank() == 0) {
+            print("dataflow stress test with", world.size(), "process(es) and",
+                  ThreadPool::size(), "threads; max depth", a.max_depth(), b.max_depth());
+        }
+
+        const int nrepeat = 3;
+        for (int rep=0; rep<nrepeat; ++rep) {
+            real_function_3d ab = a*b;
+            real_function_3d abop = binary_op(a, b, mul_and_record());
+            std::vector<real_function_3d> vab = mul(world, a, vb);
+
+            const coord_3d r0 = vec(0.3, -0.2, 0.1), r1 = vec(0.26, -0.21, 0.14);
+            double err = 0.0;
+            for (const coord_3d& r : {r0, r1}) {
+                const double exact = f1(r)*f2(r);
+                err = std::max(err, std::abs(ab(r) - exact));
+                for (std::size_t i=0; i<vab.size(); ++i) err = std::max(err, std::abs(vab[i](r) - exact));
+            }
+            nfail += check(world, "mul, vmul pointwise error  ", err, 1e-5);
+            nfail += check(world, "binary_op vs mul           ", (abop - ab).norm2(), 1e-7);
+        }
+
+        world.gop.max(stack_span);
+        nfail += check(world, "stack span of the kernel   ", double(stack_span), double(max_stack_span));
+    }
+    catch (const SafeMPI::Exception& e) {
+        print(e);
+        error("caught an MPI exception");
+    }
+    catch (const madness::MadnessException& e) {
+        print(e);
+        error("caught a MADNESS exception");
+    }
+    catch (const std::exception& e) {
+        print(e.what());
+        error("caught an STL exception");
+    }
+
+    world.gop.fence();
+    finalize();
+    return nfail ? 1 : 0;
+}
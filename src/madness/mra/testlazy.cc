@@ -0,0 +1,153 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testlazy.cc
+/// \brief Tests and times lazy function expressions against the eager operations
+
+/// The timed expressions are the potential assembly of a Chin-Chen step of
+/// apps/tdse (Vtilde = V + E z - dt^2/48 |grad V|^2) and of the SCF local
+/// potential (vnuc + vcoul + vxc).
+
+#include <madness/mra/mra.h>
+#include <madness/mra/function_expression.h>
+
+using namespace madness;
+
+static const double L = 16.0;
+static const long k = 8;
+static const double thresh = 1e-6;
+
+double ttt, sss;
+#define START_TIMER world.gop.fence(); ttt=wall_time(); sss=cpu_time()
+#define END_TIMER(msg) ttt=wall_time()-ttt; sss=cpu_time()-sss; if (world.rank()==0) printf("timer: %-24.24s %8.2fs %8.2fs\n", msg, sss, ttt)
+
+static double gauss(const coord_3d& r, const coord_3d& c, double a) {
+    const double x=r[0]-c[0], y=r[1]-c[1], z=r[2]-c[2];
+    return exp(-a*(x*x + y*y + z*z));
+}
+
+static double fa(const coord_3d& r) {return gauss(r, vec(0.0,0.0,0.7), 2.0) + gauss(r, vec(0.0,0.0,-0.7), 2.0);}
+static double fb(const coord_3d& r) {return gauss(r, vec(0.3,0.0,0.0), 1.0) - 0.5*gauss(r, vec(0.0,0.2,0.0), 4.0);}
+static double fc(const coord_3d& r) {return 1.0/(1.0 + r[0]*r[0] + r[1]*r[1] + r[2]*r[2]);}
+static double fz(const coord_3d& r) {return r[2];}
+static double fexpb(const coord_3d& r) {return exp(-fb(r));}
+static double fsqrtc(const coord_3d& r) {return sqrt(fc(r));}
+
+int check(World& world, const char* what, const real_function_3d& lazyf, const real_function_3d& eager) {
+    const double err = (lazyf - eager).norm2()/std::max(1.0, eager.norm2());
+    const bool ok = err < 10.0*thresh;
+    if (world.rank() == 0) print("   ", what, err, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+    startup(world,argc,argv);
+
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_autorefine(false);   // as in apps/tdse; eager mul does not refine
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L, L);
+
+    int nfail = 0;
+    try {
+        real_function_3d a = real_factory_3d(world).f(fa);
+        real_function_3d b = real_factory_3d(world).f(fb);
+        real_function_3d c = real_factory_3d(world).f(fc);
+        real_function_3d z = real_factory_3d(world).f(fz);
+
+        if (world.rank() == 0) print("lazy expressions");
+        nfail += check(world, "a*b + c         ", evaluate(lazy(a)*b + c), a*b + c);
+        nfail += check(world, "a*b + c*a - 2b  ", evaluate(lazy(a)*b + lazy(c)*a - 2.0*lazy(b)), a*b + c*a - 2.0*b);
+        {
+            FunctionExpression<double,3> ab = lazy(a)*b;         // shared subexpression
+            nfail += check(world, "(ab)^2 - ab + 1 ", evaluate(ab*ab - ab + 1.0), (a*b)*(a*b) - a*b + 1.0);
+        }
+        real_function_3d eager_exp = real_factory_3d(world).f(fexpb);
+        nfail += check(world, "exp(-b)         ", evaluate(lazy_exp(-lazy(b))), eager_exp);
+        real_function_3d eager_sqrt = real_factory_3d(world).f(fsqrtc);
+        nfail += check(world, "sqrt(c)         ", evaluate(lazy_sqrt(lazy(c))), eager_sqrt);
+
+        // Chin-Chen potential: Vtilde = V + E z - dt^2/48 (Vx^2 + Vy^2 + (Vz+E)^2)
+        const double E = 0.05, dt = 0.1;
+        real_function_3d V = -1.0*a;
+        real_function_3d Vx = b, Vy = c, Vz = a;
+        if (world.rank() == 0) print("\ntdse potential assembly");
+        START_TIMER;
+        real_function_3d Vtilde_eager = V + E*z;
+        {
+            real_function_3d dV_dz = copy(Vz);
+            dV_dz.add_scalar(E);
+            real_function_3d dV_dz_sq = dV_dz*dV_dz;
+            real_function_3d dvsq = Vx*Vx + Vy*Vy + dV_dz_sq;
+            Vtilde_eager.gaxpy(1.0, dvsq, -dt*dt/48.0);
+            Vtilde_eager.truncate();
+        }
+        END_TIMER("eager");
+        START_TIMER;
+        FunctionExpression<double,3> dV_dz = lazy(Vz) + E;
+        real_function_3d Vtilde_lazy = evaluate(lazy(V) + E*lazy(z)
+            - (dt*dt/48.0)*(lazy(Vx)*Vx + lazy(Vy)*Vy + dV_dz*dV_dz));
+        END_TIMER("lazy");
+        nfail += check(world, "Vtilde          ", Vtilde_lazy, Vtilde_eager);
+
+        // SCF local potential vnuc + vcoul + vxc
+        if (world.rank() == 0) print("\nSCF potential assembly");
+        START_TIMER;
+        real_function_3d vlocal_eager = V + c;
+        vlocal_eager = vlocal_eager + b;
+        vlocal_eager.truncate();
+        END_TIMER("eager");
+        START_TIMER;
+        real_function_3d vlocal_lazy = evaluate(lazy(V) + c + b);
+        END_TIMER("lazy");
+        nfail += check(world, "vlocal          ", vlocal_lazy, vlocal_eager);
+    }
+    catch (const SafeMPI::Exception& e) {
+        print(e);
+        error("caught an MPI exception");
+    }
+    catch (const madness::MadnessException& e) {
+        print(e);
+        error("caught a MADNESS exception");
+    }
+    catch (const std::exception& e) {
+        print(e.what());
+        error("caught an STL exception");
+    }
+
+    world.gop.fence();
+    finalize();
+    return nfail ? 1 : 0;
+}
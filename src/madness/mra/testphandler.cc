@@ -0,0 +1,127 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+
+/// \file testphandler.cc
+/// \brief Tests the compiled ParserHandler expressions and times their projection
+
+/// The projection of a function given as a string is timed with the
+/// compiled, vectorized evaluation, with muParser point by point, and
+/// against the same function written as a C++ functor.
+
+#include <madness/mra/mra.h>
+#include <madness/misc/phandler.h>
+
+using namespace madness;
+
+static const double L = 10.0;
+static const long k = 8;
+static const double thresh = 1e-6;
+
+double ttt, sss;
+#define START_TIMER world.gop.fence(); ttt=wall_time(); sss=cpu_time()
+#define END_TIMER(msg) ttt=wall_time()-ttt; sss=cpu_time()-sss; if (world.rank()==0) printf("timer: %-24.24s %8.2fs %8.2fs\n", msg, sss, ttt)
+
+static const char* expr = "exp(-2*r^2)*cos(3*x) + 0.5*exp(-(x-1)^2 - y^2 - 2*z^2)/(1 + z^2)";
+
+static double fexpr(const coord_3d& c) {
+    const double x=c[0], y=c[1], z=c[2], r=sqrt(x*x + y*y + z*z);
+    return exp(-2*r*r)*cos(3*x) + 0.5*exp(-(x-1)*(x-1) - y*y - 2*z*z)/(1 + z*z);
+}
+
+typedef std::shared_ptr< FunctionFunctorInterface<double,3> > functorT;
+
+/// Compares the compiled expression with muParser at a few points
+int check_expr(World& world, const char* e, bool vectorized) {
+    ParserHandler<double,3> compiled(e), parsed(e, false);
+    double err = 0.0;
+    for (int i=0; i<7; ++i) {
+        const coord_3d r = vec(0.3 + 0.4*i, -1.1 + 0.3*i, 0.7 - 0.2*i);
+        err = std::max(err, std::abs(compiled(r) - parsed(r)));
+    }
+    const bool ok = err < 1e-12 && compiled.supports_vectorized() == vectorized && !parsed.supports_vectorized();
+    if (world.rank() == 0) print("   ", e, err, compiled.supports_vectorized(), ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+    startup(world,argc,argv);
+
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L, L);
+
+    int nfail = 0;
+    try {
+        if (world.rank() == 0) print("compiled expressions");
+        nfail += check_expr(world, expr, true);
+        nfail += check_expr(world, "-2^2 + 2^3^2 - x^-2*y + -z*4", true);
+        nfail += check_expr(world, "avg(x,y,z) - min(x,y)*max(y,z,1) + sum(x,1,2)", true);
+        nfail += check_expr(world, "log(x^2+1) + ln(2) + log2(r) + _pi*_e + 1.5e-1*abs(y)", true);
+        nfail += check_expr(world, "sign(y)*rint(3*x) + tanh(z) + atan(x) - sinh(0.1*y)", true);
+        nfail += check_expr(world, "if(x>0, x, 0) + y", false);    // falls back to muParser
+
+        if (world.rank() == 0) print("\nprojection of", expr);
+        START_TIMER;
+        real_function_3d fc = real_factory_3d(world).f(fexpr);
+        END_TIMER("C++ functor");
+        START_TIMER;
+        real_function_3d fv = real_factory_3d(world).functor(functorT(new ParserHandler<double,3>(expr)));
+        END_TIMER("compiled, vectorized");
+        START_TIMER;
+        real_function_3d fp = real_factory_3d(world).functor(functorT(new ParserHandler<double,3>(expr, false)));
+        END_TIMER("muParser");
+
+        const double err = (fv - fc).norm2();
+        if (world.rank() == 0) print("    difference to the C++ functor", err, (err < thresh) ? "ok" : "FAILED");
+        if (err >= thresh) ++nfail;
+    }
+    catch (const SafeMPI::Exception& e) {
+        print(e);
+        error("caught an MPI exception");
+    }
+    catch (const madness::MadnessException& e) {
+        print(e);
+        error("caught a MADNESS exception");
+    }
+    catch (const std::exception& e) {
+        print(e.what());
+        error("caught an STL exception");
+    }
+
+    world.gop.fence();
+    finalize();
+    return nfail ? 1 : 0;
+}
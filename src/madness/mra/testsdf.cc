@@ -0,0 +1,187 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+
+/// \file testsdf.cc
+/// \brief Tests the vectorized signed distance functions and times the
+///        projection of domain masks
+
+/// The shapes of sdf_shape_3D.h and their unions and intersections are
+/// checked point by point against the scalar sdf and their bounds over
+/// boxes.  The projection of the surface function and the domain mask is
+/// timed for the sphere of apps/interior_bc/embedded_dirichlet (radius 1 in
+/// [-2,2]^3, LLRV mask) point by point and with DomainMaskSDFFunctor.
+
+#include <madness/mra/mra.h>
+#include <madness/mra/sdf_shape_3D.h>
+#include <madness/constants.h>
+#include <madness/misc/ran.h>
+
+using namespace madness;
+
+typedef std::shared_ptr< SignedDFInterface<3> > sdfT;
+typedef std::shared_ptr< FunctionFunctorInterface<double,3> > functorT;
+
+static const long k = 6;
+static const double thresh = 1e-4;
+static const double eps = 0.1;
+static const double radius = 1.0;
+
+double ttt, sss;
+#define START_TIMER world.gop.fence(); ttt=wall_time(); sss=cpu_time()
+#define END_TIMER(msg) ttt=wall_time()-ttt; sss=cpu_time()-sss; if (world.rank()==0) printf("timer: %-24.24s %8.2fs %8.2fs\n", msg, sss, ttt)
+
+/// Evaluates a DomainMaskSDFFunctor point by point, as before it was vectorized
+struct pointwise : public FunctionFunctorInterface<double,3> {
+    std::shared_ptr< DomainMaskSDFFunctor<3> > f;
+    pointwise(const std::shared_ptr< DomainMaskSDFFunctor<3> >& f) : f(f) {}
+    double operator()(const coord_3d& x) const {return (*f)(x);}
+};
+
+/// Compares sdf_points with sdf and sdf_bounds with the sdf in random boxes
+int check_shape(World& world, const char* name, const SignedDFInterface<3>& s) {
+    const int npts = 50;
+    double err = 0.0;
+    int nout = 0, nbounded = 0;
+    for (int ibox=0; ibox<200; ++ibox) {
+        coord_3d lo, hi;
+        for (int i=0; i<3; ++i) {
+            const double w = 0.5*RandomValue<double>();
+            lo[i] = 4.0*RandomValue<double>() - 2.0;
+            hi[i] = lo[i] + w;
+        }
+        std::vector<double> xs[3], d(npts);
+        for (int i=0; i<3; ++i) {
+            xs[i].resize(npts);
+            for (int j=0; j<npts; ++j) xs[i][j] = lo[i] + (hi[i]-lo[i])*RandomValue<double>();
+        }
+        Vector<double*,3> x {xs[0].data(), xs[1].data(), xs[2].data()};
+        s.sdf_points(x, d.data(), npts);
+        double dmin, dmax;
+        const bool bounded = s.sdf_bounds(lo, hi, dmin, dmax);
+        if (bounded) ++nbounded;
+        for (int j=0; j<npts; ++j) {
+            const double dj = s.sdf(vec(xs[0][j], xs[1][j], xs[2][j]));
+            err = std::max(err, std::abs(d[j] - dj));
+            if (bounded && (dj < dmin - 1e-12 || dj > dmax + 1e-12)) ++nout;
+        }
+    }
+    const bool ok = err < 1e-12 && nout == 0 && nbounded > 0;
+    if (world.rank() == 0) print("   ", name, err, nout, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+    startup(world,argc,argv);
+
+    // as apps/interior_bc/embedded_dirichlet
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_cubic_cell(-2.0, 2.0);
+    FunctionDefaults<3>::set_truncate_on_project(true);
+    FunctionDefaults<3>::set_initial_level(std::max(6, int(ceil(log(4.0/eps)/log(2.0) - 4))));
+
+    int nfail = 0;
+    try {
+        const coord_3d origin(0.0), axis = vec(0.3, -0.2, 1.0);
+        sdfT sphere(new SDFSphere(radius, origin));
+        sdfT box(new SDFBox(vec(1.5, 1.0, 0.8), vec(0.2, 0.0, -0.1)));
+        sdfT cylinder(new SDFCylinder(0.6, 2.0, vec(0.0, 0.3, 0.0), axis));
+        sdfT cone(new SDFCone(0.7, vec(0.0, 0.0, -1.0), axis));
+        sdfT ellipsoid(new SDFEllipsoid(vec(1.2, 0.7, 0.5), vec(0.1, 0.0, 0.2)));
+        sdfT plane(new SDFPlane(axis, vec(0.1, 0.1, 0.1)));
+        std::vector<sdfT> shapes {sphere, box, cylinder, cone};
+
+        if (world.rank() == 0) print("shapes: error of sdf_points, points outside sdf_bounds");
+        nfail += check_shape(world, "plane       ", *plane);
+        nfail += check_shape(world, "sphere      ", *sphere);
+        nfail += check_shape(world, "cone        ", *cone);
+        nfail += check_shape(world, "paraboloid  ", SDFParaboloid(0.8, vec(0.0, 0.0, -1.0), axis));
+        nfail += check_shape(world, "box         ", *box);
+        nfail += check_shape(world, "ellipsoid   ", *ellipsoid);
+        nfail += check_shape(world, "cylinder    ", *cylinder);
+        nfail += check_shape(world, "union       ", SDFUnion<3>(shapes));
+        nfail += check_shape(world, "intersection", SDFIntersection<3>(shapes));
+
+        std::shared_ptr<DomainMaskInterface> llrv(new LLRVDomainMask(eps));
+        if (world.rank() == 0) print("\nsphere of embedded_dirichlet, eps", eps);
+        std::shared_ptr< DomainMaskSDFFunctor<3> > scalar(new DomainMaskSDFFunctor<3>(llrv, sphere));
+        START_TIMER;
+        scalar->setMaskFunction(DomainMaskSDFFunctor<3>::SURFACE);
+        real_function_3d surf_ref = real_factory_3d(world).functor(functorT(new pointwise(scalar)));
+        scalar->setMaskFunction(DomainMaskSDFFunctor<3>::MASK);
+        real_function_3d phi_ref = real_factory_3d(world).functor(functorT(new pointwise(scalar)));
+        END_TIMER("point by point");
+
+        std::shared_ptr< DomainMaskSDFFunctor<3> > vect(new DomainMaskSDFFunctor<3>(llrv, sphere));
+        vect->cache_sdf();
+        START_TIMER;
+        vect->setMaskFunction(DomainMaskSDFFunctor<3>::SURFACE);
+        real_function_3d surf = real_factory_3d(world).functor(functorT(vect));
+        vect->setMaskFunction(DomainMaskSDFFunctor<3>::MASK);
+        real_function_3d phi = real_factory_3d(world).functor(functorT(vect));
+        END_TIMER("vectorized, cached");
+        vect->clear_cache();
+
+        const double surf_err = (surf - surf_ref).norm2()/surf_ref.norm2();
+        const double phi_err = (phi - phi_ref).norm2()/phi_ref.norm2();
+        const double area_err = std::abs(surf.trace() - 4.0*constants::pi*radius*radius);
+        const double area_ref_err = std::abs(surf_ref.trace() - 4.0*constants::pi*radius*radius);
+        const double vol_err = std::abs(phi.trace() - 4.0*constants::pi*radius*radius*radius/3.0);
+        if (world.rank() == 0) {
+            print("    surface function difference", surf_err, (surf_err < 10.0*thresh) ? "ok" : "FAILED");
+            print("    domain mask difference     ", phi_err, (phi_err < 10.0*thresh) ? "ok" : "FAILED");
+            print("    error in surface integral  ", area_err, "(point by point", area_ref_err, ")");
+            print("    error in volume integral   ", vol_err);
+        }
+        if (surf_err >= 10.0*thresh) ++nfail;
+        if (phi_err >= 10.0*thresh) ++nfail;
+        if (std::abs(area_err - area_ref_err) > 1e-3) ++nfail;
+    }
+    catch (const SafeMPI::Exception& e) {
+        print(e);
+        error("caught an MPI exception");
+    }
+    catch (const madness::MadnessException& e) {
+        print(e);
+        error("caught a MADNESS exception");
+    }
+    catch (const std::exception& e) {
+        print(e.what());
+        error("caught an STL exception");
+    }
+
+    world.gop.fence();
+    finalize();
+    return nfail ? 1 : 0;
+}
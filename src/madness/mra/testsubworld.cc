@@ -0,0 +1,198 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file mra/testsubworld.cc
+/// \brief Test independent computations on subworlds and moving functions between worlds
+
+/// A finite-difference gradient and Hessian diagonal in the style of
+/// apps/chem/vibanal: a Gaussian charge B is displaced in the field of a
+/// fixed Gaussian charge A. The potential of A is computed once in the
+/// universe and copied into every subworld; the displaced energies are
+/// computed concurrently on (up to) 4 subworlds. Run with mpirun -np 4 to
+/// get 4 subworlds.
+
+#include <madness/mra/mra.h>
+#include <madness/mra/operator.h>
+#include <madness/mra/function_transfer.h>
+#include <madness/constants.h>
+
+using namespace madness;
+
+static const double expnt=2.0;
+
+/// a normalized Gaussian charge distribution
+class GaussianCharge : public FunctionFunctorInterface<double,3> {
+    const coord_3d center;
+public:
+    GaussianCharge(const coord_3d& center) : center(center) {}
+
+    double operator()(const coord_3d& r) const {
+        double rsq=0.0;
+        for (int i=0; i<3; ++i) rsq+=(r[i]-center[i])*(r[i]-center[i]);
+        return std::pow(expnt/constants::pi,1.5)*exp(-expnt*rsq);
+    }
+
+    std::vector<coord_3d> special_points() const {
+        return std::vector<coord_3d>(1,center);
+    }
+};
+
+/// the interaction energy of two normalized Gaussians of exponent expnt at distance R
+double exact_energy(const coord_3d& R) {
+    const double r=R.normf();
+    return erf(sqrt(0.5*expnt)*r)/r;
+}
+
+Function<double,3> make_charge(World& world, const coord_3d& center) {
+    return FunctionFactory<double,3>(world)
+            .functor(std::shared_ptr<FunctionFunctorInterface<double,3> >(new GaussianCharge(center)));
+}
+
+/// the geometry of displacement i: 0 is the reference, then +h and -h along x, y, z
+coord_3d displaced(const coord_3d& ref, const double h, const std::size_t i) {
+    coord_3d R=ref;
+    if (i>0) R[(i-1)/2]+=((i-1)%2==0) ? h : -h;
+    return R;
+}
+
+int test_subworld(World& universe) {
+    int success=0;
+
+    FunctionDefaults<3>::set_cubic_cell(-20,20);
+    FunctionDefaults<3>::set_k(8);
+    FunctionDefaults<3>::set_thresh(1.e-6);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(4);
+
+    // the fixed charge and its potential are computed once in the universe
+    const coord_3d origin(0.0);
+    Function<double,3> rhoA=make_charge(universe,origin);
+    real_convolution_3d op=CoulombOperator(universe,1.e-4,1.e-6);
+    Function<double,3> vA=op(rhoA);
+    vA.reconstruct();
+    const long vsize=vA.size();
+    const double vnorm=vA.norm2();
+
+    Subworlds subworlds(universe,4);
+    if (universe.rank()==0) print("running on",subworlds.size(),"subworlds");
+
+    // every subworld receives the potential with its tree
+    Function<double,3> vA_sub=copy_to_subworld(subworlds,vA);
+    const long vsize_sub=vA_sub.size();
+    const double vnorm_sub=vA_sub.norm2();
+    if (universe.rank()==0) print("potential size and norm in universe", vsize, vnorm);
+    if (subworlds.subworld().rank()==0) print("potential size and norm in subworld",
+            subworlds.color(), vsize_sub, vnorm_sub);
+    if ((vsize_sub!=vsize) or (std::abs(vnorm_sub-vnorm)>1.e-12*vnorm)) success++;
+
+    // the displacement loop
+    coord_3d ref;
+    ref[0]=0.0;
+    ref[1]=0.3;
+    ref[2]=1.5;
+    const double h=0.1;
+    const std::size_t ndisp=7;
+    std::vector<double> energy=map_subworlds<double>(subworlds,ndisp,
+            [&](World& subworld, const std::size_t i) {
+        Function<double,3> rhoB=make_charge(subworld,displaced(ref,h,i));
+        return inner(rhoB,vA_sub);
+    });
+
+    for (int i=0; i<3; ++i) {
+        const double g=(energy[2*i+1]-energy[2*i+2])/(2.0*h);
+        const double hess=(energy[2*i+1]+energy[2*i+2]-2.0*energy[0])/(h*h);
+        const double gex=(exact_energy(displaced(ref,h,2*i+1))-exact_energy(displaced(ref,h,2*i+2)))/(2.0*h);
+        const double hessex=(exact_energy(displaced(ref,h,2*i+1))+exact_energy(displaced(ref,h,2*i+2))
+                -2.0*exact_energy(ref))/(h*h);
+        if (universe.rank()==0) {
+            print("coordinate",i,"gradient",g,"error",g-gex,"hessian",hess,"error",hess-hessex);
+        }
+        if (std::abs(g-gex)>1.e-4) success++;
+        if (std::abs(hess-hessex)>2.e-3) success++;
+    }
+
+    // a function computed in the last subworld is copied back to the universe
+    Function<double,3> rhoB_sub;
+    {
+        SubworldPmaps pmaps(subworlds.subworld());
+        rhoB_sub=make_charge(subworlds.subworld(),ref);
+    }
+    Function<double,3> rhoB=copy_to_universe(subworlds,rhoB_sub,subworlds.size()-1);
+    Function<double,3> rhoB_ref=make_charge(universe,ref);
+    const double diff=(rhoB-rhoB_ref).norm2();
+    if (universe.rank()==0) print("function copied from subworld, error",diff);
+    if (diff>1.e-12) success++;
+
+    // WorldObjects of the subworlds must go before the subworlds
+    vA_sub.clear();
+    rhoB_sub.clear();
+    universe.gop.fence();
+    return success;
+}
+
+int main(int argc, char**argv) {
+    initialize(argc,argv);
+    World universe(SafeMPI::COMM_WORLD);
+
+    int success=0;
+    try {
+        startup(universe,argc,argv);
+        success=test_subworld(universe);
+    }
+    catch (const SafeMPI::Exception& e) {
+        print(e);
+        error("caught an MPI exception");
+    }
+    catch (const madness::MadnessException& e) {
+        print(e);
+        error("caught a MADNESS exception");
+    }
+    catch (const madness::TensorException& e) {
+        print(e);
+        error("caught a Tensor exception");
+    }
+    catch (const char* s) {
+        print(s);
+        error("caught a c-string exception");
+    }
+    catch (const std::exception& e) {
+        print(e.what());
+        error("caught an STL exception");
+    }
+    catch (...) {
+        error("caught unhandled exception");
+    }
+
+    if (universe.rank()==0) print("testsubworld",(success==0) ? "passed" : "failed");
+    universe.gop.fence();
+    finalize();
+    return success;
+}
@@ -321,6 +321,9 @@ struct test_multiop {
         for (unsigned int i=1; i<c.size(); ++i) r += copy(c[i]).emul(c[i]);
         return r;
     }
+    Tensor<T> operator()(const std::vector< Key<NDIM> >& keys, const std::vector< Tensor<T> >& c) const {
+        return (*this)(keys[0],c);
+    }
     template <typename Archive>
     void serialize(Archive& ar) {}
 };
@@ -537,6 +540,13 @@ int test_math(World& world) {
         for (unsigned int i=0; i<vin.size(); i++) r += vin[i]*vin[i];
         double moperr = (r - mop).norm2();
         if (world.rank() == 0) print("\nTest DONE multi", moperr);
+
+        if (world.rank() == 0) print("\nTest batched multioperation");
+        reconstruct(world, vin);
+        Function<T,NDIM> mopb = multiop_values_batched<T,test_multiop<T,NDIM>,NDIM> (test_multiop<T,NDIM>(), vin, 7);
+        double moperrb = (mop - mopb).norm2();
+        if (world.rank() == 0) print("\nTest DONE batched multi", moperrb);
+        CHECK(moperrb,1e-10,"batched multiop");
     }
 
     if (world.rank() == 0) print("\nTest adding random functions out of place");
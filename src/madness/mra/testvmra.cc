@@ -1,6 +1,7 @@
 #define NO_GENTENSOR
 #include <madness/mra/mra.h>
 #include <madness/mra/vmra.h>
+#include <madness/mra/kain_subspace.h>
 #include <madness/misc/ran.h>
 
 const double PI = 3.1415926535897932384;
@@ -121,6 +122,227 @@ void test_inner(World& world) {
         print("error norm",(rold-rnew).normf(),"\n");
 }
 
+/// solve g*u_i = f_i with the KAIN subspace and return the solution
+
+/// @param[in]  history_thresh  truncation threshold for the stored vectors
+/// @param[in]  max_in_memory   number of stored pairs kept in memory
+template <std::size_t NDIM>
+std::vector< Function<double,NDIM> > solve_kain(World& world,
+        const Function<double,NDIM>& g, const std::vector< Function<double,NDIM> >& f,
+        const double history_thresh, const unsigned int max_in_memory) {
+
+    KAINSubspace<double,NDIM> subspace(world,5);
+    subspace.set_history_thresh(history_thresh);
+    subspace.set_spill(max_in_memory);
+
+    std::vector< Function<double,NDIM> > u=zero_functions_compressed<double,NDIM>(world,f.size());
+    for (int iter=0; iter<20; ++iter) {
+        std::vector< Function<double,NDIM> > r=sub(world,mul(world,g,u),f);
+        const double rnorm=norm2(world,r);
+        if (world.rank() == 0) print("iteration",iter,"residual",rnorm);
+        if (rnorm<10.0*FunctionDefaults<NDIM>::get_thresh()) break;
+        u=subspace.update(u,r);
+        truncate(world,u);
+    }
+    return u;
+}
+
+template <std::size_t NDIM>
+void test_kain(World& world) {
+    typedef std::shared_ptr< FunctionFunctorInterface<double,NDIM> > functorT;
+
+    Tensor<double> cell(NDIM,2);
+    for (std::size_t i=0; i<NDIM; ++i) {
+        cell(i,0) = -10.0;
+        cell(i,1) =  10.0;
+    }
+    FunctionDefaults<NDIM>::set_cell(cell);
+    FunctionDefaults<NDIM>::set_k(8);
+    FunctionDefaults<NDIM>::set_thresh(1.e-6);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_truncate_mode(1);
+
+    if (world.rank() == 0) print("testing KAINSubspace in",NDIM,"dimensions");
+
+    // the operator 1 + 0.7 exp(-x^2) is diagonal, but not trivial for KAIN
+    functorT gfunctor(new Gaussian<double,NDIM>(Vector<double,NDIM>(0.0),1.0,0.7));
+    Function<double,NDIM> g=FunctionFactory<double,NDIM>(world).functor(gfunctor);
+    g.add_scalar(1.0);
+
+    std::vector< Function<double,NDIM> > f(4);
+    for (std::size_t i=0; i<f.size(); ++i) {
+        functorT ffunctor(RandomGaussian<double,NDIM>(FunctionDefaults<NDIM>::get_cell(),10.0));
+        f[i] = FunctionFactory<double,NDIM>(world).functor(ffunctor);
+    }
+
+    START_TIMER;
+    std::vector< Function<double,NDIM> > u0=solve_kain(world,g,f,0.0,5);
+    END_TIMER("full history");
+    START_TIMER;
+    std::vector< Function<double,NDIM> > u1=solve_kain(world,g,f,1.e-5,5);
+    END_TIMER("truncated history");
+    START_TIMER;
+    std::vector< Function<double,NDIM> > u2=solve_kain(world,g,f,0.0,1);
+    END_TIMER("spilled history");
+
+    const double err0=norm2(world,sub(world,mul(world,g,u0),f));
+    const double err1=norm2(world,sub(world,u0,u1));
+    const double err2=norm2(world,sub(world,u0,u2));
+    if (world.rank() == 0) {
+        print("residual                         ",err0);
+        print("error norm, truncated history    ",err1);
+        print("error norm, spilled history      ",err2,"\n");
+        if (err0>1.e-5 or err1>1.e-4 or err2>1.e-10) print("KAINSubspace test failed");
+    }
+}
+
+template <std::size_t NDIM>
+void test_sum_products(World& world) {
+    typedef std::shared_ptr< FunctionFunctorInterface<double,NDIM> > functorT;
+
+    const double thresh=1.e-6;
+    Tensor<double> cell(NDIM,2);
+    for (std::size_t i=0; i<NDIM; ++i) {
+        cell(i,0) = -10.0;
+        cell(i,1) =  10.0;
+    }
+    FunctionDefaults<NDIM>::set_cell(cell);
+    FunctionDefaults<NDIM>::set_k(8);
+    FunctionDefaults<NDIM>::set_thresh(thresh);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_autorefine(false);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_truncate_mode(1);
+
+    if (world.rank() == 0) print("testing sum_products in",NDIM,"dimensions");
+
+    const int n=12;
+    std::vector< Function<double,NDIM> > a(n), b(n);
+    for (int i=0; i<n; ++i) {
+        functorT fa(RandomGaussian<double,NDIM>(FunctionDefaults<NDIM>::get_cell(),10.0));
+        functorT fb(RandomGaussian<double,NDIM>(FunctionDefaults<NDIM>::get_cell(),10.0));
+        a[i] = FunctionFactory<double,NDIM>(world).functor(fa);
+        b[i] = FunctionFactory<double,NDIM>(world).functor(fb);
+    }
+    Tensor<double> occ(n), dmat(n,n);
+    occ.fillrandom();
+    dmat.fillrandom();
+
+    // reference: intermediate products, accumulated after compression
+    START_TIMER;
+    std::vector< Function<double,NDIM> > vsq=square(world,a);
+    compress(world,vsq);
+    Function<double,NDIM> rho0=FunctionFactory<double,NDIM>(world).compressed();
+    for (int i=0; i<n; ++i) rho0.gaxpy(1.0,vsq[i],occ(i),false);
+    world.gop.fence();
+    vsq.clear();
+    END_TIMER("square + gaxpy");
+
+    START_TIMER;
+    Function<double,NDIM> rho1=sum_squares(world,occ,a);
+    END_TIMER("sum_squares");
+
+    START_TIMER;
+    Function<double,NDIM> rho2=sum_products(world,dmat,a,b);
+    END_TIMER("sum_products");
+    START_TIMER;
+    std::vector< Function<double,NDIM> > ad=transform(world,a,dmat);
+    std::vector< Function<double,NDIM> > vab=mul(world,ad,b);
+    compress(world,vab);
+    Function<double,NDIM> rho3=FunctionFactory<double,NDIM>(world).compressed();
+    for (int j=0; j<n; ++j) rho3.gaxpy(1.0,vab[j],1.0,false);
+    world.gop.fence();
+    END_TIMER("transform + mul + gaxpy");
+
+    const double err1=(rho0-rho1).norm2()/rho0.norm2();
+    const double err2=(rho3-rho2).norm2()/rho3.norm2();
+
+    // the result inherits the autorefine flag of the first function
+    a[0].set_autorefine(true);
+    Function<double,NDIM> rho4=sum_squares(world,occ,a);
+    const double err4=(rho0-rho4).norm2()/rho0.norm2();
+
+    if (world.rank() == 0) {
+        print("relative error, sum_squares              ",err1);
+        print("relative error, sum_products             ",err2);
+        print("relative error, autorefined sum_squares  ",err4,"\n");
+        if (err1>1.e-12 or err2>10.0*thresh or err4>10.0*thresh) print("sum_products test failed");
+    }
+}
+
+template <std::size_t NDIM>
+void test_orthonormalize(World& world) {
+    typedef std::shared_ptr< FunctionFunctorInterface<double,NDIM> > functorT;
+
+    const double thresh=1.e-6;
+    Tensor<double> cell(NDIM,2);
+    for (std::size_t i=0; i<NDIM; ++i) {
+        cell(i,0) = -10.0;
+        cell(i,1) =  10.0;
+    }
+    FunctionDefaults<NDIM>::set_cell(cell);
+    FunctionDefaults<NDIM>::set_k(8);
+    FunctionDefaults<NDIM>::set_thresh(thresh);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_autorefine(false);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_truncate_mode(1);
+
+    if (world.rank() == 0) print("testing orthonormalize in",NDIM,"dimensions");
+
+    const int n=10, nfixed=4;
+    std::vector< Function<double,NDIM> > a(n);
+    for (int i=0; i<n; ++i) {
+        functorT fa(RandomGaussian<double,NDIM>(FunctionDefaults<NDIM>::get_cell(),10.0));
+        a[i] = FunctionFactory<double,NDIM>(world).functor(fa);
+    }
+    Tensor<double> c(n,n);
+    c.fillrandom();
+    c -= 0.5;
+
+    // key-major and function-major transformations agree
+    START_TIMER;
+    std::vector< Function<double,NDIM> > b0=transform(world,a,c,0.0,true);
+    END_TIMER("transform");
+    START_TIMER;
+    std::vector< Function<double,NDIM> > b1=transform_keys(world,a,c,0.0,true);
+    END_TIMER("transform_keys");
+    const double err0=norm2(world,sub(world,b0,b1))/norm2(world,b0);
+
+    const Tensor<double> S0=matrix_inner(world,a,a,true);
+    const char* method[2] = {"lowdin","cholesky"};
+    double err[4];
+    for (int m=0; m<2; ++m) {
+        std::vector< Function<double,NDIM> > v=copy(world,a);
+        START_TIMER;
+        orthonormalize(world,v,method[m]);
+        END_TIMER(method[m]);
+        Tensor<double> S=matrix_inner(world,v,v,true);
+        for (int i=0; i<n; ++i) S(i,i)-=1.0;
+        err[m]=S.absmax();
+
+        // the span of the first nfixed functions is kept
+        v=copy(world,a);
+        orthonormalize(world,v,method[m],nfixed);
+        S=matrix_inner(world,v,v,true);
+        for (int i=0; i<n; ++i) S(i,i)-=1.0;
+        std::vector< Function<double,NDIM> > fixed(a.begin(),a.begin()+nfixed);
+        const Tensor<double> P=matrix_inner(world,fixed,std::vector< Function<double,NDIM> >(v.begin()+nfixed,v.end()));
+        err[2+m]=std::max(S.absmax(),P.absmax());
+    }
+    if (world.rank() == 0) {
+        print("largest overlap before orthonormalization",S0.absmax());
+        print("relative error, transform_keys           ",err0);
+        print("error in orthonormality, lowdin          ",err[0]);
+        print("error in orthonormality, cholesky        ",err[1]);
+        print("error with fixed functions, lowdin       ",err[2]);
+        print("error with fixed functions, cholesky     ",err[3],"\n");
+        if (err0>1.e-12 or std::max(std::max(err[0],err[1]),std::max(err[2],err[3]))>10.0*thresh)
+            print("orthonormalize test failed");
+    }
+}
+
 int main(int argc, char**argv) {
     initialize(argc, argv);
 
@@ -130,6 +352,9 @@ int main(int argc, char**argv) {
 
         test_inner<double,double,1,false>(world);
         test_inner<double,double,1,true>(world);
+        test_kain<2>(world);
+        test_sum_products<3>(world);
+        test_orthonormalize<3>(world);
 #if !HAVE_GENTENSOR
         test_inner<double,std::complex<double>,1,false>(world);
         test_inner<std::complex<double>,double,1,false>(world);
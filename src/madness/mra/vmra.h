@@ -85,6 +85,16 @@
 	transform(world, vector, tensor, tolerance, fence )
 	\endcode
 
+	*) transform_keys: the same transformation, done key by key
+	\code
+	transform_keys(world, vector, tensor, tolerance, fence )
+	\endcode
+
+	*) orthonormalize: Loewdin or Cholesky orthonormalization in one pass
+	\code
+	orthonormalize(world, vector, bra, method, nfixed, tolerance )
+	\endcode
+
 	Setting thresh-hold for precision
 
 	*) set_thresh: setting a finite thresh-hold for a vector of functions
@@ -101,6 +111,8 @@
 	*) mul
 	   - mul_sparse
 	*) square
+	*) sum_products
+	   - sum_squares
 	*) gaxpy
 	*) apply
 
@@ -122,7 +134,9 @@
 #include <madness/mra/mra.h>
 #include <madness/mra/derivative.h>
 #include <madness/tensor/distributed_matrix.h>
+#include <madness/tensor/tensor_lapack.h>
 #include <cstdio>
+#include <string>
 
 namespace madness {
 
@@ -370,6 +384,152 @@ namespace madness {
     }
 
 
+    /// Transforms a vector of functions key by key according to new[i] = sum[j] old[j]*c[j,i]
+
+    /// The local keys of all input functions are traversed once and all
+    /// outputs of a key are formed by a single small matrix product, which
+    /// pays off for dense transformations of many functions.  Contributions
+    /// |c(j,i)|*||old[j]|| below truncate_tol(tol,key) are screened as in
+    /// transform(world,v,c,tol,fence); tol=0 gives the exact transformation.
+    /// The result has the process map of the inputs.
+    template <typename L, typename R, std::size_t NDIM>
+    std::vector< Function<TENSOR_RESULT_TYPE(L,R),NDIM> >
+    transform_keys(World& world, const std::vector< Function<L,NDIM> >& v,
+                   const Tensor<R>& c, double tol=0.0, bool fence=true) {
+        PROFILE_BLOCK(Vtransform_keys);
+        typedef TENSOR_RESULT_TYPE(L,R) resultT;
+        MADNESS_ASSERT(v.size() == (unsigned int)(c.dim(0)));
+
+        std::vector< Function<resultT,NDIM> > vresult
+            = zero_functions_compressed<resultT,NDIM>(world, c.dim(1));
+        if (v.empty()) return vresult;
+
+        compress(world, v, true);
+        std::vector<const FunctionImpl<L,NDIM>*> right(v.size());
+        for (unsigned int j=0; j<v.size(); j++) right[j] = v[j].get_impl().get();
+        std::vector< std::shared_ptr< FunctionImpl<resultT,NDIM> > > left(vresult.size());
+        for (unsigned int i=0; i<vresult.size(); i++) left[i] = vresult[i].get_impl();
+
+        FunctionImpl<resultT,NDIM>::vtransform_keys(right, c, left, tol);
+        if (fence) world.gop.fence();
+        return vresult;
+    }
+
+
+    /// Returns S^{-1/2} of a symmetric positive definite matrix
+    inline Tensor<double> inverse_sqrt_symmetric(const Tensor<double>& S) {
+        Tensor<double> U, e;
+        syev(S, U, e);
+        if (e.size()>0 and e(0L)<=0.0) {
+            MADNESS_EXCEPTION("inverse_sqrt_symmetric: matrix is not positive definite", 0);
+        }
+        for (long j=0; j<U.dim(1); ++j) U(_,j).scale(1.0/std::sqrt(std::sqrt(e(j))));
+        return inner(U, U, 1, 1);
+    }
+
+
+    /// Returns the transformation C that orthonormalizes functions with overlap S
+
+    /// The orthonormal functions are new[i] = sum[j] old[j]*C(j,i), i.e.
+    /// C^T S C = 1.
+    ///  - "lowdin": C = S^{-1/2}, the orthonormal set closest to the input
+    ///  - "cholesky": C = U^{-1} with S = U^T U, i.e. Gram-Schmidt in the
+    ///    order of the input
+    ///
+    /// The first nfixed functions span a subspace that is kept, e.g. the
+    /// occupied orbitals: they are orthonormalized among themselves, and the
+    /// remaining functions are projected onto the complement of that subspace
+    /// before they are orthonormalized among themselves with the same method.
+    /// @param[in]  S       overlap matrix, symmetric positive definite
+    /// @param[in]  method  "lowdin" or "cholesky"
+    /// @param[in]  nfixed  number of leading functions whose span is kept
+    inline Tensor<double> orthonormalization_matrix(const Tensor<double>& S,
+            const std::string& method="lowdin", long nfixed=0) {
+        const long n = S.dim(0);
+        MADNESS_ASSERT(S.ndim()==2 and S.dim(1)==n);
+        if (method=="cholesky") {
+            // Gram-Schmidt keeps the span of every leading subset, including the fixed ones
+            Tensor<double> U = copy(S);
+            cholesky(U);
+            return inverse(U);
+        }
+        if (method!="lowdin") {
+            MADNESS_EXCEPTION("orthonormalization_matrix: unknown method", 0);
+        }
+        if (nfixed<=0 or nfixed>=n) return inverse_sqrt_symmetric(S);
+
+        // block Loewdin: with o the fixed and v the remaining functions
+        //   C_oo = S_oo^{-1/2},  C_vo = 0,  C_vv = D,  C_ov = -S_oo^{-1} S_ov D,
+        //   D = (S_vv - S_vo S_oo^{-1} S_ov)^{-1/2}
+        const Slice o(0,nfixed-1), v(nfixed,n-1);
+        const Tensor<double> Soo = copy(S(o,o));
+        const Tensor<double> P = inner(inverse(Soo), copy(S(o,v)));      // S_oo^{-1} S_ov
+        const Tensor<double> D = inverse_sqrt_symmetric(copy(S(v,v)) - inner(copy(S(v,o)), P));
+        Tensor<double> C(n,n);
+        C(o,o) = inverse_sqrt_symmetric(Soo);
+        C(v,v) = D;
+        C(o,v) = inner(P, D).scale(-1.0);
+        return C;
+    }
+
+
+    /// Orthonormalizes a vector of functions in place with respect to a metric
+
+    /// The overlap S(i,j) = <bra[i]|v[j]> is computed once as a
+    /// DistributedMatrix, the exact orthonormalizing transformation is
+    /// derived from it (see orthonormalization_matrix) and applied in a
+    /// single key-major pass (see transform_keys).  In contrast to iterating
+    /// the approximate rotations of Q2 this needs one overlap and one
+    /// transformation regardless of the initial overlap.  For localized
+    /// orbitals small elements of the transformation may be screened with
+    /// tol; tol=0 applies the exact transformation.
+    /// @param[in]  world   the world
+    /// @param[inout] v     the functions to be orthonormalized
+    /// @param[in]  bra     the bra functions defining the metric, e.g. R^2 v
+    /// @param[in]  method  "lowdin" or "cholesky"
+    /// @param[in]  nfixed  number of leading functions whose span is kept
+    /// @param[in]  tol     screening threshold for the transformation
+    /// @return the transformation C, with new[i] = sum[j] old[j]*C(j,i)
+    template <std::size_t NDIM>
+    Tensor<double> orthonormalize(World& world,
+                                  std::vector< Function<double,NDIM> >& v,
+                                  const std::vector< Function<double,NDIM> >& bra,
+                                  const std::string& method="lowdin",
+                                  long nfixed=0, double tol=0.0) {
+        PROFILE_BLOCK(Vorthonormalize);
+        const long n = v.size();
+        MADNESS_ASSERT(long(bra.size())==n);
+        if (n==0) return Tensor<double>();
+
+        DistributedMatrixDistribution d = column_distributed_matrix_distribution(world, n, n);
+        DistributedMatrix<double> Sdist = matrix_inner(d, bra, v);
+        Tensor<double> S(n,n);
+        Sdist.copy_to_replicated(S);
+        S = 0.5*(S + transpose(S));
+
+        // the factorization is done once and broadcast, so that all ranks apply the same matrix
+        Tensor<double> C;
+        if (world.rank()==0) C = orthonormalization_matrix(S, method, nfixed);
+        world.gop.broadcast_serializable(C, 0);
+
+        v = transform_keys(world, v, C, tol, true);
+        truncate(world, v);
+        return C;
+    }
+
+
+    /// Orthonormalizes a vector of functions in place
+
+    /// see orthonormalize(world,v,bra,method,nfixed,tol)
+    template <std::size_t NDIM>
+    Tensor<double> orthonormalize(World& world,
+                                  std::vector< Function<double,NDIM> >& v,
+                                  const std::string& method="lowdin",
+                                  long nfixed=0, double tol=0.0) {
+        return orthonormalize(world, v, v, method, nfixed, tol);
+    }
+
+
     /// Scales inplace a vector of functions by distinct values
     template <typename T, typename Q, std::size_t NDIM>
     void scale(World& world,
@@ -693,6 +853,71 @@ namespace madness {
     }
 
 
+    /// Fused sum of products --- q = sum_i c[i] a[i] * b[i]  or  q = sum_ij c(i,j) a[i] * b[j]
+
+    /// The products are formed box by box from the function values and
+    /// accumulated directly into a single result tree, so no intermediate
+    /// function per product is stored and no compression is needed. For a
+    /// vector c each product is formed on the common tree of its two factors
+    /// only, as in mul(); for a matrix c on the common tree of all functions.
+    /// The
+    /// result inherits the settings of a[0]; if autorefine is set it is
+    /// refined beyond the finest level of the inputs where the products
+    /// need it (same test as for squaring).
+    ///
+    /// Pass a vector c for an (occupation) weighted sum, e.g. the electron
+    /// density sum_i occ_i |phi_i|^2, and a matrix c for a density matrix.
+    /// All functions are reconstructed and must share the same process map.
+    /// The result is reconstructed.
+    template <typename T, std::size_t NDIM>
+    Function<T,NDIM> sum_products(World& world, const Tensor<double>& c,
+                                  const std::vector< Function<T,NDIM> >& a,
+                                  const std::vector< Function<T,NDIM> >& b,
+                                  bool fence=true) {
+        PROFILE_BLOCK(Vsum_products);
+        MADNESS_ASSERT((c.ndim()==1) or (c.ndim()==2));
+        if (c.ndim()==1) {
+            MADNESS_ASSERT((a.size()==b.size()) and (c.dim(0)==long(a.size())));
+        } else {
+            MADNESS_ASSERT((c.dim(0)==long(a.size())) and (c.dim(1)==long(b.size())));
+        }
+        if (a.empty() or b.empty()) return FunctionFactory<T,NDIM>(world);
+
+        reconstruct(world, a, false);
+        if (&a != &b) reconstruct(world, b, false);
+        world.gop.fence();
+
+        typedef FunctionImpl<T,NDIM> implT;
+        std::vector<const implT*> va(a.size()), vb(b.size());
+        for (std::size_t i=0; i<a.size(); ++i) {
+            MADNESS_ASSERT(a[i].get_pmap()==a[0].get_pmap());
+            va[i]=a[i].get_impl().get();
+        }
+        for (std::size_t i=0; i<b.size(); ++i) {
+            MADNESS_ASSERT(b[i].get_pmap()==a[0].get_pmap());
+            vb[i]=b[i].get_impl().get();
+        }
+
+        Function<T,NDIM> result;
+        result.set_impl(a[0], false);
+        world.gop.fence();
+        result.get_impl()->mulsumXX(va, vb, c, fence);
+        return result;
+    }
+
+
+    /// Fused weighted sum of squares --- q = sum_i c[i] v[i]**2
+
+    /// e.g. the electron density sum_i occ_i |phi_i|^2 for real orbitals;
+    /// see sum_products() for details
+    template <typename T, std::size_t NDIM>
+    Function<T,NDIM> sum_squares(World& world, const Tensor<double>& c,
+                                 const std::vector< Function<T,NDIM> >& v,
+                                 bool fence=true) {
+        return sum_products(world, c, v, v, fence);
+    }
+
+
     /// Sets the threshold in a vector of functions
     template <typename T, std::size_t NDIM>
     void set_thresh(World& world, std::vector< Function<T,NDIM> >& v, double thresh, bool fence=true) {
@@ -0,0 +1,460 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_TENSOR_DISTRIBUTED_LINALG_H__INCLUDED
+#define MADNESS_TENSOR_DISTRIBUTED_LINALG_H__INCLUDED
+
+/// \file distributed_linalg.h
+/// \brief Parallel dense linear algebra on DistributedMatrix without Elemental
+
+/// The routines distribute the O(n^3) work over the processes of the world
+/// and over the threads of the task queue, while communicating O(n^2) data:
+///  - gemm: matrix product, each process computes its own rows of the result
+///  - cholesky: right-looking factorization by row panels
+///  - syev: Householder tridiagonalization and implicit QL, with the
+///    reflections and rotations applied to the local rows of each process
+///  - sygv: generalized problem A x = lambda B x by symmetric orthogonalization
+///
+/// Only real symmetric matrices are supported.  Matrices that are not
+/// column distributed are gathered where necessary, which is correct but
+/// communicates the whole matrix.
+
+#include <madness/world/MADworld.h>
+#include <madness/tensor/tensor.h>
+#include <madness/tensor/distributed_matrix.h>
+#include <madness/tensor/tensor_lapack.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace madness {
+
+    namespace detail {
+
+        /// Task: rows [lo,hi] of c are set to (or decremented by) a(rows,_)*b
+        template <typename T>
+        void distributed_gemm_rows(Tensor<T> c, const Tensor<T> a, const Tensor<T> b,
+                                   const long lo, const long hi, const bool subtract) {
+            const Slice rows(lo,hi);
+            if (subtract) c(rows,_) -= inner(a(rows,_),b);
+            else c(rows,_) = inner(a(rows,_),b);
+        }
+
+        /// Computes c(i,_) = a(i,_)*b (or c -= a*b) for all rows of c with one task per block of rows
+        template <typename T>
+        void distributed_gemm_local(World& world, Tensor<T> c, const Tensor<T>& a,
+                                    const Tensor<T>& b, const bool subtract=false) {
+            const long n = c.dim(0);
+            if (n==0 || c.dim(1)==0) return;
+            const long chunk = std::max(16L, (n-1)/(4*long(ThreadPool::size()+1))+1);
+            for (long lo=0; lo<n; lo+=chunk) {
+                const long hi = std::min(lo+chunk, n)-1;
+                world.taskq.add(&distributed_gemm_rows<T>, c, a, b, lo, hi, subtract);
+            }
+            world.taskq.fence();
+        }
+
+        /// Returns the rows of a that are local in the column distribution d (collective)
+
+        /// If a is column distributed like d its local data is returned
+        /// (shallow copy), otherwise a is gathered.
+        template <typename T>
+        Tensor<T> distributed_local_rows(const DistributedMatrix<T>& a, const DistributedMatrixDistribution& d) {
+            if (a.is_column_distributed() && a.coldim()==d.coldim() && a.coltile()==d.coltile()) {
+                if (a.local_coldim()==0) return Tensor<T>(0L,a.rowdim());
+                return a.data();
+            }
+            Tensor<T> full(a.coldim(),a.rowdim());
+            a.copy_to_replicated(full);
+            if (d.local_coldim()==0) return Tensor<T>(0L,a.rowdim());
+            return copy(full(Slice(d.local_ilow(),d.local_ihigh()),_));
+        }
+
+        /// Task applying op to the local rows [lo,hi]
+        template <typename opT>
+        void distributed_rows_task(opT op, const long lo, const long hi) {
+            op(lo,hi);
+        }
+
+        /// Applies op(lo,hi) to blocks of the nrow local rows, one task per block, and waits
+
+        /// Small problems are done directly to avoid the task overhead.
+        template <typename opT>
+        void distributed_rows(World& world, const long nrow, const opT& op) {
+            if (nrow <= 0) return;
+            const long chunk = std::max(16L, (nrow-1)/(4*long(ThreadPool::size()+1))+1);
+            if (chunk >= nrow) {
+                opT local(op);
+                local(0,nrow-1);
+                return;
+            }
+            for (long lo=0; lo<nrow; lo+=chunk) {
+                world.taskq.add(&distributed_rows_task<opT>, op, lo, std::min(lo+chunk, nrow)-1);
+            }
+            world.taskq.fence();
+        }
+
+        /// Householder step on the local rows: p(i) = tau * t(i,k+1:) . v(k+1:) for rows i>k
+        template <typename T>
+        struct HouseholderMatVec {
+            Tensor<T> t, v, p;
+            int64_t ilo, k;
+            T tau;
+            void operator()(long lo, long hi) {
+                const int64_t n = t.dim(1);
+                const T* vp = v.ptr();
+                for (long r=std::max(lo,long(k+1-ilo)); r<=hi; ++r) {
+                    const T* row = &t(r,0);
+                    T s = 0;
+                    for (int64_t j=k+1; j<n; ++j) s += row[j]*vp[j];
+                    p(ilo+r) = tau*s;
+                }
+            }
+        };
+
+        /// Householder step on the local rows: t(i,j) -= v(i) w(j) + w(i) v(j) for i,j>k
+        template <typename T>
+        struct HouseholderUpdate {
+            Tensor<T> t, v, w;
+            int64_t ilo, k;
+            void operator()(long lo, long hi) {
+                const int64_t n = t.dim(1);
+                const T* vp = v.ptr();
+                const T* wp = w.ptr();
+                for (long r=std::max(lo,long(k+1-ilo)); r<=hi; ++r) {
+                    T* row = &t(r,0);
+                    const T vi = vp[ilo+r], wi = wp[ilo+r];
+                    for (int64_t j=k+1; j<n; ++j) row[j] -= vi*wp[j] + wi*vp[j];
+                }
+            }
+        };
+
+        /// Forms the local rows of Q = H_0 H_1 ... H_{n-3} from the Householder vectors (rows of hv)
+        template <typename T>
+        struct HouseholderQ {
+            Tensor<T> q, hv, tau;
+            int64_t ilo;
+            void operator()(long lo, long hi) {
+                const int64_t n = q.dim(1);
+                for (long r=lo; r<=hi; ++r) {
+                    T* row = &q(r,0);
+                    for (int64_t j=0; j<n; ++j) row[j] = T(0);
+                    row[ilo+r] = T(1);
+                    for (int64_t k=0; k<n-2; ++k) {
+                        if (tau(k) == T(0)) continue;
+                        const T* vk = &hv(k,0);
+                        T s = 0;
+                        for (int64_t j=k+1; j<n; ++j) s += row[j]*vk[j];
+                        s *= tau(k);
+                        if (s != T(0)) for (int64_t j=k+1; j<n; ++j) row[j] -= s*vk[j];
+                    }
+                }
+            }
+        };
+
+        /// Applies a sequence of plane rotations of columns (i,i+1) to the local rows of z
+        template <typename T>
+        struct PlaneRotations {
+            Tensor<T> z;
+            std::vector<int64_t> index;
+            std::vector<T> c, s;
+            void operator()(long lo, long hi) {
+                for (long r=lo; r<=hi; ++r) {
+                    T* row = &z(r,0);
+                    for (size_t q=0; q<index.size(); ++q) {
+                        const int64_t i = index[q];
+                        const T f = row[i+1];
+                        row[i+1] = s[q]*row[i] + c[q]*f;
+                        row[i] = c[q]*row[i] - s[q]*f;
+                    }
+                }
+            }
+        };
+    }
+
+
+    /// Returns the product a*b, or transpose(a)*b, of two distributed matrices (collective)
+
+    /// The result is column distributed.  Each process computes its own rows
+    /// of the result from the rows of a it holds and the gathered b, and
+    /// splits that work into tasks.  For transa, a and b must have the same
+    /// number of rows; each process forms the contribution of its rows and
+    /// the contributions are summed.
+    /// @param[in] a The left matrix (n,k), or (k,n) for transa
+    /// @param[in] b The right matrix (k,m)
+    /// @param[in] transa If true the transpose of \c a is used
+    /// @return The product as a column distributed matrix (n,m)
+    template <typename T>
+    DistributedMatrix<T> gemm(const DistributedMatrix<T>& a, const DistributedMatrix<T>& b, const bool transa=false) {
+        World& world = a.get_world();
+        const int64_t n = transa ? a.rowdim() : a.coldim();
+        const int64_t k = transa ? a.coldim() : a.rowdim();
+        const int64_t m = b.rowdim();
+        MADNESS_ASSERT(b.coldim() == k);
+        DistributedMatrix<T> c = column_distributed_matrix<T>(world, n, m);
+
+        if (!transa) {
+            const Tensor<T> arows = detail::distributed_local_rows(a, c);
+            Tensor<T> bfull(k,m);
+            b.copy_to_replicated(bfull);
+            if (c.local_coldim() > 0) detail::distributed_gemm_local(world, c.data(), arows, bfull);
+        }
+        else {
+            // sum over the rows of a and b held by this process
+            const DistributedMatrixDistribution& d = a.is_column_distributed() ? a.distribution()
+                : column_distributed_matrix_distribution(world, k, n);
+            const Tensor<T> arows = detail::distributed_local_rows(a, d);
+            const Tensor<T> brows = detail::distributed_local_rows(b, d);
+            Tensor<T> full(n,m);
+            if (arows.dim(0) > 0) {
+                const Tensor<T> at = copy(transpose(arows));
+                detail::distributed_gemm_local(world, full, at, brows);
+            }
+            world.gop.sum(full.ptr(), full.size());
+            if (c.local_coldim() > 0) c.data()(___) = full(Slice(c.local_ilow(),c.local_ihigh()),_);
+        }
+        return c;
+    }
+
+
+    /// Cholesky factorization of a column distributed matrix in place (collective)
+
+    /// On return the upper triangle holds U with A = U^T U, and the strict
+    /// lower triangle is zero, as for cholesky(Tensor<T>&).  The process
+    /// that owns a row panel factors its diagonal block with LAPACK, solves
+    /// for the rest of its panel and broadcasts it; all processes then update
+    /// their trailing rows in parallel tasks.
+    /// @param[in,out] a The symmetric positive definite matrix, replaced by U
+    template <typename T>
+    void cholesky(DistributedMatrix<T>& a) {
+        MADNESS_ASSERT(a.coldim() == a.rowdim() && a.is_column_distributed());
+        World& world = a.get_world();
+        const int64_t n = a.coldim();
+        const int64_t ilo = a.local_ilow(), ihi = a.local_ihigh();
+        Tensor<T>& t = a.data();
+
+        for (ProcessID p=0; p<a.process_coldim(); ++p) {
+            int64_t k0, k1;
+            a.get_colrange(p, k0, k1);
+            if (k1 < k0) continue;
+            const int64_t nb = k1-k0+1;
+
+            // the panel [U_kk | U_kk^-T A(k,rest)] of rows k0..k1
+            Tensor<T> panel(nb, n-k0);
+            if (world.rank() == p) {
+                Tensor<T> d = copy(t(_,Slice(k0,k1)));
+                cholesky(d);
+                panel(_,Slice(0,nb-1)) = d;
+                if (k1 < n-1) {
+                    Tensor<T> x = copy(t(_,Slice(k1+1,n-1)));
+                    for (int64_t r=0; r<nb; ++r) {
+                        for (int64_t q=0; q<r; ++q) x(r,_).gaxpy(1.0, x(q,_), -d(q,r));
+                        x(r,_).scale(1.0/d(r,r));
+                    }
+                    panel(_,Slice(nb,n-k0-1)) = x;
+                }
+                t(_,Slice(k0,n-1)) = panel;
+                if (k0 > 0) t(_,Slice(0,k0-1)) = T(0);
+            }
+            world.gop.broadcast(panel.ptr(), panel.size(), p);
+
+            // trailing update of the local rows below the panel; columns left of the
+            // local diagonal block are zeroed later and need no update
+            if (ihi >= ilo && ilo > k1) {
+                const Tensor<T> xi = copy(transpose(panel(_,Slice(ilo-k0,ihi-k0))));
+                const Tensor<T> xj = copy(panel(_,Slice(ilo-k0,n-k0-1)));
+                detail::distributed_gemm_local(world, t(_,Slice(ilo,n-1)), xi, xj, true);
+            }
+        }
+    }
+
+
+    /// Eigenvalues and eigenvectors of a real symmetric distributed matrix (collective)
+
+    /// As for syev(const Tensor<T>&, ...) on return A V = V diag(e), with the
+    /// eigenvalues in ascending order and V column distributed.
+    ///
+    /// The matrix is reduced to tridiagonal form T = Q^T A Q by Householder
+    /// reflections.  For each column the owner broadcasts its row, and every
+    /// process applies the reflection to its own rows, which costs one
+    /// broadcast and one sum of a vector per column.  The tridiagonal problem
+    /// is solved by implicit QL iterations that every process repeats
+    /// identically (O(n^2) work), while the rotations are accumulated into
+    /// the local rows of Q in parallel tasks, so that the O(n^3) work is
+    /// distributed.  The accuracy is that of LAPACK's dsteqr.
+    /// @param[in] A The symmetric matrix (n,n)
+    /// @param[out] V The eigenvectors as columns
+    /// @param[out] e The eigenvalues in ascending order, replicated
+    template <typename T>
+    void syev(const DistributedMatrix<T>& A, DistributedMatrix<T>& V, Tensor<T>& e) {
+        static_assert(std::is_floating_point<T>::value, "distributed syev requires a real type");
+        World& world = A.get_world();
+        const int64_t n = A.coldim();
+        MADNESS_ASSERT(A.rowdim() == n);
+
+        V = column_distributed_matrix<T>(world, n, n);
+        const int64_t ilo = V.local_ilow();
+        const long nlocal = V.local_coldim();
+        Tensor<T> t = copy(detail::distributed_local_rows(A, V));
+
+        // Householder tridiagonalization: diagonal d, off-diagonal f, reflectors hv and tau
+        Tensor<T> d(n), f(n), tau(n), hv(n,n);
+        for (int64_t k=0; k<n; ++k) {
+            Tensor<T> x(n);
+            const ProcessID owner = V.owner(k,0);
+            if (owner == world.rank()) x(___) = t(k-ilo,_);
+            world.gop.broadcast(x.ptr(), n, owner);
+            d(k) = x(k);
+            if (k == n-1) break;
+
+            T sigma = 0;
+            for (int64_t j=k+2; j<n; ++j) sigma += x(j)*x(j);
+            if (sigma == T(0)) {
+                f(k) = x(k+1);
+                continue;
+            }
+            const T alpha = x(k+1);
+            const T beta = (alpha > 0) ? -std::sqrt(alpha*alpha + sigma) : std::sqrt(alpha*alpha + sigma);
+            f(k) = beta;
+            tau(k) = (beta - alpha)/beta;
+            Tensor<T> v(n);
+            v(k+1) = T(1);
+            for (int64_t j=k+2; j<n; ++j) v(j) = x(j)/(alpha - beta);
+            hv(k,_) = v;
+
+            // p = tau A22 v, w = p - (tau/2)(p.v) v, A22 -= v w^T + w v^T
+            Tensor<T> p(n);
+            detail::distributed_rows(world, nlocal, detail::HouseholderMatVec<T>{t, v, p, ilo, k, tau(k)});
+            world.gop.sum(p.ptr()+k+1, n-k-1);
+            T pv = 0;
+            for (int64_t j=k+1; j<n; ++j) pv += p(j)*v(j);
+            Tensor<T> w = copy(p);
+            w.gaxpy(1.0, v, -0.5*tau(k)*pv);
+            detail::distributed_rows(world, nlocal, detail::HouseholderUpdate<T>{t, v, w, ilo, k});
+        }
+        t.clear();
+
+        Tensor<T>& q = V.data();
+        detail::distributed_rows(world, nlocal, detail::HouseholderQ<T>{q, hv, tau, ilo});
+        hv.clear();
+
+        // implicit QL with Wilkinson shifts on (d,f), rotations applied to the rows of Q
+        const T eps = std::numeric_limits<T>::epsilon();
+        if (n > 0) f(n-1) = T(0);
+        for (int64_t l=0; l<n; ++l) {
+            int iter = 0;
+            int64_t m;
+            do {
+                for (m=l; m<n-1; ++m) {
+                    const T dd = std::abs(d(m)) + std::abs(d(m+1));
+                    if (std::abs(f(m)) <= eps*dd) break;
+                }
+                if (m == l) break;
+                if (iter++ == 60) MADNESS_EXCEPTION("syev: QL iteration did not converge", l);
+
+                detail::PlaneRotations<T> rot{q, std::vector<int64_t>(), std::vector<T>(), std::vector<T>()};
+                T g = (d(l+1) - d(l))/(2*f(l));
+                T r = std::hypot(g, T(1));
+                g = d(m) - d(l) + f(l)/(g + ((g >= 0) ? r : -r));
+                T s = 1, c = 1, p = 0;
+                int64_t i;
+                for (i=m-1; i>=l; --i) {
+                    const T ff = s*f(i), b = c*f(i);
+                    f(i+1) = (r = std::hypot(ff, g));
+                    if (r == T(0)) {
+                        d(i+1) -= p;
+                        f(m) = T(0);
+                        break;
+                    }
+                    s = ff/r;
+                    c = g/r;
+                    g = d(i+1) - p;
+                    r = (d(i) - g)*s + 2*c*b;
+                    d(i+1) = g + (p = s*r);
+                    g = c*r - b;
+                    rot.index.push_back(i);
+                    rot.c.push_back(c);
+                    rot.s.push_back(s);
+                }
+                detail::distributed_rows(world, nlocal, rot);
+                if (r == T(0) && i >= l) continue;
+                d(l) -= p;
+                f(l) = g;
+                f(m) = T(0);
+            } while (m != l);
+        }
+
+        // ascending order
+        std::vector<int64_t> perm(n);
+        for (int64_t i=0; i<n; ++i) perm[i] = i;
+        std::stable_sort(perm.begin(), perm.end(),
+                         [&d](const int64_t i, const int64_t j) {return d(i) < d(j);});
+        e = Tensor<T>(n);
+        for (int64_t k=0; k<n; ++k) e(k) = d(perm[k]);
+        if (nlocal > 0) {
+            const Tensor<T> qq = copy(q);
+            for (int64_t k=0; k<n; ++k) q(_,k) = qq(_,perm[k]);
+        }
+    }
+
+
+    /// Generalized eigenproblem A x = lambda B x of distributed matrices (collective)
+
+    /// B is orthogonalized symmetrically, X = V_B diag(e_B)^(-1/2), and the
+    /// standard problem X^T A X is solved with syev.  On return A V = B V
+    /// diag(e) and V^T B V = 1, with the eigenvalues in ascending order.
+    /// @param[in] A The symmetric matrix
+    /// @param[in] B The symmetric positive definite metric
+    /// @param[out] V The eigenvectors as columns, column distributed
+    /// @param[out] e The eigenvalues in ascending order, replicated
+    template <typename T>
+    void sygv(const DistributedMatrix<T>& A, const DistributedMatrix<T>& B,
+              DistributedMatrix<T>& V, Tensor<T>& e) {
+        DistributedMatrix<T> X;
+        Tensor<T> eb;
+        syev(B, X, eb);
+        if (eb.size() > 0 && eb(0L) <= 0) {
+            MADNESS_EXCEPTION("sygv: metric is not positive definite", 0);
+        }
+        for (int64_t i=X.local_ilow(); i<=X.local_ihigh(); ++i) {
+            for (int64_t k=0; k<X.rowdim(); ++k) X.data()(i-X.local_ilow(),k) /= std::sqrt(eb(k));
+        }
+        const DistributedMatrix<T> XAX = gemm(X, gemm(A, X), true);
+        DistributedMatrix<T> Y;
+        syev(XAX, Y, e);
+        V = gemm(X, Y);
+    }
+
+}
+
+#endif // MADNESS_TENSOR_DISTRIBUTED_LINALG_H__INCLUDED
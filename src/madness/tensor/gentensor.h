@@ -134,10 +134,13 @@ namespace madness {
 	struct TensorArgs {
 		double thresh;
 		TensorType tt;
-        TensorArgs() : thresh(-1.0), tt(TT_NONE) {}
-		TensorArgs(const double& thresh1, const TensorType& tt1)
+		RankReductionType rr;	///< algorithm for reduce_rank and add_SVD
+        TensorArgs() : thresh(-1.0), tt(TT_NONE), rr(RR_SVD) {}
+		TensorArgs(const double& thresh1, const TensorType& tt1,
+				const RankReductionType& rr1=RR_SVD)
 			: thresh(thresh1)
-			, tt(tt1) {
+			, tt(tt1)
+			, rr(rr1) {
 		}
 		static std::string what_am_i(const TensorType& tt) {
 			if (tt==TT_2D) return "TT_2D";
@@ -148,8 +151,10 @@ namespace madness {
 		template <typename Archive>
 		void serialize(const Archive& ar) {
 		    int i=int(tt);
-		    ar & thresh & i;
+		    int j=int(rr);
+		    ar & thresh & i & j;
 		    tt=TensorType(i);
+		    rr=RankReductionType(j);
 		}
 	};
 
@@ -200,12 +205,14 @@ namespace madness {
 		size_t real_size() const {return this->size();}
 
         void reduce_rank(const double& eps) {return;};
+        void reduce_rank(const TensorArgs& targs) {return;};
         void normalize() {return;}
 
         std::string what_am_i() const {return "GenTensor, aliased to Tensor";};
 		TensorType tensor_type() const {return TT_FULL;}
 
 		void add_SVD(const GenTensor<T>& rhs, const double& eps) {*this+=rhs;}
+		void add_SVD(const GenTensor<T>& rhs, const TensorArgs& targs) {*this+=rhs;}
 
 		SRConf<T> config() const {MADNESS_EXCEPTION("no SRConf in complex GenTensor",1);}
         SRConf<T> get_configs(const int& start, const int& end) const {MADNESS_EXCEPTION("no SRConf in complex GenTensor",1);}
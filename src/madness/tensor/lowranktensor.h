@@ -598,6 +598,15 @@ public:
         }
     }
 
+    /// add other to this, using the rank reduction algorithm given in targs
+    void add_SVD(const LowRankTensor& other, const TensorArgs& targs) {
+        if (type==TT_2D) impl.svd->add_SVD((*other.impl.svd),targs.thresh*facReduce(),targs.rr);
+        else if ((type==TT_TENSORTRAIN) and std::is_arithmetic<T>::value) {
+            impl.tt->gaxpy_and_truncate(1.0,*other.impl.tt,1.0,targs.thresh*facReduce());
+        }
+        else add_SVD(other,targs.thresh);
+    }
+
     /// Inplace multiply by corresponding elements of argument Tensor
     LowRankTensor<T>& emul(const LowRankTensor<T>& other) {
 
@@ -631,6 +640,12 @@ public:
         }
     }
 
+    /// reduce the rank, using the rank reduction algorithm given in targs
+    void reduce_rank(const TensorArgs& targs) {
+        if (type==TT_2D) impl.svd->reduce_rank(targs.thresh*facReduce(),targs.rr);
+        else reduce_rank(targs.thresh);
+    }
+
     /// Returns a pointer to the internal data
 
     /// @param[in]  ivec    index of core vector to which the return values points
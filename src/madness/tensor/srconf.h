@@ -39,6 +39,7 @@
 
 //#define BENCH 0
 
+#include <madness/constants.h>
 #include <madness/world/print.h>
 #include <madness/tensor/tensor.h>
 #include <madness/tensor/clapack.h>
@@ -436,6 +437,38 @@ namespace madness {
             MADNESS_ASSERT(has_structure());
 		}
 
+		/// reduce the rank using the requested algorithm
+		void reduce_rank(const double& thresh, const RankReductionType& rr) {
+			if (rr==RR_RANDOMIZED) randomized_reduce(thresh);
+			else divide_and_conquer_reduce(thresh);
+		}
+
+		/// reduce the rank using a randomized range finder (see ortho_random)
+
+		/// for small ranks the deterministic algorithm is cheaper and will be used
+		void randomized_reduce(const double& thresh) {
+
+			if (type()==TT_FULL) return;
+			if (has_no_data()) return;
+			if (rank()<=16) {
+				this->orthonormalize(thresh);
+				return;
+			}
+
+            normalize();
+			weights_=weights_(Slice(0,rank()-1));
+            tensorT v0=flat_vector(0);
+            tensorT v1=flat_vector(1);
+            ortho_random(v0,v1,weights_,thresh);
+            std::swap(vector_[0],v0);
+            std::swap(vector_[1],v1);
+			rank_=weights_.size();
+			MADNESS_ASSERT(rank_>=0);
+			this->make_structure();
+			make_slices();
+            MADNESS_ASSERT(has_structure());
+		}
+
 	public:
 		/// orthonormalize this
 		void orthonormalize(const double& thresh) {
@@ -553,6 +586,43 @@ namespace madness {
 #endif
 		}
 
+		/// add rhs to this by updating the orthonormal bases of this
+
+		/// this must be orthonormal (e.g. after add_SVD or reduce_rank), rhs
+		/// may be any configuration; cheaper and more accurate than add_SVD if
+		/// the rank of rhs is small compared to the rank of this
+		void add_QR(const SRConf<T>& rhs, const double& thresh) {
+
+			if (rhs.has_no_data()) return;
+			if (has_no_data()) {
+				*this=copy(rhs);
+				this->orthonormalize(thresh);
+				return;
+			}
+
+			if (check_orthonormality) check_right_orthonormality();
+
+			tensorT x=flat_vector(0);
+			tensorT y=flat_vector(1);
+			Tensor<double> w=weights_(Slice(0,rank()-1));
+			ortho_qr_update(x,y,w,rhs.flat_vector(0),rhs.flat_vector(1),
+					rhs.weights_(Slice(0,rhs.rank()-1)),thresh);
+			std::swap(vector_[0],x);
+			std::swap(vector_[1],y);
+			weights_=w;
+			rank_=weights_.size();
+			make_structure();
+			make_slices();
+            MADNESS_ASSERT(has_structure());
+		}
+
+		/// add rhs to this using the requested algorithm
+		void add_SVD(const SRConf<T>& rhs, const double& thresh,
+				const RankReductionType& rr) {
+			if (rr==RR_RANDOMIZED) add_QR(rhs,thresh);
+			else add_SVD(rhs,thresh);
+		}
+
 	protected:
 		/// alpha * this(lhs_s) + beta * rhs(rhs_s)
 
@@ -1664,6 +1734,246 @@ protected:
 		return;
 	}
 
+	/// return a (n,m) matrix with normally distributed random entries
+	template<typename T>
+	Tensor<T> random_gaussian_matrix(const long n, const long m) {
+		Tensor<T> g(n,m);
+		T* p=g.ptr();
+		const long size=g.size();
+		for (long i=0; i<size; i+=2) {
+			// Box-Muller transform; 1-u is in (0,1]
+			const double u1=1.0-RandomValue<double>();
+			const double u2=RandomValue<double>();
+			const double r=sqrt(-2.0*log(u1));
+			p[i]=T(r*cos(2.0*constants::pi*u2));
+			if (i+1<size) p[i+1]=T(r*sin(2.0*constants::pi*u2));
+		}
+		return g;
+	}
+
+	/// orthonormalize the rows of a against the orthonormal rows of q and among themselves
+
+	/// block Gram-Schmidt with reorthogonalization against q, modified
+	/// Gram-Schmidt (twice) within a; rows that are numerically linearly
+	/// dependent are discarded. On exit
+	/// \code
+	///   a = cq * q + ca * result
+	/// \endcode
+	/// @param[in]	a	(m,k) rows to be orthonormalized
+	/// @param[in]	q	(n,k) orthonormal rows, may be empty
+	/// @param[out]	cq	(m,n) coefficients of a in q
+	/// @param[out]	ca	(m,m') coefficients of a in the result
+	/// @return		(m',k) orthonormal rows, empty if m'==0
+	template<typename T>
+	Tensor<T> gram_schmidt_rows(const Tensor<T>& a, const Tensor<T>& q,
+			Tensor<T>& cq, Tensor<T>& ca) {
+
+		const long m=a.dim(0);
+		const long k=a.dim(1);
+		const long n=(q.size()>0) ? q.dim(0) : 0;
+		Tensor<T> aa=copy(a);
+
+		// remember the original norms for the linear dependency check
+		Tensor<double> norm0(m);
+		for (long i=0; i<m; ++i) norm0(i)=aa(i,_).normf();
+
+		// project out q, twice is enough
+		cq=Tensor<T>();
+		if (n>0) {
+			cq=Tensor<T>(m,n);
+			for (int pass=0; pass<2; ++pass) {
+				Tensor<T> c=inner(aa,q,1,1);
+				aa-=inner(c,q,1,0);
+				cq+=c;
+			}
+		}
+
+		Tensor<T> result(m,k);
+		Tensor<T> c(m,m);
+		long r=0;
+		for (long i=0; i<m; ++i) {
+			Tensor<T> ai=aa(i,_);
+			for (int pass=0; pass<2; ++pass) {
+				for (long j=0; j<r; ++j) {
+					const T cij=ai.trace(result(j,_));
+					ai.gaxpy(1.0,result(j,_),-cij);
+					c(i,j)+=cij;
+				}
+			}
+			const double norm=ai.normf();
+			if (norm>1.e-12*norm0(i)) {
+				result(r,_)=ai*(1.0/norm);
+				c(i,r)=norm;
+				++r;
+			}
+		}
+
+		if (r==0) {
+			ca=Tensor<T>(m,long(0));
+			return Tensor<T>();
+		}
+		ca=copy(c(_,Slice(0,r-1)));
+		return copy(result(Slice(0,r-1),_));
+	}
+
+	/// rank reduction by a randomized range finder
+
+	/// For an unoptimized representation A = x^T diag(w) y of rank r the range
+	/// of A is sampled with blocks of random vectors until the estimated
+	/// residual falls below a fraction of the threshold (adaptive range
+	/// finder, Halko, Martinsson, Tropp, SIAM Rev 53, 217 (2011)). Only the
+	/// small matrix Q A is decomposed by an SVD.
+	/// Operation count is O(k r l + k l^2), with l the final rank, compared to
+	/// O(k r^2 + r^3) for ortho3; output has the same form as ortho3.
+	/// @param[in,out]	x	normalized left subspace
+	/// @param[in,out]	y	normalized right subspace
+	/// @param[in,out]	weights	weights
+	/// @param[in]		thresh	truncation threshold
+	template<typename T>
+	void ortho_random(Tensor<T>& x, Tensor<T>& y, Tensor<double>& weights,
+			const double& thresh) {
+
+		typedef Tensor<T> tensorT;
+
+		const long rank=x.dim(0);
+		const long kx=x.dim(1);
+		const long ky=y.dim(1);
+		const long maxrank=std::min(rank,std::min(kx,ky));
+		const long blocksize=8;
+
+		// part of the error budget for the range finder, the rest for truncation
+		const double range_thresh=0.1*thresh;
+
+		// fold the weights into y
+		tensorT yw=copy(y);
+		for (long r=0; r<rank; ++r) yw(r,_)*=weights(r);
+
+		// the orthonormal basis for the range of A, one row per basis vector
+		tensorT Q;
+		long nq=0;
+		while (nq<maxrank) {
+
+			// the rows of S are A g for random vectors g
+			tensorT G=random_gaussian_matrix<T>(blocksize,ky);
+			tensorT S=inner(inner(G,yw,1,1),x,1,0);
+
+			// E |(1-QQ^T) A g|^2 = |(1-QQ^T) A|^2 for normal g
+			tensorT R=(nq>0) ? S-inner(inner(S,Q,1,1),Q,1,0) : copy(S);
+			const double err=R.normf()/sqrt(double(blocksize));
+			if (err<range_thresh) break;
+
+			// the probe becomes part of the basis
+			tensorT cq, ca;
+			tensorT Qnew=gram_schmidt_rows(S,Q,cq,ca);
+			if (Qnew.size()==0) break;
+			const long nnew=Qnew.dim(0);
+			if (nq==0) {
+				Q=Qnew;
+			} else {
+				tensorT Q2(nq+nnew,kx);
+				Q2(Slice(0,nq-1),_)=Q;
+				Q2(Slice(nq,nq+nnew-1),_)=Qnew;
+				Q=Q2;
+			}
+			nq=Q.dim(0);
+		}
+
+		// fast return if possible
+		if (nq==0) {
+			x.clear();
+			y.clear();
+			weights.clear();
+			return;
+		}
+
+		// B = Q A is small: (nq,ky)
+		tensorT B=inner(inner(Q,x,1,1),yw,1,0);
+		tensorT U,VT;
+		Tensor<double> s;
+		svd(B,U,s,VT);
+
+		long i=SRConf<T>::max_sigma(thresh-range_thresh,s.dim(0),s);
+		if (i>=0) {
+			tensorT Ui=copy(U(_,Slice(0,i)));
+			x=inner(Ui,Q,0,0);
+			y=copy(VT(Slice(0,i),_));
+			weights=copy(s(Slice(0,i)));
+		} else {
+			x.clear();
+			y.clear();
+			weights.clear();
+		}
+	}
+
+	/// add a configuration to an orthonormal configuration by updating its bases
+
+	/// The rows of x2 and y2 are decomposed into their components in the
+	/// orthonormal rows of x1 and y1 and a QR-like residual (Gram-Schmidt),
+	/// so that only the small core matrix of dimension (r1+r2) needs an SVD
+	/// (Brand, Lin. Alg. Appl. 415, 20 (2006)). Does not rely on eigenvalues of
+	/// the overlap matrices as ortho5 does, and therefore keeps all digits.
+	/// Result will be written onto the first config.
+	/// @param[in,out]	x1	orthonormal left subspace, will hold the result on exit
+	/// @param[in,out]	y1	orthonormal right subspace, will hold the result on exit
+	/// @param[in,out]	w1	weights, will hold the result on exit
+	/// @param[in]		x2	left subspace, will be accumulated onto x1
+	/// @param[in]		y2	right subspace, will be accumulated onto y1
+	/// @param[in]		w2	weights, will be accumulated onto w1
+	/// @param[in]		thresh	truncation threshold
+	template<typename T>
+	void ortho_qr_update(Tensor<T>& x1, Tensor<T>& y1, Tensor<double>& w1,
+				const Tensor<T>& x2, const Tensor<T>& y2, const Tensor<double>& w2,
+				const double& thresh) {
+
+		typedef Tensor<T> tensorT;
+
+		const long rank1=x1.dim(0);
+		const long rank2=x2.dim(0);
+
+		// x2 = cx1 x1 + cx2 qx, same for y
+		tensorT cx1, cx2, cy1, cy2;
+		tensorT qx=gram_schmidt_rows(x2,x1,cx1,cx2);
+		tensorT qy=gram_schmidt_rows(y2,y1,cy1,cy2);
+		const long nx=cx2.dim(1);
+		const long ny=cy2.dim(1);
+
+		// the extended bases
+		tensorT bx(rank1+nx,x1.dim(1));
+		tensorT by(rank1+ny,y1.dim(1));
+		bx(Slice(0,rank1-1),_)=x1;
+		by(Slice(0,rank1-1),_)=y1;
+		if (nx>0) bx(Slice(rank1,-1),_)=qx;
+		if (ny>0) by(Slice(rank1,-1),_)=qy;
+
+		// coefficients of rhs in the extended bases, weights folded into x
+		tensorT cx(rank2,rank1+nx), cy(rank2,rank1+ny);
+		cx(_,Slice(0,rank1-1))=cx1;
+		cy(_,Slice(0,rank1-1))=cy1;
+		if (nx>0) cx(_,Slice(rank1,-1))=cx2;
+		if (ny>0) cy(_,Slice(rank1,-1))=cy2;
+		for (long i=0; i<rank2; ++i) cx(i,_)*=w2(i);
+
+		// the core matrix
+		tensorT K=inner(cx,cy,0,0);
+		for (long i=0; i<rank1; ++i) K(i,i)+=w1(i);
+
+		tensorT U,VT;
+		Tensor<double> s;
+		svd(K,U,s,VT);
+
+		long i=SRConf<T>::max_sigma(thresh,s.dim(0),s);
+		if (i>=0) {
+			tensorT Ui=copy(U(_,Slice(0,i)));
+			x1=inner(Ui,bx,0,0);
+			y1=inner(VT(Slice(0,i),_),by,1,0);
+			w1=copy(s(Slice(0,i)));
+		} else {
+			x1.clear();
+			y1.clear();
+			w1.clear();
+		}
+	}
+
 	template<typename T>
 	static inline
 	std::ostream& operator<<(std::ostream& s, const SRConf<T>& sr) {
@@ -283,6 +283,19 @@ namespace madness {
         return s;
     }
 
+    /// algorithms for the rank reduction of low rank tensors (see srconf.h)
+    enum RankReductionType {RR_SVD, RR_RANDOMIZED};
+
+    static
+    inline
+    std::ostream& operator << (std::ostream& s, const RankReductionType& rr) {
+        std::string str="confused rank reduction type";
+        if (rr==RR_SVD) str="deterministic SVD";
+        if (rr==RR_RANDOMIZED) str="randomized range finder";
+        s << str.c_str();
+        return s;
+    }
+
     //#define TENSOR_USE_SHARED_ALIGNED_ARRAY
 #ifdef TENSOR_USE_SHARED_ALIGNED_ARRAY
 #define TENSOR_SHARED_PTR detail::SharedAlignedArray
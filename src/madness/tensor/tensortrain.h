@@ -107,6 +107,92 @@ namespace madness {
     }
 
 
+    /// scratch space for the LAPACK calls in the TensorTrain algorithms
+
+    /// decompose, truncate and gaxpy_and_truncate need buffers for the SVD
+    /// and LQ factorizations, whose size depends only on the maximum ranks
+    /// and mode dimensions. The buffers only grow, so reusing a workspace for
+    /// many tensors (e.g. all nodes of a Function) removes the allocations
+    /// from the inner loop. Pass one in explicitly or use the instance
+    /// returned by thread_local_workspace().
+    ///
+    /// All accessors return contiguous, uninitialized views of the buffers;
+    /// the views of different buffers never overlap.
+    template<typename T>
+    class TTWorkspace {
+
+        typedef typename TensorTypeData<T>::scalar_type scalar_type;
+
+        Tensor<T> work_;            ///< LAPACK work arrays
+        Tensor<T> u_;               ///< left singular vectors
+        Tensor<T> tau_;             ///< scalar factors of the LQ reflectors
+        Tensor<T> l_;               ///< L factors of the LQ decomposition
+        Tensor<T> stack_;           ///< stacked cores for gaxpy_and_truncate
+        Tensor<scalar_type> s_;     ///< singular values
+
+        /// return a contiguous view of the first n elements of buf, grow buf if necessary
+        template<typename R>
+        static Tensor<R> get(Tensor<R>& buf, long n) {
+            n=std::max(n,1l);
+            if (buf.size()<n) {
+                long size=std::max(n,2*buf.size());
+                buf=Tensor<R>(1,&size,false);
+            }
+            return buf(Slice(0,n-1));
+        }
+
+    public:
+
+        TTWorkspace() {}
+
+        Tensor<T> work(const long n) {return get(work_,n);}
+        Tensor<T> u(const long n) {return get(u_,n);}
+        Tensor<T> tau(const long n) {return get(tau_,n);}
+        Tensor<T> stack(const long n) {return get(stack_,n);}
+        Tensor<scalar_type> s(const long n) {return get(s_,n);}
+
+        /// return a zeroed, contiguous matrix for the L factor of lq_result
+        Tensor<T> L(const long n, const long m) {
+            Tensor<T> result=get(l_,n*m).reshape(n,m);
+            result=0.0;
+            return result;
+        }
+
+        /// the size of the LAPACK work array for the LQ decomposition of a matrix (n,m)
+
+        /// lq_result factorizes the transpose, dgeqrf/dorgqr use the blocked
+        /// algorithm only if lwork>=n*nb
+        static long lq_lwork(const long n) {
+            const long nb=64;
+            return (n+1)*nb;
+        }
+
+        /// the size of the LAPACK work array for the SVD of a matrix (n,m)
+        static long svd_lwork(const long n, const long m) {
+            const long mn=std::min(n,m), mx=std::max(n,m);
+            return std::max(3*mn+mx,5*mn)*32;
+        }
+
+        /// release all memory
+        void clear() {
+            work_.clear(); u_.clear(); tau_.clear(); l_.clear(); stack_.clear();
+            s_.clear();
+        }
+
+        /// return the memory held by this workspace in bytes
+        long real_size() const {
+            return (work_.size()+u_.size()+tau_.size()+l_.size()+stack_.size())*sizeof(T)
+                    + s_.size()*sizeof(scalar_type);
+        }
+
+        /// the workspace used by this thread if none is provided by the caller
+        static TTWorkspace& thread_local_workspace() {
+            static thread_local TTWorkspace ws;
+            return ws;
+        }
+    };
+
+
 
 	/**
 	 * A tensor train is a multi-modal representation of a tensor t
@@ -322,8 +408,10 @@ namespace madness {
 		/// @param[in]	t		tensor in full rank
 		/// @param[in]	eps		the precision threshold
 		/// @param[in]	dims	the tt structure
+		/// @param[in]	ws		scratch space for the SVDs
 		void decompose(const Tensor<T>& t, double eps,
-				const std::vector<long>& dims) {
+				const std::vector<long>& dims,
+				TTWorkspace<T>& ws=TTWorkspace<T>::thread_local_workspace()) {
 
 			core.resize(dims.size());
 			eps=eps/sqrt(dims.size()-1);	// error is relative
@@ -354,9 +442,9 @@ namespace madness {
 			const int rmax=std::min(rmax1,rmax2);
 
 			// these are max dimensions, so we can avoid frequent reallocation
-			Tensor<T> u(rmax1*rmax2);
+			Tensor<T> u=ws.u(rmax1*rmax2);
 			Tensor<T> dummy;
-			Tensor< typename Tensor<T>::scalar_type > s(rmax);
+			Tensor< typename Tensor<T>::scalar_type > s=ws.s(rmax);
 
 			// the dimension of the remainder tensor; will be cut down in each iteration
 			long vtdim=t.size();
@@ -365,7 +453,7 @@ namespace madness {
 			Tensor<T> c=madness::copy(t);
 
 			// work array for dgesvd
-			Tensor<T> work(lwork);
+			Tensor<T> work=ws.work(lwork);
 
 
 			// this keeps track of the ranks
@@ -451,6 +539,96 @@ namespace madness {
 		}
 
 
+		/// LQ-decompose the core tensor c(r0,...) in place
+
+		/// on exit c holds the right-orthogonal factor Q(rn,...), rn=min(r0,size/r0)
+		/// @param[inout]	c	the core tensor
+		/// @param[in]	ws	scratch space for the LAPACK calls
+		/// @return	the factor L(r0,rn) as a contiguous view of the workspace
+		Tensor<T> right_orthogonalize(Tensor<T>& c, TTWorkspace<T>& ws) const {
+
+		    // save tensor structure
+		    long dimensions[TENSOR_MAXDIM];
+		    const long ndim=c.ndim();
+		    for (int i=0; i<ndim; ++i) dimensions[i]=c.dim(i);
+
+		    // G(r0, k*r1)
+		    const long r0=c.dim(0);
+		    const long r1=c.size()/r0;
+		    const long rn=std::min(r0,r1);
+		    c=c.reshape(r0,r1);
+
+		    // lq_result fills only the lower triangle of L, which comes zeroed;
+		    // the work array is large enough for the blocked dgeqrf/dorgqr
+		    Tensor<T> L=ws.L(r0,rn);
+		    Tensor<T> tau=ws.tau(rn);
+		    Tensor<T> work=ws.work(TTWorkspace<T>::lq_lwork(r0));
+		    lq_result(c,L,tau,work,false);
+
+		    dimensions[0]=rn;
+		    c=c.reshape(ndim,dimensions);
+		    return L;
+		}
+
+		/// left-to-right SVD sweep of the truncation, see Alg. 2 of the TT paper
+
+		/// all cores but the first one must be right-orthogonal
+		/// @param[in]	eps	the truncation threshold for each bond
+		/// @param[in]	ws	scratch space for the LAPACK calls
+		void truncate_left_to_right(const double eps, TTWorkspace<T>& ws) {
+
+		    std::vector<long> tt_dims=this->dims();
+		    long dimensions[TENSOR_MAXDIM];
+		    Tensor<T> dummy;
+
+		    for (std::size_t d=0; d<core.size()-1; ++d) {
+
+		        // save tensor structure
+		        const long ndim=core[d].ndim();
+		        for (int i=0; i<ndim; ++i) dimensions[i]=core[d].dim(i);
+
+		        // reshape the core tensor (r0*k, r1)
+		        const long r1=core[d].dim(ndim-1);
+		        core[d]=core[d].reshape(core[d].size()/r1,r1);
+
+		        // get the dimensions of U and V
+		        const long du=core[d].dim(0);
+		        const long dv=core[d].dim(1);
+		        const long ds=std::min(du,dv);
+		        Tensor< typename Tensor<T>::scalar_type > s=ws.s(ds);
+		        Tensor<T> U_buffer=ws.u(du*ds);
+		        Tensor<T> work=ws.work(TTWorkspace<T>::svd_lwork(du,dv));
+
+		        // decompose (line 10); VT is written on core[d]
+		        svd_result(core[d],U_buffer,s,dummy,work);
+
+		        // truncate the SVD
+		        int r_truncate=SRConf<T>::max_sigma(eps,ds,s)+1;
+		        if (r_truncate==0) {
+		            zero_me(tt_dims);
+		            return;
+		        }
+
+		        // make tensors contiguous
+		        Tensor<T> U=madness::copy(U_buffer.reshape(du,ds)(_,Slice(0,r_truncate-1)));
+		        Tensor<T> VT=madness::copy(core[d](Slice(0,r_truncate-1),Slice(0,dv-1)));
+
+		        dimensions[ndim-1]=r_truncate;
+		        core[d]=U.reshape(ndim,dimensions);
+
+		        for (int i=0; i<VT.dim(0); ++i) {
+		            for (int j=0; j<VT.dim(1); ++j) {
+		                VT(i,j)*=s(i);
+		            }
+		        }
+
+		        // multiply to the right (line 11)
+		        core[d+1]=inner(VT,core[d+1]);
+		    }
+
+		    if (not verify()) MADNESS_EXCEPTION("ranks in TensorTrain inconsistent",1);
+		}
+
 		/// turn this into an empty tensor with all cores properly shaped
 		void zero_me() {
 		    *this=TensorTrain<T>(this->dims());
@@ -864,9 +1042,11 @@ namespace madness {
 
         /// this in recompressed TT form with optimal rank
         /// @param[in]  eps the truncation threshold
+        /// @param[in]  ws  scratch space for the LAPACK calls
 		template<typename R=T>
         typename std::enable_if<!std::is_arithmetic<R>::value, void>::type
-        truncate(double eps) {
+        truncate(double eps,
+                TTWorkspace<T>& ws=TTWorkspace<T>::thread_local_workspace()) {
             MADNESS_EXCEPTION("no complex truncate in TensorTrain",1);
         }
 
@@ -875,9 +1055,11 @@ namespace madness {
 
 		/// this in recompressed TT form with optimal rank
 		/// @param[in]	eps	the truncation threshold
+		/// @param[in]	ws	scratch space for the LAPACK calls
 		template<typename R=T>
 		typename std::enable_if<std::is_arithmetic<R>::value, void>::type
-		truncate(double eps) {
+		truncate(double eps,
+		        TTWorkspace<T>& ws=TTWorkspace<T>::thread_local_workspace()) {
 
 		    // fast return
 		    if (zero_rank) return;
@@ -889,160 +1071,137 @@ namespace madness {
 		        return;
 		    }
 
-		    std::vector<long> tt_dims=this->dims();
-
 		    eps=eps/sqrt(this->ndim());
 		    if (not verify()) MADNESS_EXCEPTION("ranks in TensorTrain inconsistent",1);
 
 		    // right-to-left orthogonalization (line 4)
-		    // get maximum rank and maximum k-value
-		    // cores are (k0,r0), (r0,k1,r1), (r1,k2,r2), ... (rd-1,kd)
-		    long rmax = core[0].dim(1);
-		    long kmax = core[0].dim(0);
-		    for(size_t i=1;i<core.size();i++){
-		        rmax = std::max(rmax,core[i].dim(0));
-		        kmax = std::max(kmax,core[i].dim(1));
-		    }
-
-		    Tensor<T> L;//L_buffer(rmax,rmax*kmax);
-		    Tensor<T> lq_tau(rmax);
-		    long max_rk = std::max(rmax,kmax);
-		    long lq_work_dim = 2*max_rk+(max_rk+1)*64;
-		    Tensor<T> lq_work(lq_work_dim);
-		    Tensor<T> L_buffer(max_rk,max_rk);
-		    long dimensions[TENSOR_MAXDIM];
-		    // last tensor differs in dimension (first tensor also, but we dont reach it in the loop)
-		    if(core.size()>1){
-		        const long n_dim = core.back().ndim();
-		        for (int i=0; i<n_dim; ++i) dimensions[i]=core.back().dim(i);
-
-		        const long r0 = core.back().dim(0);
-		        const long r1 = core.back().size()/r0;
-		        core.back()=core.back().reshape(r0,r1);
-
-		        // assignement of L with the L_buffer tensor
-		        // works only if the bool for lq_result is set to false
-		        {
-		            long r_rows= (core.back().dim(1)>=core.back().dim(0)) ? core.back().dim(0) : core.back().dim(1);
-		            long r_cols=core.back().dim(0);
-		            L = L_buffer(Slice(0,r_cols-1),Slice(0,r_rows-1));
-		            L = 0.0;
-		        }
-		        lq_result(core.back(),L,lq_tau,lq_work,false);
-		        //Tensor<T> L = L_buffer(Slice(0,r0-1),Slice(0,r1-1));
-
-		        dimensions[0]=std::min(dimensions[0],core.back().dim(0));
-		        core.back()=core.back().reshape(n_dim,dimensions);
-		        // multiply to the left (line 6)
-		        core[core.size()-2]=inner(core[core.size()-2],L);
-
-		    }
-
-
-		    for (std::size_t d=core.size()-2; d>0; --d) {
-
-		        // save tensor structure
-		        const long ndim=core[d].ndim();
-		        for (int i=0; i<ndim; ++i) dimensions[i]=core[d].dim(i);
-
-		        // G(r0, k*r1)
-		        const long r0=core[d].dim(0);
-		        const long r1=core[d].size()/r0;
-		        core[d]=core[d].reshape(r0,r1);
-
-		        // decompose the core tensor (line 5)
-		        //lq(core[d],L_buffer);  // might shrink the core
-
-		        // assignement of L with the inner_buffer tensor
-		        // works only if the bool for lq_result is set to false
-		        {
-		            long r_rows= (core[d].dim(1)>=core[d].dim(0)) ? core[d].dim(0) : core[d].dim(1);
-		            long r_cols=core[d].dim(0);
-		            L = L_buffer(Slice(0,r_cols-1),Slice(0,r_rows-1));
-		            L = 0.0;
-		        }
-
-		        // workaround for LQ decomposition to avoid reallocations
-		        //L_buffer = 0.0;
-		        lq_tau = 0.0;
-		        lq_work = 0.0;
-		        lq_result(core[d],L,lq_tau,lq_work,false);
-		        // slice L to the right size
-		        //Tensor<T> L = L_buffer(Slice(0,r0-1),Slice(0,r1-1));
-
-		        dimensions[0]=std::min(r0,core[d].dim(0));
-		        core[d]=core[d].reshape(ndim,dimensions);
+		    for (std::size_t d=core.size()-1; d>0; --d) {
+		        Tensor<T> L=right_orthogonalize(core[d],ws);
 
 		        // multiply to the left (line 6)
 		        core[d-1]=inner(core[d-1],L);
 		    }
 
-		    // svd buffer tensor (see svd_results in lapack.cc)
-		    long m =rmax*kmax;
-		    long n =rmax;
-		    long k =std::min<long>(m,n);
-		    long svd_buffer_size = std::max<long>(3*std::min<long>(m,n)+std::max<long>(m,n),5*std::min<long>(m,n)-4)*32;
-		    Tensor<T> svd_buffer(svd_buffer_size);
-		    Tensor<T> U_buffer(m,k);
-		    Tensor<T> dummy;
-		    Tensor< typename Tensor<T>::scalar_type > s_buffer(k);
-
 		    // left-to-right SVD (line 9)
-		    for (std::size_t d=0; d<core.size()-1; ++d) {
-
-		        // save tensor structure
-		        const long ndim=core[d].ndim();
-		        for (int i=0; i<ndim; ++i) dimensions[i]=core[d].dim(i);
+		    truncate_left_to_right(eps,ws);
+		}
 
-		        // reshape the core tensor (r0*k, r1)
-		        long r1=core[d].dim(core[d].ndim()-1);
-		        //				long r1=core[d].dim(1);
-		        core[d]=core[d].reshape(core[d].size()/r1,r1);
 
-		        Tensor<T> U,VT;
-		        long ds=std::min(core[d].dim(0),core[d].dim(1));
-		        s_buffer = 0.0;
-		        //Tensor< typename Tensor<T>::scalar_type > s(ds)
-		        Tensor< typename Tensor<T>::scalar_type > s = s_buffer(Slice(0,ds-1));
+        /// inplace generalized saxpy with truncation: this = this*alpha + rhs*beta
+
+        /// Equivalent to gaxpy(alpha,rhs,beta) followed by truncate(eps), but
+        /// the cores of the sum, which are block-diagonal in the ranks, are
+        /// never formed: the right-to-left orthogonalization contracts the L
+        /// factor with the cores of this and rhs separately and stacks the
+        /// results.
+        /// @param[in]  alpha   factor for this
+        /// @param[in]  rhs     the TensorTrain to be added
+        /// @param[in]  beta    factor for rhs
+        /// @param[in]  eps     the truncation threshold
+        /// @param[in]  ws      scratch space for the LAPACK calls
+        template<typename R=T>
+        typename std::enable_if<!std::is_arithmetic<R>::value, TensorTrain<T>&>::type
+        gaxpy_and_truncate(T alpha, const TensorTrain<T>& rhs, T beta, double eps,
+                TTWorkspace<T>& ws=TTWorkspace<T>::thread_local_workspace()) {
+            MADNESS_EXCEPTION("no complex truncate in TensorTrain",1);
+            return *this;
+        }
 
-		        // decompose (line 10)
-		        //svd(core[d],U,s,VT);
-		        // get the dimensions of U and V
-		        long du = core[d].dim(0);
-		        long dv = core[d].dim(1);
-		        U_buffer = 0.0;
-		        svd_buffer = 0.0;
-		        U_buffer = U_buffer.flat();
-		        // VT is written on core[d] input
-		        svd_result(core[d],U_buffer,s,dummy,svd_buffer);
+        /// inplace generalized saxpy with truncation: this = this*alpha + rhs*beta
+
+        /// Equivalent to gaxpy(alpha,rhs,beta) followed by truncate(eps), but
+        /// the cores of the sum, which are block-diagonal in the ranks, are
+        /// never formed: the right-to-left orthogonalization contracts the L
+        /// factor with the cores of this and rhs separately and stacks the
+        /// results.
+        /// @param[in]  alpha   factor for this
+        /// @param[in]  rhs     the TensorTrain to be added
+        /// @param[in]  beta    factor for rhs
+        /// @param[in]  eps     the truncation threshold
+        /// @param[in]  ws      scratch space for the LAPACK calls
+        template<typename R=T>
+        typename std::enable_if<std::is_arithmetic<R>::value, TensorTrain<T>&>::type
+        gaxpy_and_truncate(T alpha, const TensorTrain<T>& rhs, T beta, double eps,
+                TTWorkspace<T>& ws=TTWorkspace<T>::thread_local_workspace()) {
 
-		        // truncate the SVD
-		        int r_truncate=SRConf<T>::max_sigma(eps,ds,s)+1;
-		        if (r_truncate==0) {
-		            zero_me(tt_dims);
-		            return;
-		        }
+            // make sure dimensions conform
+            MADNESS_ASSERT(this->ndim()==rhs.ndim());
 
-		        // make tensors contiguous
-		        U=madness::copy(U_buffer(Slice(0,(du*ds)-1)).reshape(du,ds)(_,Slice(0,r_truncate-1)));
-		        VT=madness::copy(core[d](Slice(0,r_truncate-1),Slice(0,dv-1)));
+            // the simple cases and the operator representation are handled
+            // by the unfused algorithm
+            bool fuse=not (zero_rank or rhs.zero_rank or (alpha==0.0) or (beta==0.0)
+                    or (ndim()==1) or is_operator() or rhs.is_operator());
+            for (long i=0; fuse and (i<ndim()-1); ++i) {
+                if ((ranks(i)==0) or (rhs.ranks(i)==0)) fuse=false;
+            }
+            if (not fuse) {
+                gaxpy(alpha,rhs,beta);
+                truncate(eps,ws);
+                return *this;
+            }
 
-		        dimensions[ndim-1]=r_truncate;
-		        core[d]=U.reshape(ndim,dimensions);
+            if (not (verify() and rhs.verify())) MADNESS_EXCEPTION("ranks in TensorTrain inconsistent",1);
+            MADNESS_ASSERT(this->dims()==rhs.dims());
+
+            const long nd=ndim();
+            eps=eps/sqrt(nd);
+
+            // right-to-left orthogonalization of the sum; the core d of the
+            // sum contracted with L is the stack of core[d]*L_this and
+            // rhs.core[d]*L_rhs. Note that rhs may be an alias of this.
+            Tensor<T> L, L_this, L_rhs;
+            for (long d=nd-1; d>0; --d) {
+                const long r0_this=core[d].dim(0);
+                const long r0_rhs=rhs.core[d].dim(0);
+                const long r0=r0_this+r0_rhs;
+                const long k=core[d].dim(1);
+                const long rq=(d==nd-1) ? 1 : L.dim(1);
+                const long cols=k*rq;
+
+                Tensor<T> buf=ws.stack(r0*cols);
+                Tensor<T> top=buf(Slice(0,r0_this*cols-1));
+                Tensor<T> bottom=buf(Slice(r0_this*cols,r0*cols-1));
+                if (d==nd-1) {
+                    top(_)=core[d].flat();
+                    bottom(_)=rhs.core[d].flat();
+                } else {
+                    buf=0.0;
+                    top=top.reshape(r0_this,k,rq);
+                    bottom=bottom.reshape(r0_rhs,k,rq);
+                    inner_result(core[d],L_this,-1,0,top);
+                    inner_result(rhs.core[d],L_rhs,-1,0,bottom);
+                }
 
-		        for (int i=0; i<VT.dim(0); ++i) {
-		            for (int j=0; j<VT.dim(1); ++j) {
-		                VT(i,j)*=s(i);
-		            }
-		        }
+                Tensor<T> stacked=buf.reshape(r0,cols);
+                L=right_orthogonalize(stacked,ws);
+                if (d==nd-1) {
+                    core[d]=madness::copy(stacked);
+                } else {
+                    core[d]=madness::copy(stacked).reshape(stacked.dim(0),k,rq);
+                }
 
-		        // multiply to the right (line 11)
-		        core[d+1]=inner(VT,core[d+1]);
+                // split L into the parts belonging to this and rhs
+                const long rn=L.dim(1);
+                Tensor<T> Lflat=L.flat();
+                L_this=Lflat(Slice(0,r0_this*rn-1)).reshape(r0_this,rn);
+                L_rhs=Lflat(Slice(r0_this*rn,r0*rn-1)).reshape(r0_rhs,rn);
+            }
 
-		    }
+            // the first core is the sum (not the stack) of the contracted
+            // cores; alpha and beta are only included here
+            {
+                L_this.scale(alpha);
+                L_rhs.scale(beta);
+                Tensor<T> core_new(core[0].dim(0),L.dim(1));
+                inner_result(core[0],L_this,-1,0,core_new);
+                inner_result(rhs.core[0],L_rhs,-1,0,core_new);
+                core[0]=core_new;
+            }
 
-		    if (not verify()) MADNESS_EXCEPTION("ranks in TensorTrain inconsistent",1);
-		}
+            // left-to-right SVD
+            truncate_left_to_right(eps,ws);
+            return *this;
+        }
 
 		/// return the number of dimensions
 		long ndim() const {return core.size();}
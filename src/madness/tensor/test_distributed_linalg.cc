@@ -0,0 +1,151 @@
+#define WORLD_INSTANTIATE_STATIC_TEMPLATES
+
+#include <madness/madness_config.h>
+#include <madness/world/MADworld.h>
+#include <madness/tensor/distributed_linalg.h>
+#include <cmath>
+#include <cstdlib>
+
+using namespace madness;
+
+// deterministic symmetric entries, identical on all processes
+double aij(int64_t i, int64_t j) {return std::sin(1.0+i+j) + std::cos(0.37*i*j) + ((i==j) ? 0.1*i : 0.0);}
+double bij(int64_t i, int64_t j) {return std::cos(0.11*(i+1)*(j+1));}
+
+int nfail = 0;
+
+void check(World& world, const char* what, double err, double tol) {
+    if (world.rank() == 0) {
+        print("    ", what, err, (err>tol) ? "FAILED" : "ok");
+    }
+    if (err > tol) ++nfail;
+}
+
+Tensor<double> replicated(const DistributedMatrix<double>& A) {
+    Tensor<double> t(A.coldim(),A.rowdim());
+    A.copy_to_replicated(t);
+    return t;
+}
+
+void test(World& world, int64_t n) {
+    if (world.rank() == 0) print("testing distributed linear algebra with n =", n);
+    DistributedMatrix<double> A = column_distributed_matrix<double>(world, n, n);
+    A.fill(aij);
+    const Tensor<double> a = replicated(A);
+
+    // gemm, also with a row distributed right factor and a transposed left factor
+    DistributedMatrix<double> B = row_distributed_matrix<double>(world, n, n+3);
+    B.fill(bij);
+    const Tensor<double> b = replicated(B);
+    check(world, "gemm             ", (replicated(gemm(A,B))-inner(a,b)).normf(), 1e-12*n*n);
+    check(world, "gemm transa      ", (replicated(gemm(A,B,true))-inner(transpose(a),b)).normf(), 1e-12*n*n);
+
+    // cholesky of a positive definite matrix
+    DistributedMatrix<double> S = gemm(A,A,true);
+    for (int64_t i=S.local_ilow(); i<=S.local_ihigh(); ++i) S.data()(i-S.local_ilow(),i) += 1.0;
+    const Tensor<double> s = replicated(S);
+    Tensor<double> u = copy(s);
+    cholesky(u);
+    DistributedMatrix<double> U = copy(S);
+    cholesky(U);
+    check(world, "cholesky         ", (replicated(U)-u).normf()/u.normf(), 1e-12);
+
+    // symmetric eigenproblem
+    Tensor<double> v, e;
+    syev(a, v, e);
+    DistributedMatrix<double> V;
+    Tensor<double> ee;
+    syev(A, V, ee);
+    const Tensor<double> vv = replicated(V);
+    const double anorm = a.normf();
+    Tensor<double> r = inner(a,vv);
+    for (int64_t k=0; k<n; ++k) r(_,k).gaxpy(1.0, vv(_,k), -ee(k));
+    Tensor<double> o = inner(transpose(vv),vv);
+    for (int64_t k=0; k<n; ++k) o(k,k) -= 1.0;
+    check(world, "syev eigenvalues ", (e-ee).absmax()/anorm, 1e-13);
+    check(world, "syev residual    ", r.normf()/anorm, 1e-12);
+    check(world, "syev orthogonal  ", o.normf(), 1e-12);
+
+    // generalized eigenproblem
+    Tensor<double> vg, eg;
+    sygv(a, s, 1, vg, eg);
+    DistributedMatrix<double> VG;
+    Tensor<double> eeg;
+    sygv(A, S, VG, eeg);
+    const Tensor<double> vvg = replicated(VG);
+    Tensor<double> og = inner(transpose(vvg),inner(s,vvg));
+    for (int64_t k=0; k<n; ++k) og(k,k) -= 1.0;
+    check(world, "sygv eigenvalues ", (eg-eeg).absmax()/std::max(1.0,eg.absmax()), 1e-10);
+    check(world, "sygv orthogonal  ", og.normf(), 1e-10);
+}
+
+void benchmark(World& world, int64_t n) {
+    if (world.rank() == 0) print("\nbenchmark with n =", n, "on", world.size(), "process(es)");
+    DistributedMatrix<double> A = column_distributed_matrix<double>(world, n, n);
+    A.fill(aij);
+    const Tensor<double> a = replicated(A);
+    DistributedMatrix<double> S = gemm(A,A,true);
+    for (int64_t i=S.local_ilow(); i<=S.local_ihigh(); ++i) S.data()(i-S.local_ilow(),i) += 1.0;
+    const Tensor<double> s = replicated(S);
+
+    double t0, t1;
+    world.gop.fence(); t0 = wall_time();
+    Tensor<double> c = inner(a,a);
+    t1 = wall_time() - t0;
+    world.gop.fence(); t0 = wall_time();
+    DistributedMatrix<double> C = gemm(A,A);
+    world.gop.fence();
+    if (world.rank() == 0) printf("    gemm      replicated %8.3fs   distributed %8.3fs\n", t1, wall_time()-t0);
+
+    Tensor<double> u = copy(s);
+    world.gop.fence(); t0 = wall_time();
+    cholesky(u);
+    t1 = wall_time() - t0;
+    DistributedMatrix<double> U = copy(S);
+    world.gop.fence(); t0 = wall_time();
+    cholesky(U);
+    world.gop.fence();
+    if (world.rank() == 0) printf("    cholesky  replicated %8.3fs   distributed %8.3fs\n", t1, wall_time()-t0);
+
+    Tensor<double> v, e;
+    world.gop.fence(); t0 = wall_time();
+    syev(a, v, e);
+    t1 = wall_time() - t0;
+    DistributedMatrix<double> V;
+    world.gop.fence(); t0 = wall_time();
+    syev(A, V, e);
+    world.gop.fence();
+    if (world.rank() == 0) printf("    syev      replicated %8.3fs   distributed %8.3fs\n", t1, wall_time()-t0);
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+    redirectio(world);
+
+    try {
+        const int64_t sizes[] = {1, 2, 7, 64, 151};
+        for (int64_t n : sizes) test(world, n);
+        benchmark(world, (argc > 1) ? std::atol(argv[1]) : 200);
+    }
+    catch (const SafeMPI::Exception& e) {
+        print(e);
+        error("caught an MPI exception");
+    }
+    catch (const madness::MadnessException& e) {
+        print(e);
+        error("caught a MADNESS exception");
+    }
+    catch (const madness::TensorException& e) {
+        print(e);
+        error("caught a Tensor exception");
+    }
+    catch (const std::exception& e) {
+        print(e.what());
+        error("caught an STL exception");
+    }
+
+    world.gop.fence();
+    finalize();
+    return nfail ? 1 : 0;
+}
@@ -35,7 +35,9 @@
 #include <madness/tensor/tensor.h>
 #include <madness/tensor/gentensor.h>
 #include <madness/tensor/lowranktensor.h>
+#include <madness/tensor/tensortrain.h>
 #include <madness/world/print.h>
+#include <madness/world/timers.h>
 
 #if defined USE_GENTENSOR && MADNESS_HAS_GOOGLE_TEST
 
@@ -364,6 +366,234 @@ namespace {
     	}
     }
 
+    // checks for randomized rank reduction and incremental QR addition
+    TEST_P(BinaryGenTest, RandomizedRankReduction) {
+    	try {
+    		const TensorArgs targs(eps,tt,RR_RANDOMIZED);
+
+    		// check for addition
+    		t0+=t1;
+    		g0+=g1;
+    		g0.reduce_rank(targs);
+    		ASSERT_LT((g0.full_tensor_copy()-t0).normf(),eps);
+
+    		// check for subtraction
+    		t0-=t1;
+    		g0-=g1;
+    		g0.reduce_rank(targs);
+    		ASSERT_LT((g0.full_tensor_copy()-t0).normf(),eps);
+
+    		// check for inplace stuff
+    		t0.gaxpy(-0.7, t1, 0.1);
+    		g0.gaxpy(-0.7, g1, 0.1);
+    		g0.reduce_rank(targs);
+    		ASSERT_LT((g0.full_tensor_copy()-t0).normf(),eps);
+
+    		// check for the incremental addition onto an orthonormal lhs
+    		g1=LowRankTensor<double>(t1,targs);
+    		t0+=t1;
+    		g0.add_SVD(g1,targs);
+    		ASSERT_LT((g0.full_tensor_copy()-t0).normf(),eps);
+
+    	} catch (const madness::TensorException& e) {
+    		if (dim.size() != 0) std::cout << e;
+    		EXPECT_EQ(dim.size(),0);
+    	} catch(...) {
+    		std::cout << "Caught unknown exception" << std::endl;
+    		EXPECT_EQ(1,0);
+    	}
+    }
+
+    /// a 6D SVD tensor with many redundant terms, as in the apply of 6D functions
+
+    /// the terms are linear combinations of a few basis vectors with decaying weights
+    LowRankTensor<double> prep_svd_tensor(const long k, const long rank, const long baserank) {
+    	const long kvec=k*k*k;
+    	Tensor<double> b0(baserank,kvec), b1(baserank,kvec);
+    	b0.fillrandom();
+    	b1.fillrandom();
+    	for (long r=0; r<baserank; ++r) b0(r,_).scale(exp(-0.5*r));
+    	Tensor<double> c0(rank,baserank), c1(rank,baserank);
+    	c0.fillrandom();
+    	c1.fillrandom();
+    	Tensor<double> v0=inner(c0,b0), v1=inner(c1,b1);
+    	Tensor<double> weights(rank);
+    	weights=1.0/rank;
+    	for (long r=0; r<rank; ++r) {
+    		weights(r)*=v0(r,_).normf()*v1(r,_).normf();
+    		v0(r,_).scale(1.0/v0(r,_).normf());
+    		v1(r,_).scale(1.0/v1(r,_).normf());
+    	}
+    	SVDTensor<double> sr(weights,v0,v1,6,k);
+    	return LowRankTensor<double>(sr);
+    }
+
+    // compare timings and accuracy of the deterministic and the randomized rank reduction
+    TEST(RankReductionTiming, RandomizedVsSVD) {
+    	const long k=8;
+    	const double thresh=1.e-4;
+    	LowRankTensor<double> g=prep_svd_tensor(k,400,30);
+    	const Tensor<double> ref=g.full_tensor_copy();
+
+    	LowRankTensor<double> g_svd=copy(g);
+    	double wall0=wall_time();
+    	g_svd.reduce_rank(TensorArgs(thresh,TT_2D,RR_SVD));
+    	double wall1=wall_time();
+    	LowRankTensor<double> g_rnd=copy(g);
+    	g_rnd.reduce_rank(TensorArgs(thresh,TT_2D,RR_RANDOMIZED));
+    	double wall2=wall_time();
+
+    	const double err_svd=(g_svd.full_tensor_copy()-ref).normf();
+    	const double err_rnd=(g_rnd.full_tensor_copy()-ref).normf();
+    	print("reduce_rank: rank, error, time (SVD)       ",g_svd.rank(),err_svd,wall1-wall0);
+    	print("reduce_rank: rank, error, time (randomized)",g_rnd.rank(),err_rnd,wall2-wall1);
+    	EXPECT_LT(err_svd,thresh);
+    	EXPECT_LT(err_rnd,thresh);
+    	EXPECT_LE(g_rnd.rank(),g_svd.rank()+8);
+
+    	// accumulate a few terms at a time, as in FunctionNode::accumulate
+    	LowRankTensor<double> a_svd=copy(g_svd), a_rnd=copy(g_svd);
+    	Tensor<double> aref=g_svd.full_tensor_copy();
+    	double time_svd=0.0, time_rnd=0.0;
+    	for (int i=0; i<20; ++i) {
+    		LowRankTensor<double> h=prep_svd_tensor(k,3,3);
+    		h.reduce_rank(TensorArgs(thresh,TT_2D,RR_SVD));
+    		aref+=h.full_tensor_copy();
+    		double wall3=wall_time();
+    		a_svd.add_SVD(h,TensorArgs(thresh,TT_2D,RR_SVD));
+    		double wall4=wall_time();
+    		a_rnd.add_SVD(h,TensorArgs(thresh,TT_2D,RR_RANDOMIZED));
+    		double wall5=wall_time();
+    		time_svd+=wall4-wall3;
+    		time_rnd+=wall5-wall4;
+    	}
+    	const double aerr_svd=(a_svd.full_tensor_copy()-aref).normf();
+    	const double aerr_rnd=(a_rnd.full_tensor_copy()-aref).normf();
+    	print("add_SVD: rank, error, time (SVD)           ",a_svd.rank(),aerr_svd,time_svd);
+    	print("add_SVD: rank, error, time (QR update)     ",a_rnd.rank(),aerr_rnd,time_rnd);
+    	EXPECT_LT(aerr_svd,thresh);
+    	EXPECT_LT(aerr_rnd,thresh);
+    }
+
+    // checks for the fused addition and truncation of TensorTrains
+    TEST_P(BinaryGenTest, FusedAddAndTruncate) {
+    	if (tt!=TT_TENSORTRAIN) return;
+    	try {
+    		TensorTrain<double> tt0(t0,eps), tt1(t1,eps);
+
+    		t0.gaxpy(-0.7, t1, 0.1);
+    		tt0.gaxpy_and_truncate(-0.7, tt1, 0.1, eps);
+    		ASSERT_LT((tt0.reconstruct()-t0).normf(),eps);
+
+    		// rhs is an alias of this
+    		t0.scale(2.0);
+    		tt0.gaxpy_and_truncate(1.0, tt0, 1.0, eps);
+    		ASSERT_LT((tt0.reconstruct()-t0).normf(),eps);
+
+    		// with an explicit workspace
+    		TTWorkspace<double> ws;
+    		t0+=t1;
+    		tt0.gaxpy_and_truncate(1.0, tt1, 1.0, eps, ws);
+    		ASSERT_LT((tt0.reconstruct()-t0).normf(),eps);
+
+    	} catch (const madness::TensorException& e) {
+    		if (dim.size() != 0) std::cout << e;
+    		EXPECT_EQ(dim.size(),0);
+    	} catch(...) {
+    		std::cout << "Caught unknown exception" << std::endl;
+    		EXPECT_EQ(1,0);
+    	}
+    }
+
+    /// a TT operator in tensor form as constructed by make_tt_representation
+
+    /// the cores are diagonal in the ranks and hold random (k2k,k2k) matrices,
+    /// the terms have decaying weights as the terms of a Gaussian expansion;
+    /// the result is normalized
+    TensorTrain<double> prep_tt_operator(const long ndim, const long k2k, const long rank) {
+    	std::vector<Tensor<double> > cores(ndim,Tensor<double>(rank,k2k*k2k,rank));
+    	cores[0]=Tensor<double>(k2k*k2k,rank);
+    	cores[ndim-1]=Tensor<double>(rank,k2k*k2k);
+    	for (long r=0; r<rank; ++r) {
+    		Tensor<double> m(k2k*k2k);
+    		m.fillrandom();
+    		cores[0](_,r)=m*exp(-0.3*r);
+    		for (long idim=1; idim<ndim-1; ++idim) {
+    			m.fillrandom();
+    			cores[idim](r,_,r)=m;
+    		}
+    		m.fillrandom();
+    		cores[ndim-1](r,_)=m;
+    	}
+    	TensorTrain<double> result(cores);
+    	result.scale(1.0/result.normf());
+    	return result;
+    }
+
+    /// return the norm of the difference of two TensorTrains
+    double tt_distance(const TensorTrain<double>& a, const TensorTrain<double>& b) {
+    	TensorTrain<double> diff=copy(a);
+    	diff-=b;
+    	return diff.normf();
+    }
+
+    // compare timings of the TT rounding with and without workspace reuse and
+    // fused addition, for the ranks and dimensions of the TT operators
+    TEST(TensorTrainTiming, WorkspaceAndFusedAddition) {
+    	const double thresh=1.e-4;
+    	for (long ndim : {4l,6l}) {
+    		for (long k2k : {12l,16l}) {
+    			for (long rank : {10l,30l}) {
+    				const int nrepeat=2;
+    				TensorTrain<double> a=prep_tt_operator(ndim,k2k,rank);
+    				TensorTrain<double> b=prep_tt_operator(ndim,k2k,rank);
+
+    				// truncation with a new and with a reused workspace
+    				double wall0=wall_time();
+    				for (int i=0; i<nrepeat; ++i) {
+    					TTWorkspace<double> ws;
+    					TensorTrain<double> c=copy(a);
+    					c.truncate(thresh,ws);
+    				}
+    				double wall1=wall_time();
+    				TTWorkspace<double> ws;
+    				TensorTrain<double> atrunc;
+    				for (int i=0; i<nrepeat; ++i) {
+    					atrunc=copy(a);
+    					atrunc.truncate(thresh,ws);
+    				}
+    				double wall2=wall_time();
+
+    				// addition with subsequent truncation and fused
+    				TensorTrain<double> sum_ref, sum_fused;
+    				for (int i=0; i<nrepeat; ++i) {
+    					sum_ref=copy(a);
+    					sum_ref.gaxpy(0.5,b,2.0);
+    					sum_ref.truncate(thresh,ws);
+    				}
+    				double wall3=wall_time();
+    				for (int i=0; i<nrepeat; ++i) {
+    					sum_fused=copy(a);
+    					sum_fused.gaxpy_and_truncate(0.5,b,2.0,thresh,ws);
+    				}
+    				double wall4=wall_time();
+
+    				TensorTrain<double> sum_exact=copy(a);
+    				sum_exact.gaxpy(0.5,b,2.0);
+    				const double err_trunc=tt_distance(atrunc,a);
+    				const double err_fused=tt_distance(sum_fused,sum_exact);
+    				print("ndim, k2k, rank",ndim,k2k,rank,"ranks",sum_ref.ranks(),sum_fused.ranks());
+    				print("  truncate: new/reused workspace   ",(wall1-wall0)/nrepeat,
+    						(wall2-wall1)/nrepeat,"error",err_trunc);
+    				print("  addition: gaxpy+truncate/fused   ",(wall3-wall2)/nrepeat,
+    						(wall4-wall3)/nrepeat,"error",err_fused);
+    				EXPECT_LT(err_trunc,thresh);
+    				EXPECT_LT(err_fused,thresh);
+    			}
+    		}
+    	}
+    }
+
     // checks for addition with slices
     TEST_P(BinaryGenTest, SliceAddition) {
         Tensor<double> t0_save=copy(t0);
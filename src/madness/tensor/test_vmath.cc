@@ -0,0 +1,226 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+
+  $Id$
+*/
+
+/// \file test_vmath.cc
+/// \brief Accuracy (in ulp) and throughput of the vector math routines against libm
+
+#include <madness/tensor/vmath.h>
+#include <madness/world/timers.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace madness;
+
+typedef void (*vfunT)(int, const double*, double*);
+typedef double (*sfunT)(double);
+
+double ran() {
+    static unsigned long seed = 76521;
+    seed = seed *1812433253 + 12345;
+    return ((double) (seed & 0x7fffffff)) * 4.6566128752458e-10;
+}
+
+/// distance of a from the reference b in units in the last place of b
+double ulp_error(const double a, const double b) {
+    if ((a==b) || (std::isnan(a) && std::isnan(b))) return 0.0;
+    if (std::isinf(b) || std::isnan(a) || std::isnan(b)) return 1.e300;
+    const double ulp=std::nextafter(std::fabs(b),HUGE_VAL)-std::fabs(b);
+    return std::fabs(a-b)/ulp;
+}
+
+double reldiff(const double a, const double b) {
+    if (a==b) return 0.0;
+    return std::fabs(a-b)/std::fabs(b);
+}
+
+/// throughput of a vector routine and of the libm loop in Mega-elements per second
+void throughput(const std::vector<double>& x, vfunT vf, sfunT sf, double& mvec, double& mlibm) {
+    const int n=x.size();
+    std::vector<double> y(n);
+    const int nrep=20;
+    double t0=wall_time();
+    for (int rep=0; rep<nrep; ++rep) vf(n,&x[0],&y[0]);
+    mvec=1.e-6*n*nrep/(wall_time()-t0);
+    t0=wall_time();
+    for (int rep=0; rep<nrep; ++rep) {
+        for (int i=0; i<n; ++i) y[i]=sf(x[i]);
+    }
+    mlibm=1.e-6*n*nrep/(wall_time()-t0);
+}
+
+/// compare a routine with libm on random arguments in [lo,hi]; return the number of failures
+int test_function(const char* name, vfunT vf, sfunT sf, const double lo, const double hi,
+        const double maxulp) {
+    const int n=100003;         // odd, to cover the remainder loop
+    std::vector<double> x(n), y(n);
+    for (int i=0; i<n; ++i) x[i]=lo+(hi-lo)*ran();
+    vf(n,&x[0],&y[0]);
+
+    double errmax=0.0, relmax=0.0;
+    for (int i=0; i<n; ++i) {
+        const double ref=sf(x[i]);
+        errmax=std::max(errmax,ulp_error(y[i],ref));
+        relmax=std::max(relmax,reldiff(y[i],ref));
+    }
+
+    // in place
+    std::vector<double> z(x);
+    vf(n,&z[0],&z[0]);
+    bool inplace=(z==y);
+
+    double mvec, mlibm;
+    throughput(x,vf,sf,mvec,mlibm);
+
+    const bool ok=(errmax<=maxulp) && (relmax<1.e-12) && inplace;
+    printf("%-8s [%9.2e,%9.2e]  max error %6.2f ulp  rel %8.1e  %8.1f Melem/s  libm %8.1f Melem/s  %s\n",
+            name,lo,hi,errmax,relmax,mvec,mlibm,ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/// special values must agree with libm
+int test_special(const char* name, vfunT vf, sfunT sf) {
+    const double x[]={0.0,-0.0,1.0,-1.0,0.5,-0.5,HUGE_VAL,-HUGE_VAL,NAN,1.e-320,1.e-310,
+                      710.0,-746.0,27.0,-27.0};
+    const int n=sizeof(x)/sizeof(double);
+    double y[n];
+    vf(n,x,y);
+    int nfail=0;
+    for (int i=0; i<n; ++i) {
+        const double ref=sf(x[i]);
+        const bool ok=(std::isnan(ref) && std::isnan(y[i])) || (reldiff(y[i],ref)<1.e-14)
+                || (std::fabs(ref)<2.3e-308 && std::fabs(y[i]-ref)<1.e-320);
+        if (!ok) {
+            printf("%-8s special value %g: %.17g expected %.17g  FAIL\n",name,x[i],y[i],ref);
+            nfail++;
+        }
+    }
+    return nfail;
+}
+
+double invsqrt(double x) {return 1.0/std::sqrt(x);}
+double cube(double x) {return std::pow(x,3.0);}
+double pow_m13(double x) {return std::pow(x,-1.0/3.0);}
+void vcube(int n, const double* x, double* y) {vdPowx(n,x,3.0,y);}
+void vpow_m13(int n, const double* x, double* y) {vdPowx(n,x,-1.0/3.0,y);}
+double sin_of(double x) {return std::sin(x);}
+double cos_of(double x) {return std::cos(x);}
+void vsin(int n, const double* x, double* y) {std::vector<double> c(n); vdSinCos(n,x,y,c.data());}
+void vcos(int n, const double* x, double* y) {std::vector<double> s(n); vdSinCos(n,x,s.data(),y);}
+double exp_of(double x) {return std::exp(x);}
+double erf_of(double x) {return std::erf(x);}
+double erfc_of(double x) {return std::erfc(x);}
+double sqrt_of(double x) {return std::sqrt(x);}
+double log_of(double x) {return std::log(x);}
+
+int test_complex_exp() {
+    const int n=10001;
+    std::vector<double_complex> x(n), y(n);
+    for (int i=0; i<n; ++i) x[i]=double_complex(-50.0+100.0*ran(),-1.e3+2.e3*ran());
+    vzExp(n,&x[0],&y[0]);
+    double errmax=0.0;
+    for (int i=0; i<n; ++i) errmax=std::max(errmax,std::abs(y[i]-std::exp(x[i]))/std::abs(std::exp(x[i])));
+    const bool ok=(errmax<1.e-14);
+    printf("%-8s max relative error %8.1e  %s\n","zexp",errmax,ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/// the tensor entry points and the unaryop adapter
+int test_tensor() {
+    Tensor<double> t(7,5,3);
+    t.fillrandom();
+    t-=0.5;
+    const Tensor<double> tt=t(_,Slice(0,-1,2),_);      // not contiguous
+    int nfail=0;
+
+    Tensor<double> r=verf(tt);
+    double err=0.0;
+    for (long i=0; i<tt.dim(0); ++i)
+        for (long j=0; j<tt.dim(1); ++j)
+            for (long k=0; k<tt.dim(2); ++k) err=std::max(err,reldiff(r(i,j,k),std::erf(tt(i,j,k))));
+    if (err>1.e-14) nfail++;
+
+    Tensor<double> u=copy(t);
+    const VMathUnaryOp<double> expop(vdExp);
+    expop(0,u);
+    u-=vexp(t);
+    if (u.normf()>1.e-14) nfail++;
+
+    Tensor<double> p=abs(t);
+    Tensor<double> q=vpow(p,vsqrt(p));
+    const VMathPowOp square(2.0);
+    square(0,p);
+    if ((vlog(vexp(p))-p).normf()>1.e-13) nfail++;
+    if (q.size()!=p.size()) nfail++;
+
+    Tensor<double_complex> c(7,5,3);
+    c.fillrandom();
+    Tensor<double_complex> ce=vexp(c);
+    err=0.0;
+    for (long i=0; i<c.size(); ++i) err=std::max(err,std::abs(ce.ptr()[i]-std::exp(c.ptr()[i])));
+    if (err>1.e-14) nfail++;
+
+    printf("%-8s %s\n","tensor",nfail ? "FAIL" : "ok");
+    return nfail;
+}
+
+int main(int argc, char** argv) {
+    int nfail=0;
+    printf("function range                     error (libm reference)      throughput\n");
+    nfail+=test_function("exp",vdExp,exp_of,-708.0,709.0,2.0);
+    nfail+=test_function("exp",vdExp,exp_of,-1.0,1.0,2.0);
+    nfail+=test_function("erf",vdErf,erf_of,-6.0,6.0,4.0);
+    nfail+=test_function("erf",vdErf,erf_of,-0.6,0.6,4.0);
+    nfail+=test_function("erfc",vdErfc,erfc_of,-6.0,26.0,8.0);
+    nfail+=test_function("sqrt",vdSqrt,sqrt_of,0.0,1.e6,1.0);
+    nfail+=test_function("invsqrt",vdInvSqrt,invsqrt,1.e-6,1.e6,2.0);
+    nfail+=test_function("log",vdLn,log_of,1.e-300,1.e300,2.0);
+    nfail+=test_function("log",vdLn,log_of,0.5,2.0,2.0);
+    // the error of pow is a few ulp times |b*log(a)|
+    nfail+=test_function("pow3",vcube,cube,-1.e3,1.e3,64.0);
+    nfail+=test_function("pow-1/3",vpow_m13,pow_m13,1.e-8,1.e8,64.0);
+    nfail+=test_function("sin",vsin,sin_of,-1.e5,1.e5,2.0);
+    nfail+=test_function("cos",vcos,cos_of,-1.e5,1.e5,2.0);
+
+    nfail+=test_special("exp",vdExp,exp_of);
+    nfail+=test_special("erf",vdErf,erf_of);
+    nfail+=test_special("erfc",vdErfc,erfc_of);
+    nfail+=test_special("log",vdLn,log_of);
+    nfail+=test_special("pow3",vcube,cube);
+
+    nfail+=test_complex_exp();
+    nfail+=test_tensor();
+
+    printf("%s\n", nfail ? "vmath: FAILED" : "vmath: all tests passed");
+    return nfail ? 1 : 0;
+}
@@ -38,6 +38,8 @@
 
 #include <complex>
 #include <cmath>
+#include <cstring>
+#include <limits>
 
 typedef std::complex<double> double_complex;
 
@@ -45,7 +47,316 @@ typedef std::complex<double> double_complex;
 #ifdef HAVE_MKL
 #include <mkl.h>
 
-#elif defined(HAVE_ACML)
+#else
+
+// The portable kernels are written as branch-free scalar functions of one
+// element; the drivers apply them to blocks of a fixed length, so that the
+// compiler vectorizes them to the full width of the instruction set. On
+// x86-64 Linux the drivers are cloned for AVX-512 and AVX2/FMA in addition to
+// the SSE2 baseline, and the dynamic loader selects the best clone for the CPU.
+// The kernels are forced inline into the clones, which compile them for their
+// instruction set.
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 6) && defined(__x86_64__) && defined(__linux__)
+#define MADNESS_VMATH_DISPATCH __attribute__((target_clones("arch=skylake-avx512","arch=haswell","default")))
+#define MADNESS_VMATH_INLINE inline __attribute__((always_inline))
+#else
+#define MADNESS_VMATH_DISPATCH
+#define MADNESS_VMATH_INLINE inline
+#endif
+
+namespace {
+
+    typedef unsigned long long bitsT;
+
+    const int VBLOCK=8;             ///< block length, one AVX-512 vector
+
+    /// 1.5*2^52: x+shifter rounds x to an integer held in the low bits of the mantissa
+    const double shifter=6755399441055744.0;
+
+    const double dbl_inf=std::numeric_limits<double>::infinity();
+    const double dbl_nan=std::numeric_limits<double>::quiet_NaN();
+
+    MADNESS_VMATH_INLINE bitsT as_bits(const double x) {
+        bitsT u;
+        std::memcpy(&u,&x,sizeof(u));
+        return u;
+    }
+
+    MADNESS_VMATH_INLINE double as_double(const bitsT u) {
+        double x;
+        std::memcpy(&x,&u,sizeof(x));
+        return x;
+    }
+
+    /// round to the nearest integer; |x|<2^51
+    MADNESS_VMATH_INLINE double round_small(const double x) {return (x+shifter)-shifter;}
+
+    /// 2^k for integer k in [-1022,1023]
+    MADNESS_VMATH_INLINE double pow2(const double k) {return as_double(as_bits(k+(shifter+1023.0))<<52);}
+
+    /// exp(x+xlo), where xlo carries bits of the argument beyond the precision of x
+    MADNESS_VMATH_INLINE double exp_kernel(double x, double xlo=0.0) {
+        const double log2e=1.4426950408889634074;
+        const double ln2hi=6.93147180369123816490e-01;    // 32 bits, k*ln2hi is exact
+        const double ln2lo=1.90821492927058770002e-10;
+
+        // clamp to the range where exp neither overflows nor underflows to zero; NaN passes
+        const double xs=x+xlo;
+        x=(xs<-745.2) ? -745.2 : x;
+        x=(xs>709.8) ? 709.8 : x;
+        xlo=((xs<-745.2) or (xs>709.8)) ? 0.0 : xlo;
+        const double k=round_small((x+xlo)*log2e);
+        const double r=((x-k*ln2hi)+xlo)-k*ln2lo;       // |r|<=ln2/2
+
+        // Taylor series to r^13, truncation error below 1e-17
+        double p=1.0/6227020800.0;
+        p=1.0/479001600.0+r*p;
+        p=1.0/39916800.0+r*p;
+        p=1.0/3628800.0+r*p;
+        p=1.0/362880.0+r*p;
+        p=1.0/40320.0+r*p;
+        p=1.0/5040.0+r*p;
+        p=1.0/720.0+r*p;
+        p=1.0/120.0+r*p;
+        p=1.0/24.0+r*p;
+        p=1.0/6.0+r*p;
+        p=0.5+r*p;
+        p=1.0+r*p;
+        p=1.0+r*p;
+
+        // scale by 2^k in two steps, so that overflow and gradual underflow are exact
+        const double k1=round_small(0.5*k-0.25);
+        return (p*pow2(k1))*pow2(k-k1);
+    }
+
+    /// natural logarithm after fdlibm
+    MADNESS_VMATH_INLINE double log_kernel(const double x) {
+        const double ln2hi=6.93147180369123816490e-01;
+        const double ln2lo=1.90821492927058770002e-10;
+        const double Lg1=6.666666666666735130e-01, Lg2=3.999999999940941908e-01;
+        const double Lg3=2.857142874366239149e-01, Lg4=2.222219843214978396e-01;
+        const double Lg5=1.818357216161805012e-01, Lg6=1.531383769920937332e-01;
+        const double Lg7=1.479819860511658591e-01;
+
+        // x = 2^e m with m in [sqrt(1/2),sqrt(2)); subnormals are scaled by 2^54 first
+        const bool sub=(x<2.2250738585072014e-308);
+        const bitsT u=as_bits(sub ? x*18014398509481984.0 : x);
+        double e=as_double((u>>52) | 0x4330000000000000ULL)-4503599627370496.0-(sub ? 1077.0 : 1023.0);
+        double m=as_double((u & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+        const bool big=(m>1.4142135623730951);
+        m=big ? 0.5*m : m;
+        e=big ? e+1.0 : e;
+
+        const double f=m-1.0;
+        const double s=f/(2.0+f);
+        const double z=s*s;
+        const double w=z*z;
+        const double R=z*(Lg1+w*(Lg3+w*(Lg5+w*Lg7)))+w*(Lg2+w*(Lg4+w*Lg6));
+        const double hfsq=0.5*f*f;
+        double y=e*ln2hi-((hfsq-(s*(hfsq+R)+e*ln2lo))-f);
+
+        y=(x<dbl_inf) ? y : x+x;        // +inf and NaN
+        y=(x==0.0) ? -dbl_inf : y;
+        y=(x<0.0) ? dbl_nan : y;
+        return y;
+    }
+
+    /// erfc(z) for z>=0 from a Chebyshev fit of log(erfc(z)/t)+z^2 in t=2/(2+z), as in Numerical Recipes (3rd ed.)
+    MADNESS_VMATH_INLINE double erfc_positive(double z) {
+        const double cof[28] = {-1.3026537197817094,  6.4196979235649026e-1,
+             1.9476473204185836e-2, -9.5615147868086316e-3, -9.4659534448203698e-4,
+             3.6683949785276161e-4,  4.2523324806907627e-5, -2.0278578112534185e-5,
+            -1.6242900046470386e-6,  1.3036558355805389e-6,  1.5626441722100225e-8,
+            -8.5238095915104485e-8,  6.5290544394569754e-9,  5.0593434952248516e-9,
+            -9.9136415630785533e-10,-2.2736512230456599e-10, 9.6467910809050830e-11,
+             2.3940384277863075e-12,-6.8860278471059161e-12, 8.9448807085237836e-13,
+             3.1309216395707107e-13,-1.1270835718717176e-13, 3.8138762981088092e-16,
+             7.1057070817615031e-15,-1.5228486874296898e-15,-9.4644344444949624e-17,
+             1.2091673148861837e-16,-2.7672092048347530e-17};
+
+        z=(z>30.0) ? 30.0 : z;          // erfc underflows beyond 27.3
+        const double t=2.0/(2.0+z);
+        const double ty=4.0*t-2.0;
+        double d=0.0, dd=0.0;
+#pragma GCC unroll 27
+        for (int j=27; j>0; --j) {
+            const double tmp=d;
+            d=ty*d-dd+cof[j];
+            dd=tmp;
+        }
+        // -z^2 in two parts, exact to the last bit of the exponent of erfc
+        const double zh=as_double(as_bits(z) & 0xfffffffff8000000ULL);
+        const double zl=z-zh;
+        return t*exp_kernel(-zh*zh,-zl*(z+zh)+(0.5*(cof[0]+ty*d)-dd));
+    }
+
+    /// erf(x) for |x|<0.5 from its Taylor series to x^27
+    MADNESS_VMATH_INLINE double erf_small(const double x) {
+        const double z=x*x;
+        double p=-1.0/(6227020800.0*27.0);
+        p=1.0/(479001600.0*25.0)+z*p;
+        p=-1.0/(39916800.0*23.0)+z*p;
+        p=1.0/(3628800.0*21.0)+z*p;
+        p=-1.0/(362880.0*19.0)+z*p;
+        p=1.0/(40320.0*17.0)+z*p;
+        p=-1.0/(5040.0*15.0)+z*p;
+        p=1.0/(720.0*13.0)+z*p;
+        p=-1.0/(120.0*11.0)+z*p;
+        p=1.0/(24.0*9.0)+z*p;
+        p=-1.0/(6.0*7.0)+z*p;
+        p=1.0/(2.0*5.0)+z*p;
+        p=-1.0/3.0+z*p;
+        p=1.0+z*p;
+        return 1.1283791670955126*x*p;
+    }
+
+    MADNESS_VMATH_INLINE double erf_kernel(const double x) {
+        const double ax=std::fabs(x);
+        const double large=1.0-erfc_positive(ax);
+        const double y=(ax<0.5) ? erf_small(x) : ((x<0.0) ? -large : large);
+        return y;
+    }
+
+    MADNESS_VMATH_INLINE double erfc_kernel(const double x) {
+        const double y=erfc_positive(std::fabs(x));
+        return (x<0.0) ? 2.0-y : y;
+    }
+
+    /// true if x is an integer
+    MADNESS_VMATH_INLINE bool is_integer(const double x) {
+        return (std::fabs(x)>=4503599627370496.0) or (round_small(x)==x);
+    }
+
+    /// a^b for real a and b
+    MADNESS_VMATH_INLINE double pow_kernel(const double a, const double b) {
+        // the error of b*log(a) is amplified by |b*log(a)|, which is at most
+        // 745 for finite nonzero results
+        double y=exp_kernel(b*log_kernel(std::fabs(a)));
+        const bool odd=is_integer(b) and not is_integer(0.5*b);
+        y=(a<0.0) ? (is_integer(b) ? (odd ? -y : y) : dbl_nan) : y;
+        y=((b==0.0) or (a==1.0)) ? 1.0 : y;
+        return y;
+    }
+
+    /// sin and cos after fdlibm; |x| < 1.6e6
+    MADNESS_VMATH_INLINE void sincos_kernel(const double x, double& sinx, double& cosx) {
+        const double two_over_pi=6.36619772367581382433e-01;
+        const double pio2_1=1.57079632673412561417e+00;   // 33 bits each, n*pio2_i is exact
+        const double pio2_2=6.07710050630396597660e-11;
+        const double pio2_3=2.02226624871116645580e-21;
+        const double S1=-1.66666666666666324348e-01, S2=8.33333333332248946124e-03;
+        const double S3=-1.98412698298579493134e-04, S4=2.75573137070700676789e-06;
+        const double S5=-2.50507602534068634195e-08, S6=1.58969099521155010221e-10;
+        const double C1=4.16666666666666019037e-02, C2=-1.38888888888741095749e-03;
+        const double C3=2.48015872894767294178e-05, C4=-2.75573143513906633035e-07;
+        const double C5=2.08757232129817482790e-09, C6=-1.13596475577881948265e-11;
+
+        const double n=round_small(x*two_over_pi);
+        const double q=n-4.0*round_small(0.25*n-0.375);     // n mod 4
+        const double r=((x-n*pio2_1)-n*pio2_2)-n*pio2_3;
+
+        const double z=r*r;
+        const double s=r+r*z*(S1+z*(S2+z*(S3+z*(S4+z*(S5+z*S6)))));
+        const double hz=0.5*z;
+        const double w=1.0-hz;
+        const double c=w+(((1.0-w)-hz)+z*z*(C1+z*(C2+z*(C3+z*(C4+z*(C5+z*C6))))));
+
+        const bool odd=(q==1.0) | (q==3.0);
+        const double ss=odd ? c : s;
+        const double cc=odd ? s : c;
+        sinx=(q>=2.0) ? -ss : ss;
+        cosx=((q==1.0) | (q==2.0)) ? -cc : cc;
+    }
+
+    /// y[i]=op(x[i]); x and y may alias
+    template <typename opT>
+    MADNESS_VMATH_INLINE void map1(const int n, const double* x, double* y, const opT& op) {
+        int i=0;
+        for (; i+VBLOCK<=n; i+=VBLOCK) {
+            double xb[VBLOCK], yb[VBLOCK];
+            for (int j=0; j<VBLOCK; ++j) xb[j]=x[i+j];
+            for (int j=0; j<VBLOCK; ++j) yb[j]=op(xb[j]);
+            for (int j=0; j<VBLOCK; ++j) y[i+j]=yb[j];
+        }
+        for (; i<n; ++i) y[i]=op(x[i]);
+    }
+
+    /// y[i]=op(a[i],b[i]); a, b and y may alias
+    template <typename opT>
+    MADNESS_VMATH_INLINE void map2(const int n, const double* a, const double* b, double* y, const opT& op) {
+        int i=0;
+        for (; i+VBLOCK<=n; i+=VBLOCK) {
+            double ab[VBLOCK], bb[VBLOCK], yb[VBLOCK];
+            for (int j=0; j<VBLOCK; ++j) {
+                ab[j]=a[i+j];
+                bb[j]=b[i+j];
+            }
+            for (int j=0; j<VBLOCK; ++j) yb[j]=op(ab[j],bb[j]);
+            for (int j=0; j<VBLOCK; ++j) y[i+j]=yb[j];
+        }
+        for (; i<n; ++i) y[i]=op(a[i],b[i]);
+    }
+
+    struct exp_op {MADNESS_VMATH_INLINE double operator()(const double x) const {return exp_kernel(x);}};
+    struct erf_op {MADNESS_VMATH_INLINE double operator()(const double x) const {return erf_kernel(x);}};
+    struct erfc_op {MADNESS_VMATH_INLINE double operator()(const double x) const {return erfc_kernel(x);}};
+    struct sqrt_op {MADNESS_VMATH_INLINE double operator()(const double x) const {return std::sqrt(x);}};
+    struct invsqrt_op {MADNESS_VMATH_INLINE double operator()(const double x) const {return 1.0/std::sqrt(x);}};
+    struct log_op {MADNESS_VMATH_INLINE double operator()(const double x) const {return log_kernel(x);}};
+    struct pow_op {MADNESS_VMATH_INLINE double operator()(const double a, const double b) const {return pow_kernel(a,b);}};
+
+    struct powx_op {
+        double b;
+        powx_op(const double b) : b(b) {}
+        MADNESS_VMATH_INLINE double operator()(const double a) const {return pow_kernel(a,b);}
+    };
+
+    /// sin and cos of a block; arguments beyond the range of the reduction use libm
+    MADNESS_VMATH_INLINE void sincos_block(const int n, const double* x, double* sinx, double* cosx) {
+        for (int j=0; j<n; ++j) {
+            double s, c;
+            sincos_kernel(x[j],s,c);
+            sinx[j]=s;
+            cosx[j]=c;
+        }
+        for (int j=0; j<n; ++j) {
+            if (not (std::fabs(x[j])<1.5e6)) {
+                sinx[j]=std::sin(x[j]);
+                cosx[j]=std::cos(x[j]);
+            }
+        }
+    }
+
+    MADNESS_VMATH_INLINE void portable_sincos(const int n, const double* x, double* sinx, double* cosx) {
+        int i=0;
+        for (; i+VBLOCK<=n; i+=VBLOCK) {
+            double xb[VBLOCK], sb[VBLOCK], cb[VBLOCK];
+            for (int j=0; j<VBLOCK; ++j) xb[j]=x[i+j];
+            sincos_block(VBLOCK,xb,sb,cb);
+            for (int j=0; j<VBLOCK; ++j) {
+                sinx[i+j]=sb[j];
+                cosx[i+j]=cb[j];
+            }
+        }
+        if (i<n) sincos_block(n-i,x+i,sinx+i,cosx+i);
+    }
+
+    MADNESS_VMATH_INLINE void portable_zexp(const int n, const double_complex* x, double_complex* y) {
+        for (int i=0; i<n; i+=VBLOCK) {
+            const int nb=(n-i<VBLOCK) ? n-i : VBLOCK;
+            double re[VBLOCK], im[VBLOCK], sb[VBLOCK], cb[VBLOCK];
+            for (int j=0; j<nb; ++j) {
+                re[j]=x[i+j].real();
+                im[j]=x[i+j].imag();
+            }
+            sincos_block(nb,im,sb,cb);
+            for (int j=0; j<nb; ++j) re[j]=exp_kernel(re[j]);
+            for (int j=0; j<nb; ++j) y[i+j]=double_complex(re[j]*cb[j],re[j]*sb[j]);
+        }
+    }
+}
+
+#if defined(HAVE_ACML)
 #include <acml_mv.h>
 
 void vdSinCos(int n, const double* x, double* sinx, double* cosx) {
@@ -71,7 +382,7 @@ void vzExp(int n, const double_complex* x, double_complex* y) {
     vdExp(n, a, expa);
     vdSinCos(n, b, sinb, cosb);
     for (int i=0; i<n; ++i) {
-        y[i] = double_complex(a[i]*cosb[i],a[i]*sinb[i]);
+        y[i] = double_complex(expa[i]*cosb[i],expa[i]*sinb[i]);
     }
     delete[] cosb;
     delete[] sinb;
@@ -82,8 +393,56 @@ void vzExp(int n, const double_complex* x, double_complex* y) {
 
 #else
 
+MADNESS_VMATH_DISPATCH
+void vdSinCos(int n, const double* x, double* sinx, double* cosx) {
+    portable_sincos(n, x, sinx, cosx);
+}
+
+MADNESS_VMATH_DISPATCH
+void vdExp(int n, const double* x, double* y) {
+    map1(n, x, y, exp_op());
+}
+
+MADNESS_VMATH_DISPATCH
 void vzExp(int n, const double_complex* x, double_complex* y) {
-    for (int i=0; i<n; ++i) y[i] = exp(x[i]);
+    portable_zexp(n, x, y);
+}
+
+#endif
+
+MADNESS_VMATH_DISPATCH
+void vdErf(int n, const double* x, double* y) {
+    map1(n, x, y, erf_op());
+}
+
+MADNESS_VMATH_DISPATCH
+void vdErfc(int n, const double* x, double* y) {
+    map1(n, x, y, erfc_op());
+}
+
+MADNESS_VMATH_DISPATCH
+void vdSqrt(int n, const double* x, double* y) {
+    map1(n, x, y, sqrt_op());
+}
+
+MADNESS_VMATH_DISPATCH
+void vdInvSqrt(int n, const double* x, double* y) {
+    map1(n, x, y, invsqrt_op());
+}
+
+MADNESS_VMATH_DISPATCH
+void vdLn(int n, const double* x, double* y) {
+    map1(n, x, y, log_op());
+}
+
+MADNESS_VMATH_DISPATCH
+void vdPow(int n, const double* a, const double* b, double* y) {
+    map2(n, a, b, y, pow_op());
+}
+
+MADNESS_VMATH_DISPATCH
+void vdPowx(int n, const double* a, const double b, double* y) {
+    map1(n, a, y, powx_op(b));
 }
 
 #endif
@@ -33,14 +33,155 @@
 #ifndef MADNESS_TENSOR_VMATH_H__INCLUDED
 #define MADNESS_TENSOR_VMATH_H__INCLUDED
 
+/// \file vmath.h
+/// \brief Elementwise vector math on arrays and tensors
+
+/// We adopt the interface of the Intel MKL vector math library (VML). If
+/// MKL is not used the routines are provided by vmath.cc, on top of ACML
+/// where it has them. The portable kernels are branch-free polynomial
+/// approximations that the compiler vectorizes; on x86-64 they are compiled
+/// for SSE2, AVX2 and AVX-512 and the best version is selected at run time.
+/// Their relative error is a few ulp (pow: a few ulp times |b*ln(a)|, which
+/// is bounded by 745 for finite nonzero results) in the range of normal
+/// results, and the arguments may alias the results.
+
 #include <madness/madness_config.h>
+#include <madness/tensor/tensor.h>
 
 #ifdef HAVE_MKL
 #include <mkl.h>
 
-#elif defined(HAVE_ACML)
+#else
+void vdExp(int n, const double* x, double* y);
+void vdErf(int n, const double* x, double* y);
+void vdErfc(int n, const double* x, double* y);
+void vdSqrt(int n, const double* x, double* y);
+void vdInvSqrt(int n, const double* x, double* y);
+void vdLn(int n, const double* x, double* y);
+void vdPow(int n, const double* a, const double* b, double* y);
+void vdPowx(int n, const double* a, const double b, double* y);
+void vdSinCos(int n, const double* x, double* sinx, double* cosx);
 void vzExp(int n, const double_complex* x, double_complex* y);
 #endif
 
-#endif // MADNESS_TENSOR_VMATH_H__INCLUDED
+namespace madness {
+
+    namespace detail {
+
+        /// apply an array function of the vector math library to a tensor, returning a new tensor
+        template <typename T, typename fnT>
+        Tensor<T> vmath_apply(const Tensor<T>& t, const fnT& fn) {
+            Tensor<T> result;
+            if (t.size()==0) return result;
+            if (t.iscontiguous()) {
+                result=Tensor<T>(t.ndim(),t.dims(),false);
+                fn(int(t.size()),t.ptr(),result.ptr());
+            } else {
+                result=copy(t);
+                fn(int(t.size()),result.ptr(),result.ptr());
+            }
+            return result;
+        }
+
+        /// apply an array function of the vector math library to a tensor in place
+        template <typename T, typename fnT>
+        void vmath_inplace(Tensor<T>& t, const fnT& fn) {
+            if (t.size()==0) return;
+            if (t.iscontiguous()) {
+                fn(int(t.size()),t.ptr(),t.ptr());
+            } else {
+                t=vmath_apply(t,fn);
+            }
+        }
+
+        /// complex exp with the argument types of the std::complex tensors
+        inline void vmath_zexp(int n, const double_complex* x, double_complex* y) {
+#ifdef HAVE_MKL
+            vzExp(n,reinterpret_cast<const MKL_Complex16*>(x),reinterpret_cast<MKL_Complex16*>(y));
+#else
+            vzExp(n,x,y);
+#endif
+        }
+
+        struct vmath_powx {
+            double b;
+            vmath_powx(const double b) : b(b) {}
+            void operator()(int n, const double* x, double* y) const {vdPowx(n,x,b,y);}
+        };
+    }
+
+    /// elementwise exp(t)
+    inline Tensor<double> vexp(const Tensor<double>& t) {return detail::vmath_apply(t,vdExp);}
+
+    /// elementwise exp(t)
+    inline Tensor<double_complex> vexp(const Tensor<double_complex>& t) {return detail::vmath_apply(t,detail::vmath_zexp);}
+
+    /// elementwise erf(t)
+    inline Tensor<double> verf(const Tensor<double>& t) {return detail::vmath_apply(t,vdErf);}
+
+    /// elementwise erfc(t)
+    inline Tensor<double> verfc(const Tensor<double>& t) {return detail::vmath_apply(t,vdErfc);}
+
+    /// elementwise sqrt(t)
+    inline Tensor<double> vsqrt(const Tensor<double>& t) {return detail::vmath_apply(t,vdSqrt);}
+
+    /// elementwise 1/sqrt(t)
+    inline Tensor<double> vinvsqrt(const Tensor<double>& t) {return detail::vmath_apply(t,vdInvSqrt);}
 
+    /// elementwise log(t)
+    inline Tensor<double> vlog(const Tensor<double>& t) {return detail::vmath_apply(t,vdLn);}
+
+    /// elementwise pow(t,b)
+    inline Tensor<double> vpow(const Tensor<double>& t, const double b) {
+        return detail::vmath_apply(t,detail::vmath_powx(b));
+    }
+
+    /// elementwise pow(a,b) of two tensors of the same shape
+    inline Tensor<double> vpow(const Tensor<double>& a, const Tensor<double>& b) {
+        MADNESS_ASSERT(a.conforms(b));
+        const Tensor<double> bb=b.iscontiguous() ? b : copy(b);
+        Tensor<double> result=copy(a);
+        if (result.size()) vdPow(int(result.size()),result.ptr(),bb.ptr(),result.ptr());
+        return result;
+    }
+
+    /// Adapter for Function::unaryop that applies an array function of the vector math library to the values
+
+    /// e.g. \c f.unaryop(VMathUnaryOp<double>(vdErf)) replaces f(x) by erf(f(x)).
+    template <typename T>
+    class VMathUnaryOp {
+    public:
+        typedef void (*fnT)(int, const T*, T*);
+
+        VMathUnaryOp(fnT fn) : fn(fn) {}
+
+        template <typename keyT>
+        void operator()(const keyT& key, Tensor<T>& t) const {
+            detail::vmath_inplace(t,fn);
+        }
+
+        template <typename Archive> void serialize(Archive& ar) {}
+
+    private:
+        fnT fn;
+    };
+
+    /// Adapter for Function::unaryop that replaces the values by their power b
+    class VMathPowOp {
+    public:
+        VMathPowOp(const double b) : b(b) {}
+
+        template <typename keyT>
+        void operator()(const keyT& key, Tensor<double>& t) const {
+            detail::vmath_inplace(t,detail::vmath_powx(b));
+        }
+
+        template <typename Archive> void serialize(Archive& ar) {ar & b;}
+
+    private:
+        double b;
+    };
+
+}
+
+#endif // MADNESS_TENSOR_VMATH_H__INCLUDED
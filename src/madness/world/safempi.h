@@ -596,6 +596,26 @@ namespace SafeMPI {
             return Intracomm(std::shared_ptr<Impl>(new Impl(group_comm, me, nproc, true)));
         }
 
+        /**
+         * This collective operation partitions this \c Intracomm into
+         * disjoint communicators, one for each value of \c color . Must be
+         * called by all processes that belong to this communicator.
+         *
+         * @param color processes with the same color end up in the same communicator
+         * @param key determines the rank order in the new communicator; ties
+         *   are broken by the rank in this communicator
+         * @return a new Intracomm object
+         */
+        Intracomm Split(int color, int key = 0) const {
+            MADNESS_ASSERT(pimpl);
+            SAFE_MPI_GLOBAL_MUTEX;
+            MPI_Comm group_comm;
+            MADNESS_MPI_TEST(MPI_Comm_split(pimpl->comm, color, key, &group_comm));
+            int me; MADNESS_MPI_TEST(MPI_Comm_rank(group_comm, &me));
+            int nproc; MADNESS_MPI_TEST(MPI_Comm_size(group_comm, &nproc));
+            return Intracomm(std::shared_ptr<Impl>(new Impl(group_comm, me, nproc, true)));
+        }
+
         /**
          * Clones this Intracomm object
          *
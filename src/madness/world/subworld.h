@@ -0,0 +1,147 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_SUBWORLD_H__INCLUDED
+#define MADNESS_WORLD_SUBWORLD_H__INCLUDED
+
+/// \file subworld.h
+/// \brief Split a world into subworlds that run independent computations
+
+#include <madness/world/MADworld.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace madness {
+
+    /// Partition of a world into disjoint subworlds
+
+    /// The processes of the universe are split into contiguous blocks, each
+    /// of which forms a new World on its own communicator. Independent
+    /// computations (displacements of a finite-difference Hessian,
+    /// frequencies of a response calculation, ...) can then run
+    /// concurrently, one per subworld, and their results are gathered in the
+    /// universe.
+    ///
+    /// Construction and destruction are collective over the universe. Every
+    /// process belongs to exactly one subworld. WorldObjects living in a
+    /// subworld must be destroyed before the Subworlds object.
+    class Subworlds : private NO_DEFAULTS {
+        World& universe_;
+        int nsubworld_;
+        int color_;
+        std::vector<ProcessID> roots_;      ///< universe rank of rank 0 of each subworld
+        std::shared_ptr<World> subworld_;
+
+    public:
+
+        /// split the universe into nsubworld subworlds
+
+        /// The number of subworlds is limited to the number of processes.
+        /// @param[in]  universe    the world to split
+        /// @param[in]  nsubworld   the requested number of subworlds
+        Subworlds(World& universe, const int nsubworld)
+            : universe_(universe)
+            , nsubworld_(std::max(1,std::min(nsubworld,universe.size())))
+            , color_(color_of(universe.rank()))
+            , roots_(nsubworld_) {
+
+            for (int c=0; c<nsubworld_; ++c) {
+                ProcessID p=0;
+                while (color_of(p)!=c) ++p;
+                roots_[c]=p;
+            }
+            universe_.gop.fence();
+            subworld_.reset(new World(universe_.mpi.comm().Split(color_,universe_.rank())));
+            universe_.gop.fence();
+        }
+
+        ~Subworlds() {
+            subworld_->gop.fence();
+            subworld_.reset();
+            universe_.gop.fence();
+        }
+
+        /// the world that was split
+        World& universe() const {return universe_;}
+
+        /// the subworld of this process
+        World& subworld() const {return *subworld_;}
+
+        /// the number of subworlds
+        int size() const {return nsubworld_;}
+
+        /// the subworld of this process
+        int color() const {return color_;}
+
+        /// the subworld of a process of the universe
+        int color_of(const ProcessID p) const {
+            return int((long(p)*nsubworld_)/universe_.size());
+        }
+
+        /// the universe rank of rank 0 of a subworld
+        ProcessID root(const int color) const {return roots_[color];}
+
+        /// the universe ranks of the members of a subworld, in the order of their subworld ranks
+        std::vector<ProcessID> universe_ranks(const int color) const {
+            std::vector<ProcessID> ranks;
+            for (ProcessID p=0; p<universe_.size(); ++p) {
+                if (color_of(p)==color) ranks.push_back(p);
+            }
+            return ranks;
+        }
+
+        /// run independent computations on the subworlds and gather the results
+
+        /// Computation i runs as op(subworld,i) on subworld i%size(); it is
+        /// collective over that subworld and must return the same result on
+        /// all of its processes. Collective over the universe.
+        /// @param[in]  n   the number of computations
+        /// @param[in]  op  op(World&, std::size_t) returns a serializable resultT
+        /// @return the results of all computations, on all processes of the universe
+        template <typename resultT, typename opT>
+        std::vector<resultT> map(const std::size_t n, const opT& op) const {
+            std::vector<resultT> results(n);
+            for (std::size_t i=color_; i<n; i+=nsubworld_) {
+                results[i]=op(*subworld_,i);
+                subworld_->gop.fence();
+            }
+            universe_.gop.fence();
+            for (std::size_t i=0; i<n; ++i) {
+                universe_.gop.broadcast_serializable(results[i],root(i%nsubworld_));
+            }
+            return results;
+        }
+    };
+
+}
+
+#endif // MADNESS_WORLD_SUBWORLD_H__INCLUDED